@@ -1,54 +1,383 @@
 /**
  * Music subsystem implementation using libopenmpt + Sokol Audio
  *
- * Thread-safety: Position values are updated atomically in the audio callback
- * and can be read safely from any thread (for DIS synchronization).
+ * Thread-safety: The position is published by the audio callback as one
+ * seqlock-protected snapshot, so readers on any thread never see a torn
+ * order/row pair (for DIS synchronization).
+ *
+ * Offline mode skips Sokol Audio and runs the same render path from
+ * music_render_offline() on the caller's thread.
+ *
+ * Audible clock: each callback is timestamped on a monotonic clock and
+ * rendered in MUSIC_CLOCK_STEP sub-blocks, recording row starts in a
+ * small ring. Readers extrapolate from the last callback, subtract the
+ * output buffer latency and look the audible sample up in the ring, so
+ * sync no longer lags the speakers by a buffer or moves in block steps.
+ *
+ * Sync index: built (or read from MODULE.sync) at load, it maps every
+ * order/row to its song time and lists the Zxx sync codes, so DIS code
+ * queries are table lookups. Only the main thread touches it.
+ *
+ * Async loading reads, parses and indexes a module on a worker thread;
+ * music_load_commit() swaps it in on the main thread after parking the
+ * audio callback, so modules can change while the device keeps running.
+ *
+ * Web builds with SR_AUDIO_WORKLET render in a Wasm Audio Worklet instead
+ * of Sokol Audio's main-thread ScriptProcessor: the worklet shares the
+ * wasm memory (SharedArrayBuffer), so the same atomics carry the position
+ * back and the main thread never pays for rendering. The worklet scope
+ * has no clock, so blocks are not timestamped and the audible position
+ * is the rendered position minus the context's output latency; with
+ * 128-frame render quanta that is already fine-grained.
+ *
+ * PCM cache mode (music_set_pcm_cache(), or SR_MUSIC_PCM=1) renders the
+ * song once into MODULE.pcm and then plays it from the mapped file, so
+ * the callback only converts samples. The cache's per-step timeline holds
+ * what libopenmpt reported after each MUSIC_CLOCK_STEP, so the position
+ * snapshot and the audible ring see the same rows as live rendering.
  */
 
 #include "music.h"
+#include "music_index.h"
+#include "music_pcm.h"
+#include "core/thread.h"
+#include "core/framecheck.h"
 #include "sokol_log.h"
 #include "sokol_audio.h"
 #include <libopenmpt/libopenmpt.h>
+#if defined(SR_AUDIO_WORKLET)
+#include <emscripten.h>
+#include <emscripten/webaudio.h>
+#endif
 #include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 /* Audio configuration */
 #define MUSIC_SAMPLE_RATE 48000
 #define MUSIC_NUM_CHANNELS 2
+#define MUSIC_BUFFER_FRAMES 2048
+#define MUSIC_PACKET_FRAMES 512
+
+/* Row detection granularity inside a callback (~2.7 ms at 48 kHz) */
+#define MUSIC_CLOCK_STEP 128
+
+/* Web Audio render quantum */
+#define MUSIC_WORKLET_QUANTUM 128
+
+/* Audio worklet thread stack (libopenmpt mixing runs on it) */
+#define MUSIC_WORKLET_STACK (256 * 1024)
+
+/* Row starts kept for the audible lookup; must cover the output latency */
+#define MUSIC_ROW_RING 16
+
+/* Row start in the audible ring; relaxed atomics under position_seq */
+typedef struct {
+    atomic_int order;
+    atomic_int pattern;
+    atomic_int row;
+    atomic_int speed;
+    atomic_ullong start_sample;
+    atomic_ullong tick_samples;         /* Bit pattern of a double */
+} music_row_entry_t;
+
+/* A parsed module with its caches, between loading and installing */
+typedef struct {
+    openmpt_module *mod;
+    music_index_t index;
+    bool index_valid;
+    music_pcm_t pcm;
+    bool pcm_valid;
+} music_loaded_t;
 
 /* Internal state */
 static struct {
     openmpt_module *mod;
     bool initialized;
+    bool offline;       /* No audio device, rendered by music_render_offline() */
     atomic_bool playing;
 
-    /* Atomic position tracking for thread-safe DIS queries */
-    atomic_int current_order;
-    atomic_int current_pattern;
-    atomic_int current_row;
-    atomic_int position_seconds_x1000; /* Fixed-point: seconds * 1000 */
+    /* Position snapshot for DIS queries. Odd position_seq means a write is
+     * in progress. Fields are relaxed atomics ordered by the sequence. */
+    atomic_uint position_seq;
+    atomic_int position_order;
+    atomic_int position_pattern;
+    atomic_int position_row;
+    atomic_int position_tick;
+    atomic_ullong position_seconds;     /* Bit pattern of a double */
+    atomic_ullong position_samples;
+
+    /* Audible clock anchor: callback time and first sample of its block */
+    atomic_ullong clock_time_ns;
+    atomic_ullong clock_sample;
+    atomic_uint row_count;              /* Row starts written since reset */
+    music_row_entry_t rows[MUSIC_ROW_RING];
+    int latency_frames;                 /* Output buffer, 0 when offline */
+
+    music_index_t index;
+    bool index_valid;
+
+    /* PCM cache: requested for the next load, and installed with mod */
+    bool pcm_enabled;
+    music_pcm_t pcm;
+    bool pcm_valid;
+    uint64_t pcm_pos;                   /* Next song frame, audio thread */
+
+    /* Set by the audio callback while it may touch mod (see stop_rendering) */
+    atomic_bool render_busy;
+
+    /* Background load request (one at a time, main thread owns it) */
+    struct {
+        bool active;
+        bool joined;
+        bool notified;
+        char *path;
+        music_load_fn callback;
+        void *user_data;
+        thread_t thread;
+        bool pcm;                       /* PCM cache mode when requested */
+        atomic_int state;               /* music_load_state_t, set by the worker */
+        music_loaded_t loaded;          /* Result, valid once READY */
+    } async;
+
+    /* Render path state for tick estimation (seeks reset it) */
+    uint64_t samples_rendered;
+    uint64_t row_start_sample;
+    int last_order;
+    int last_row;
+
+#if defined(SR_PROFILE)
+    _Atomic(music_render_hook_fn) render_hook;
+#endif
 } music_state;
 
+/* Monotonic clock for the audible position, in nanoseconds */
+static uint64_t music_clock_ns(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static double bits_to_double(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static uint64_t double_to_bits(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+/* Row start recorded with a snapshot (NULL when the row did not change) */
+typedef struct {
+    int speed;
+    uint64_t start_sample;
+    double tick_samples;
+} music_row_start_t;
+
 /**
- * Audio callback - called by Sokol Audio from audio thread.
- * Renders audio and updates position atomically.
+ * Publish a position snapshot.
+ * The audio thread is the usual writer; seeks from the main thread take
+ * the same sequence, so concurrent writers serialize on the odd count.
  */
-static void music_audio_callback(float *buffer, int num_frames, int num_channels) {
-    if (!music_state.mod || !atomic_load(&music_state.playing)) {
+static void publish_position(int order, int pattern, int row, int tick,
+                             double seconds, uint64_t samples,
+                             uint64_t clock_time_ns, uint64_t clock_sample,
+                             const music_row_start_t *row_start) {
+    unsigned seq = atomic_load_explicit(&music_state.position_seq, memory_order_relaxed);
+    for (;;) {
+        if ((seq & 1) == 0 &&
+            atomic_compare_exchange_weak_explicit(&music_state.position_seq, &seq, seq + 1,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+        seq = atomic_load_explicit(&music_state.position_seq, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&music_state.position_order, order, memory_order_relaxed);
+    atomic_store_explicit(&music_state.position_pattern, pattern, memory_order_relaxed);
+    atomic_store_explicit(&music_state.position_row, row, memory_order_relaxed);
+    atomic_store_explicit(&music_state.position_tick, tick, memory_order_relaxed);
+    atomic_store_explicit(&music_state.position_seconds, double_to_bits(seconds), memory_order_relaxed);
+    atomic_store_explicit(&music_state.position_samples, samples, memory_order_relaxed);
+    atomic_store_explicit(&music_state.clock_time_ns, clock_time_ns, memory_order_relaxed);
+    atomic_store_explicit(&music_state.clock_sample, clock_sample, memory_order_relaxed);
+
+    if (row_start) {
+        unsigned n = atomic_load_explicit(&music_state.row_count, memory_order_relaxed);
+        music_row_entry_t *e = &music_state.rows[n % MUSIC_ROW_RING];
+        atomic_store_explicit(&e->order, order, memory_order_relaxed);
+        atomic_store_explicit(&e->pattern, pattern, memory_order_relaxed);
+        atomic_store_explicit(&e->row, row, memory_order_relaxed);
+        atomic_store_explicit(&e->speed, row_start->speed, memory_order_relaxed);
+        atomic_store_explicit(&e->start_sample, row_start->start_sample, memory_order_relaxed);
+        atomic_store_explicit(&e->tick_samples, double_to_bits(row_start->tick_samples),
+                              memory_order_relaxed);
+        atomic_store_explicit(&music_state.row_count, n + 1, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&music_state.position_seq, seq + 2, memory_order_release);
+}
+
+/* Reset the snapshot, the audible ring and the audio thread's tick tracking */
+static void reset_position(int order, int row) {
+    double seconds = music_get_row_time(order, row);
+    music_state.samples_rendered = 0;
+    music_state.row_start_sample = 0;
+    music_state.last_order = order;
+    music_state.last_row = row;
+    atomic_store_explicit(&music_state.row_count, 0, memory_order_relaxed);
+    publish_position(order, 0, row, 0, seconds > 0.0 ? seconds : 0.0, 0,
+                     music_clock_ns(), 0, NULL);
+}
+
+/* Tracker tick length in samples (2.5 / tempo seconds), 0 if unknown */
+static double current_tick_samples(void) {
+#if defined(OPENMPT_API_VERSION_AT_LEAST)
+#if OPENMPT_API_VERSION_AT_LEAST(0, 7, 0)
+    double tempo = openmpt_module_get_current_tempo2(music_state.mod);
+#else
+    double tempo = (double)openmpt_module_get_current_tempo(music_state.mod);
+#endif
+#else
+    double tempo = openmpt_module_get_current_tempo2(music_state.mod);
+#endif
+    return tempo > 0.0 ? MUSIC_SAMPLE_RATE * 2.5 / tempo : 0.0;
+}
+
+/* Estimate the tick within the current row: libopenmpt exposes row and
+ * speed but not the tick, so count samples since the row was first seen.
+ * Resolution is one render step. Fills row_start when the row changed. */
+static int estimate_tick(int order, int row, int speed, double tick_samples,
+                         uint64_t block_start, music_row_start_t *row_start,
+                         bool *row_changed) {
+    /* The first step after a reset records the starting row as well */
+    *row_changed = order != music_state.last_order || row != music_state.last_row ||
+                   atomic_load_explicit(&music_state.row_count, memory_order_relaxed) == 0;
+    if (*row_changed) {
+        music_state.last_order = order;
+        music_state.last_row = row;
+        music_state.row_start_sample = block_start;
+        row_start->speed = speed;
+        row_start->start_sample = block_start;
+        row_start->tick_samples = tick_samples;
+        return 0;
+    }
+
+    if (speed <= 0 || tick_samples <= 0.0) {
+        return 0;
+    }
+    int tick = (int)((double)(music_state.samples_rendered - music_state.row_start_sample) /
+                     tick_samples);
+    return tick < speed ? tick : speed - 1;
+}
+
+/* Convert cached PCM from the current song frame; returns frames read */
+static size_t read_pcm(float *buffer, size_t num_frames) {
+    const music_pcm_t *pcm = &music_state.pcm;
+    uint64_t pos = music_state.pcm_pos;
+    size_t available = pos < pcm->num_frames ? (size_t)(pcm->num_frames - pos) : 0;
+    if (num_frames > available) {
+        num_frames = available;
+    }
+    const int16_t *src = pcm->pcm + pos * 2;
+    for (size_t i = 0; i < num_frames * 2; i++) {
+        buffer[i] = (float)src[i] * (1.0f / 32768.0f);
+    }
+    music_state.pcm_pos = pos + num_frames;
+    return num_frames;
+}
+
+/**
+ * Render audio in MUSIC_CLOCK_STEP steps, publishing the position snapshot
+ * after each so row starts are known to within one step.
+ * @param time_ns Monotonic time the block was requested (audible anchor)
+ * @return Number of frames rendered from the module
+ */
+static size_t music_render(float *buffer, int num_frames, int num_channels, uint64_t time_ns) {
+    /* playing first: it guards mod against swaps (see stop_rendering) */
+    if (!atomic_load(&music_state.playing) || !music_state.mod) {
         /* Silence when not playing */
         memset(buffer, 0, (size_t)(num_frames * num_channels) * sizeof(float));
-        return;
+        return 0;
     }
 
-    /* Render audio */
-    size_t frames_rendered = openmpt_module_read_interleaved_float_stereo(
-        music_state.mod,
-        MUSIC_SAMPLE_RATE,
-        (size_t)num_frames,
-        buffer
-    );
+    uint64_t clock_sample = music_state.samples_rendered;
+    size_t frames_rendered = 0;
+    while (frames_rendered < (size_t)num_frames) {
+        size_t step = (size_t)num_frames - frames_rendered;
+        if (step > MUSIC_CLOCK_STEP) {
+            step = MUSIC_CLOCK_STEP;
+        }
+        size_t got;
+        int order, pattern, row, speed;
+        double tick_samples, seconds;
+        if (music_state.pcm_valid) {
+            /* The timeline entry covering the last frame read */
+            got = read_pcm(buffer + frames_rendered * 2, step);
+            const music_pcm_t *pcm = &music_state.pcm;
+            uint64_t entry = (music_state.pcm_pos + (uint64_t)pcm->step - 1) / (uint64_t)pcm->step;
+            const music_pcm_step_t *s = &pcm->timeline[entry > 0 ? entry - 1 : 0];
+            order = s->order;
+            pattern = s->pattern;
+            row = s->row;
+            speed = s->speed;
+            tick_samples = s->tick_samples;
+            seconds = (double)music_state.pcm_pos / MUSIC_SAMPLE_RATE;
+        } else {
+            got = openmpt_module_read_interleaved_float_stereo(
+                music_state.mod,
+                MUSIC_SAMPLE_RATE,
+                step,
+                buffer + frames_rendered * 2
+            );
+            order = openmpt_module_get_current_order(music_state.mod);
+            pattern = openmpt_module_get_current_pattern(music_state.mod);
+            row = openmpt_module_get_current_row(music_state.mod);
+            speed = openmpt_module_get_current_speed(music_state.mod);
+            tick_samples = current_tick_samples();
+            seconds = openmpt_module_get_position_seconds(music_state.mod);
+        }
+
+        /* Publish the whole position at once for thread-safe queries */
+        uint64_t block_start = music_state.samples_rendered;
+        music_state.samples_rendered += got;
+        frames_rendered += got;
+        music_row_start_t row_start;
+        bool row_changed;
+        int tick = estimate_tick(order, row, speed, tick_samples, block_start,
+                                 &row_start, &row_changed);
+        publish_position(order,
+                         pattern,
+                         row,
+                         tick,
+                         seconds,
+                         music_state.samples_rendered,
+                         time_ns, clock_sample,
+                         row_changed ? &row_start : NULL);
+        if (got < step) {
+            break;
+        }
+    }
 
     /* Fill remainder with silence if we didn't get enough frames */
     if (frames_rendered < (size_t)num_frames) {
@@ -58,17 +387,156 @@ static void music_audio_callback(float *buffer, int num_frames, int num_channels
         /* Stop playback at end of module */
         atomic_store(&music_state.playing, false);
     }
+    return frames_rendered;
+}
+
+#if !defined(SR_AUDIO_WORKLET)
+/**
+ * Audio callback - called by Sokol Audio from audio thread.
+ */
+static void music_audio_callback(float *buffer, int num_frames, int num_channels) {
+    /* Timestamp before rendering: the device asked for this block now */
+    uint64_t time_ns = music_clock_ns();
+    atomic_store(&music_state.render_busy, true);
+    FRAMECHECK_BEGIN(FRAMECHECK_AUDIO);
+#if defined(SR_PROFILE)
+    music_render_hook_fn hook = atomic_load(&music_state.render_hook);
+    if (hook) {
+        hook(0);
+    }
+    music_render(buffer, num_frames, num_channels, time_ns);
+    if (hook) {
+        hook(1);
+    }
+#else
+    music_render(buffer, num_frames, num_channels, time_ns);
+#endif
+    FRAMECHECK_END();
+    atomic_store(&music_state.render_busy, false);
+}
+#endif
+
+#if defined(SR_AUDIO_WORKLET)
+
+static struct {
+    EMSCRIPTEN_WEBAUDIO_T context;
+    float interleaved[MUSIC_WORKLET_QUANTUM * MUSIC_NUM_CHANNELS];
+    uint8_t stack[MUSIC_WORKLET_STACK] __attribute__((aligned(16)));
+} worklet_state;
+
+/* Output latency of the context in frames (base + output, as reported) */
+static int worklet_latency_frames(void) {
+    return EM_ASM_INT({
+        var ctx = emscriptenGetAudioObject($0);
+        if (!ctx) {
+            return 0;
+        }
+        return Math.round(((ctx.baseLatency || 0) + (ctx.outputLatency || 0)) * ctx.sampleRate);
+    }, worklet_state.context);
+}
+
+/* Audio worklet thread: render one quantum and split it into planes */
+static bool worklet_process(int num_inputs, const AudioSampleFrame *inputs,
+                            int num_outputs, AudioSampleFrame *outputs,
+                            int num_params, const AudioParamFrame *params, void *user_data) {
+    (void)num_inputs;
+    (void)inputs;
+    (void)num_params;
+    (void)params;
+    (void)user_data;
+    if (num_outputs < 1 || outputs[0].numberOfChannels < MUSIC_NUM_CHANNELS) {
+        return true;
+    }
+
+    /* No clock in the worklet scope (and no profiler hook) */
+    atomic_store(&music_state.render_busy, true);
+    music_render(worklet_state.interleaved, MUSIC_WORKLET_QUANTUM, MUSIC_NUM_CHANNELS, 0);
+    atomic_store(&music_state.render_busy, false);
+
+    float *left = outputs[0].data;
+    float *right = outputs[0].data + MUSIC_WORKLET_QUANTUM;
+    for (int i = 0; i < MUSIC_WORKLET_QUANTUM; i++) {
+        left[i] = worklet_state.interleaved[i * 2];
+        right[i] = worklet_state.interleaved[i * 2 + 1];
+    }
+    return true;
+}
+
+static void worklet_processor_created(EMSCRIPTEN_WEBAUDIO_T context, bool success, void *user_data) {
+    (void)user_data;
+    if (!success) {
+        fprintf(stderr, "MUSIC: Failed to create audio worklet processor\n");
+        return;
+    }
+    int output_channels[1] = { MUSIC_NUM_CHANNELS };
+    EmscriptenAudioWorkletNodeCreateOptions options = {
+        .numberOfInputs = 0,
+        .numberOfOutputs = 1,
+        .outputChannelCounts = output_channels,
+    };
+    EMSCRIPTEN_AUDIO_WORKLET_NODE_T node = emscripten_create_wasm_audio_worklet_node(
+        context, "sr-music", &options, worklet_process, NULL);
+    emscripten_audio_node_connect(node, context, 0, 0);
+    music_state.latency_frames = worklet_latency_frames();
+    printf("MUSIC: Audio worklet running\n");
+}
+
+static void worklet_thread_started(EMSCRIPTEN_WEBAUDIO_T context, bool success, void *user_data) {
+    (void)user_data;
+    if (!success) {
+        fprintf(stderr, "MUSIC: Failed to start audio worklet thread\n");
+        return;
+    }
+    WebAudioWorkletProcessorCreateOptions options = { .name = "sr-music" };
+    emscripten_create_wasm_audio_worklet_processor_async(context, &options,
+                                                         worklet_processor_created, NULL);
+}
+
+/* Create the context and start the worklet (completes asynchronously) */
+static bool worklet_setup(void) {
+    EmscriptenWebAudioCreateAttributes attrs = {
+        .latencyHint = "interactive",
+        .sampleRate = MUSIC_SAMPLE_RATE,
+    };
+    worklet_state.context = emscripten_create_audio_context(&attrs);
+    if (!worklet_state.context) {
+        return false;
+    }
+    emscripten_start_wasm_audio_worklet_thread_async(worklet_state.context,
+                                                     worklet_state.stack, sizeof(worklet_state.stack),
+                                                     worklet_thread_started, NULL);
+
+    /* Browsers start contexts suspended until a user gesture */
+    EM_ASM({
+        var ctx = emscriptenGetAudioObject($0);
+        var resume = function() { ctx.resume(); };
+        ['pointerdown', 'keydown', 'touchend'].forEach(function(type) {
+            document.addEventListener(type, resume, { once: true });
+        });
+    }, worklet_state.context);
+    return true;
+}
+
+static void worklet_shutdown(void) {
+    if (worklet_state.context) {
+        emscripten_destroy_audio_context(worklet_state.context);
+        worklet_state.context = 0;
+    }
+}
 
-    /* Update position atomically for thread-safe queries */
-    atomic_store(&music_state.current_order,
-                 openmpt_module_get_current_order(music_state.mod));
-    atomic_store(&music_state.current_pattern,
-                 openmpt_module_get_current_pattern(music_state.mod));
-    atomic_store(&music_state.current_row,
-                 openmpt_module_get_current_row(music_state.mod));
+#endif /* SR_AUDIO_WORKLET */
 
-    double pos = openmpt_module_get_position_seconds(music_state.mod);
-    atomic_store(&music_state.position_seconds_x1000, (int)(pos * 1000.0));
+/* Reset shared state after the backend is up */
+static void music_reset_state(bool offline) {
+    music_state.initialized = true;
+    music_state.offline = offline;
+    music_state.mod = NULL;
+    atomic_store(&music_state.playing, false);
+    if (!music_state.pcm_enabled) {
+        const char *pcm = getenv("SR_MUSIC_PCM");
+        music_state.pcm_enabled = pcm && strcmp(pcm, "1") == 0;
+    }
+    reset_position(0, 0);
 }
 
 bool music_init(void) {
@@ -76,13 +544,22 @@ bool music_init(void) {
         return true;
     }
 
+#if defined(SR_AUDIO_WORKLET)
+    if (!worklet_setup()) {
+        fprintf(stderr, "MUSIC: Failed to initialize audio\n");
+        return false;
+    }
+    music_reset_state(false);
+    printf("MUSIC: Initialized (sample rate: %d Hz, audio worklet)\n", MUSIC_SAMPLE_RATE);
+    return true;
+#else
     /* Initialize Sokol Audio with proper logging */
     saudio_setup(&(saudio_desc){
         .sample_rate = MUSIC_SAMPLE_RATE,
         .num_channels = MUSIC_NUM_CHANNELS,
         .stream_cb = music_audio_callback,
-        .buffer_frames = 2048,
-        .packet_frames = 512,
+        .buffer_frames = MUSIC_BUFFER_FRAMES,
+        .packet_frames = MUSIC_PACKET_FRAMES,
         .logger.func = slog_func,
     });
 
@@ -91,16 +568,52 @@ bool music_init(void) {
         return false;
     }
 
-    music_state.initialized = true;
-    music_state.mod = NULL;
-    atomic_store(&music_state.playing, false);
-    atomic_store(&music_state.current_order, 0);
-    atomic_store(&music_state.current_pattern, 0);
-    atomic_store(&music_state.current_row, 0);
-    atomic_store(&music_state.position_seconds_x1000, 0);
+    music_reset_state(false);
+    music_state.latency_frames = saudio_buffer_frames();
 
     printf("MUSIC: Initialized (sample rate: %d Hz)\n", saudio_sample_rate());
     return true;
+#endif
+}
+
+bool music_init_offline(void) {
+    if (music_state.initialized) {
+        return music_state.offline;
+    }
+
+    music_reset_state(true);
+    music_state.latency_frames = 0;
+
+    printf("MUSIC: Initialized offline (sample rate: %d Hz)\n", MUSIC_SAMPLE_RATE);
+    return true;
+}
+
+int music_render_offline(float *buffer, int num_frames) {
+    if (!buffer || num_frames <= 0) {
+        return 0;
+    }
+    if (!music_state.offline) {
+        memset(buffer, 0, (size_t)num_frames * MUSIC_NUM_CHANNELS * sizeof(float));
+        return 0;
+    }
+    /* The headless runner's stand-in for the audio callback */
+    FRAMECHECK_BEGIN(FRAMECHECK_AUDIO);
+    int frames = (int)music_render(buffer, num_frames, MUSIC_NUM_CHANNELS, 0);
+    FRAMECHECK_END();
+    return frames;
+}
+
+int music_get_sample_rate(void) {
+#if !defined(SR_AUDIO_WORKLET)
+    if (music_state.initialized && !music_state.offline) {
+        return saudio_sample_rate();
+    }
+#endif
+    return MUSIC_SAMPLE_RATE;
+}
+
+int music_get_render_rate(void) {
+    return MUSIC_SAMPLE_RATE;
 }
 
 void music_shutdown(void) {
@@ -108,23 +621,87 @@ void music_shutdown(void) {
         return;
     }
 
+    music_load_cancel();
     music_unload();
-    saudio_shutdown();
+    if (!music_state.offline) {
+#if defined(SR_AUDIO_WORKLET)
+        worklet_shutdown();
+#else
+        saudio_shutdown();
+#endif
+    }
     music_state.initialized = false;
+    music_state.offline = false;
     printf("MUSIC: Shutdown complete\n");
 }
 
-bool music_load(const void *data, size_t size) {
-    if (!music_state.initialized) {
-        fprintf(stderr, "MUSIC: Not initialized\n");
-        return false;
+/**
+ * Stop the audio thread from touching the module.
+ * Dekker-style handshake with music_audio_callback(): it raises
+ * render_busy before checking playing, we clear playing before checking
+ * render_busy, so after this returns no render is in flight.
+ * @return Whether music was playing (to resume after the change)
+ */
+static bool stop_rendering(void) {
+    bool was_playing = atomic_exchange(&music_state.playing, false);
+    while (atomic_load(&music_state.render_busy)) {
+        /* One render step is well under a millisecond */
     }
+    return was_playing;
+}
 
-    /* Unload existing module */
-    music_unload();
+/* Read a whole file; caller frees. Safe on any thread. */
+static void *read_file(const char *path, size_t *out_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "MUSIC: Cannot open file: %s\n", path);
+        return NULL;
+    }
+
+    /* Get file size */
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size <= 0) {
+        fprintf(stderr, "MUSIC: Invalid file size\n");
+        fclose(f);
+        return NULL;
+    }
+
+    /* Read file into memory */
+    void *data = malloc((size_t)size);
+    if (!data) {
+        fprintf(stderr, "MUSIC: Out of memory\n");
+        fclose(f);
+        return NULL;
+    }
+
+    size_t read = fread(data, 1, (size_t)size, f);
+    fclose(f);
 
-    /* Load new module */
-    music_state.mod = openmpt_module_create_from_memory2(
+    if (read != (size_t)size) {
+        fprintf(stderr, "MUSIC: Read error\n");
+        free(data);
+        return NULL;
+    }
+    *out_size = (size_t)size;
+    return data;
+}
+
+/* Cache file next to the module file (path + suffix); caller frees */
+static char *cache_path_for(const char *path, const char *suffix) {
+    char *cache_path = malloc(strlen(path) + strlen(suffix) + 1);
+    if (cache_path) {
+        strcpy(cache_path, path);
+        strcat(cache_path, suffix);
+    }
+    return cache_path;
+}
+
+/* Parse module data. Safe on any thread. */
+static openmpt_module *create_module(const void *data, size_t size) {
+    openmpt_module *mod = openmpt_module_create_from_memory2(
         data, size,
         NULL, /* log_func */
         NULL, /* log_user */
@@ -135,99 +712,308 @@ bool music_load(const void *data, size_t size) {
         NULL  /* ctls */
     );
 
-    if (!music_state.mod) {
+    if (!mod) {
         fprintf(stderr, "MUSIC: Failed to load module\n");
-        return false;
+        return NULL;
     }
 
     /* Configure module for interpolated output */
     openmpt_module_set_render_param(
-        music_state.mod,
+        mod,
         OPENMPT_MODULE_RENDER_INTERPOLATIONFILTER_LENGTH,
         8 /* 8-tap sinc */
     );
+    return mod;
+}
+
+/**
+ * Read the cached sync index or build it, refreshing the cache.
+ * Safe on any thread for a module the audio thread does not render.
+ * @return true if index is valid
+ */
+static bool load_index(music_index_t *index, openmpt_module *mod, uint32_t hash,
+                       size_t size, const char *cache_path) {
+    if (cache_path && music_index_load(index, cache_path, hash,
+                                       (uint32_t)size, MUSIC_SAMPLE_RATE) == 0) {
+        return true;
+    }
+    if (music_index_build(index, mod, MUSIC_SAMPLE_RATE, hash, (uint32_t)size) != 0) {
+        fprintf(stderr, "MUSIC: Cannot build sync index\n");
+        return false;
+    }
+    openmpt_module_set_position_order_row(mod, 0, 0);
+    if (cache_path) {
+        if (music_index_save(index, cache_path) == 0) {
+            printf("MUSIC: Wrote sync index: %s\n", cache_path);
+        } else {
+            fprintf(stderr, "MUSIC: Cannot write sync index: %s\n", cache_path);
+        }
+    }
+    return true;
+}
+
+/**
+ * Map the PCM cache, rendering it first if missing or stale.
+ * Safe on any thread for a module the audio thread does not render.
+ * @return true if pcm is valid
+ */
+static bool load_pcm(music_pcm_t *pcm, openmpt_module *mod, uint32_t hash,
+                     size_t size, const char *cache_path) {
+    if (music_pcm_open(pcm, cache_path, MUSIC_SAMPLE_RATE, MUSIC_CLOCK_STEP,
+                       hash, (uint32_t)size) == 0) {
+        return true;
+    }
+    printf("MUSIC: Rendering PCM cache: %s\n", cache_path);
+    bool ok = music_pcm_build(cache_path, mod, MUSIC_SAMPLE_RATE, MUSIC_CLOCK_STEP,
+                              hash, (uint32_t)size) == 0 &&
+              music_pcm_open(pcm, cache_path, MUSIC_SAMPLE_RATE, MUSIC_CLOCK_STEP,
+                             hash, (uint32_t)size) == 0;
+    openmpt_module_set_position_order_row(mod, 0, 0);
+    if (!ok) {
+        fprintf(stderr, "MUSIC: Cannot write PCM cache: %s\n", cache_path);
+    }
+    return ok;
+}
+
+/**
+ * Parse module data and load its caches. Safe on any thread.
+ * @param path Module file the caches live next to (NULL: none, no PCM)
+ * @param pcm Whether to use the PCM cache
+ */
+static bool prepare_module(music_loaded_t *loaded, const void *data, size_t size,
+                           const char *path, bool pcm) {
+    memset(loaded, 0, sizeof(*loaded));
+    loaded->mod = create_module(data, size);
+    if (!loaded->mod) {
+        return false;
+    }
+
+    uint32_t hash = music_index_hash(data, size);
+    char *index_path = path ? cache_path_for(path, ".sync") : NULL;
+    loaded->index_valid = load_index(&loaded->index, loaded->mod, hash, size, index_path);
+    free(index_path);
+
+    /* PCM seeks go through the index, so it needs one */
+    if (pcm && path && loaded->index_valid) {
+        char *pcm_path = cache_path_for(path, ".pcm");
+        loaded->pcm_valid = pcm_path && load_pcm(&loaded->pcm, loaded->mod, hash, size, pcm_path);
+        free(pcm_path);
+    }
+    return true;
+}
+
+/* Release a prepared module that was not installed */
+static void release_module(music_loaded_t *loaded) {
+    if (loaded->mod) {
+        openmpt_module_destroy(loaded->mod);
+    }
+    music_index_free(&loaded->index);
+    music_pcm_close(&loaded->pcm);
+    memset(loaded, 0, sizeof(*loaded));
+}
+
+/* Replace the current module (takes ownership of loaded) */
+static void install_module(music_loaded_t *loaded) {
+    music_unload();
+    music_state.mod = loaded->mod;
+    music_state.index = loaded->index;
+    music_state.index_valid = loaded->index_valid;
+    music_state.pcm = loaded->pcm;
+    music_state.pcm_valid = loaded->pcm_valid;
+    memset(loaded, 0, sizeof(*loaded));
 
     /* Reset position */
-    atomic_store(&music_state.current_order, 0);
-    atomic_store(&music_state.current_pattern, 0);
-    atomic_store(&music_state.current_row, 0);
-    atomic_store(&music_state.position_seconds_x1000, 0);
+    music_state.pcm_pos = 0;
+    reset_position(0, 0);
 
-    printf("MUSIC: Module loaded (duration: %.1f sec, orders: %d, patterns: %d)\n",
+    printf("MUSIC: Module loaded (duration: %.1f sec, orders: %d, patterns: %d%s)\n",
            music_get_duration(),
            music_get_num_orders(),
-           music_get_num_patterns());
+           music_get_num_patterns(),
+           music_state.pcm_valid ? ", PCM cache" : "");
+}
+
+/* Load module data; path names the file its caches live next to (NULL: none) */
+static bool load_module(const void *data, size_t size, const char *path) {
+    if (!music_state.initialized) {
+        fprintf(stderr, "MUSIC: Not initialized\n");
+        return false;
+    }
 
+    music_loaded_t loaded;
+    if (!prepare_module(&loaded, data, size, path, music_state.pcm_enabled)) {
+        return false;
+    }
+    install_module(&loaded);
     return true;
 }
 
+bool music_load(const void *data, size_t size) {
+    return load_module(data, size, NULL);
+}
+
 bool music_load_file(const char *path) {
     if (!path) {
         return false;
     }
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        fprintf(stderr, "MUSIC: Cannot open file: %s\n", path);
+    size_t size;
+    void *data = read_file(path, &size);
+    if (!data) {
         return false;
     }
 
-    /* Get file size */
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    /* Load module from memory, with its caches next to the file */
+    bool result = load_module(data, size, path);
+    free(data);
 
-    if (size <= 0) {
-        fprintf(stderr, "MUSIC: Invalid file size\n");
-        fclose(f);
+    if (result) {
+        printf("MUSIC: Loaded file: %s\n", path);
+    }
+
+    return result;
+}
+
+void music_set_pcm_cache(bool enabled) {
+    music_state.pcm_enabled = enabled;
+}
+
+/* Background load: read, parse and index, then hand over via state */
+static void async_worker(void *arg) {
+    (void)arg;
+    size_t size;
+    void *data = read_file(music_state.async.path, &size);
+    bool ok = data && prepare_module(&music_state.async.loaded, data, size,
+                                     music_state.async.path, music_state.async.pcm);
+    free(data);
+    atomic_store(&music_state.async.state, ok ? MUSIC_LOAD_READY : MUSIC_LOAD_FAILED);
+}
+
+bool music_load_file_async(const char *path, music_load_fn callback, void *user_data) {
+    if (!path) {
+        return false;
+    }
+    if (!music_state.initialized) {
+        fprintf(stderr, "MUSIC: Not initialized\n");
+        return false;
+    }
+    if (music_state.async.active) {
+        fprintf(stderr, "MUSIC: Load already pending: %s\n", music_state.async.path);
         return false;
     }
 
-    /* Read file into memory */
-    void *data = malloc((size_t)size);
-    if (!data) {
+    music_state.async.path = malloc(strlen(path) + 1);
+    if (!music_state.async.path) {
         fprintf(stderr, "MUSIC: Out of memory\n");
-        fclose(f);
         return false;
     }
+    strcpy(music_state.async.path, path);
+    music_state.async.callback = callback;
+    music_state.async.user_data = user_data;
+    music_state.async.pcm = music_state.pcm_enabled;
+    memset(&music_state.async.loaded, 0, sizeof(music_state.async.loaded));
+    music_state.async.joined = false;
+    music_state.async.notified = false;
+    atomic_store(&music_state.async.state, MUSIC_LOAD_PENDING);
 
-    size_t read = fread(data, 1, (size_t)size, f);
-    fclose(f);
+    if (thread_create(&music_state.async.thread, async_worker, NULL) != 0) {
+        /* No thread: load now so callers see the same sequence */
+        async_worker(NULL);
+        music_state.async.joined = true;
+    }
+    music_state.async.active = true;
+    return true;
+}
 
-    if (read != (size_t)size) {
-        fprintf(stderr, "MUSIC: Read error\n");
-        free(data);
-        return false;
+/* Release the finished request */
+static void async_release(void) {
+    release_module(&music_state.async.loaded);
+    free(music_state.async.path);
+    music_state.async.path = NULL;
+    music_state.async.active = false;
+    atomic_store(&music_state.async.state, MUSIC_LOAD_IDLE);
+}
+
+music_load_state_t music_load_poll(void) {
+    if (!music_state.async.active) {
+        return MUSIC_LOAD_IDLE;
+    }
+    music_load_state_t state = atomic_load(&music_state.async.state);
+    if (state == MUSIC_LOAD_PENDING) {
+        return state;
+    }
+    if (!music_state.async.joined) {
+        thread_join(&music_state.async.thread);
+        music_state.async.joined = true;
     }
+    if (!music_state.async.notified) {
+        music_state.async.notified = true;
+        if (music_state.async.callback) {
+            music_state.async.callback(state == MUSIC_LOAD_READY, music_state.async.user_data);
+        }
+        /* Failures are reported once, then the request is gone */
+        if (state == MUSIC_LOAD_FAILED && music_state.async.active) {
+            async_release();
+        }
+    }
+    return state;
+}
 
-    /* Load module from memory */
-    bool result = music_load(data, (size_t)size);
-    free(data);
+music_load_state_t music_load_wait(void) {
+    if (music_state.async.active && !music_state.async.joined) {
+        thread_join(&music_state.async.thread);
+        music_state.async.joined = true;
+    }
+    return music_load_poll();
+}
 
-    if (result) {
-        printf("MUSIC: Loaded file: %s\n", path);
+const char *music_load_pending_path(void) {
+    return music_state.async.active ? music_state.async.path : NULL;
+}
+
+bool music_load_commit(void) {
+    if (music_load_poll() != MUSIC_LOAD_READY) {
+        return false;
     }
+    install_module(&music_state.async.loaded);
+    printf("MUSIC: Loaded file: %s\n", music_state.async.path);
+    async_release();
+    return true;
+}
 
-    return result;
+void music_load_cancel(void) {
+    if (!music_state.async.active) {
+        return;
+    }
+    /* The worker cannot be interrupted; wait it out without the callback */
+    if (!music_state.async.joined) {
+        thread_join(&music_state.async.thread);
+        music_state.async.joined = true;
+    }
+    async_release();
 }
 
 void music_unload(void) {
     if (music_state.mod) {
-        /* Stop playback first */
-        atomic_store(&music_state.playing, false);
-
-        /* Wait for audio callback to complete by allowing one buffer cycle.
-         * sokol_audio uses ~2048 frames at 48kHz = ~43ms buffer.
-         * We could add proper synchronization, but for demo use this is safe:
-         * unload is only called during init/shutdown, not during playback. */
-
+        /* Stop playback and wait out a render in progress */
+        stop_rendering();
         openmpt_module_destroy(music_state.mod);
         music_state.mod = NULL;
     }
+    music_index_free(&music_state.index);
+    music_state.index_valid = false;
+    music_pcm_close(&music_state.pcm);
+    music_state.pcm_valid = false;
 }
 
 void music_play(void) {
     if (music_state.mod) {
+#if defined(SR_AUDIO_WORKLET)
+        /* outputLatency is only known once the context runs */
+        if (worklet_state.context) {
+            music_state.latency_frames = worklet_latency_frames();
+        }
+#endif
         atomic_store(&music_state.playing, true);
     }
 }
@@ -238,12 +1024,10 @@ void music_pause(void) {
 
 void music_stop(void) {
     if (music_state.mod) {
-        atomic_store(&music_state.playing, false);
+        stop_rendering();
         openmpt_module_set_position_order_row(music_state.mod, 0, 0);
-        atomic_store(&music_state.current_order, 0);
-        atomic_store(&music_state.current_pattern, 0);
-        atomic_store(&music_state.current_row, 0);
-        atomic_store(&music_state.position_seconds_x1000, 0);
+        music_state.pcm_pos = 0;
+        reset_position(0, 0);
     }
 }
 
@@ -251,38 +1035,227 @@ bool music_is_playing(void) {
     return atomic_load(&music_state.playing);
 }
 
+void music_get_position(music_position_t *pos) {
+    unsigned seq;
+    uint64_t seconds_bits;
+
+    /* Retry only if the audio thread published in between */
+    for (;;) {
+        seq = atomic_load_explicit(&music_state.position_seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        pos->order = atomic_load_explicit(&music_state.position_order, memory_order_relaxed);
+        pos->pattern = atomic_load_explicit(&music_state.position_pattern, memory_order_relaxed);
+        pos->row = atomic_load_explicit(&music_state.position_row, memory_order_relaxed);
+        pos->tick = atomic_load_explicit(&music_state.position_tick, memory_order_relaxed);
+        seconds_bits = atomic_load_explicit(&music_state.position_seconds, memory_order_relaxed);
+        pos->samples = atomic_load_explicit(&music_state.position_samples, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&music_state.position_seq, memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+    memcpy(&pos->seconds, &seconds_bits, sizeof(pos->seconds));
+}
+
+double music_get_audible_position(music_position_t *pos) {
+    unsigned seq;
+    unsigned row_count;
+    music_row_entry_t *e;
+    int order = 0, pattern = 0, row = 0, speed = 0;
+    uint64_t start_sample = 0;
+    uint64_t tick_bits = 0;
+    uint64_t audible;
+
+    for (;;) {
+        seq = atomic_load_explicit(&music_state.position_seq, memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        music_get_position(pos);
+        row_count = atomic_load_explicit(&music_state.row_count, memory_order_relaxed);
+
+        /* Extrapolate from the last callback, minus the queued output */
+        audible = pos->samples;
+#if defined(SR_AUDIO_WORKLET)
+        /* Untimestamped quanta: rendered position minus the output latency */
+        audible = audible > (uint64_t)music_state.latency_frames ?
+                  audible - (uint64_t)music_state.latency_frames : 0;
+#else
+        if (music_state.latency_frames > 0) {
+            uint64_t time_ns = atomic_load_explicit(&music_state.clock_time_ns, memory_order_relaxed);
+            uint64_t clock_sample = atomic_load_explicit(&music_state.clock_sample, memory_order_relaxed);
+            uint64_t now = music_clock_ns();
+            double elapsed = now > time_ns ? (double)(now - time_ns) * 1e-9 : 0.0;
+            double sample = (double)clock_sample + elapsed * MUSIC_SAMPLE_RATE -
+                            music_state.latency_frames;
+            audible = sample <= 0.0 ? 0 : (uint64_t)sample;
+            if (audible > pos->samples) {
+                audible = pos->samples;
+            }
+        }
+#endif
+
+        /* Newest row that had started by the audible sample */
+        unsigned oldest = row_count > MUSIC_ROW_RING ? row_count - MUSIC_ROW_RING : 0;
+        unsigned n = row_count;
+        e = NULL;
+        while (n > oldest) {
+            n--;
+            e = &music_state.rows[n % MUSIC_ROW_RING];
+            if (atomic_load_explicit(&e->start_sample, memory_order_relaxed) <= audible) {
+                break;
+            }
+        }
+        if (e) {
+            order = atomic_load_explicit(&e->order, memory_order_relaxed);
+            pattern = atomic_load_explicit(&e->pattern, memory_order_relaxed);
+            row = atomic_load_explicit(&e->row, memory_order_relaxed);
+            speed = atomic_load_explicit(&e->speed, memory_order_relaxed);
+            start_sample = atomic_load_explicit(&e->start_sample, memory_order_relaxed);
+            tick_bits = atomic_load_explicit(&e->tick_samples, memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&music_state.position_seq, memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+
+    /* No row recorded yet (stopped, just seeked): the snapshot is audible */
+    if (!e) {
+        return 0.0;
+    }
+
+    /* Audible sample older than the ring: clamp to its oldest row */
+    if (start_sample > audible) {
+        audible = start_sample;
+    }
+
+    double fraction = 0.0;
+    double tick_samples = bits_to_double(tick_bits);
+    double into_row = (double)(audible - start_sample);
+    pos->tick = 0;
+    if (speed > 0 && tick_samples > 0.0) {
+        int tick = (int)(into_row / tick_samples);
+        pos->tick = tick < speed ? tick : speed - 1;
+        fraction = into_row / (tick_samples * speed);
+        if (fraction > 0.999) {
+            fraction = 0.999;
+        }
+    }
+    pos->seconds -= (double)(pos->samples - audible) / MUSIC_SAMPLE_RATE;
+    if (pos->seconds < 0.0) {
+        pos->seconds = 0.0;
+    }
+    pos->order = order;
+    pos->pattern = pattern;
+    pos->row = row;
+    pos->samples = audible;
+    return fraction;
+}
+
 double music_get_position_seconds(void) {
-    int ms = atomic_load(&music_state.position_seconds_x1000);
-    return (double)ms / 1000.0;
+    music_position_t pos;
+    music_get_position(&pos);
+    return pos.seconds;
 }
 
 int music_get_current_order(void) {
-    return atomic_load(&music_state.current_order);
+    music_position_t pos;
+    music_get_position(&pos);
+    return pos.order;
 }
 
 int music_get_current_pattern(void) {
-    return atomic_load(&music_state.current_pattern);
+    music_position_t pos;
+    music_get_position(&pos);
+    return pos.pattern;
 }
 
 int music_get_current_row(void) {
-    return atomic_load(&music_state.current_row);
+    music_position_t pos;
+    music_get_position(&pos);
+    return pos.row;
 }
 
 void music_set_position(int order, int row) {
     if (music_state.mod) {
-        openmpt_module_set_position_order_row(music_state.mod, order, row);
-        atomic_store(&music_state.current_order, order);
-        atomic_store(&music_state.current_row, row);
+        /* Keep the audio thread out of the module while it seeks */
+        bool was_playing = stop_rendering();
+        if (music_state.pcm_valid) {
+            /* The cache plays, not the module: the index has the row's
+             * offset into the rendered song */
+            uint32_t sample = music_index_row_sample(&music_state.index, order, row);
+            music_state.pcm_pos = sample != MUSIC_INDEX_UNREACHED ? sample : 0;
+        } else {
+            openmpt_module_set_position_order_row(music_state.mod, order, row);
+        }
+        reset_position(order, row);
+        atomic_store(&music_state.playing, was_playing);
     }
 }
 
+void music_set_render_hook(music_render_hook_fn hook) {
+#if defined(SR_PROFILE)
+    atomic_store(&music_state.render_hook, hook);
+#else
+    (void)hook;
+#endif
+}
+
 double music_get_duration(void) {
     if (!music_state.mod) {
         return 0.0;
     }
+    if (music_state.index_valid) {
+        return (double)music_state.index.end_sample / MUSIC_SAMPLE_RATE;
+    }
     return openmpt_module_get_duration_seconds(music_state.mod);
 }
 
+double music_get_row_time(int order, int row) {
+    if (!music_state.index_valid) {
+        return -1.0;
+    }
+    uint32_t sample = music_index_row_sample(&music_state.index, order, row);
+    return sample == MUSIC_INDEX_UNREACHED ? -1.0 : (double)sample / MUSIC_SAMPLE_RATE;
+}
+
+int music_get_sync_code(int order, int row) {
+    if (!music_state.index_valid) {
+        return 0;
+    }
+    uint32_t sample = music_index_row_sample(&music_state.index, order, row);
+    return sample == MUSIC_INDEX_UNREACHED ? 0 : music_index_code_at(&music_state.index, sample);
+}
+
+bool music_sync_code_passed(int code, int order, int row) {
+    if (!music_state.index_valid || code < 0 || code >= MUSIC_INDEX_CODES) {
+        return false;
+    }
+    uint32_t first = music_state.index.code_first[code];
+    uint32_t sample = music_index_row_sample(&music_state.index, order, row);
+    return first != MUSIC_INDEX_UNREACHED && sample != MUSIC_INDEX_UNREACHED && sample >= first;
+}
+
+bool music_find_sync_code(int code, int *order, int *row) {
+    if (!music_state.index_valid || code <= 0 || code >= MUSIC_INDEX_CODES ||
+        music_state.index.code_first[code] == MUSIC_INDEX_UNREACHED) {
+        return false;
+    }
+    /* Codes are sorted by sample: the first event with the code is the one */
+    for (int i = 0; i < music_state.index.num_codes; i++) {
+        const music_index_code_t *c = &music_state.index.codes[i];
+        if (c->code == code) {
+            *order = c->order;
+            *row = c->row;
+            return true;
+        }
+    }
+    return false;
+}
+
 int music_get_num_orders(void) {
     if (!music_state.mod) {
         return 0;
@@ -10,6 +10,38 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Consistent playback position, published once per audio block
+ */
+typedef struct {
+    int order;          /* Order (pattern sequence position) */
+    int pattern;        /* Pattern number */
+    int row;            /* Row within the pattern */
+    int tick;           /* Tick within the row (estimated, one-block resolution) */
+    double seconds;     /* Module position in seconds */
+    uint64_t samples;   /* Sample frames rendered since load, stop or seek,
+                         * at music_get_render_rate() */
+} music_position_t;
+
+/**
+ * Background load request state
+ */
+typedef enum {
+    MUSIC_LOAD_IDLE = 0,    /* No request */
+    MUSIC_LOAD_PENDING,     /* Worker is reading and parsing */
+    MUSIC_LOAD_READY,       /* Parsed, waiting for music_load_commit() */
+    MUSIC_LOAD_FAILED       /* Reported once by music_load_poll(), then idle */
+} music_load_state_t;
+
+/**
+ * Completion callback for music_load_file_async().
+ * Runs on the main thread from music_load_poll() or music_load_wait().
+ * @param success true if the module is ready to commit
+ * @param user_data Value given to music_load_file_async()
+ */
+typedef void (*music_load_fn)(bool success, void *user_data);
 
 /**
  * Initialize the music subsystem.
@@ -19,6 +51,37 @@
  */
 bool music_init(void);
 
+/**
+ * Initialize the music subsystem for offline rendering.
+ * No audio device is opened; the caller pulls samples with
+ * music_render_offline() at its own pace (headless capture).
+ * @return true on success, false on failure
+ */
+bool music_init_offline(void);
+
+/**
+ * Render the next block of music in offline mode.
+ * Advances playback and the position used for DIS synchronization
+ * exactly as the audio callback does in realtime mode.
+ * @param buffer Interleaved stereo output (num_frames * 2 floats)
+ * @param num_frames Number of sample frames to render
+ * @return Number of frames rendered from the module (rest is silence)
+ */
+int music_render_offline(float *buffer, int num_frames);
+
+/**
+ * Get the output sample rate.
+ * @return Sample rate in Hz
+ */
+int music_get_sample_rate(void);
+
+/**
+ * Get the rate the module is rendered at. Positions, the sync index and
+ * the PCM cache count samples at this rate, whatever the device runs at.
+ * @return Sample rate in Hz
+ */
+int music_get_render_rate(void);
+
 /**
  * Shutdown the music subsystem.
  * Stops playback and releases all resources.
@@ -41,6 +104,59 @@ bool music_load(const void *data, size_t size);
  */
 bool music_load_file(const char *path);
 
+/**
+ * Play modules from a pre-rendered PCM cache instead of mixing live.
+ * Applies to later music_load_file() calls (not music_load()): the song is
+ * rendered once to PATH.pcm and memory-mapped, so playback costs a sample
+ * conversion. Positions and sync codes match live playback. Also enabled
+ * by SR_MUSIC_PCM=1 at init.
+ * @param enabled Whether to use the cache
+ */
+void music_set_pcm_cache(bool enabled);
+
+/**
+ * Start loading a module file in the background.
+ * File reading, parsing and the sync index run on a worker thread; the
+ * current module keeps playing until music_load_commit(). One request
+ * at a time.
+ * @param path Path to module file (copied)
+ * @param callback Completion callback (NULL to poll only)
+ * @param user_data Passed to the callback
+ * @return true if the request was started
+ */
+bool music_load_file_async(const char *path, music_load_fn callback, void *user_data);
+
+/**
+ * Check a background load; runs the callback once it finished.
+ * Call once per frame while a request is pending.
+ * @return Request state
+ */
+music_load_state_t music_load_poll(void);
+
+/**
+ * Block until a background load finished, then poll it.
+ * @return Request state (IDLE if none)
+ */
+music_load_state_t music_load_wait(void);
+
+/**
+ * Get the file of the current background request.
+ * @return Path, or NULL if no request is active
+ */
+const char *music_load_pending_path(void);
+
+/**
+ * Replace the current module with the finished background load.
+ * Position resets to the start; playback stays stopped until music_play().
+ * @return true if a READY module was installed
+ */
+bool music_load_commit(void);
+
+/**
+ * Drop a background request (waits for the worker if still running).
+ */
+void music_load_cancel(void);
+
 /**
  * Unload the currently loaded module.
  * Stops playback if playing.
@@ -68,6 +184,26 @@ void music_stop(void);
  */
 bool music_is_playing(void);
 
+/**
+ * Get the current position as one consistent snapshot.
+ * Lock-free for readers on any thread; fields never mix two audio blocks.
+ * Cheap enough to call many times per frame.
+ * @param pos Receives the position
+ */
+void music_get_position(music_position_t *pos);
+
+/**
+ * Get the position the listener hears now.
+ * Extrapolates from the last audio callback on a monotonic clock and
+ * subtracts the output buffer latency, so the value advances smoothly
+ * between callbacks. Offline, the position after the last rendered block.
+ * Call once per frame and reuse the result; lock-free like music_get_position().
+ * @param pos Receives the audible position (tick, seconds and samples
+ *            refer to the audible sample)
+ * @return Fraction of the current row already heard, in [0, 1)
+ */
+double music_get_audible_position(music_position_t *pos);
+
 /**
  * Get current playback position in seconds.
  * Thread-safe for use from any thread.
@@ -98,17 +234,70 @@ int music_get_current_row(void);
 
 /**
  * Set playback position by order and row.
+ * Playing from a PCM cache, only the cache position moves, to the row's
+ * offset from the sync index (a row the song never reaches starts it
+ * from the top); the module is not seeked. Otherwise libopenmpt seeks.
  * @param order Order number to seek to
  * @param row Row within the pattern (0-63)
  */
 void music_set_position(int order, int row);
 
 /**
- * Get total duration of the module in seconds.
+ * Hook called around each block rendered by the audio callback.
+ * Only invoked in SR_PROFILE builds; runs on the audio thread.
+ * @param end 0 before rendering, 1 after
+ */
+typedef void (*music_render_hook_fn)(int end);
+
+/**
+ * Set the render hook (profiling).
+ * @param hook Hook function (NULL to remove)
+ */
+void music_set_render_hook(music_render_hook_fn hook);
+
+/**
+ * Get total duration of the module in seconds (from the sync index).
  * @return Duration in seconds, or 0.0 if no module loaded
  */
 double music_get_duration(void);
 
+/**
+ * Get the song time of a row from the sync index.
+ * @param order Order number
+ * @param row Row within the pattern
+ * @return Seconds from song start, or -1.0 if the row is never played
+ *         or no module is loaded
+ */
+double music_get_row_time(int order, int row);
+
+/**
+ * Get the sync code (S3M Zxx parameter) in effect at a row.
+ * @param order Order number
+ * @param row Row within the pattern
+ * @return Last code at or before the row, 0 if none
+ */
+int music_get_sync_code(int order, int row);
+
+/**
+ * Check whether a sync code has been reached by a row. O(1).
+ * @param code Sync code (0-255)
+ * @param order Order number
+ * @param row Row within the pattern
+ * @return true if the code first occurs at or before the row
+ */
+bool music_sync_code_passed(int code, int order, int row);
+
+/**
+ * Find where a sync code first occurs in playback order, from the sync
+ * index. With music_set_position() this starts the music where a part
+ * waiting for that code would have started.
+ * @param code Sync code (1-255)
+ * @param order Receives the order number
+ * @param row Receives the row within the pattern
+ * @return true if the code occurs, false if not or no module is loaded
+ */
+bool music_find_sync_code(int code, int *order, int *row);
+
 /**
  * Get number of orders (patterns in sequence).
  * @return Number of orders, or 0 if no module loaded
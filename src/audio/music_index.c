@@ -0,0 +1,340 @@
+/**
+ * Music sync index - Implementation
+ *
+ * The build follows playback order from order 0: each order is entered
+ * with one libopenmpt seek (exact time, speed and tempo at its first row),
+ * then its rows are timed from the pattern's speed (A), tempo (T) and
+ * pattern delay (SEx) commands until the pattern ends or jumps (B, C).
+ * Seeks cost one song scan each inside libopenmpt, so the result is
+ * cached; the cache file is keyed by a hash of the module data.
+ */
+
+#include "music_index.h"
+#include <libopenmpt/libopenmpt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MUSIC_INDEX_MAGIC 0x494D5253u   /* "SRMI" */
+#define MUSIC_INDEX_VERSION 2    /* 2: pattern break rows no longer BCD-decoded twice */
+
+/* Sanity limits for cache files */
+#define MUSIC_INDEX_MAX_ORDERS 4096
+#define MUSIC_INDEX_MAX_ROWS (1 << 20)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t data_hash;
+    uint32_t data_size;
+    int32_t sample_rate;
+    int32_t num_orders;
+    int32_t num_rows;
+    int32_t num_codes;
+    uint32_t end_sample;
+} music_index_header_t;
+
+uint32_t music_index_hash(const void *data, size_t size) {
+    const uint8_t *p = data;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+void music_index_free(music_index_t *index) {
+    free(index->order_base);
+    free(index->order_rows);
+    free(index->row_sample);
+    free(index->codes);
+    memset(index, 0, sizeof(*index));
+}
+
+/* Allocate tables for the given order layout; order_rows must be set */
+static int alloc_rows(music_index_t *index) {
+    index->order_base = malloc(sizeof(int32_t) * (size_t)(index->num_orders + 1));
+    if (!index->order_base) {
+        return -1;
+    }
+    index->num_rows = 0;
+    for (int o = 0; o < index->num_orders; o++) {
+        index->order_base[o] = index->num_rows;
+        index->num_rows += index->order_rows[o];
+    }
+    index->order_base[index->num_orders] = index->num_rows;
+
+    index->row_sample = malloc(sizeof(uint32_t) * (size_t)(index->num_rows + 1));
+    if (!index->row_sample) {
+        return -1;
+    }
+    for (int i = 0; i < index->num_rows; i++) {
+        index->row_sample[i] = MUSIC_INDEX_UNREACHED;
+    }
+    return 0;
+}
+
+/* First sample of each code from the sorted event list */
+static void fill_code_first(music_index_t *index) {
+    for (int c = 0; c < MUSIC_INDEX_CODES; c++) {
+        index->code_first[c] = MUSIC_INDEX_UNREACHED;
+    }
+    for (int i = index->num_codes - 1; i >= 0; i--) {
+        index->code_first[index->codes[i].code] = index->codes[i].sample;
+    }
+}
+
+static int compare_code(const void *a, const void *b) {
+    uint32_t x = ((const music_index_code_t *)a)->sample;
+    uint32_t y = ((const music_index_code_t *)b)->sample;
+    return (x > y) - (x < y);
+}
+
+/* Effect letter of a pattern cell in the module's own notation, or 0 */
+static char cell_effect(openmpt_module *mod, int pattern, int row, int channel, int *param) {
+    const char *text = openmpt_module_format_pattern_row_channel_command(
+        mod, pattern, row, channel, OPENMPT_MODULE_COMMAND_EFFECT);
+    char effect = text ? text[0] : 0;
+    openmpt_free_string(text);
+    if (effect == '.' || effect == ' ') {
+        return 0;
+    }
+    *param = openmpt_module_get_pattern_row_channel_command(
+        mod, pattern, row, channel, OPENMPT_MODULE_COMMAND_PARAMETER);
+    return effect;
+}
+
+static double current_tempo(openmpt_module *mod) {
+#if defined(OPENMPT_API_VERSION_AT_LEAST)
+#if OPENMPT_API_VERSION_AT_LEAST(0, 7, 0)
+    return openmpt_module_get_current_tempo2(mod);
+#else
+    return (double)openmpt_module_get_current_tempo(mod);
+#endif
+#else
+    return openmpt_module_get_current_tempo2(mod);
+#endif
+}
+
+int music_index_build(music_index_t *index, void *module, int sample_rate,
+                      uint32_t data_hash, uint32_t data_size) {
+    openmpt_module *mod = module;
+    music_index_free(index);
+    index->data_hash = data_hash;
+    index->data_size = data_size;
+    index->sample_rate = sample_rate;
+    index->num_orders = openmpt_module_get_num_orders(mod);
+    if (index->num_orders <= 0 || index->num_orders > MUSIC_INDEX_MAX_ORDERS) {
+        return -1;
+    }
+
+    int num_patterns = openmpt_module_get_num_patterns(mod);
+    int num_channels = openmpt_module_get_num_channels(mod);
+    index->order_rows = calloc((size_t)index->num_orders, sizeof(int32_t));
+    if (!index->order_rows) {
+        return -1;
+    }
+    for (int o = 0; o < index->num_orders; o++) {
+        int p = openmpt_module_get_order_pattern(mod, o);
+        index->order_rows[o] = (p >= 0 && p < num_patterns) ?
+                               openmpt_module_get_pattern_num_rows(mod, p) : 0;
+    }
+    char *visited = calloc((size_t)index->num_orders, 1);
+    if (alloc_rows(index) != 0 || !visited) {
+        free(visited);
+        music_index_free(index);
+        return -1;
+    }
+
+    int capacity = 64;
+    index->codes = malloc(sizeof(music_index_code_t) * (size_t)capacity);
+    if (!index->codes) {
+        free(visited);
+        music_index_free(index);
+        return -1;
+    }
+
+    int order = 0;
+    int start_row = 0;
+    double seconds = 0.0;
+    while (order >= 0 && order < index->num_orders && !visited[order]) {
+        visited[order] = 1;
+        int pattern = openmpt_module_get_order_pattern(mod, order);
+        int rows = index->order_rows[order];
+        if (rows <= 0 || start_row >= rows) {
+            /* Separator ("+++") or empty pattern */
+            order++;
+            start_row = 0;
+            continue;
+        }
+
+        seconds = openmpt_module_set_position_order_row(mod, order, start_row);
+        int speed = openmpt_module_get_current_speed(mod);
+        double tempo = current_tempo(mod);
+        int next_order = order + 1;
+        int next_row = 0;
+
+        for (int row = start_row; row < rows; row++) {
+            int delay = 0;
+            bool jump = false;
+            for (int ch = 0; ch < num_channels; ch++) {
+                int param = 0;
+                char effect = cell_effect(mod, pattern, row, ch, &param);
+                if (effect == 'A' && param > 0) {
+                    speed = param;
+                } else if (effect == 'T' && param >= 0x20) {
+                    tempo = param;
+                } else if (effect == 'S' && (param >> 4) == 0xE) {
+                    delay = param & 15;
+                } else if (effect == 'B') {
+                    next_order = param;
+                    jump = true;
+                } else if (effect == 'C') {
+                    /* libopenmpt decodes the BCD row of S3M breaks on load */
+                    next_row = param;
+                    jump = true;
+                } else if (effect == 'Z') {
+                    if (index->num_codes == capacity) {
+                        capacity *= 2;
+                        music_index_code_t *grown = realloc(index->codes,
+                            sizeof(music_index_code_t) * (size_t)capacity);
+                        if (!grown) {
+                            free(visited);
+                            music_index_free(index);
+                            return -1;
+                        }
+                        index->codes = grown;
+                    }
+                    music_index_code_t *c = &index->codes[index->num_codes++];
+                    c->sample = (uint32_t)(seconds * sample_rate + 0.5);
+                    c->order = order;
+                    c->row = row;
+                    c->code = param & (MUSIC_INDEX_CODES - 1);
+                }
+            }
+
+            index->row_sample[index->order_base[order] + row] =
+                (uint32_t)(seconds * sample_rate + 0.5);
+            if (speed > 0 && tempo > 0.0) {
+                seconds += speed * (1 + delay) * 2.5 / tempo;
+            }
+            if (jump) {
+                break;
+            }
+        }
+        order = next_order;
+        start_row = next_row;
+    }
+    free(visited);
+
+    index->end_sample = (uint32_t)(seconds * sample_rate + 0.5);
+    qsort(index->codes, (size_t)index->num_codes, sizeof(index->codes[0]), compare_code);
+    fill_code_first(index);
+    return 0;
+}
+
+int music_index_load(music_index_t *index, const char *path, uint32_t data_hash,
+                     uint32_t data_size, int sample_rate) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    music_index_header_t h;
+    music_index_free(index);
+    if (fread(&h, sizeof(h), 1, f) != 1 ||
+        h.magic != MUSIC_INDEX_MAGIC || h.version != MUSIC_INDEX_VERSION ||
+        h.data_hash != data_hash || h.data_size != data_size || h.sample_rate != sample_rate ||
+        h.num_orders <= 0 || h.num_orders > MUSIC_INDEX_MAX_ORDERS ||
+        h.num_rows < 0 || h.num_rows > MUSIC_INDEX_MAX_ROWS ||
+        h.num_codes < 0 || h.num_codes > MUSIC_INDEX_MAX_ROWS) {
+        fclose(f);
+        return -1;
+    }
+
+    index->data_hash = h.data_hash;
+    index->data_size = h.data_size;
+    index->sample_rate = h.sample_rate;
+    index->num_orders = h.num_orders;
+    index->num_codes = h.num_codes;
+    index->end_sample = h.end_sample;
+    index->order_rows = malloc(sizeof(int32_t) * (size_t)h.num_orders);
+    index->codes = malloc(sizeof(music_index_code_t) * (size_t)(h.num_codes + 1));
+    int ok = index->order_rows && index->codes &&
+             fread(index->order_rows, sizeof(int32_t), (size_t)h.num_orders, f) == (size_t)h.num_orders;
+    if (ok) {
+        for (int o = 0; o < h.num_orders; o++) {
+            ok = ok && index->order_rows[o] >= 0 && index->order_rows[o] <= MUSIC_INDEX_MAX_ROWS;
+        }
+    }
+    ok = ok && alloc_rows(index) == 0 && index->num_rows == h.num_rows &&
+         fread(index->row_sample, sizeof(uint32_t), (size_t)h.num_rows, f) == (size_t)h.num_rows &&
+         fread(index->codes, sizeof(music_index_code_t), (size_t)h.num_codes, f) == (size_t)h.num_codes;
+    fclose(f);
+
+    if (ok) {
+        for (int i = 0; i < h.num_codes; i++) {
+            ok = ok && index->codes[i].code >= 0 && index->codes[i].code < MUSIC_INDEX_CODES;
+        }
+    }
+    if (!ok) {
+        music_index_free(index);
+        return -1;
+    }
+    fill_code_first(index);
+    return 0;
+}
+
+int music_index_save(const music_index_t *index, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+
+    music_index_header_t h = {
+        .magic = MUSIC_INDEX_MAGIC,
+        .version = MUSIC_INDEX_VERSION,
+        .data_hash = index->data_hash,
+        .data_size = index->data_size,
+        .sample_rate = index->sample_rate,
+        .num_orders = index->num_orders,
+        .num_rows = index->num_rows,
+        .num_codes = index->num_codes,
+        .end_sample = index->end_sample,
+    };
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(index->order_rows, sizeof(int32_t), (size_t)h.num_orders, f) == (size_t)h.num_orders &&
+             fwrite(index->row_sample, sizeof(uint32_t), (size_t)h.num_rows, f) == (size_t)h.num_rows &&
+             fwrite(index->codes, sizeof(music_index_code_t), (size_t)h.num_codes, f) == (size_t)h.num_codes;
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+uint32_t music_index_row_sample(const music_index_t *index, int order, int row) {
+    if (!index->row_sample || order < 0 || order >= index->num_orders ||
+        row < 0 || row >= index->order_rows[order]) {
+        return MUSIC_INDEX_UNREACHED;
+    }
+    return index->row_sample[index->order_base[order] + row];
+}
+
+int music_index_code_at(const music_index_t *index, uint32_t sample) {
+    /* Last event at or before sample */
+    int lo = 0;
+    int hi = index->num_codes;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (index->codes[mid].sample <= sample) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 ? index->codes[lo - 1].code : 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * Music sync index - Order/row timing and sync codes for a module
+ *
+ * Built once per module from its pattern data and cached on disk next to
+ * the module file, so seeks and sync-code queries need no song scan.
+ * Internal to the music subsystem.
+ */
+
+#ifndef MUSIC_INDEX_H
+#define MUSIC_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Row never reached in playback order */
+#define MUSIC_INDEX_UNREACHED UINT32_MAX
+
+/* Sync codes are the S3M Zxx parameter (the original DIS np_zinfo) */
+#define MUSIC_INDEX_CODES 256
+
+/**
+ * Sync code event: a Zxx effect in playback order
+ */
+typedef struct {
+    uint32_t sample;    /* Start of the row, in samples from song start */
+    int32_t order;
+    int32_t row;
+    int32_t code;
+} music_index_code_t;
+
+/**
+ * Sync index for one module
+ */
+typedef struct {
+    uint32_t data_hash;         /* FNV-1a of the module data (cache key) */
+    uint32_t data_size;
+    int32_t sample_rate;
+    int32_t num_orders;
+    int32_t *order_base;        /* First entry of each order in row_sample */
+    int32_t *order_rows;        /* Rows of each order's pattern */
+    uint32_t *row_sample;       /* Row start in samples, or MUSIC_INDEX_UNREACHED */
+    int32_t num_rows;
+    music_index_code_t *codes;  /* Sorted by sample */
+    int32_t num_codes;
+    uint32_t code_first[MUSIC_INDEX_CODES];     /* First sample of each code */
+    uint32_t end_sample;        /* Song length */
+} music_index_t;
+
+/**
+ * Hash module data for the cache key.
+ * @param data Module data
+ * @param size Size in bytes
+ * @return FNV-1a 32-bit hash
+ */
+uint32_t music_index_hash(const void *data, size_t size);
+
+/**
+ * Build the index from a loaded module.
+ * Seeks the module once per order; the caller resets the position after.
+ * @param index Index to fill (freed first)
+ * @param mod libopenmpt module (openmpt_module *)
+ * @param sample_rate Output sample rate the offsets refer to
+ * @param data_hash Hash of the module data
+ * @param data_size Size of the module data
+ * @return 0 on success, -1 on failure
+ */
+int music_index_build(music_index_t *index, void *mod, int sample_rate,
+                      uint32_t data_hash, uint32_t data_size);
+
+/**
+ * Load a cached index, rejecting it if it belongs to other module data.
+ * @param index Index to fill (freed first)
+ * @param path Cache file path
+ * @param data_hash Expected module data hash
+ * @param data_size Expected module data size
+ * @param sample_rate Expected sample rate
+ * @return 0 on success, -1 if missing, stale or corrupt
+ */
+int music_index_load(music_index_t *index, const char *path, uint32_t data_hash,
+                     uint32_t data_size, int sample_rate);
+
+/**
+ * Write the index to a cache file.
+ * @param index Index to write
+ * @param path Cache file path
+ * @return 0 on success, -1 on failure
+ */
+int music_index_save(const music_index_t *index, const char *path);
+
+/**
+ * Release the index tables.
+ * @param index Index to free (safe on a zeroed or freed index)
+ */
+void music_index_free(music_index_t *index);
+
+/**
+ * Get the start of a row.
+ * @param index Sync index
+ * @param order Order number
+ * @param row Row within the order's pattern
+ * @return Samples from song start, or MUSIC_INDEX_UNREACHED
+ */
+uint32_t music_index_row_sample(const music_index_t *index, int order, int row);
+
+/**
+ * Get the sync code in effect at a song position.
+ * @param index Sync index
+ * @param sample Samples from song start
+ * @return Last code at or before sample, 0 if none
+ */
+int music_index_code_at(const music_index_t *index, uint32_t sample);
+
+#endif /* MUSIC_INDEX_H */
@@ -0,0 +1,146 @@
+/**
+ * Music PCM cache - Implementation
+ *
+ * File layout: header, PCM (16-bit interleaved stereo), timeline. The PCM
+ * is streamed to disk while rendering; the timeline is kept in memory
+ * (12 bytes per step) and appended, then the header is rewritten.
+ */
+
+#include "music_pcm.h"
+#include <libopenmpt/libopenmpt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MUSIC_PCM_MAGIC 0x43505253u     /* "SRPC" */
+#define MUSIC_PCM_VERSION 1
+
+/* Stop rendering modules that never end (one hour at 48 kHz) */
+#define MUSIC_PCM_MAX_FRAMES (48000u * 3600u)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t data_hash;
+    uint32_t data_size;
+    int32_t sample_rate;
+    int32_t step;
+    uint32_t num_frames;
+    uint32_t num_steps;
+    uint32_t pcm_offset;
+    uint32_t timeline_offset;
+} music_pcm_header_t;
+
+static double tempo_of(openmpt_module *mod) {
+#if defined(OPENMPT_API_VERSION_AT_LEAST)
+#if OPENMPT_API_VERSION_AT_LEAST(0, 7, 0)
+    return openmpt_module_get_current_tempo2(mod);
+#else
+    return (double)openmpt_module_get_current_tempo(mod);
+#endif
+#else
+    return openmpt_module_get_current_tempo2(mod);
+#endif
+}
+
+int music_pcm_build(const char *path, void *module, int sample_rate, int step,
+                    uint32_t data_hash, uint32_t data_size) {
+    openmpt_module *mod = module;
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+
+    music_pcm_header_t h = {
+        .magic = MUSIC_PCM_MAGIC,
+        .version = MUSIC_PCM_VERSION,
+        .data_hash = data_hash,
+        .data_size = data_size,
+        .sample_rate = sample_rate,
+        .step = step,
+        .pcm_offset = sizeof(music_pcm_header_t),
+    };
+    int16_t *block = malloc(sizeof(int16_t) * 2 * (size_t)step);
+    size_t capacity = 4096;
+    music_pcm_step_t *timeline = malloc(sizeof(music_pcm_step_t) * capacity);
+    int ok = block && timeline && fwrite(&h, sizeof(h), 1, f) == 1;
+
+    while (ok && h.num_frames < MUSIC_PCM_MAX_FRAMES) {
+        size_t got = openmpt_module_read_interleaved_stereo(mod, sample_rate, (size_t)step, block);
+        if (got == 0) {
+            break;
+        }
+        if (h.num_steps == capacity) {
+            capacity *= 2;
+            music_pcm_step_t *grown = realloc(timeline, sizeof(music_pcm_step_t) * capacity);
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            timeline = grown;
+        }
+        double tempo = tempo_of(mod);
+        music_pcm_step_t *s = &timeline[h.num_steps++];
+        s->order = (int16_t)openmpt_module_get_current_order(mod);
+        s->pattern = (int16_t)openmpt_module_get_current_pattern(mod);
+        s->row = (int16_t)openmpt_module_get_current_row(mod);
+        s->speed = (int16_t)openmpt_module_get_current_speed(mod);
+        s->tick_samples = tempo > 0.0 ? (float)(sample_rate * 2.5 / tempo) : 0.0f;
+
+        ok = fwrite(block, sizeof(int16_t) * 2, got, f) == got;
+        h.num_frames += (uint32_t)got;
+        if (got < (size_t)step) {
+            break;
+        }
+    }
+
+    h.timeline_offset = h.pcm_offset + h.num_frames * 4;
+    ok = ok && h.num_frames > 0 &&
+         fwrite(timeline, sizeof(music_pcm_step_t), h.num_steps, f) == h.num_steps &&
+         fseek(f, 0, SEEK_SET) == 0 && fwrite(&h, sizeof(h), 1, f) == 1;
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    free(block);
+    free(timeline);
+    if (!ok) {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+int music_pcm_open(music_pcm_t *pcm, const char *path, int sample_rate, int step,
+                   uint32_t data_hash, uint32_t data_size) {
+    memset(pcm, 0, sizeof(*pcm));
+    if (mapfile_open(&pcm->map, path) != 0) {
+        return -1;
+    }
+
+    const music_pcm_header_t *h = pcm->map.data;
+    size_t size = pcm->map.size;
+    if (size < sizeof(*h) || h->magic != MUSIC_PCM_MAGIC || h->version != MUSIC_PCM_VERSION ||
+        h->data_hash != data_hash || h->data_size != data_size ||
+        h->sample_rate != sample_rate || h->step != step ||
+        h->num_frames == 0 || h->num_frames > MUSIC_PCM_MAX_FRAMES ||
+        h->num_steps != (h->num_frames + (uint32_t)step - 1) / (uint32_t)step ||
+        h->pcm_offset != sizeof(*h) ||
+        h->timeline_offset != h->pcm_offset + h->num_frames * 4 ||
+        (size_t)h->timeline_offset + (size_t)h->num_steps * sizeof(music_pcm_step_t) != size) {
+        mapfile_close(&pcm->map);
+        return -1;
+    }
+
+    const uint8_t *base = pcm->map.data;
+    pcm->pcm = (const int16_t *)(base + h->pcm_offset);
+    pcm->timeline = (const music_pcm_step_t *)(base + h->timeline_offset);
+    pcm->num_frames = h->num_frames;
+    pcm->num_steps = h->num_steps;
+    pcm->step = step;
+    return 0;
+}
+
+void music_pcm_close(music_pcm_t *pcm) {
+    mapfile_close(&pcm->map);
+    memset(pcm, 0, sizeof(*pcm));
+}
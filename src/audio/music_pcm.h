@@ -0,0 +1,72 @@
+/**
+ * Music PCM cache - A module pre-rendered to 16-bit PCM with its timeline
+ *
+ * The whole song is rendered once at the playback sample rate into
+ * MODULE.pcm and memory-mapped afterwards, so playback is a copy instead
+ * of libopenmpt mixing. A timeline sampled every render step keeps the
+ * order/pattern/row/speed/tempo the live renderer would have reported,
+ * so DIS sync is identical in both modes. Internal to the music subsystem.
+ */
+
+#ifndef MUSIC_PCM_H
+#define MUSIC_PCM_H
+
+#include "core/mapfile.h"
+#include <stdint.h>
+
+/**
+ * Module state after one render step
+ */
+typedef struct {
+    int16_t order;
+    int16_t pattern;
+    int16_t row;
+    int16_t speed;
+    float tick_samples;         /* Tick length in samples (0 if unknown) */
+} music_pcm_step_t;
+
+/**
+ * Mapped PCM cache
+ */
+typedef struct {
+    mapfile_t map;
+    const int16_t *pcm;                 /* Interleaved stereo */
+    const music_pcm_step_t *timeline;   /* One entry per step frames */
+    uint32_t num_frames;
+    uint32_t num_steps;
+    int step;
+} music_pcm_t;
+
+/**
+ * Render a module from its current position to a cache file.
+ * @param path Cache file path
+ * @param mod libopenmpt module (openmpt_module *), left at its end
+ * @param sample_rate Render sample rate
+ * @param step Frames per timeline entry
+ * @param data_hash Hash of the module data (cache key)
+ * @param data_size Size of the module data
+ * @return 0 on success, -1 on failure (no file is left behind)
+ */
+int music_pcm_build(const char *path, void *mod, int sample_rate, int step,
+                    uint32_t data_hash, uint32_t data_size);
+
+/**
+ * Map a cache file, rejecting it if it belongs to other data or settings.
+ * @param pcm Receives the mapping
+ * @param path Cache file path
+ * @param sample_rate Expected sample rate
+ * @param step Expected frames per timeline entry
+ * @param data_hash Expected module data hash
+ * @param data_size Expected module data size
+ * @return 0 on success, -1 if missing, stale or corrupt
+ */
+int music_pcm_open(music_pcm_t *pcm, const char *path, int sample_rate, int step,
+                   uint32_t data_hash, uint32_t data_size);
+
+/**
+ * Unmap a cache (safe on a zeroed or closed cache).
+ * @param pcm Cache to close
+ */
+void music_pcm_close(music_pcm_t *pcm);
+
+#endif /* MUSIC_PCM_H */
@@ -11,6 +11,25 @@ bool music_init(void) {
     return true;
 }
 
+bool music_init_offline(void) {
+    return true;
+}
+
+int music_render_offline(float *buffer, int num_frames) {
+    for (int i = 0; i < num_frames * 2; i++) {
+        buffer[i] = 0.0f;
+    }
+    return 0;
+}
+
+int music_get_sample_rate(void) {
+    return 48000;
+}
+
+int music_get_render_rate(void) {
+    return 48000;
+}
+
 void music_shutdown(void) {
 }
 
@@ -25,6 +44,36 @@ bool music_load_file(const char *path) {
     return false;
 }
 
+void music_set_pcm_cache(bool enabled) {
+    (void)enabled;
+}
+
+bool music_load_file_async(const char *path, music_load_fn callback, void *user_data) {
+    (void)path;
+    (void)callback;
+    (void)user_data;
+    return false;
+}
+
+music_load_state_t music_load_poll(void) {
+    return MUSIC_LOAD_IDLE;
+}
+
+music_load_state_t music_load_wait(void) {
+    return MUSIC_LOAD_IDLE;
+}
+
+const char *music_load_pending_path(void) {
+    return NULL;
+}
+
+bool music_load_commit(void) {
+    return false;
+}
+
+void music_load_cancel(void) {
+}
+
 void music_unload(void) {
 }
 
@@ -41,6 +90,20 @@ bool music_is_playing(void) {
     return false;
 }
 
+void music_get_position(music_position_t *pos) {
+    pos->order = 0;
+    pos->pattern = 0;
+    pos->row = 0;
+    pos->tick = 0;
+    pos->seconds = 0.0;
+    pos->samples = 0;
+}
+
+double music_get_audible_position(music_position_t *pos) {
+    music_get_position(pos);
+    return 0.0;
+}
+
 double music_get_position_seconds(void) {
     return 0.0;
 }
@@ -62,10 +125,40 @@ void music_set_position(int order, int row) {
     (void)row;
 }
 
+void music_set_render_hook(music_render_hook_fn hook) {
+    (void)hook;
+}
+
 double music_get_duration(void) {
     return 0.0;
 }
 
+double music_get_row_time(int order, int row) {
+    (void)order;
+    (void)row;
+    return -1.0;
+}
+
+int music_get_sync_code(int order, int row) {
+    (void)order;
+    (void)row;
+    return 0;
+}
+
+bool music_sync_code_passed(int code, int order, int row) {
+    (void)code;
+    (void)order;
+    (void)row;
+    return false;
+}
+
+bool music_find_sync_code(int code, int *order, int *row) {
+    (void)code;
+    (void)order;
+    (void)row;
+    return false;
+}
+
 int music_get_num_orders(void) {
     return 0;
 }
@@ -0,0 +1,385 @@
+/**
+ * Benchmarks - Microbenchmarks for the core video, rasterizer, DIS and music paths
+ *
+ * Runs on the headless core (sokol_gfx dummy backend), so GPU work drops
+ * out and numbers reflect CPU cost only. Each benchmark runs a warm-up
+ * pass and then BENCH_RUNS timed passes; the median is reported to keep
+ * results stable between runs.
+ *
+ * Usage: benchmarks [--music PATH] [--frames N] [--filter NAME]
+ */
+
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#include "core/dis.h"
+#include "core/video.h"
+#include "core/video_convert.h"
+#include "core/part.h"
+#include "audio/music.h"
+#include "parts/parts.h"
+#include "visu/visu.h"
+#include "visu/visu_span.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Timed passes per benchmark (median reported) */
+#define BENCH_RUNS 7
+
+/* Audio block matching music_init(): packet_frames */
+#define BENCH_AUDIO_PACKET 512
+
+typedef void (*bench_fn)(int iterations);
+
+static struct {
+    const char *filter;     /* Only run benchmarks whose name contains this */
+} bench_state;
+
+static uint8_t s_palette[768];
+static float s_audio[BENCH_AUDIO_PACKET * 2];
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Median nanoseconds per iteration */
+static double bench_measure(bench_fn fn, int iterations) {
+    double runs[BENCH_RUNS];
+    fn(iterations); /* Warm-up */
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        uint64_t start = stm_now();
+        fn(iterations);
+        runs[r] = stm_ns(stm_since(start)) / (double)iterations;
+    }
+    qsort(runs, BENCH_RUNS, sizeof(runs[0]), compare_double);
+    return runs[BENCH_RUNS / 2];
+}
+
+static int bench_enabled(const char *name) {
+    return !bench_state.filter || strstr(name, bench_state.filter) != NULL;
+}
+
+/* Report ns/op, plus ns/unit when an op covers several units (pixels, samples) */
+static double bench_report(const char *name, bench_fn fn, int iterations,
+                           double units, const char *unit) {
+    if (!bench_enabled(name)) {
+        return 0.0;
+    }
+    double ns = bench_measure(fn, iterations);
+    if (units > 1.0) {
+        printf("%-28s %12.1f ns/op %10.3f ns/%s\n", name, ns, ns / units, unit);
+    } else {
+        printf("%-28s %12.1f ns/op\n", name, ns);
+    }
+    return ns;
+}
+
+/* Video */
+
+static uint32_t s_rgba[VIDEO_WIDTH * VIDEO_HEIGHT_X];
+static video_lut_t s_lut;
+
+/* One frame as the player draws it: video_present() inside a swapchain
+ * pass (the window size main.c asks for), then the commit that ends the
+ * frame and lets the next one update the textures again */
+static void bench_frame(void) {
+    sg_begin_pass(&(sg_pass){
+        .swapchain = {
+            .width = VIDEO_WIDTH,
+            .height = VIDEO_HEIGHT_13H,
+            .sample_count = 1,
+            .color_format = SG_PIXELFORMAT_RGBA8,
+            .depth_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+        },
+    });
+    video_present();
+    sg_end_pass();
+    sg_commit();
+}
+
+static void fill_framebuffer(void) {
+    uint8_t *fb = video_get_framebuffer();
+    for (int i = 0; i < VIDEO_MEMORY_SIZE; i++) {
+        fb[i] = (uint8_t)(i * 7 + (i >> 9));
+    }
+}
+
+static void bench_kernel_scalar(int iterations) {
+    const uint8_t *fb = video_get_framebuffer();
+    for (int i = 0; i < iterations; i++) {
+        video_convert_scalar(s_rgba, fb, VIDEO_WIDTH * VIDEO_HEIGHT_13H, &s_lut);
+    }
+}
+
+static void bench_kernel_selected(int iterations) {
+    const uint8_t *fb = video_get_framebuffer();
+    for (int i = 0; i < iterations; i++) {
+        video_convert(s_rgba, fb, VIDEO_WIDTH * VIDEO_HEIGHT_13H, &s_lut);
+    }
+}
+
+/* CPU present: convert_framebuffer_to_rgba() plus a no-op upload */
+static void bench_present(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        bench_frame();
+    }
+}
+
+/* Palette change forces rebuild_rgba_lut(); with the GPU path and clean
+ * explicit dirty rows nothing else runs but the 1KB palette upload */
+static void bench_present_palette(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        video_set_color((uint8_t)i, (uint8_t)(i & 63), 0, 0);
+        bench_frame();
+    }
+}
+
+static void bench_clear(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        video_clear((uint8_t)i);
+    }
+}
+
+/* The count is a uint8_t, so 255 colors is the most one call sets */
+static void bench_palette_range(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        video_set_palette_range(0, 255, s_palette);
+    }
+}
+
+static void bench_video(void) {
+    fill_framebuffer();
+    for (int i = 0; i < 256; i++) {
+        s_lut.rgba[i] = 0xFF000000u | (uint32_t)i * 0x010101u;
+    }
+    video_convert_prepare_lut(&s_lut);
+    for (int i = 0; i < 768; i++) {
+        s_palette[i] = (uint8_t)(i & 63);
+    }
+
+    double pixels_13h = VIDEO_WIDTH * VIDEO_HEIGHT_13H;
+    double pixels_x = VIDEO_WIDTH * VIDEO_HEIGHT_X;
+    char name[64];
+
+    bench_report("convert_kernel_scalar", bench_kernel_scalar, 200, pixels_13h, "px");
+    snprintf(name, sizeof(name), "convert_kernel_%s", video_get_convert_kernel());
+    bench_report(name, bench_kernel_selected, 200, pixels_13h, "px");
+
+    video_set_present_mode(VIDEO_PRESENT_CPU);
+    video_set_dirty_tracking(VIDEO_DIRTY_OFF);
+
+    video_set_mode(VIDEO_MODE_13H);
+    bench_report("convert_framebuffer_13h", bench_present, 200, pixels_13h, "px");
+    video_set_mode(VIDEO_MODE_X);
+    bench_report("convert_framebuffer_x", bench_present, 200, pixels_x, "px");
+
+    video_set_present_mode(VIDEO_PRESENT_GPU);
+    bench_report("present_gpu_indexed_x", bench_present, 200, pixels_x, "px");
+    video_set_dirty_tracking(VIDEO_DIRTY_EXPLICIT);
+    bench_frame();
+    bench_report("rebuild_rgba_lut", bench_present_palette, 20000, 256, "color");
+    video_set_dirty_tracking(VIDEO_DIRTY_OFF);
+    video_set_present_mode(VIDEO_PRESENT_CPU);
+    video_set_mode(VIDEO_MODE_13H);
+
+    bench_report("video_clear", bench_clear, 500, VIDEO_MEMORY_SIZE, "byte");
+    bench_report("video_set_palette_range", bench_palette_range, 20000, 255, "color");
+}
+
+/* VISU */
+
+/* Full-width spans and a ring of triangles covering most of the screen */
+#define BENCH_VISU_TRIS 32
+
+static uint8_t s_span[VIDEO_WIDTH];
+static visu_vertex_t s_tris[BENCH_VISU_TRIS][3];
+
+static void bench_span_gouraud_scalar(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        visu_span_gouraud_scalar(s_span, VIDEO_WIDTH, 0x1000, (int16_t)(i & 255));
+    }
+}
+
+static void bench_span_gouraud(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        visu_span_gouraud(s_span, VIDEO_WIDTH, 0x1000, (int16_t)(i & 255));
+    }
+}
+
+static void bench_span_glenz(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        visu_span_glenz(s_span, VIDEO_WIDTH, (uint8_t)i);
+    }
+}
+
+static void bench_poly(int mode, int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        for (int t = 0; t < BENCH_VISU_TRIS; t++) {
+            visu_poly(s_tris[t], 3, mode, (uint8_t)(t * 8 + 1));
+        }
+    }
+}
+
+static void bench_poly_flat(int iterations) { bench_poly(VISU_FILL_FLAT, iterations); }
+static void bench_poly_gouraud(int iterations) { bench_poly(VISU_FILL_GOURAUD, iterations); }
+static void bench_poly_glenz(int iterations) { bench_poly(VISU_FILL_GLENZ, iterations); }
+
+static void bench_visu(void) {
+    /* Fans around the screen center, overhanging every window side */
+    for (int t = 0; t < BENCH_VISU_TRIS; t++) {
+        double a0 = t * 6.283185307179586 / BENCH_VISU_TRIS;
+        double a1 = (t + 1) * 6.283185307179586 / BENCH_VISU_TRIS;
+        s_tris[t][0] = (visu_vertex_t){ 160, 100, 0x2000 };
+        s_tris[t][1] = (visu_vertex_t){ (int16_t)(160 + 200 * cos(a0)), (int16_t)(100 + 130 * sin(a0)), 0x3F00 };
+        s_tris[t][2] = (visu_vertex_t){ (int16_t)(160 + 200 * cos(a1)), (int16_t)(100 + 130 * sin(a1)), 0x0100 };
+    }
+    char name[64];
+
+    bench_report("visu_span_gouraud_scalar", bench_span_gouraud_scalar, 100000, VIDEO_WIDTH, "px");
+    snprintf(name, sizeof(name), "visu_span_gouraud_%s", visu_get_span_kernel());
+    bench_report(name, bench_span_gouraud, 100000, VIDEO_WIDTH, "px");
+    bench_report("visu_span_glenz", bench_span_glenz, 100000, VIDEO_WIDTH, "px");
+
+    visu_window(0, 0, VIDEO_WIDTH - 1, VIDEO_HEIGHT_13H - 1);
+    bench_report("visu_poly_flat", bench_poly_flat, 500, BENCH_VISU_TRIS, "poly");
+    bench_report("visu_poly_gouraud", bench_poly_gouraud, 500, BENCH_VISU_TRIS, "poly");
+    bench_report("visu_poly_glenz", bench_poly_glenz, 500, BENCH_VISU_TRIS, "poly");
+}
+
+/* DIS */
+
+static volatile int s_copper_hits;
+
+static void copper_top(void) { s_copper_hits++; }
+static void copper_bottom(void) { s_copper_hits++; }
+static void copper_retrace(void) { s_copper_hits++; }
+
+static void bench_waitb(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        dis_frame_tick();
+        dis_waitb();
+    }
+}
+
+static void bench_dis(void) {
+    dis_setcopper(0, copper_top);
+    dis_setcopper(1, copper_bottom);
+    dis_setcopper(2, copper_retrace);
+    bench_report("dis_waitb_3_coppers", bench_waitb, 200000, 1, NULL);
+    dis_reset();
+}
+
+/* Music */
+
+static void bench_music_block(int iterations) {
+    for (int i = 0; i < iterations; i++) {
+        music_render_offline(s_audio, BENCH_AUDIO_PACKET);
+    }
+}
+
+static void bench_music(const char *path) {
+    if (!bench_enabled("music_render") || !path) {
+        return;
+    }
+    if (!music_load_file(path)) {
+        printf("%-28s skipped (no module)\n", "music_render_512");
+        return;
+    }
+    music_play();
+    double ns = bench_report("music_render_512", bench_music_block, 200,
+                             BENCH_AUDIO_PACKET, "frame");
+    double realtime_ns = 1e9 * BENCH_AUDIO_PACKET / music_get_render_rate();
+    printf("%-28s %12.1f x realtime\n", "music_render_512", realtime_ns / ns);
+    music_unload();
+}
+
+/* Full part */
+
+static void bench_part_frames(int iterations) {
+    for (int i = 0; i < iterations && part_loader_is_running(); i++) {
+        dis_frame_tick();
+        part_loader_tick();
+        part_loader_render();
+    }
+}
+
+/* Start part p on a fresh loader so every pass runs the same frames */
+static sr_part_t *start_part(int p) {
+    part_loader_init();
+    parts_register_all();
+    if (part_loader_start(p) != 0) {
+        return NULL;
+    }
+    return part_loader_current();
+}
+
+/* Run each registered part from its start for N virtual frames */
+static void bench_parts(int frames) {
+    part_loader_init();
+    parts_register_all();
+    int count = part_loader_get_count();
+    part_loader_shutdown();
+
+    for (int p = 0; p < count; p++) {
+        char name[64];
+        sr_part_t *part = start_part(p);
+        part_loader_shutdown();
+        snprintf(name, sizeof(name), "part_%s", part && part->name ? part->name : "?");
+        if (!part || !bench_enabled(name)) {
+            continue;
+        }
+
+        double runs[BENCH_RUNS];
+        for (int r = 0; r < BENCH_RUNS; r++) {
+            start_part(p);
+            uint64_t start = stm_now();
+            bench_part_frames(frames);
+            runs[r] = stm_sec(stm_since(start));
+            part_loader_shutdown();
+        }
+        qsort(runs, BENCH_RUNS, sizeof(runs[0]), compare_double);
+        double sec = runs[BENCH_RUNS / 2];
+        printf("%-28s %12.1f frames/s (%d frames)\n", name, sec > 0.0 ? frames / sec : 0.0, frames);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *music_path = "MAIN/MUSIC0.S3M";
+    int part_frames = 150;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--music") == 0) {
+            music_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            part_frames = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--filter") == 0) {
+            bench_state.filter = argv[i + 1];
+        } else {
+            fprintf(stderr, "Usage: %s [--music PATH] [--frames N] [--filter NAME]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    dis_version();
+    sg_setup(&(sg_desc){ 0 });
+    stm_setup();
+    video_init();
+    visu_init();
+    music_init_offline();
+
+    printf("Second Reality benchmarks (median of %d runs, kernel: %s)\n\n",
+           BENCH_RUNS, video_get_convert_kernel());
+    bench_video();
+    bench_visu();
+    bench_dis();
+    bench_music(music_path);
+    bench_parts(part_frames);
+
+    music_shutdown();
+    video_shutdown();
+    sg_shutdown();
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * Arena Allocator - Implementation
+ */
+
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Heap chunk for allocations past capacity; data follows the header */
+struct arena_chunk {
+    arena_chunk_t *next;
+    size_t size;
+};
+
+#define ARENA_CHUNK_HEADER \
+    ((sizeof(arena_chunk_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void *aligned_block(size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, ARENA_ALIGN);
+#else
+    void *block = NULL;
+    return posix_memalign(&block, ARENA_ALIGN, size) == 0 ? block : NULL;
+#endif
+}
+
+static void aligned_release(void *block) {
+#if defined(_WIN32)
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+int arena_init(arena_t *arena, size_t capacity, int hard_cap) {
+    memset(arena, 0, sizeof(*arena));
+    capacity = align_up(capacity);
+    arena->base = capacity ? aligned_block(capacity) : NULL;
+    if (capacity && !arena->base) {
+        return -1;
+    }
+    arena->capacity = capacity;
+    arena->hard_cap = hard_cap;
+    return 0;
+}
+
+void arena_destroy(arena_t *arena) {
+    arena_reset(arena);
+    aligned_release(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+    size = align_up(size ? size : 1);
+    void *block;
+    if (size <= arena->capacity - arena->offset) {
+        block = arena->base + arena->offset;
+        arena->offset += size;
+    } else if (arena->hard_cap) {
+        return NULL;
+    } else {
+        arena_chunk_t *chunk = aligned_block(ARENA_CHUNK_HEADER + size);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = arena->spill;
+        chunk->size = size;
+        arena->spill = chunk;
+        block = (unsigned char *)chunk + ARENA_CHUNK_HEADER;
+    }
+
+    arena->used += size;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+    arena->last = block;
+    arena->last_size = size;
+    return block;
+}
+
+int arena_free(arena_t *arena, void *block) {
+    if (!block || block != arena->last) {
+        return -1;
+    }
+    if (arena->spill && block == (unsigned char *)arena->spill + ARENA_CHUNK_HEADER) {
+        arena_chunk_t *chunk = arena->spill;
+        arena->spill = chunk->next;
+        aligned_release(chunk);
+    } else {
+        arena->offset -= arena->last_size;
+    }
+    arena->used -= arena->last_size;
+    arena->last = NULL;
+    arena->last_size = 0;
+    return 0;
+}
+
+void arena_reset(arena_t *arena) {
+    while (arena->spill) {
+        arena_chunk_t *next = arena->spill->next;
+        aligned_release(arena->spill);
+        arena->spill = next;
+    }
+    arena->offset = 0;
+    arena->used = 0;
+    arena->peak = 0;
+    arena->last = NULL;
+    arena->last_size = 0;
+}
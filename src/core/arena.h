@@ -0,0 +1,73 @@
+/**
+ * Arena Allocator - Bump allocation released in one shot
+ *
+ * One block is reserved up front and handed out in 16-byte aligned
+ * pieces; arena_reset() returns everything at once, so a user that
+ * allocates during init and frees on exit causes no heap churn. Past the
+ * reserved block, allocations spill into heap chunks unless the arena has
+ * a hard cap, and the high-water mark records how much was really needed.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Allocation alignment */
+#define ARENA_ALIGN 16
+
+typedef struct arena_chunk arena_chunk_t;
+
+/**
+ * Arena
+ */
+typedef struct {
+    unsigned char *base;        /* Reserved block */
+    size_t capacity;            /* Size of the reserved block */
+    size_t offset;              /* Next free byte in the reserved block */
+    size_t used;                /* Bytes allocated, including spill chunks */
+    size_t peak;                /* High-water mark of used since arena_reset() */
+    int hard_cap;               /* Fail allocations past capacity instead of spilling */
+    void *last;                 /* Most recent allocation (arena_free() target) */
+    size_t last_size;
+    arena_chunk_t *spill;       /* Heap chunks past capacity */
+} arena_t;
+
+/**
+ * Reserve an arena.
+ * @param arena Arena to set up
+ * @param capacity Bytes to reserve
+ * @param hard_cap 1 to fail allocations past capacity, 0 to spill to the heap
+ * @return 0 on success, -1 if out of memory
+ */
+int arena_init(arena_t *arena, size_t capacity, int hard_cap);
+
+/**
+ * Release the reserved block and any spill chunks.
+ * @param arena Arena (safe on a zeroed or destroyed arena)
+ */
+void arena_destroy(arena_t *arena);
+
+/**
+ * Allocate from the arena.
+ * @param arena Arena
+ * @param size Bytes (rounded up to ARENA_ALIGN)
+ * @return ARENA_ALIGN-aligned memory, or NULL past a hard cap or out of memory
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * Give back the most recent allocation; others stay until arena_reset().
+ * @param arena Arena
+ * @param block Pointer from arena_alloc()
+ * @return 0 if the space was reclaimed, -1 if not the most recent block
+ */
+int arena_free(arena_t *arena, void *block);
+
+/**
+ * Release every allocation and restart the high-water mark.
+ * @param arena Arena
+ */
+void arena_reset(arena_t *arena);
+
+#endif /* ARENA_H */
@@ -0,0 +1,126 @@
+/**
+ * Assets - Implementation
+ *
+ * Every load starts from pack_readfile(): a baked blob is recognised by
+ * its header whether it sits in a pack or in a loose file, anything else
+ * is converted from the original format by its extension. Tables the
+ * table service generates never reach the loader.
+ */
+
+#include "asset.h"
+#include "asset_bake.h"
+#include "pack.h"
+#include "part.h"
+#include "table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Copy a converted payload into part memory and drop the heap copy */
+static const uint8_t *keep_payload(const char *name, uint8_t *payload, size_t size) {
+    uint8_t *block = payload ? part_getmem(size) : NULL;
+    if (block) {
+        memcpy(block, payload, size);
+    } else if (payload) {
+        fprintf(stderr, "ASSET: ERROR No part memory for %s (%zu bytes)\n", name, size);
+    }
+    free(payload);
+    return block;
+}
+
+/* Get the payload of a baked blob or converted original.
+ * @param type Expected ASSET_TYPE_*
+ * @return Payload (in the pack when stored, else in part memory), NULL on error */
+static const uint8_t *load_payload(const char *name, int type, size_t *size) {
+    size_t file_size;
+    const uint8_t *data = pack_readfile(name, &file_size);
+    if (!data) {
+        return NULL;
+    }
+
+    asset_header_t header;
+    if (file_size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+    }
+    if (file_size < sizeof(header) || header.magic != ASSET_MAGIC) {
+        /* Original file: convert it now */
+        uint8_t *payload = NULL;
+        if (type == ASSET_TYPE_TABLE && bake_has_extension(name, ".INC")) {
+            payload = bake_inc(name, (const char *)data, file_size, size);
+        } else if (type == ASSET_TYPE_IMAGE && bake_has_extension(name, ".LBM")) {
+            payload = bake_lbm(name, data, file_size, size);
+        } else {
+            fprintf(stderr, "ASSET: ERROR %s is neither baked nor a known original\n", name);
+        }
+        pack_release(data);
+        return keep_payload(name, payload, *size);
+    }
+
+    /* A stored payload is read in place or copied: it must fit the entry */
+    if (header.version != ASSET_VERSION || header.type != type ||
+        header.packed_size > file_size - sizeof(header) ||
+        (!(header.flags & ASSET_FLAG_LZ) && header.size > header.packed_size)) {
+        fprintf(stderr, "ASSET: ERROR Bad baked blob: %s\n", name);
+        pack_release(data);
+        return NULL;
+    }
+    const uint8_t *payload = data + sizeof(header);
+    *size = header.size;
+    if (!(header.flags & ASSET_FLAG_LZ) && !pack_is_loose(data)) {
+        return payload;     /* Zero-copy: valid as long as the pack is open */
+    }
+
+    /* Unpacked, or copied out of a loose file, which is released below */
+    uint8_t *block = part_getmem(header.size);
+    int ok = block != NULL;
+    if (ok && (header.flags & ASSET_FLAG_LZ)) {
+        ok = bake_lz_decompress(payload, header.packed_size, block, header.size) == 0;
+    } else if (ok) {
+        memcpy(block, payload, header.size);
+    }
+    if (!ok) {
+        fprintf(stderr, "ASSET: ERROR Cannot unpack %s\n", name);
+        part_freemem(block);
+        block = NULL;
+    }
+    pack_release(data);
+    return block;
+}
+
+const void *asset_table(const char *name, size_t *size) {
+    int id = table_find(name);
+    if (id >= 0) {
+        return table_get((table_id_t)id, size);
+    }
+
+    size_t n = 0;
+    const void *table = load_payload(name, ASSET_TYPE_TABLE, &n);
+    if (table && size) {
+        *size = n;
+    }
+    return table;
+}
+
+int asset_image(const char *name, asset_image_t *image) {
+    size_t size = 0;
+    const uint8_t *payload = load_payload(name, ASSET_TYPE_IMAGE, &size);
+    if (!payload) {
+        return -1;
+    }
+
+    asset_image_header_t header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "ASSET: ERROR Truncated image: %s\n", name);
+        return -1;
+    }
+    memcpy(&header, payload, sizeof(header));
+    if ((size_t)header.width * header.height > size - sizeof(header)) {
+        fprintf(stderr, "ASSET: ERROR Truncated image: %s\n", name);
+        return -1;
+    }
+    image->width = header.width;
+    image->height = header.height;
+    image->palette = payload + offsetof(asset_image_header_t, palette);
+    image->pixels = payload + sizeof(header);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * Assets - Baked tables and pictures from the pack loader
+ *
+ * Parts load precalculated .INC tables and .LBM pictures by their
+ * original names (e.g. PLZPART/TILE.INC). The srbake tool stores them in
+ * the demo pack already converted, as baked blobs with a 16-byte header,
+ * so an uncompressed blob is served as a pointer into the mapped pack
+ * with no parsing or copying. LZ-compressed blobs are unpacked into part
+ * memory. Without a baked pack the loose originals are converted on the
+ * fly, at the startup cost the baker exists to remove.
+ *
+ * Main thread, or a part's prepare callback.
+ */
+
+#ifndef ASSET_H
+#define ASSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Baked blob header fields */
+#define ASSET_MAGIC         0x53415253u     /* "SRAS" */
+#define ASSET_VERSION       1
+#define ASSET_TYPE_TABLE    1               /* Assembled .INC data */
+#define ASSET_TYPE_IMAGE    2               /* asset_image_header_t + pixels */
+#define ASSET_FLAG_LZ       1               /* Payload is an LZ4 block */
+
+/**
+ * Baked blob header, followed by the payload (16-byte aligned in a pack)
+ */
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t type;               /* ASSET_TYPE_* */
+    uint8_t flags;              /* ASSET_FLAG_* */
+    uint8_t reserved;
+    uint32_t size;              /* Payload bytes, unpacked */
+    uint32_t packed_size;       /* Payload bytes as stored */
+} asset_header_t;
+
+/**
+ * Image payload header, followed by width * height chunky pixels.
+ * The size keeps the pixels 16-byte aligned.
+ */
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t reserved[12];
+    uint8_t palette[768];       /* VGA components 0-63, for video_set_palette() */
+} asset_image_header_t;
+
+/**
+ * Picture loaded from a baked blob or a loose .LBM
+ */
+typedef struct {
+    int width;
+    int height;
+    const uint8_t *palette;     /* 768 bytes, components 0-63 */
+    const uint8_t *pixels;      /* width * height, one byte per pixel */
+} asset_image_t;
+
+/**
+ * Load a precalculated table.
+ * Sine, divide and similar tables come from table_get(), generated once
+ * and shared by all parts for the whole run. Baked, uncompressed and in
+ * a pack: points into the pack. Otherwise the table is unpacked, copied
+ * out of the loose file or assembled into part memory (freed when the
+ * part ends); the loose file itself is released at once.
+ * @param name Original file name (e.g. "PLZPART/TILE.INC")
+ * @param size Receives the table size in bytes (may be NULL)
+ * @return 16-byte aligned read-only table, or NULL on error
+ */
+const void *asset_table(const char *name, size_t *size);
+
+/**
+ * Load a picture.
+ * Memory follows the same rules as asset_table().
+ * @param name Original file name (e.g. "JPLOGO/PIC.LBM")
+ * @param image Receives the size, palette and pixels
+ * @return 0 on success, -1 on error
+ */
+int asset_image(const char *name, asset_image_t *image);
+
+#endif /* ASSET_H */
@@ -0,0 +1,688 @@
+/**
+ * Asset Baking - Implementation
+ *
+ * The .INC assembler handles only what the data tables use; the
+ * generated code includes (ZOOMLOOP.INC, THELOOP.INC and the like) are
+ * rebuilt in C by the ports and rejected here.
+ *
+ * LZ blobs use the LZ4 block format (token, literals, 16-bit offset,
+ * match length, minimum match 4), compressed greedily with a hash of the
+ * next four bytes. Decompression checks every length against both
+ * buffers, so a corrupt pack fails instead of overrunning.
+ */
+
+#include "asset_bake.h"
+#include "asset.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Output that grows as the table is assembled */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} bake_buffer_t;
+
+/* Parser position inside one source line */
+typedef struct {
+    const char *p;
+    const char *end;
+    const char *name;
+    int line;
+} bake_cursor_t;
+
+/* Deepest N dup (...) nesting */
+#define BAKE_MAX_DUP_DEPTH 8
+
+/* LZ4 block limits: the last match starts 12 bytes before the end and
+ * the last 5 bytes are always literals */
+#define BAKE_LZ_MIN_MATCH 4
+#define BAKE_LZ_MFLIMIT 12
+#define BAKE_LZ_LAST_LITERALS 5
+#define BAKE_LZ_MAX_OFFSET 65535
+#define BAKE_LZ_HASH_BITS 14
+
+static int buffer_reserve(bake_buffer_t *b, size_t size) {
+    if (b->size + size > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+        while (capacity < b->size + size) {
+            capacity *= 2;
+        }
+        uint8_t *grown = realloc(b->data, capacity);
+        if (!grown) {
+            return -1;
+        }
+        b->data = grown;
+        b->capacity = capacity;
+    }
+    return 0;
+}
+
+static int buffer_put(bake_buffer_t *b, const void *data, size_t size) {
+    if (buffer_reserve(b, size) != 0) {
+        return -1;
+    }
+    memcpy(b->data + b->size, data, size);
+    b->size += size;
+    return 0;
+}
+
+/* Append a copy of bytes already in the buffer (may move the buffer) */
+static int buffer_repeat(bake_buffer_t *b, size_t start, size_t size) {
+    if (buffer_reserve(b, size) != 0) {
+        return -1;
+    }
+    memcpy(b->data + b->size, b->data + start, size);
+    b->size += size;
+    return 0;
+}
+
+/* Table assembly */
+
+static void skip_space(bake_cursor_t *c) {
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r')) {
+        c->p++;
+    }
+}
+
+static int is_word_char(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+           ch == '_' || ch == '@' || ch == '$' || ch == '?';
+}
+
+/* Length of the identifier or number at the cursor */
+static size_t word_length(const bake_cursor_t *c) {
+    size_t n = 0;
+    while (c->p + n < c->end && is_word_char(c->p[n])) {
+        n++;
+    }
+    return n;
+}
+
+static int word_is(const bake_cursor_t *c, size_t length, const char *word) {
+    size_t n = strlen(word);
+    if (length != n) {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        char ch = c->p[i];
+        if (ch >= 'A' && ch <= 'Z') {
+            ch = (char)(ch - 'A' + 'a');
+        }
+        if (ch != word[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Directive width for db/dw/dd, 0 for anything else */
+static int directive_width(const bake_cursor_t *c, size_t length) {
+    return word_is(c, length, "db") ? 1 : word_is(c, length, "dw") ? 2 :
+           word_is(c, length, "dd") ? 4 : 0;
+}
+
+static int parse_error(const bake_cursor_t *c, const char *what) {
+    fprintf(stderr, "BAKE: ERROR %s:%d: %s\n", c->name, c->line, what);
+    return -1;
+}
+
+/* Number in TASM notation: decimal, 0FFh hex, 101b binary, ? for zero */
+static int parse_number(bake_cursor_t *c, long long *value) {
+    int negative = 0;
+    skip_space(c);
+    if (c->p < c->end && (*c->p == '-' || *c->p == '+')) {
+        negative = *c->p == '-';
+        c->p++;
+        skip_space(c);
+    }
+    size_t n = word_length(c);
+    if (n == 1 && *c->p == '?') {
+        c->p++;
+        *value = 0;
+        return 0;
+    }
+    if (n == 0 || c->p[0] < '0' || c->p[0] > '9') {
+        return parse_error(c, "expected a number");
+    }
+
+    int base = 10;
+    size_t digits = n;
+    char suffix = c->p[n - 1];
+    if (suffix == 'h' || suffix == 'H') {
+        base = 16;
+        digits--;
+    } else if ((suffix == 'b' || suffix == 'B') && n > 1) {
+        base = 2;
+        digits--;
+    }
+    long long v = 0;
+    for (size_t i = 0; i < digits; i++) {
+        char ch = c->p[i];
+        int d = (ch >= '0' && ch <= '9') ? ch - '0' :
+                (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 :
+                (ch >= 'A' && ch <= 'F') ? ch - 'A' + 10 : 99;
+        if (d >= base || v > 0xFFFFFFFFLL) {
+            return parse_error(c, "bad number");
+        }
+        v = v * base + d;
+    }
+    c->p += n;
+    *value = negative ? -v : v;
+    return 0;
+}
+
+static int emit_value(bake_cursor_t *c, bake_buffer_t *out, int width, long long value) {
+    long long lo = width == 1 ? -128 : width == 2 ? -32768 : -2147483648LL;
+    long long hi = width == 1 ? 255 : width == 2 ? 65535 : 4294967295LL;
+    if (value < lo || value > hi) {
+        return parse_error(c, "value out of range");
+    }
+    uint8_t bytes[4];
+    uint32_t v = (uint32_t)value;
+    for (int i = 0; i < width; i++) {
+        bytes[i] = (uint8_t)(v >> (8 * i));
+    }
+    return buffer_put(out, bytes, (size_t)width) == 0 ? 0 : parse_error(c, "out of memory");
+}
+
+/* Comma-separated values up to the end of the line, or to ')' inside dup */
+static int parse_values(bake_cursor_t *c, bake_buffer_t *out, int width, int depth) {
+    for (;;) {
+        skip_space(c);
+        if (c->p < c->end && (*c->p == '\'' || *c->p == '"')) {
+            char quote = *c->p++;
+            const char *start = c->p;
+            while (c->p < c->end && *c->p != quote) {
+                c->p++;
+            }
+            if (c->p == c->end || width != 1) {
+                return parse_error(c, width != 1 ? "strings need db" : "unterminated string");
+            }
+            if (buffer_put(out, start, (size_t)(c->p - start)) != 0) {
+                return parse_error(c, "out of memory");
+            }
+            c->p++;
+        } else {
+            long long value;
+            if (parse_number(c, &value) != 0) {
+                return -1;
+            }
+            skip_space(c);
+            size_t n = word_length(c);
+            if (word_is(c, n, "dup")) {
+                c->p += n;
+                skip_space(c);
+                if (c->p == c->end || *c->p != '(' || depth >= BAKE_MAX_DUP_DEPTH || value < 0) {
+                    return parse_error(c, "bad dup");
+                }
+                c->p++;
+                size_t start = out->size;
+                if (parse_values(c, out, width, depth + 1) != 0) {
+                    return -1;
+                }
+                if (c->p == c->end || *c->p != ')') {
+                    return parse_error(c, "expected )");
+                }
+                c->p++;
+                /* Repeat the group value - 1 more times */
+                size_t group = out->size - start;
+                for (long long r = 1; r < value; r++) {
+                    if (buffer_repeat(out, start, group) != 0) {
+                        return parse_error(c, "out of memory");
+                    }
+                }
+                if (value == 0) {
+                    out->size = start;
+                }
+            } else if (emit_value(c, out, width, value) != 0) {
+                return -1;
+            }
+        }
+        skip_space(c);
+        if (c->p < c->end && *c->p == ',') {
+            c->p++;
+            continue;
+        }
+        if (c->p == c->end || (depth > 0 && *c->p == ')')) {
+            return 0;
+        }
+        return parse_error(c, "expected , or end of line");
+    }
+}
+
+static int pad_to(bake_buffer_t *out, size_t align) {
+    static const uint8_t zero[16];
+    while (out->size % align != 0) {
+        if (buffer_put(out, zero, align - out->size % align > 16 ? 16 : align - out->size % align) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Assemble one source line */
+static int parse_line(bake_cursor_t *c, bake_buffer_t *out) {
+    skip_space(c);
+    if (c->p == c->end) {
+        return 0;
+    }
+    size_t n = word_length(c);
+    if (n == 0) {
+        return parse_error(c, "not a data directive");
+    }
+
+    if (word_is(c, n, "even")) {
+        c->p += n;
+        return pad_to(out, 2) == 0 ? 0 : parse_error(c, "out of memory");
+    }
+    if (word_is(c, n, "align")) {
+        long long align;
+        c->p += n;
+        if (parse_number(c, &align) != 0) {
+            return -1;
+        }
+        if (align <= 0 || align > 4096 || (align & (align - 1)) != 0) {
+            return parse_error(c, "bad ALIGN");
+        }
+        return pad_to(out, (size_t)align) == 0 ? 0 : parse_error(c, "out of memory");
+    }
+
+    int width = directive_width(c, n);
+    if (width == 0) {
+        /* A label: "name db ..." or "name LABEL type" */
+        c->p += n;
+        skip_space(c);
+        if (c->p < c->end && *c->p == ':') {
+            c->p++;
+            skip_space(c);
+        }
+        n = word_length(c);
+        if (word_is(c, n, "label")) {
+            return 0;
+        }
+        width = directive_width(c, n);
+        if (width == 0) {
+            return parse_error(c, "not a data directive");
+        }
+    }
+    c->p += n;
+    return parse_values(c, out, width, 0);
+}
+
+int bake_has_extension(const char *name, const char *ext) {
+    size_t n = strlen(name);
+    size_t e = strlen(ext);
+    if (n < e) {
+        return 0;
+    }
+    for (size_t i = 0; i < e; i++) {
+        char c = name[n - e + i];
+        if (c >= 'a' && c <= 'z') {
+            c = (char)(c - 'a' + 'A');
+        }
+        if (c != ext[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+uint8_t *bake_inc(const char *name, const char *text, size_t length, size_t *size) {
+    bake_buffer_t out = { NULL, 0, 0 };
+    bake_cursor_t c = { text, text, name, 0 };
+    const char *end = text + length;
+
+    while (c.p < end) {
+        const char *eol = memchr(c.p, '\n', (size_t)(end - c.p));
+        const char *next = eol ? eol + 1 : end;
+        eol = eol ? eol : end;
+
+        /* Comments run from ';' outside quotes to the end of the line */
+        const char *stop = c.p;
+        char quote = 0;
+        for (; stop < eol; stop++) {
+            if (quote) {
+                quote = *stop == quote ? 0 : quote;
+            } else if (*stop == '\'' || *stop == '"') {
+                quote = *stop;
+            } else if (*stop == ';') {
+                break;
+            }
+        }
+        c.end = stop;
+        c.line++;
+        if (parse_line(&c, &out) != 0) {
+            free(out.data);
+            return NULL;
+        }
+        c.p = next;
+    }
+    if (out.size == 0) {
+        fprintf(stderr, "BAKE: ERROR %s: no data\n", name);
+        free(out.data);
+        return NULL;
+    }
+    *size = out.size;
+    return out.data;
+}
+
+/* Picture decoding */
+
+static uint32_t get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t get_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* Unpack one ByteRun1 (or stored) row of count bytes.
+ * @return Bytes of body consumed, or 0 on corrupt input */
+static size_t unpack_row(const uint8_t *src, size_t avail, uint8_t *dst, size_t count, int packed) {
+    if (!packed) {
+        if (avail < count) {
+            return 0;
+        }
+        memcpy(dst, src, count);
+        return count;
+    }
+    size_t s = 0;
+    size_t d = 0;
+    while (d < count) {
+        if (s >= avail) {
+            return 0;
+        }
+        int n = (int8_t)src[s++];
+        if (n >= 0) {
+            size_t run = (size_t)n + 1;
+            if (d + run > count || s + run > avail) {
+                return 0;
+            }
+            memcpy(dst + d, src + s, run);
+            s += run;
+            d += run;
+        } else if (n != -128) {
+            size_t run = (size_t)(1 - n);
+            if (d + run > count || s >= avail) {
+                return 0;
+            }
+            memset(dst + d, src[s++], run);
+            d += run;
+        }
+    }
+    return s;
+}
+
+uint8_t *bake_lbm(const char *name, const uint8_t *data, size_t length, size_t *size) {
+    if (length < 12 || memcmp(data, "FORM", 4) != 0 ||
+        (memcmp(data + 8, "PBM ", 4) != 0 && memcmp(data + 8, "ILBM", 4) != 0)) {
+        fprintf(stderr, "BAKE: ERROR %s: not an IFF PBM or ILBM picture\n", name);
+        return NULL;
+    }
+    int planar = memcmp(data + 8, "ILBM", 4) == 0;
+    size_t form_end = 8 + (size_t)get_be32(data + 4);
+    if (form_end > length) {
+        form_end = length;
+    }
+
+    const uint8_t *bmhd = NULL;
+    const uint8_t *cmap = NULL;
+    const uint8_t *body = NULL;
+    size_t cmap_size = 0;
+    size_t body_size = 0;
+    for (size_t pos = 12; pos + 8 <= form_end;) {
+        size_t chunk = get_be32(data + pos + 4);
+        const uint8_t *payload = data + pos + 8;
+        if (chunk > form_end - pos - 8) {
+            chunk = form_end - pos - 8;
+        }
+        if (memcmp(data + pos, "BMHD", 4) == 0 && chunk >= 20) {
+            bmhd = payload;
+        } else if (memcmp(data + pos, "CMAP", 4) == 0) {
+            cmap = payload;
+            cmap_size = chunk;
+        } else if (memcmp(data + pos, "BODY", 4) == 0) {
+            body = payload;
+            body_size = chunk;
+        }
+        pos += 8 + chunk + (chunk & 1);
+    }
+    if (!bmhd || !body) {
+        fprintf(stderr, "BAKE: ERROR %s: missing BMHD or BODY\n", name);
+        return NULL;
+    }
+
+    int width = get_be16(bmhd);
+    int height = get_be16(bmhd + 2);
+    int planes = bmhd[8];
+    int masking = bmhd[9];
+    int packed = bmhd[10];
+    if (width == 0 || height == 0 || packed > 1 || (planar && (planes == 0 || planes > 8)) ||
+        (!planar && planes != 8)) {
+        fprintf(stderr, "BAKE: ERROR %s: unsupported %dx%d, %d planes, compression %d\n",
+                name, width, height, planes, packed);
+        return NULL;
+    }
+
+    size_t pixels = (size_t)width * (size_t)height;
+    uint8_t *out = calloc(1, sizeof(asset_image_header_t) + pixels);
+    /* PBM rows are padded to even bytes; ILBM rows hold one word-aligned
+     * bit row per plane, plus the mask plane for mskHasMask (1) */
+    size_t row_bytes = planar ? (size_t)((width + 15) / 16) * 2 : (size_t)((width + 1) & ~1);
+    int row_planes = planar ? planes + (masking == 1) : 1;
+    uint8_t *row = malloc(row_bytes * (size_t)row_planes);
+    if (!out || !row) {
+        free(out);
+        free(row);
+        return NULL;
+    }
+
+    asset_image_header_t *header = (asset_image_header_t *)out;
+    header->width = (uint16_t)width;
+    header->height = (uint16_t)height;
+    for (size_t i = 0; i < 768 && i < cmap_size; i++) {
+        header->palette[i] = (uint8_t)(cmap[i] >> 2);
+    }
+
+    uint8_t *dst = out + sizeof(asset_image_header_t);
+    size_t s = 0;
+    for (int y = 0; y < height; y++, dst += width) {
+        for (int p = 0; p < row_planes; p++) {
+            size_t used = unpack_row(body + s, body_size - s, row + (size_t)p * row_bytes, row_bytes, packed);
+            if (used == 0) {
+                fprintf(stderr, "BAKE: ERROR %s: truncated BODY at row %d\n", name, y);
+                free(out);
+                free(row);
+                return NULL;
+            }
+            s += used;
+        }
+        if (!planar) {
+            memcpy(dst, row, (size_t)width);
+            continue;
+        }
+        for (int x = 0; x < width; x++) {
+            uint8_t px = 0;
+            for (int p = 0; p < planes; p++) {
+                px |= (uint8_t)(((row[(size_t)p * row_bytes + (x >> 3)] >> (7 - (x & 7))) & 1) << p);
+            }
+            dst[x] = px;
+        }
+    }
+    free(row);
+    *size = sizeof(asset_image_header_t) + pixels;
+    return out;
+}
+
+/* LZ4 block codec */
+
+/* Write an LZ4 length continuation (the part past the 4-bit token field) */
+static int lz_put_length(uint8_t *dst, size_t capacity, size_t *d, size_t length) {
+    while (length >= 255) {
+        if (*d >= capacity) {
+            return -1;
+        }
+        dst[(*d)++] = 255;
+        length -= 255;
+    }
+    if (*d >= capacity) {
+        return -1;
+    }
+    dst[(*d)++] = (uint8_t)length;
+    return 0;
+}
+
+/* One sequence: literals, then a match unless match_length is 0 */
+static int lz_put_sequence(uint8_t *dst, size_t capacity, size_t *d, const uint8_t *literals,
+                           size_t literal_length, size_t offset, size_t match_length) {
+    size_t ml = match_length ? match_length - BAKE_LZ_MIN_MATCH : 0;
+    if (*d >= capacity) {
+        return -1;
+    }
+    dst[(*d)++] = (uint8_t)(((literal_length < 15 ? literal_length : 15) << 4) | (ml < 15 ? ml : 15));
+    if (literal_length >= 15 && lz_put_length(dst, capacity, d, literal_length - 15) != 0) {
+        return -1;
+    }
+    if (literal_length > capacity - *d) {
+        return -1;
+    }
+    memcpy(dst + *d, literals, literal_length);
+    *d += literal_length;
+    if (match_length == 0) {
+        return 0;
+    }
+    if (capacity - *d < 2) {
+        return -1;
+    }
+    dst[(*d)++] = (uint8_t)offset;
+    dst[(*d)++] = (uint8_t)(offset >> 8);
+    if (ml >= 15 && lz_put_length(dst, capacity, d, ml - 15) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t lz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+size_t bake_lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity) {
+    uint32_t *table = calloc((size_t)1 << BAKE_LZ_HASH_BITS, sizeof(uint32_t));
+    if (!table || size > UINT32_MAX - 1) {
+        free(table);
+        return 0;
+    }
+
+    size_t d = 0;
+    size_t anchor = 0;
+    size_t ip = 0;
+    size_t limit = size > BAKE_LZ_MFLIMIT ? size - BAKE_LZ_MFLIMIT : 0;
+    while (ip < limit) {
+        uint32_t h = (lz_read32(src + ip) * 2654435761u) >> (32 - BAKE_LZ_HASH_BITS);
+        size_t ref = table[h];      /* Position + 1, 0 = empty */
+        table[h] = (uint32_t)(ip + 1);
+        if (ref == 0 || ip - (ref - 1) > BAKE_LZ_MAX_OFFSET ||
+            lz_read32(src + ref - 1) != lz_read32(src + ip)) {
+            ip++;
+            continue;
+        }
+        ref--;
+        size_t length = BAKE_LZ_MIN_MATCH;
+        while (ip + length < size - BAKE_LZ_LAST_LITERALS && src[ref + length] == src[ip + length]) {
+            length++;
+        }
+        if (lz_put_sequence(dst, capacity, &d, src + anchor, ip - anchor, ip - ref, length) != 0) {
+            free(table);
+            return 0;
+        }
+        ip += length;
+        anchor = ip;
+    }
+    free(table);
+    if (lz_put_sequence(dst, capacity, &d, src + anchor, size - anchor, 0, 0) != 0) {
+        return 0;
+    }
+    return d;
+}
+
+/* Read an LZ4 length continuation */
+static int lz_get_length(const uint8_t *src, size_t packed_size, size_t *s, size_t *length) {
+    uint8_t b;
+    do {
+        if (*s >= packed_size) {
+            return -1;
+        }
+        b = src[(*s)++];
+        *length += b;
+    } while (b == 255);
+    return 0;
+}
+
+int bake_lz_decompress(const uint8_t *src, size_t packed_size, uint8_t *dst, size_t size) {
+    size_t s = 0;
+    size_t d = 0;
+    while (s < packed_size) {
+        uint8_t token = src[s++];
+        size_t literals = token >> 4;
+        if (literals == 15 && lz_get_length(src, packed_size, &s, &literals) != 0) {
+            return -1;
+        }
+        if (literals > packed_size - s || literals > size - d) {
+            return -1;
+        }
+        memcpy(dst + d, src + s, literals);
+        s += literals;
+        d += literals;
+        if (s == packed_size) {
+            break;      /* Last sequence has no match */
+        }
+
+        if (packed_size - s < 2) {
+            return -1;
+        }
+        size_t offset = src[s] | ((size_t)src[s + 1] << 8);
+        s += 2;
+        size_t length = token & 15;
+        if (length == 15 && lz_get_length(src, packed_size, &s, &length) != 0) {
+            return -1;
+        }
+        length += BAKE_LZ_MIN_MATCH;
+        if (offset == 0 || offset > d || length > size - d) {
+            return -1;
+        }
+        /* Byte copy: matches may overlap their own output */
+        for (size_t i = 0; i < length; i++, d++) {
+            dst[d] = dst[d - offset];
+        }
+    }
+    return d == size ? 0 : -1;
+}
+
+uint8_t *bake_blob(int type, const uint8_t *payload, size_t size, int compress, size_t *blob_size) {
+    if (size > UINT32_MAX) {
+        return NULL;
+    }
+    uint8_t *blob = malloc(sizeof(asset_header_t) + size);
+    if (!blob) {
+        return NULL;
+    }
+
+    asset_header_t header = { ASSET_MAGIC, ASSET_VERSION, (uint8_t)type, 0, 0,
+                              (uint32_t)size, (uint32_t)size };
+    /* Keep the compressed form only when it saves something */
+    size_t packed = compress && size > 1 ?
+                    bake_lz_compress(payload, size, blob + sizeof(header), size - 1) : 0;
+    if (packed > 0) {
+        header.flags = ASSET_FLAG_LZ;
+        header.packed_size = (uint32_t)packed;
+    } else {
+        memcpy(blob + sizeof(header), payload, size);
+    }
+    memcpy(blob, &header, sizeof(header));
+    *blob_size = sizeof(header) + header.packed_size;
+    return blob;
+}
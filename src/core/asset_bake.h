@@ -0,0 +1,86 @@
+/**
+ * Asset Baking - Conversion of original data files into baked blobs
+ *
+ * Modern counterpart of UTIL/DOOBJ and UTIL/LBM2P. Turns the TASM data
+ * tables (.INC) into the bytes the assembler would have emitted and
+ * Deluxe Paint pictures (.LBM, PBM or ILBM) into chunky pixels with a VGA
+ * palette, then wraps either in the baked blob format of asset.h with
+ * optional LZ compression.
+ *
+ * Used by the srbake tool at build time, and by asset.c to convert loose
+ * originals when no baked pack is present. Functions only touch their
+ * arguments, so any thread may call them.
+ */
+
+#ifndef ASSET_BAKE_H
+#define ASSET_BAKE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Check the extension of an original file name, ignoring case.
+ * @param name File name (e.g. "PLZPART/TILE.INC")
+ * @param ext Extension in upper case, with the dot (e.g. ".INC")
+ * @return 1 if name ends in ext, 0 if not
+ */
+int bake_has_extension(const char *name, const char *ext);
+
+/**
+ * Assemble the data directives of an .INC table.
+ * Accepts db/dw/dd lists (decimal, 0FFh hex, 101b binary, negative
+ * values, N dup (V) and quoted strings for db), optional labels and
+ * "name LABEL type" lines, ALIGN N and EVEN. Anything else (code,
+ * OFFSET, macros) is rejected with the offending line.
+ * @param name Source name for error messages
+ * @param text Source text (need not be terminated)
+ * @param length Source length in bytes
+ * @param size Receives the table size in bytes
+ * @return Table bytes (free() them), or NULL on error
+ */
+uint8_t *bake_inc(const char *name, const char *text, size_t length, size_t *size);
+
+/**
+ * Decode an IFF picture (FORM PBM or FORM ILBM, 8 planes or fewer,
+ * uncompressed or ByteRun1) into an image payload: asset_image_header_t
+ * followed by width * height chunky pixels.
+ * @param name Source name for error messages
+ * @param data File contents
+ * @param length File size in bytes
+ * @param size Receives the payload size in bytes
+ * @return Image payload (free() it), or NULL on error
+ */
+uint8_t *bake_lbm(const char *name, const uint8_t *data, size_t length, size_t *size);
+
+/**
+ * Wrap a payload into a baked blob (asset_header_t + payload).
+ * @param type ASSET_TYPE_TABLE or ASSET_TYPE_IMAGE
+ * @param payload Payload bytes
+ * @param size Payload size in bytes
+ * @param compress 1 to store LZ-compressed when that is smaller
+ * @param blob_size Receives the blob size in bytes
+ * @return Blob (free() it), or NULL if out of memory
+ */
+uint8_t *bake_blob(int type, const uint8_t *payload, size_t size, int compress, size_t *blob_size);
+
+/**
+ * Compress with the LZ4 block format (greedy, 64 KB window).
+ * @param src Input
+ * @param size Input size in bytes
+ * @param dst Output buffer
+ * @param capacity Output buffer size
+ * @return Compressed size, or 0 if it does not fit in capacity
+ */
+size_t bake_lz_compress(const uint8_t *src, size_t size, uint8_t *dst, size_t capacity);
+
+/**
+ * Decompress an LZ4 block.
+ * @param src Compressed data
+ * @param packed_size Compressed size in bytes
+ * @param dst Output buffer
+ * @param size Exact decompressed size in bytes
+ * @return 0 on success, -1 on corrupt input
+ */
+int bake_lz_decompress(const uint8_t *src, size_t packed_size, uint8_t *dst, size_t size);
+
+#endif /* ASSET_BAKE_H */
@@ -3,10 +3,18 @@
  *
  * Reimplements the original DOS interrupt-driven DIS server using
  * Sokol's frame-based callback system.
+ *
+ * Retraces come from a virtual 70 Hz clock: the timer clock counts
+ * elapsed ticks of a monotonic timer, the music clock counts them off
+ * the audible sample position so parts stay locked to the speakers.
+ * Either way several retraces can pass in one display frame (slow
+ * display) or none (high refresh rate), as dis_waitb() always allowed.
  */
 
 #include "dis.h"
+#include "profile.h"
 #include "audio/music.h"
+#include "sokol_time.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -16,20 +24,33 @@ static struct {
     int exit_flag;
     int frame_counter;
     int music_frame;
-    int music_code;
+    int music_order;
+    int music_code;             /* Zxx sync code in effect */
     int music_row;
     int music_plus;
+    int music_frac;             /* Heard part of the row, 0-255 */
+    uint64_t music_samples;     /* Audible sample of the latched position */
     uint8_t msg_areas[DIS_MSG_AREA_COUNT][DIS_MSG_AREA_SIZE];
     dis_copper_fn copper[DIS_COPPER_COUNT];
+
+    /* Virtual retrace clock */
+    dis_clock_t clock;
+    uint64_t timer_origin;      /* sokol_time tick the timer counts from */
+    uint64_t timer_ticks;       /* Retraces reported since timer_origin */
+    int music_anchored;         /* music_tick is valid */
+    uint64_t music_tick;        /* Retrace of the last latched music position */
 } dis_state;
 
 int dis_version(void) {
     /* Clear transient state */
     dis_state.exit_flag = 0;
     dis_state.frame_counter = 0;
+    dis_state.music_order = 0;
     dis_state.music_code = 0;
     dis_state.music_row = 0;
     dis_state.music_plus = 0;
+    dis_state.music_frac = 0;
+    dis_state.music_samples = 0;
 
     /* Mark as initialized */
     dis_state.initialized = 1;
@@ -45,18 +66,24 @@ int dis_waitb(void) {
     int frames;
 
     /* Execute copper callbacks in order: top, bottom, retrace */
+    PROFILE_BEGIN(PROFILE_ZONE_COPPER);
     for (int i = 0; i < DIS_COPPER_COUNT; i++) {
         if (dis_state.copper[i]) {
             dis_state.copper[i]();
         }
     }
+    PROFILE_END(PROFILE_ZONE_COPPER);
 
     /* Return frame count and reset */
     frames = dis_state.frame_counter;
     if (frames == 0) {
         frames = 1; /* Always return at least 1 */
     }
-    /* NOTE: Not thread-safe. Must be called from the same thread as dis_frame_tick() */
+    /* The counter and the music latch are written by dis_frame_tick() on
+     * the main thread, once per frame. Pipelined, parts call this on the
+     * render thread between pipeline_kick() and the end of the frame, and
+     * the main thread leaves DIS alone until pipeline_busy() clears; the
+     * pipeline's mutex orders the two, so nothing here is locked */
     dis_state.frame_counter = 0;
 
     return frames;
@@ -71,24 +98,49 @@ int dis_indemo(void) {
     return 1;
 }
 
+/* Latch the audible music position for this frame. Small backward steps
+ * (callback jitter against the extrapolation) are held so rows never
+ * repeat; larger ones are seeks and pass through. */
+static void latch_music(void) {
+    music_position_t pos;
+    double fraction = music_get_audible_position(&pos);
+    uint64_t hold = (uint64_t)music_get_render_rate() / 20;
+    if (pos.samples < dis_state.music_samples &&
+        dis_state.music_samples - pos.samples < hold) {
+        return;
+    }
+    dis_state.music_order = pos.order;
+    dis_state.music_code = music_get_sync_code(pos.order, pos.row);
+    dis_state.music_row = pos.row;
+    dis_state.music_plus = pos.order * 64 + pos.row;
+    dis_state.music_frac = (int)(fraction * 256.0);
+    dis_state.music_samples = pos.samples;
+}
+
 int dis_muscode(int code) {
-    (void)code; /* Parameter reserved for skip logic */
-    /* Return current order from music subsystem */
-    return music_get_current_order();
+    /* Original parts wait with while (dis_muscode(X) != X), so report X
+     * once it has been reached; after a seek past it they do not hang */
+    if (code > 0 && music_sync_code_passed(code, dis_state.music_order, dis_state.music_row)) {
+        return code;
+    }
+    return dis_state.music_code;
 }
 
 int dis_musplus(void) {
     /* Returns order*64 + row for sync calculations.
-     * In tracker terms: order is position in pattern sequence. */
-    int order = music_get_current_order();
-    int row = music_get_current_row();
-    return order * 64 + row;
+     * In tracker terms: order is position in pattern sequence.
+     * Latched once per frame, so order and row always belong together. */
+    return dis_state.music_plus;
+}
+
+int dis_musfrac(void) {
+    return dis_state.music_frac;
 }
 
 int dis_musrow(int row) {
     (void)row; /* Parameter reserved for skip logic */
-    /* Return current row from music subsystem */
-    return music_get_current_row();
+    /* Current row as heard at this frame */
+    return dis_state.music_row;
 }
 
 void *dis_msgarea(int areanumber) {
@@ -124,8 +176,59 @@ int dis_sync(void) {
 
 /* Internal Sokol integration functions */
 
-void dis_frame_tick(void) {
-    dis_state.frame_counter++;
+void dis_set_clock(dis_clock_t clock) {
+    if (clock != DIS_CLOCK_FRAMES && dis_state.clock == DIS_CLOCK_FRAMES) {
+        stm_setup();
+    }
+    dis_state.clock = clock;
+    dis_state.timer_origin = stm_now();
+    dis_state.timer_ticks = 0;
+    dis_state.music_anchored = 0;
+}
+
+/* Retraces of the monotonic timer since the last call, capped */
+static int timer_ticks(void) {
+    uint64_t total = (uint64_t)(stm_sec(stm_since(dis_state.timer_origin)) * DIS_TICK_RATE);
+    uint64_t ticks = total - dis_state.timer_ticks;
+    if (ticks > DIS_MAX_TICKS) {
+        ticks = DIS_MAX_TICKS;  /* Stalled: drop the backlog */
+        dis_state.timer_ticks = total - ticks;
+    }
+    dis_state.timer_ticks += ticks;
+    return (int)ticks;
+}
+
+/* Retraces of the audible music position since the last call. Seeks and
+ * stops re-anchor; the timer runs on from here while music is stopped. */
+static int music_ticks(void) {
+    if (!music_is_playing()) {
+        dis_state.music_anchored = 0;
+        return timer_ticks();
+    }
+    uint64_t tick = dis_state.music_samples * DIS_TICK_RATE / (uint64_t)music_get_render_rate();
+    int ticks = 0;
+    if (dis_state.music_anchored && tick >= dis_state.music_tick) {
+        uint64_t n = tick - dis_state.music_tick;
+        ticks = n > DIS_MAX_TICKS ? DIS_MAX_TICKS : (int)n;
+    }
+    dis_state.music_anchored = 1;
+    dis_state.music_tick = tick;
+    dis_state.timer_origin = stm_now();
+    dis_state.timer_ticks = 0;
+    return ticks;
+}
+
+int dis_frame_tick(void) {
+    latch_music();
+
+    int ticks = 1;
+    if (dis_state.clock == DIS_CLOCK_TIMER) {
+        ticks = timer_ticks();
+    } else if (dis_state.clock == DIS_CLOCK_MUSIC) {
+        ticks = music_ticks();
+    }
+    dis_state.frame_counter += ticks;
+    return ticks;
 }
 
 void dis_handle_event(const sapp_event *e) {
@@ -149,9 +252,10 @@ void dis_reset(void) {
     /* Clear transient state for part transitions */
     dis_state.exit_flag = 0;
     dis_state.frame_counter = 0;
-    dis_state.music_code = 0;
-    dis_state.music_row = 0;
-    dis_state.music_plus = 0;
+
+    /* Re-latch so a part starting after a seek sees the new position */
+    dis_state.music_samples = 0;
+    latch_music();
 
     /* Clear copper callbacks */
     for (int i = 0; i < DIS_COPPER_COUNT; i++) {
@@ -4,10 +4,12 @@
  * Original DIS was an interrupt-driven server for DOS that provided:
  * - Frame synchronization (dis_waitb)
  * - Inter-part communication (dis_msgarea)
- * - Music synchronization (dis_muscode, dis_musrow, dis_musplus)
+ * - Music synchronization (dis_muscode, dis_musrow, dis_musplus, dis_musfrac)
  * - Copper-like raster interrupts (dis_setcopper)
  *
  * This implementation provides the same API using Sokol's frame callbacks.
+ * The "vblank" is a virtual 70 Hz VGA clock, so display refresh rate does
+ * not change how fast parts run (see dis_set_clock()).
  */
 
 #ifndef DIS_H
@@ -23,6 +25,21 @@
 #define DIS_MSG_AREA_SIZE  64
 #define DIS_MSG_AREA_COUNT 4
 
+/* Virtual vertical retrace rate (VGA 320x200/320x400) */
+#define DIS_TICK_RATE 70
+
+/* Ticks one dis_frame_tick() reports at most; a longer stall is dropped */
+#define DIS_MAX_TICKS 7
+
+/**
+ * What drives the virtual retrace
+ */
+typedef enum {
+    DIS_CLOCK_FRAMES = 0,   /* One tick per dis_frame_tick() (offline, fixed-rate callers) */
+    DIS_CLOCK_TIMER,        /* Monotonic timer at DIS_TICK_RATE */
+    DIS_CLOCK_MUSIC         /* Audible music position; timer while music is stopped */
+} dis_clock_t;
+
 /* Copper callback count (0=top, 1=bottom, 2=retrace) */
 #define DIS_COPPER_COUNT 3
 
@@ -48,7 +65,7 @@ void dis_partstart(void);
  * Returns frame count since last call.
  * In the cross-platform implementation, this is non-blocking and adapts
  * to Sokol's frame callback model instead of blocking for vblank.
- * @return Frame count since last call
+ * @return Virtual 70 Hz retraces since last call (at least 1)
  */
 int dis_waitb(void);
 
@@ -65,18 +82,27 @@ int dis_exit(void);
 int dis_indemo(void);
 
 /**
- * Get current music synchronization code.
- * @param code The code being waited for (for future skip logic, not currently used)
- * @return Current music code (stub: returns 0)
+ * Get current music synchronization code (S3M Zxx parameter).
+ * @param code The code being waited for
+ * @return code if it has been reached at the audible position, otherwise
+ *         the code currently in effect (0 before the first one)
  */
 int dis_muscode(int code);
 
 /**
  * Get music plus value for synchronization.
- * @return Music plus value
+ * Like dis_muscode() and dis_musrow(), reflects the audible position
+ * (output latency compensated) latched at the last dis_frame_tick().
+ * @return Music plus value (order * 64 + row)
  */
 int dis_musplus(void);
 
+/**
+ * Get how far into the current row playback is, for sub-row sync.
+ * @return Heard fraction of the row in 1/256 units (0-255)
+ */
+int dis_musfrac(void);
+
 /**
  * Get music row synchronization.
  * @param row The row being waited for (for future skip logic, not currently used)
@@ -119,11 +145,20 @@ int dis_sync(void);
 
 /* Internal functions for Sokol integration */
 
+/**
+ * Select the clock behind dis_frame_tick() (default DIS_CLOCK_FRAMES).
+ * Call before profile_init(): the timer clocks set up sokol_time.
+ * @param clock DIS_CLOCK_FRAMES, DIS_CLOCK_TIMER or DIS_CLOCK_MUSIC
+ */
+void dis_set_clock(dis_clock_t clock);
+
 /**
  * Called each frame by Sokol frame callback.
- * Increments frame counter and manages timing.
+ * Advances the virtual retrace and latches the audible music position.
+ * @return Retraces elapsed since the last call (0 to DIS_MAX_TICKS); with
+ *         0 the part has nothing new to show and rendering can be skipped
  */
-void dis_frame_tick(void);
+int dis_frame_tick(void);
 
 /**
  * Handle Sokol events (key presses, etc).
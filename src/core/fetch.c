@@ -0,0 +1,258 @@
+/**
+ * Asset Fetch - Implementation
+ *
+ * Web: requests are queued and started FETCH_PARALLEL at a time with
+ * emscripten_fetch(). Its callbacks run on the browser's main thread
+ * between frames, when nothing reads the packs; the web build has no
+ * worker threads that could. Progress goes to Module.setStatus(), which
+ * the Emscripten page shell shows under the canvas.
+ *
+ * Native: every request completes inside fetch_request().
+ */
+
+#include "fetch.h"
+#include "pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/emscripten.h>
+#include <emscripten/fetch.h>
+#include <sys/stat.h>
+#endif
+
+typedef struct {
+    const char *path;
+    int flags;
+    fetch_status_t status;
+    int order;                  /* Queue position, lowest starts first */
+    int started;
+    size_t loaded;
+    size_t total;
+    void *data;                 /* Pack contents, owned until shutdown */
+#if defined(__EMSCRIPTEN__)
+    emscripten_fetch_t *fetch;
+#endif
+} fetch_entry_t;
+
+static struct {
+    fetch_entry_t entries[FETCH_MAX_REQUESTS];
+    int count;
+    int active;                 /* Downloads in flight */
+    int front;                  /* Next FETCH_URGENT order (counts down) */
+    int back;                   /* Next queued order (counts up) */
+} fetch_state;
+
+static fetch_entry_t *find_entry(const char *path) {
+    for (int i = 0; i < fetch_state.count; i++) {
+        if (strcmp(fetch_state.entries[i].path, path) == 0) {
+            return &fetch_state.entries[i];
+        }
+    }
+    return NULL;
+}
+
+void fetch_init(void) {
+    fetch_shutdown();
+}
+
+void fetch_get_progress(fetch_progress_t *progress) {
+    memset(progress, 0, sizeof(*progress));
+    for (int i = 0; i < fetch_state.count; i++) {
+        const fetch_entry_t *e = &fetch_state.entries[i];
+        progress->loaded += e->loaded;
+        progress->total += e->total;
+        progress->done += e->status != FETCH_PENDING;
+    }
+    progress->count = fetch_state.count;
+}
+
+fetch_status_t fetch_status(const char *path) {
+    if (!path) {
+        return FETCH_READY;
+    }
+    const fetch_entry_t *e = find_entry(path);
+    return e ? e->status : FETCH_NONE;
+}
+
+#if defined(__EMSCRIPTEN__)
+
+static void report_progress(void) {
+    fetch_progress_t p;
+    fetch_get_progress(&p);
+    EM_ASM({
+        if (Module.setStatus) {
+            Module.setStatus($0 >= $1 ? '' : 'Downloading ' + $0 + '/' + $1 + ' (' +
+                             ($2 / 1048576).toFixed(1) + ' of ' + ($3 / 1048576).toFixed(1) + ' MB)');
+        }
+    }, p.done, p.count, (double)p.loaded, (double)p.total);
+}
+
+/* Create the directories of a path in the in-memory file system */
+static void make_parents(const char *path) {
+    char dir[PACK_NAME_SIZE];
+    for (size_t i = 0; path[i] && i < sizeof(dir) - 1; i++) {
+        if (path[i] == '/' && i > 0) {
+            memcpy(dir, path, i);
+            dir[i] = '\0';
+            mkdir(dir, 0777);
+        }
+    }
+}
+
+/* Make a downloaded file available to the pack or the file system */
+static int store_file(fetch_entry_t *e, const void *data, size_t size) {
+    if (e->flags & FETCH_PACK) {
+        void *copy = NULL;
+        if (posix_memalign(&copy, PACK_ALIGN, size ? size : 1) != 0) {
+            return -1;
+        }
+        memcpy(copy, data, size);
+        if (pack_open_memory(copy, size) != 0) {
+            free(copy);
+            return -1;
+        }
+        e->data = copy;
+        return 0;
+    }
+    make_parents(e->path);
+    FILE *f = fopen(e->path, "wb");
+    if (!f) {
+        return -1;
+    }
+    int ok = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && ok ? 0 : -1;
+}
+
+static void start_queued(void);
+
+static void finish(emscripten_fetch_t *fetch, int success) {
+    fetch_entry_t *e = fetch->userData;
+    if (success) {
+        e->loaded = (size_t)fetch->numBytes;
+        e->total = e->loaded;
+        success = store_file(e, fetch->data, (size_t)fetch->numBytes) == 0;
+    }
+    if (success) {
+        printf("[fetch] %s: %zu bytes\n", e->path, e->loaded);
+    } else {
+        fprintf(stderr, "FETCH: ERROR Cannot load %s (HTTP %d)\n", e->path, (int)fetch->status);
+    }
+    e->status = success ? FETCH_READY : FETCH_FAILED;
+    e->fetch = NULL;
+    emscripten_fetch_close(fetch);
+    fetch_state.active--;
+    start_queued();
+    report_progress();
+}
+
+static void on_success(emscripten_fetch_t *fetch) {
+    finish(fetch, 1);
+}
+
+static void on_error(emscripten_fetch_t *fetch) {
+    finish(fetch, 0);
+}
+
+static void on_progress(emscripten_fetch_t *fetch) {
+    fetch_entry_t *e = fetch->userData;
+    e->loaded = (size_t)fetch->dataOffset + (size_t)fetch->numBytes;
+    e->total = (size_t)fetch->totalBytes;
+    report_progress();
+}
+
+/* Start queued requests, lowest order first, up to FETCH_PARALLEL */
+static void start_queued(void) {
+    while (fetch_state.active < FETCH_PARALLEL) {
+        fetch_entry_t *next = NULL;
+        for (int i = 0; i < fetch_state.count; i++) {
+            fetch_entry_t *e = &fetch_state.entries[i];
+            if (e->status == FETCH_PENDING && !e->started && (!next || e->order < next->order)) {
+                next = e;
+            }
+        }
+        if (!next) {
+            return;
+        }
+
+        emscripten_fetch_attr_t attr;
+        emscripten_fetch_attr_init(&attr);
+        strcpy(attr.requestMethod, "GET");
+        attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY;
+        attr.onsuccess = on_success;
+        attr.onerror = on_error;
+        attr.onprogress = on_progress;
+        attr.userData = next;
+        next->started = 1;
+        fetch_state.active++;
+        emscripten_fetch_t *fetch = emscripten_fetch(&attr, next->path);
+        if (next->status == FETCH_PENDING) {
+            next->fetch = fetch;    /* Unless it already failed in there */
+        }
+    }
+}
+
+fetch_status_t fetch_request(const char *path, int flags) {
+    fetch_entry_t *e = find_entry(path);
+    if (!e) {
+        if (fetch_state.count >= FETCH_MAX_REQUESTS) {
+            fprintf(stderr, "FETCH: ERROR Too many requests (max %d)\n", FETCH_MAX_REQUESTS);
+            return FETCH_FAILED;
+        }
+        e = &fetch_state.entries[fetch_state.count++];
+        memset(e, 0, sizeof(*e));
+        e->path = path;
+        e->flags = flags;
+        e->status = FETCH_PENDING;
+        e->order = fetch_state.back++;
+    }
+    if ((flags & FETCH_URGENT) && !e->started) {
+        e->order = --fetch_state.front;
+    }
+    start_queued();
+    report_progress();
+    return e->status;
+}
+
+void fetch_shutdown(void) {
+    for (int i = 0; i < fetch_state.count; i++) {
+        fetch_entry_t *e = &fetch_state.entries[i];
+        if (e->fetch) {
+            emscripten_fetch_close(e->fetch);
+        }
+        free(e->data);
+    }
+    memset(&fetch_state, 0, sizeof(fetch_state));
+}
+
+#else
+
+fetch_status_t fetch_request(const char *path, int flags) {
+    fetch_entry_t *e = find_entry(path);
+    if (e) {
+        return e->status;
+    }
+    if (fetch_state.count >= FETCH_MAX_REQUESTS) {
+        fprintf(stderr, "FETCH: ERROR Too many requests (max %d)\n", FETCH_MAX_REQUESTS);
+        return FETCH_FAILED;
+    }
+    e = &fetch_state.entries[fetch_state.count++];
+    memset(e, 0, sizeof(*e));
+    e->path = path;
+    e->flags = flags;
+
+    /* Missing files are expected: segments only exist in web builds */
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        fclose(f);
+    }
+    e->status = f && (!(flags & FETCH_PACK) || pack_open(path) == 0) ? FETCH_READY : FETCH_FAILED;
+    return e->status;
+}
+
+void fetch_shutdown(void) {
+    memset(&fetch_state, 0, sizeof(fetch_state));
+}
+
+#endif
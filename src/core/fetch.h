@@ -0,0 +1,89 @@
+/**
+ * Asset Fetch - Pack segments and loose files downloaded on demand
+ *
+ * On the web nothing is preloaded: the page starts as soon as the wasm
+ * module is compiled, and assets stream in afterwards. The assets are
+ * split into pack segments, one per part directory (MAIN/ALKU.PAK,
+ * MAIN/WATER.PAK, ...) plus MAIN/COMMON.PAK for shared data. The part
+ * loader requests the segment of the part about to start first and
+ * queues the rest in sequence order, so the first part only waits for
+ * its own segment. A downloaded segment is opened with
+ * pack_open_memory(). A loose file, such as a module, is written to
+ * the in-memory file system, where fopen() finds it.
+ *
+ * Natively every file is already on disk. A request completes at once:
+ * packs are opened with pack_open() and loose files are checked for.
+ * A missing segment fails quietly, since MAIN/REALITY.PAK holds the
+ * same assets.
+ *
+ * Main thread only, between fetch_init() and fetch_shutdown().
+ */
+
+#ifndef FETCH_H
+#define FETCH_H
+
+#include <stddef.h>
+
+/* Requests tracked, and downloads in flight at once */
+#define FETCH_MAX_REQUESTS 48
+#define FETCH_PARALLEL 2
+
+/* fetch_request() flags */
+#define FETCH_PACK      1   /* Open as a pack once downloaded */
+#define FETCH_URGENT    2   /* Start before everything queued */
+
+/**
+ * Request status
+ */
+typedef enum {
+    FETCH_NONE = 0,         /* Never requested */
+    FETCH_PENDING,          /* Queued or downloading */
+    FETCH_READY,            /* Available to pack_*() or fopen() */
+    FETCH_FAILED            /* Missing or unusable; callers go on without it */
+} fetch_status_t;
+
+/**
+ * Download totals, for a progress display
+ */
+typedef struct {
+    size_t loaded;          /* Bytes received */
+    size_t total;           /* Bytes expected, as far as announced */
+    int done;               /* Requests ready or failed */
+    int count;              /* Requests made */
+} fetch_progress_t;
+
+/**
+ * Initialize the request table.
+ */
+void fetch_init(void);
+
+/**
+ * Cancel downloads in flight and free the downloaded packs.
+ * Call after pack_shutdown(), which stops using them.
+ */
+void fetch_shutdown(void);
+
+/**
+ * Request a file, relative to the page (web) or working directory.
+ * Requesting a file again is cheap: FETCH_URGENT moves it to the
+ * front of the queue if it has not started, and nothing else changes.
+ * @param path File path (e.g. "MAIN/WATER.PAK"; must remain valid)
+ * @param flags FETCH_PACK, FETCH_URGENT
+ * @return Status after the call (natively never FETCH_PENDING)
+ */
+fetch_status_t fetch_request(const char *path, int flags);
+
+/**
+ * Get the status of a file.
+ * @param path File path, NULL for nothing (FETCH_READY)
+ * @return FETCH_NONE if it was never requested
+ */
+fetch_status_t fetch_status(const char *path);
+
+/**
+ * Get the download totals over all requests.
+ * @param progress Receives the totals
+ */
+void fetch_get_progress(fetch_progress_t *progress);
+
+#endif /* FETCH_H */
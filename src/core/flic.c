@@ -0,0 +1,509 @@
+/**
+ * FLIC Player - Implementation
+ *
+ * File layout: a 128-byte header, then frames of a 16-byte header
+ * (size, 0xF1FA, chunk count) and chunks of a 6-byte header (size,
+ * type). After the last frame comes the ring frame, the delta from the
+ * last frame back to the first, which loops play before resuming at
+ * frame 2. Every read from a frame is bounds checked, so a corrupt file
+ * fails the frame instead of touching memory outside the framebuffer.
+ */
+
+#include "flic.h"
+#include "video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* File and frame magic */
+#define FLIC_MAGIC_FLI      0xAF11
+#define FLIC_MAGIC_FLC      0xAF12
+#define FLIC_FRAME_MAGIC    0xF1FA
+#define FLIC_PREFIX_MAGIC   0xF100  /* FLC settings chunk, not a frame */
+
+#define FLIC_HEADER_SIZE    128
+#define FLIC_FRAME_HEADER   16
+#define FLIC_CHUNK_HEADER   6
+
+/* Chunk types */
+#define FLIC_COLOR_256      4       /* Palette, components 0-255 */
+#define FLIC_DELTA_FLC      7       /* Word-oriented line delta */
+#define FLIC_COLOR_64       11      /* Palette, components 0-63 */
+#define FLIC_DELTA_FLI      12      /* Byte-oriented line delta */
+#define FLIC_BLACK          13
+#define FLIC_BYTE_RUN       15      /* Full frame, run-length coded */
+#define FLIC_COPY           16      /* Full frame, uncompressed */
+#define FLIC_PSTAMP         18      /* Thumbnail, ignored */
+
+/* Rows of framebuffer memory a frame may cover */
+#define FLIC_MAX_HEIGHT     (VIDEO_MEMORY_SIZE / VIDEO_WIDTH)
+
+/* Bounds-checked reader over one chunk */
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} flic_cursor_t;
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int has(const flic_cursor_t *c, size_t n) {
+    return (size_t)(c->end - c->p) >= n;
+}
+
+/* Palette chunk: packets of (skip, count) followed by count RGB triples */
+static int apply_color(flic_cursor_t *c, int shift) {
+    if (!has(c, 2)) {
+        return -1;
+    }
+    int packets = get16(c->p);
+    c->p += 2;
+    int index = 0;
+    for (int i = 0; i < packets; i++) {
+        if (!has(c, 2)) {
+            return -1;
+        }
+        index += c->p[0];
+        int count = c->p[1] ? c->p[1] : 256;
+        c->p += 2;
+        if (index + count > 256 || !has(c, (size_t)count * 3)) {
+            return -1;
+        }
+
+        uint8_t rgb[768];
+        for (int j = 0; j < count * 3; j++) {
+            rgb[j] = (uint8_t)(c->p[j] >> shift);
+        }
+        c->p += count * 3;
+        if (count == 256) {
+            video_set_palette(rgb);
+        } else {
+            video_set_palette_range((uint8_t)index, (uint8_t)count, rgb);
+        }
+        index += count;
+    }
+    return 0;
+}
+
+/* BRUN: every line as runs, positive counts replicate, negative copy */
+static int apply_byte_run(flic_cursor_t *c, const flic_t *flic, uint8_t *fb) {
+    for (int y = 0; y < flic->height; y++) {
+        uint8_t *row = fb + (size_t)y * VIDEO_WIDTH;
+        if (!has(c, 1)) {
+            return -1;
+        }
+        c->p++;     /* Packet count: unreliable past 255, the width decides */
+        int x = 0;
+        while (x < flic->width) {
+            if (!has(c, 1)) {
+                return -1;
+            }
+            int n = (int8_t)*c->p++;
+            if (n > 0) {
+                if (x + n > flic->width || !has(c, 1)) {
+                    return -1;
+                }
+                memset(row + x, *c->p++, (size_t)n);
+                x += n;
+            } else if (n < 0) {
+                n = -n;
+                if (x + n > flic->width || !has(c, (size_t)n)) {
+                    return -1;
+                }
+                memcpy(row + x, c->p, (size_t)n);
+                c->p += n;
+                x += n;
+            } else {
+                return -1;
+            }
+        }
+    }
+    video_mark_dirty(0, flic->height);
+    return 0;
+}
+
+/* LC: changed lines only, packets of (skip, count), positive counts copy */
+static int apply_delta_fli(flic_cursor_t *c, const flic_t *flic, uint8_t *fb) {
+    if (!has(c, 4)) {
+        return -1;
+    }
+    int first = get16(c->p);
+    int lines = get16(c->p + 2);
+    c->p += 4;
+    if (first + lines > flic->height) {
+        return -1;
+    }
+
+    for (int y = first; y < first + lines; y++) {
+        uint8_t *row = fb + (size_t)y * VIDEO_WIDTH;
+        if (!has(c, 1)) {
+            return -1;
+        }
+        int packets = *c->p++;
+        int x = 0;
+        for (int i = 0; i < packets; i++) {
+            if (!has(c, 2)) {
+                return -1;
+            }
+            x += c->p[0];
+            int n = (int8_t)c->p[1];
+            c->p += 2;
+            if (n >= 0) {
+                if (x + n > flic->width || !has(c, (size_t)n)) {
+                    return -1;
+                }
+                memcpy(row + x, c->p, (size_t)n);
+                c->p += n;
+                x += n;
+            } else {
+                n = -n;
+                if (x + n > flic->width || !has(c, 1)) {
+                    return -1;
+                }
+                memset(row + x, *c->p++, (size_t)n);
+                x += n;
+            }
+        }
+    }
+    if (lines > 0) {
+        video_mark_dirty(first, lines);
+    }
+    return 0;
+}
+
+/* DELTA_FLC: like LC in pixel pairs, with line skips and odd last pixels
+ * as opcode words before each line's packet count */
+static int apply_delta_flc(flic_cursor_t *c, const flic_t *flic, uint8_t *fb) {
+    if (!has(c, 2)) {
+        return -1;
+    }
+    int lines = get16(c->p);
+    c->p += 2;
+    int y = 0;
+    int top = flic->height;
+    int bottom = 0;
+
+    for (int l = 0; l < lines; l++) {
+        int packets;
+        for (;;) {
+            if (!has(c, 2)) {
+                return -1;
+            }
+            uint16_t op = get16(c->p);
+            c->p += 2;
+            if ((op & 0xC000) == 0xC000) {
+                /* Skip lines; y stays below height, so it cannot overflow */
+                y += 0x10000 - op;
+                if (y >= flic->height) {
+                    return -1;
+                }
+            } else if ((op & 0xC000) == 0x8000) {
+                if (y >= flic->height) {
+                    return -1;
+                }
+                fb[(size_t)y * VIDEO_WIDTH + flic->width - 1] = (uint8_t)op;
+            } else {
+                packets = op;
+                break;
+            }
+        }
+        if (y >= flic->height) {
+            return -1;
+        }
+
+        uint8_t *row = fb + (size_t)y * VIDEO_WIDTH;
+        int x = 0;
+        for (int i = 0; i < packets; i++) {
+            if (!has(c, 2)) {
+                return -1;
+            }
+            x += c->p[0];
+            int n = (int8_t)c->p[1];
+            c->p += 2;
+            if (n >= 0) {
+                if (x + 2 * n > flic->width || !has(c, (size_t)n * 2)) {
+                    return -1;
+                }
+                memcpy(row + x, c->p, (size_t)n * 2);
+                c->p += n * 2;
+                x += n * 2;
+            } else {
+                n = -n;
+                if (x + 2 * n > flic->width || !has(c, 2)) {
+                    return -1;
+                }
+                for (int j = 0; j < n; j++) {
+                    row[x++] = c->p[0];
+                    row[x++] = c->p[1];
+                }
+                c->p += 2;
+            }
+        }
+        top = y < top ? y : top;
+        bottom = y + 1;
+        y++;
+    }
+    if (bottom > top) {
+        video_mark_dirty(top, bottom - top);
+    }
+    return 0;
+}
+
+static int apply_frame(const flic_t *flic, const flic_slot_t *slot) {
+    uint8_t *fb = video_get_framebuffer();
+    flic_cursor_t frame = { slot->data, slot->data + slot->size };
+
+    for (int i = 0; i < slot->chunks; i++) {
+        if (!has(&frame, FLIC_CHUNK_HEADER)) {
+            return -1;
+        }
+        uint32_t size = get32(frame.p);
+        int type = get16(frame.p + 4);
+        if (size < FLIC_CHUNK_HEADER || !has(&frame, size)) {
+            return -1;
+        }
+        flic_cursor_t c = { frame.p + FLIC_CHUNK_HEADER, frame.p + size };
+        frame.p += size;
+
+        int rc = 0;
+        switch (type) {
+        case FLIC_COLOR_256:
+            rc = apply_color(&c, 2);
+            break;
+        case FLIC_COLOR_64:
+            rc = apply_color(&c, 0);
+            break;
+        case FLIC_BYTE_RUN:
+            rc = apply_byte_run(&c, flic, fb);
+            break;
+        case FLIC_DELTA_FLI:
+            rc = apply_delta_fli(&c, flic, fb);
+            break;
+        case FLIC_DELTA_FLC:
+            rc = apply_delta_flc(&c, flic, fb);
+            break;
+        case FLIC_BLACK:
+            for (int y = 0; y < flic->height; y++) {
+                memset(fb + (size_t)y * VIDEO_WIDTH, 0, (size_t)flic->width);
+            }
+            video_mark_dirty(0, flic->height);
+            break;
+        case FLIC_COPY:
+            if (!has(&c, (size_t)flic->width * flic->height)) {
+                rc = -1;
+                break;
+            }
+            for (int y = 0; y < flic->height; y++) {
+                memcpy(fb + (size_t)y * VIDEO_WIDTH, c.p + (size_t)y * flic->width, (size_t)flic->width);
+            }
+            video_mark_dirty(0, flic->height);
+            break;
+        case FLIC_PSTAMP:
+        default:
+            break;      /* Unknown chunks are skipped, as players do */
+        }
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Read the next frame to show into a slot (the worker, or the caller
+ * without threads)
+ * @return 1 frame, 0 end of animation, -1 error */
+static int read_frame(flic_t *flic, flic_slot_t *slot) {
+    for (;;) {
+        if (flic->read_frame == flic->frames && !flic->loop) {
+            return 0;
+        }
+        if (flic->read_frame > flic->frames ||
+            (flic->read_frame == flic->frames && flic->read_pos + FLIC_FRAME_HEADER > flic->file_size)) {
+            /* Past the ring frame, or no ring frame: start over */
+            int restart_second = flic->read_frame > flic->frames && flic->second;
+            flic->read_pos = restart_second ? flic->second : flic->first;
+            flic->read_frame = restart_second ? 1 : 0;
+        }
+
+        uint8_t header[FLIC_FRAME_HEADER];
+        if (pack_readfileto(header, flic->name, flic->read_pos, sizeof(header)) != (long)sizeof(header)) {
+            fprintf(stderr, "FLIC: ERROR Truncated frame %d in %s\n", flic->read_frame, flic->name);
+            return -1;
+        }
+        uint32_t size = get32(header);
+        int magic = get16(header + 4);
+        if (size < FLIC_FRAME_HEADER || size > flic->file_size - flic->read_pos) {
+            fprintf(stderr, "FLIC: ERROR Bad frame %d in %s\n", flic->read_frame, flic->name);
+            return -1;
+        }
+        if (magic == FLIC_PREFIX_MAGIC) {
+            flic->read_pos += size;
+            continue;
+        }
+        if (magic != FLIC_FRAME_MAGIC) {
+            fprintf(stderr, "FLIC: ERROR Bad frame %d in %s\n", flic->read_frame, flic->name);
+            return -1;
+        }
+
+        size_t data_size = size - FLIC_FRAME_HEADER;
+        if (data_size > slot->capacity) {
+            uint8_t *data = realloc(slot->data, data_size);
+            if (!data) {
+                fprintf(stderr, "FLIC: ERROR Out of memory for %s\n", flic->name);
+                return -1;
+            }
+            slot->data = data;
+            slot->capacity = data_size;
+        }
+        if (data_size > 0 &&
+            pack_readfileto(slot->data, flic->name, flic->read_pos + FLIC_FRAME_HEADER, data_size) != (long)data_size) {
+            fprintf(stderr, "FLIC: ERROR Truncated frame %d in %s\n", flic->read_frame, flic->name);
+            return -1;
+        }
+        slot->size = data_size;
+        slot->chunks = get16(header + 6);
+
+        flic->read_pos += size;
+        flic->read_frame++;
+        if (flic->read_frame == 1) {
+            flic->second = flic->read_pos;
+        }
+        return 1;
+    }
+}
+
+/* Keep the ring full until the animation ends or the player closes */
+static void reader(void *arg) {
+    flic_t *flic = arg;
+    thread_mutex_lock(&flic->mutex);
+    while (!flic->quit) {
+        if (flic->count == FLIC_AHEAD) {
+            thread_cond_wait(&flic->cond, &flic->mutex);
+            continue;
+        }
+        flic_slot_t *slot = &flic->slots[(flic->head + flic->count) % FLIC_AHEAD];
+        thread_mutex_unlock(&flic->mutex);
+        int status = read_frame(flic, slot);
+        thread_mutex_lock(&flic->mutex);
+
+        slot->status = status;
+        flic->count++;
+        thread_cond_broadcast(&flic->cond);
+        if (status <= 0) {
+            while (!flic->quit) {
+                thread_cond_wait(&flic->cond, &flic->mutex);
+            }
+        }
+    }
+    thread_mutex_unlock(&flic->mutex);
+}
+
+int flic_open(flic_t *flic, const char *name, int loop) {
+    memset(flic, 0, sizeof(*flic));
+    size_t file_size = 0;
+    uint8_t header[FLIC_HEADER_SIZE];
+    if (strlen(name) >= sizeof(flic->name) || !pack_exists(name, &file_size) ||
+        pack_readfileto(header, name, 0, sizeof(header)) != (long)sizeof(header)) {
+        fprintf(stderr, "FLIC: ERROR Cannot read %s\n", name);
+        return -1;
+    }
+
+    int magic = get16(header + 4);
+    int width = get16(header + 8);
+    int height = get16(header + 10);
+    int depth = get16(header + 12);
+    if ((magic != FLIC_MAGIC_FLI && magic != FLIC_MAGIC_FLC) || (depth != 8 && depth != 0) ||
+        width < 1 || width > VIDEO_WIDTH || height < 1 || height > FLIC_MAX_HEIGHT) {
+        fprintf(stderr, "FLIC: ERROR Unsupported file %s (%dx%d)\n", name, width, height);
+        return -1;
+    }
+
+    strcpy(flic->name, name);
+    flic->width = width;
+    flic->height = height;
+    flic->frames = get16(header + 6);
+    flic->loop = loop;
+    flic->file_size = file_size;
+    if (magic == FLIC_MAGIC_FLI) {
+        flic->speed = get16(header + 16);   /* Jiffies, 1/70 s */
+        flic->first = FLIC_HEADER_SIZE;
+    } else {
+        flic->speed = (int)((get32(header + 16) * 70 + 500) / 1000);    /* Milliseconds */
+        flic->first = get32(header + 80) ? get32(header + 80) : FLIC_HEADER_SIZE;
+    }
+    if (flic->speed < 1) {
+        flic->speed = 1;
+    }
+    flic->read_pos = flic->first;
+
+    thread_mutex_init(&flic->mutex);
+    thread_cond_init(&flic->cond);
+    flic->threaded = thread_create(&flic->thread, reader, flic) == 0;
+    return 0;
+}
+
+void flic_close(flic_t *flic) {
+    if (flic->name[0] == '\0') {
+        return;
+    }
+    if (flic->threaded) {
+        thread_mutex_lock(&flic->mutex);
+        flic->quit = 1;
+        thread_cond_broadcast(&flic->cond);
+        thread_mutex_unlock(&flic->mutex);
+        thread_join(&flic->thread);
+    }
+    thread_cond_destroy(&flic->cond);
+    thread_mutex_destroy(&flic->mutex);
+    for (int i = 0; i < FLIC_AHEAD; i++) {
+        free(flic->slots[i].data);
+    }
+    memset(flic, 0, sizeof(*flic));
+}
+
+int flic_next_frame(flic_t *flic) {
+    if (flic->name[0] == '\0') {
+        return -1;
+    }
+
+    flic_slot_t *slot;
+    if (flic->threaded) {
+        thread_mutex_lock(&flic->mutex);
+        while (flic->count == 0) {
+            thread_cond_wait(&flic->cond, &flic->mutex);
+        }
+        slot = &flic->slots[flic->head];
+        thread_mutex_unlock(&flic->mutex);
+    } else {
+        /* The last status sticks, like the worker stopping at it */
+        slot = &flic->slots[0];
+        if (!flic->done) {
+            slot->status = read_frame(flic, slot);
+            flic->done = slot->status <= 0;
+        }
+    }
+
+    int status = slot->status;
+    if (status > 0 && apply_frame(flic, slot) != 0) {
+        fprintf(stderr, "FLIC: ERROR Corrupt frame %d in %s\n", flic->frame, flic->name);
+        slot->status = status = -1;
+        flic->done = 1;
+    }
+    if (status > 0) {
+        flic->frame++;
+    }
+
+    if (flic->threaded && status > 0) {
+        thread_mutex_lock(&flic->mutex);
+        flic->head = (flic->head + 1) % FLIC_AHEAD;
+        flic->count--;
+        thread_cond_broadcast(&flic->cond);
+        thread_mutex_unlock(&flic->mutex);
+    }
+    return status;
+}
@@ -0,0 +1,94 @@
+/**
+ * FLIC Player - Streaming FLI/FLC decoding into the framebuffer
+ *
+ * Portable replacement for the readflic() loops of GRAB/FLIC and
+ * PAM/VFLI.C. Frames are applied straight to video_get_framebuffer()
+ * (BRUN, LC, DELTA_FLC, BLACK and COPY chunks) with no frame buffer of
+ * the decoder's own, and palette chunks become video_set_palette_range()
+ * calls. Only the compressed frames are held: a worker thread reads them
+ * ahead through pack_readfileto(), so a frame is never waited on from
+ * disk between two dis_waitb() calls. Without threads each frame is read
+ * when it is shown.
+ *
+ * Main thread only, one animation per flic_t.
+ */
+
+#ifndef FLIC_H
+#define FLIC_H
+
+#include "pack.h"
+#include "thread.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compressed frames read ahead of the one being shown */
+#define FLIC_AHEAD 4
+
+/**
+ * One read-ahead frame
+ */
+typedef struct {
+    uint8_t *data;              /* Frame chunks, header stripped */
+    size_t size;
+    size_t capacity;
+    int chunks;                 /* Chunks in data */
+    int status;                 /* 1 frame, 0 end of animation, -1 error */
+} flic_slot_t;
+
+/**
+ * Animation being played
+ */
+typedef struct {
+    char name[PACK_NAME_SIZE];
+    int width;                  /* Frame size, at most VIDEO_WIDTH x 800 */
+    int height;
+    int frames;                 /* Frames in the file, ring frame excluded */
+    int speed;                  /* dis_waitb() ticks (1/70 s) per frame */
+    int loop;                   /* Play the ring frame and start over at the end */
+    int frame;                  /* Frames shown so far, loops included */
+
+    /* Reader position, owned by the worker while it runs */
+    size_t file_size;
+    size_t first;               /* Offset of frame 1 */
+    size_t second;              /* Offset of frame 2 (where a loop resumes) */
+    size_t read_pos;
+    int read_frame;             /* File frame index at read_pos, 0-based */
+
+    /* Ring of read-ahead frames between the worker and flic_next_frame() */
+    flic_slot_t slots[FLIC_AHEAD];
+    int head;                   /* Next slot to show */
+    int count;                  /* Slots filled and not shown */
+    int threaded;
+    int done;                   /* Without threads: the last status sticks */
+    int quit;
+    thread_t thread;
+    thread_mutex_t mutex;
+    thread_cond_t cond;
+} flic_t;
+
+/**
+ * Open an animation and start reading ahead.
+ * @param flic Player to set up
+ * @param name File name in the pack or search paths (e.g. "PAM/PRAX4.FLI")
+ * @param loop 1 to restart after the last frame, 0 to stop there
+ * @return 0 on success, -1 if the file is missing or not a FLIC
+ */
+int flic_open(flic_t *flic, const char *name, int loop);
+
+/**
+ * Stop the worker and free the read-ahead frames.
+ * @param flic Player (safe on a zeroed or closed player)
+ */
+void flic_close(flic_t *flic);
+
+/**
+ * Apply the next frame to the framebuffer (rows 0..height-1 at
+ * VIDEO_WIDTH bytes per row) and its palette changes to the palette.
+ * Changed rows are passed to video_mark_dirty().
+ * @param flic Player
+ * @return 1 if a frame was shown, 0 at the end of the animation, -1 on a
+ *         read error or corrupt frame
+ */
+int flic_next_frame(flic_t *flic);
+
+#endif /* FLIC_H */
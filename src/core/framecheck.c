@@ -0,0 +1,274 @@
+/**
+ * Frame Check - Implementation
+ *
+ * The wrappers are bound by the linker option --wrap=NAME: every call to
+ * NAME in the program's own objects lands in __wrap_NAME, which counts it
+ * and calls the library through __real_NAME. Calls made inside the C
+ * library itself are not seen, only the ones this code makes.
+ *
+ * Calls inside an allowed step are kept apart from the rest and listed as
+ * allowed, so the allow-list stays visible in every report.
+ *
+ * Counting takes no locks: a slot in a fixed table is claimed with a
+ * compare-exchange, so the audio thread can report as well. Two threads
+ * hitting a new combination at once may fill two slots for it; the
+ * report simply lists both.
+ */
+
+#include "framecheck.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct {
+    atomic_int used;            /* 0 free, 1 being filled, 2 filled */
+    const char *part;
+    framecheck_scope_t scope;
+    framecheck_step_t step;
+    const char *function;
+    atomic_uint count;
+} framecheck_record_t;
+
+static struct {
+    const char *_Atomic part;
+    framecheck_record_t records[FRAMECHECK_MAX_RECORDS];
+    atomic_uint dropped;        /* Calls past a full table */
+} framecheck_state;
+
+static _Thread_local framecheck_scope_t t_scope = FRAMECHECK_NONE;
+static _Thread_local framecheck_step_t t_step = FRAMECHECK_STEP_NONE;
+
+static const char *const scope_names[FRAMECHECK_SCOPE_COUNT] = {
+    [FRAMECHECK_TICK] = "tick",
+    [FRAMECHECK_RENDER] = "render",
+    [FRAMECHECK_PRESENT] = "present",
+    [FRAMECHECK_AUDIO] = "audio",
+};
+
+static const char *const step_names[FRAMECHECK_STEP_COUNT] = {
+    [FRAMECHECK_STEP_MUSIC_LOAD] = "music load",
+    [FRAMECHECK_STEP_MUSIC_COMMIT] = "music commit",
+    [FRAMECHECK_STEP_PREPARE_START] = "prepare start",
+};
+
+framecheck_scope_t framecheck_enter(framecheck_scope_t scope) {
+    framecheck_scope_t outer = t_scope;
+    t_scope = scope;
+    return outer;
+}
+
+void framecheck_leave(framecheck_scope_t outer) {
+    t_scope = outer;
+}
+
+framecheck_step_t framecheck_allow(framecheck_step_t step) {
+    framecheck_step_t outer = t_step;
+    t_step = step;
+    return outer;
+}
+
+void framecheck_set_part(const char *name) {
+    atomic_store(&framecheck_state.part, name);
+}
+
+void framecheck_note(const char *function) {
+    framecheck_scope_t scope = t_scope;
+    framecheck_step_t step = t_step;
+    const char *part = atomic_load(&framecheck_state.part);
+    if (scope == FRAMECHECK_NONE || !part) {
+        return;
+    }
+    for (int i = 0; i < FRAMECHECK_MAX_RECORDS; i++) {
+        framecheck_record_t *r = &framecheck_state.records[i];
+        int used = atomic_load(&r->used);
+        if (used == 0) {
+            if (atomic_compare_exchange_strong(&r->used, &used, 1)) {
+                r->part = part;
+                r->scope = scope;
+                r->step = step;
+                r->function = function;
+                atomic_store(&r->count, 1);
+                atomic_store(&r->used, 2);
+                return;
+            }
+        }
+        if (used == 2 && r->part == part && r->scope == scope && r->step == step &&
+            r->function == function) {
+            atomic_fetch_add(&r->count, 1);
+            return;
+        }
+    }
+    atomic_fetch_add(&framecheck_state.dropped, 1);
+}
+
+unsigned framecheck_report(void) {
+    unsigned total = atomic_load(&framecheck_state.dropped);
+    for (int i = 0; i < FRAMECHECK_MAX_RECORDS; i++) {
+        framecheck_record_t *r = &framecheck_state.records[i];
+        if (atomic_load(&r->used) != 2) {
+            continue;
+        }
+        unsigned count = atomic_load(&r->count);
+        if (r->step != FRAMECHECK_STEP_NONE) {
+            printf("[framecheck] Allowed %s %s (%s): %u x %s\n",
+                   r->part, scope_names[r->scope], step_names[r->step], count, r->function);
+            continue;
+        }
+        total += count;
+        fprintf(stderr, "FRAMECHECK: ERROR %s %s: %u x %s\n",
+                r->part, scope_names[r->scope], count, r->function);
+    }
+    if (atomic_load(&framecheck_state.dropped) > 0) {
+        fprintf(stderr, "FRAMECHECK: ERROR %u more calls not itemized\n",
+                atomic_load(&framecheck_state.dropped));
+    }
+    if (total == 0) {
+        printf("[framecheck] No heap or stdio calls in the frame path outside allowed steps\n");
+    }
+    return total;
+}
+
+/* Heap */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *block, size_t size);
+void __real_free(void *block);
+int __real_posix_memalign(void **block, size_t alignment, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    framecheck_note("malloc");
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    framecheck_note("calloc");
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *block, size_t size) {
+    framecheck_note("realloc");
+    return __real_realloc(block, size);
+}
+
+void __wrap_free(void *block) {
+    if (block) {
+        framecheck_note("free");
+    }
+    __real_free(block);
+}
+
+int __wrap_posix_memalign(void **block, size_t alignment, size_t size) {
+    framecheck_note("posix_memalign");
+    return __real_posix_memalign(block, alignment, size);
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    framecheck_note("aligned_alloc");
+    return __real_aligned_alloc(alignment, size);
+}
+
+/* Files */
+
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_fclose(FILE *f);
+size_t __real_fread(void *data, size_t size, size_t count, FILE *f);
+size_t __real_fwrite(const void *data, size_t size, size_t count, FILE *f);
+int __real_fseek(FILE *f, long offset, int origin);
+long __real_ftell(FILE *f);
+int __real_fflush(FILE *f);
+
+FILE *__wrap_fopen(const char *path, const char *mode) {
+    framecheck_note("fopen");
+    return __real_fopen(path, mode);
+}
+
+int __wrap_fclose(FILE *f) {
+    framecheck_note("fclose");
+    return __real_fclose(f);
+}
+
+size_t __wrap_fread(void *data, size_t size, size_t count, FILE *f) {
+    framecheck_note("fread");
+    return __real_fread(data, size, count, f);
+}
+
+/* The compiler turns constant fprintf() calls into fwrite() */
+size_t __wrap_fwrite(const void *data, size_t size, size_t count, FILE *f) {
+    framecheck_note("fwrite");
+    return __real_fwrite(data, size, count, f);
+}
+
+int __wrap_fseek(FILE *f, long offset, int origin) {
+    framecheck_note("fseek");
+    return __real_fseek(f, offset, origin);
+}
+
+long __wrap_ftell(FILE *f) {
+    framecheck_note("ftell");
+    return __real_ftell(f);
+}
+
+int __wrap_fflush(FILE *f) {
+    framecheck_note("fflush");
+    return __real_fflush(f);
+}
+
+/* Printing; constant printf() calls become puts() or putchar() */
+
+int __real_vprintf(const char *format, va_list args);
+int __real_vfprintf(FILE *f, const char *format, va_list args);
+int __real_puts(const char *text);
+int __real_putchar(int c);
+int __real_fputs(const char *text, FILE *f);
+int __real_fputc(int c, FILE *f);
+
+int __wrap_printf(const char *format, ...) {
+    framecheck_note("printf");
+    va_list args;
+    va_start(args, format);
+    int n = __real_vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+int __wrap_fprintf(FILE *f, const char *format, ...) {
+    framecheck_note("fprintf");
+    va_list args;
+    va_start(args, format);
+    int n = __real_vfprintf(f, format, args);
+    va_end(args);
+    return n;
+}
+
+int __wrap_vprintf(const char *format, va_list args) {
+    framecheck_note("vprintf");
+    return __real_vprintf(format, args);
+}
+
+int __wrap_vfprintf(FILE *f, const char *format, va_list args) {
+    framecheck_note("vfprintf");
+    return __real_vfprintf(f, format, args);
+}
+
+int __wrap_puts(const char *text) {
+    framecheck_note("puts");
+    return __real_puts(text);
+}
+
+int __wrap_putchar(int c) {
+    framecheck_note("putchar");
+    return __real_putchar(c);
+}
+
+int __wrap_fputs(const char *text, FILE *f) {
+    framecheck_note("fputs");
+    return __real_fputs(text, f);
+}
+
+int __wrap_fputc(int c, FILE *f) {
+    framecheck_note("fputc");
+    return __real_fputc(c, f);
+}
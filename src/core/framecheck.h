@@ -0,0 +1,130 @@
+/**
+ * Frame Check - No heap or stdio calls in the steady-state frame path
+ *
+ * Once a part runs, a frame must not allocate, free, touch files or
+ * print. The audio thread is where long unattended runs drop out now
+ * and then: a heap spike or the stdio lock there makes the device run
+ * dry. Checked scopes cover the whole part loader tick (music polling,
+ * the prepare-ahead start, dis_waitb() and the part's update), the
+ * part's render, video_present() and the music render of the audio
+ * callback. Transitions and background workers are not checked.
+ *
+ * A few one-shot steps in the tick have to allocate or print: they run
+ * once when a download or background load completes, not every frame.
+ * They are the allow-list below (framecheck_step_t). Calls made inside
+ * FRAMECHECK_ALLOW_BEGIN() are reported as allowed, and count as
+ * failures in any other scope.
+ *
+ * Builds with SR_FRAME_CHECK (CMake option, on by default for Debug
+ * builds where the linker has --wrap) route malloc & co and the stdio
+ * calls through counting wrappers. Each call made in a checked scope
+ * while a part runs is attributed to that part and the scope.
+ * framecheck_report() lists them, and the headless runner fails when
+ * there are any outside allowed steps, so golden-frame runs enforce the
+ * rule.
+ *
+ * Not seen: --wrap only rebinds calls from the program's own objects.
+ * System calls made directly (open, read, mmap) are missed, and so is
+ * everything inside shared libraries. That includes the allocations
+ * libopenmpt makes through libstdc++'s operator new while it renders on
+ * the audio thread.
+ *
+ * Compiled out otherwise: the scope macros expand to nothing and the
+ * functions to empty inlines.
+ */
+
+#ifndef FRAMECHECK_H
+#define FRAMECHECK_H
+
+/**
+ * Checked scopes
+ */
+typedef enum {
+    FRAMECHECK_NONE = -1,       /* Not checked */
+    FRAMECHECK_TICK = 0,        /* part_loader_tick(): dis_waitb() and update */
+    FRAMECHECK_RENDER,          /* sr_part_t render callback */
+    FRAMECHECK_PRESENT,         /* video_present() */
+    FRAMECHECK_AUDIO,           /* Music render for the audio device */
+    FRAMECHECK_SCOPE_COUNT
+} framecheck_scope_t;
+
+/**
+ * One-shot steps allowed to use the heap and stdio in a checked scope
+ */
+typedef enum {
+    FRAMECHECK_STEP_NONE = -1,          /* Not allowed */
+    FRAMECHECK_STEP_MUSIC_LOAD = 0,     /* Background module load starts (path copy, thread) */
+    FRAMECHECK_STEP_MUSIC_COMMIT,       /* Loaded module swapped in, old one freed */
+    FRAMECHECK_STEP_PREPARE_START,      /* Next part's prepare thread starts */
+    FRAMECHECK_STEP_COUNT
+} framecheck_step_t;
+
+/* Distinct part, scope, step and function combinations reported */
+#define FRAMECHECK_MAX_RECORDS 64
+
+#if defined(SR_FRAME_CHECK)
+
+/* Check the rest of the current block (one per block); close it with
+ * FRAMECHECK_END(). Scopes nest: the inner one is attributed */
+#define FRAMECHECK_BEGIN(scope) framecheck_scope_t framecheck_outer = framecheck_enter(scope)
+#define FRAMECHECK_END() framecheck_leave(framecheck_outer)
+
+/* Allow a one-shot step for the rest of the current block (one per
+ * block); close it with FRAMECHECK_ALLOW_END() */
+#define FRAMECHECK_ALLOW_BEGIN(step) framecheck_step_t framecheck_outer_step = framecheck_allow(step)
+#define FRAMECHECK_ALLOW_END() ((void)framecheck_allow(framecheck_outer_step))
+
+/**
+ * Enter a scope on this thread.
+ * @param scope FRAMECHECK_*, FRAMECHECK_NONE to stop checking
+ * @return Scope to restore with framecheck_leave()
+ */
+framecheck_scope_t framecheck_enter(framecheck_scope_t scope);
+
+/**
+ * Leave a scope on this thread.
+ * @param outer Value framecheck_enter() returned
+ */
+void framecheck_leave(framecheck_scope_t outer);
+
+/**
+ * Mark the calls made on this thread as part of an allowed step.
+ * @param step FRAMECHECK_STEP_*, FRAMECHECK_STEP_NONE to stop allowing
+ * @return Step to restore
+ */
+framecheck_step_t framecheck_allow(framecheck_step_t step);
+
+/**
+ * Set the part calls are attributed to. Nothing is counted without one.
+ * Any thread.
+ * @param name Running part's name (must remain valid), NULL between parts
+ */
+void framecheck_set_part(const char *name);
+
+/**
+ * Count a call if this thread is in a checked scope while a part runs.
+ * Called by the wrappers; uses no heap or stdio itself.
+ * @param function Function name (a string literal)
+ */
+void framecheck_note(const char *function);
+
+/**
+ * Print the calls counted so far, one line per part, scope, step and
+ * function. Call outside checked scopes.
+ * @return Number of calls counted outside allowed steps
+ */
+unsigned framecheck_report(void);
+
+#else
+
+#define FRAMECHECK_BEGIN(scope) ((void)0)
+#define FRAMECHECK_END() ((void)0)
+#define FRAMECHECK_ALLOW_BEGIN(step) ((void)0)
+#define FRAMECHECK_ALLOW_END() ((void)0)
+
+static inline void framecheck_set_part(const char *name) { (void)name; }
+static inline unsigned framecheck_report(void) { return 0; }
+
+#endif /* SR_FRAME_CHECK */
+
+#endif /* FRAMECHECK_H */
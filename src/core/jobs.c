@@ -0,0 +1,233 @@
+/**
+ * Job System - Implementation
+ *
+ * Deques are Chase-Lev rings of task indices. All deque operations are
+ * sequentially consistent, which keeps the protocol simple and costs
+ * nothing measurable at the task sizes used here (whole screen bands).
+ *
+ * A batch is dealt into the deques while every worker is parked, then
+ * published by bumping the generation under the pool mutex. jobs_run()
+ * returns only once all tasks are done and every worker has parked again,
+ * so no deque is touched by two batches at once.
+ */
+
+#include "jobs.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Tasks one deque holds; bigger batches run in several rounds */
+#define JOBS_DEQUE_SIZE 256
+#define JOBS_DEQUE_MASK (JOBS_DEQUE_SIZE - 1)
+
+/* Deque operation results other than a task index */
+#define JOBS_EMPTY -1
+#define JOBS_RETRY -2
+
+typedef struct {
+    atomic_int top;         /* Thieves take from here */
+    atomic_int bottom;      /* Owner pushes and pops here */
+    atomic_int tasks[JOBS_DEQUE_SIZE];
+} jobs_deque_t;
+
+static struct {
+    int threads;            /* Pool size, caller included */
+    thread_t workers[JOBS_MAX_THREADS];
+    jobs_deque_t deques[JOBS_MAX_THREADS];  /* [0] is the caller's */
+
+    thread_mutex_t mutex;
+    thread_cond_t wake;     /* Workers wait for a new generation */
+    thread_cond_t done;     /* jobs_run() waits for the batch */
+    unsigned generation;
+    int active;             /* Workers not yet parked after this batch */
+    int quit;
+
+    jobs_fn fn;
+    void *data;
+    int base;               /* Index of task 0 in this round */
+    atomic_int pending;     /* Tasks not finished in this round */
+} jobs_state = { .threads = 1 };
+
+static void deque_push(jobs_deque_t *d, int task) {
+    int b = atomic_load(&d->bottom);
+    atomic_store(&d->tasks[b & JOBS_DEQUE_MASK], task);
+    atomic_store(&d->bottom, b + 1);
+}
+
+static int deque_pop(jobs_deque_t *d) {
+    int b = atomic_load(&d->bottom) - 1;
+    atomic_store(&d->bottom, b);
+    int t = atomic_load(&d->top);
+    if (t > b) {
+        atomic_store(&d->bottom, b + 1);
+        return JOBS_EMPTY;
+    }
+    int task = atomic_load(&d->tasks[b & JOBS_DEQUE_MASK]);
+    if (t == b) {
+        /* Last task: race the thieves for it */
+        if (!atomic_compare_exchange_strong(&d->top, &t, t + 1)) {
+            task = JOBS_EMPTY;
+        }
+        atomic_store(&d->bottom, b + 1);
+    }
+    return task;
+}
+
+static int deque_steal(jobs_deque_t *d) {
+    int t = atomic_load(&d->top);
+    int b = atomic_load(&d->bottom);
+    if (t >= b) {
+        return JOBS_EMPTY;
+    }
+    int task = atomic_load(&d->tasks[t & JOBS_DEQUE_MASK]);
+    if (!atomic_compare_exchange_strong(&d->top, &t, t + 1)) {
+        return JOBS_RETRY;
+    }
+    return task;
+}
+
+/* Run tasks from our own deque, then steal until every deque is empty */
+static void jobs_work(int self) {
+    for (;;) {
+        int task = deque_pop(&jobs_state.deques[self]);
+        for (int i = 1; task < 0 && i < jobs_state.threads; i++) {
+            jobs_deque_t *victim = &jobs_state.deques[(self + i) % jobs_state.threads];
+            do {
+                task = deque_steal(victim);
+            } while (task == JOBS_RETRY);
+        }
+        if (task < 0) {
+            return;
+        }
+        jobs_state.fn(jobs_state.data, jobs_state.base + task);
+        if (atomic_fetch_sub(&jobs_state.pending, 1) == 1) {
+            thread_mutex_lock(&jobs_state.mutex);
+            thread_cond_broadcast(&jobs_state.done);
+            thread_mutex_unlock(&jobs_state.mutex);
+        }
+    }
+}
+
+static void jobs_worker(void *arg) {
+    int self = (int)(intptr_t)arg;
+    unsigned seen = 0;
+    thread_mutex_lock(&jobs_state.mutex);
+    for (;;) {
+        while (jobs_state.generation == seen && !jobs_state.quit) {
+            thread_cond_wait(&jobs_state.wake, &jobs_state.mutex);
+        }
+        if (jobs_state.quit) {
+            break;
+        }
+        seen = jobs_state.generation;
+        thread_mutex_unlock(&jobs_state.mutex);
+
+        jobs_work(self);
+
+        thread_mutex_lock(&jobs_state.mutex);
+        if (--jobs_state.active == 0) {
+            thread_cond_broadcast(&jobs_state.done);
+        }
+    }
+    thread_mutex_unlock(&jobs_state.mutex);
+}
+
+int jobs_init(int threads) {
+    jobs_shutdown();
+    if (threads <= 0) {
+        threads = thread_cpu_count();
+    }
+    if (threads > JOBS_MAX_THREADS) {
+        threads = JOBS_MAX_THREADS;
+    }
+    if (threads <= 1) {
+        return 1;
+    }
+
+    thread_mutex_init(&jobs_state.mutex);
+    thread_cond_init(&jobs_state.wake);
+    thread_cond_init(&jobs_state.done);
+    jobs_state.generation = 0;
+    jobs_state.active = 0;
+    jobs_state.quit = 0;
+
+    jobs_state.threads = 1;
+    for (int i = 1; i < threads; i++) {
+        if (thread_create(&jobs_state.workers[i], jobs_worker, (void *)(intptr_t)i) != 0) {
+            break;
+        }
+        jobs_state.threads++;
+    }
+    if (jobs_state.threads == 1) {
+        thread_cond_destroy(&jobs_state.done);
+        thread_cond_destroy(&jobs_state.wake);
+        thread_mutex_destroy(&jobs_state.mutex);
+        return 1;
+    }
+    printf("[jobs] Started %d worker threads\n", jobs_state.threads - 1);
+    return jobs_state.threads;
+}
+
+void jobs_shutdown(void) {
+    if (jobs_state.threads <= 1) {
+        return;
+    }
+    thread_mutex_lock(&jobs_state.mutex);
+    jobs_state.quit = 1;
+    thread_cond_broadcast(&jobs_state.wake);
+    thread_mutex_unlock(&jobs_state.mutex);
+    for (int i = 1; i < jobs_state.threads; i++) {
+        thread_join(&jobs_state.workers[i]);
+    }
+    thread_cond_destroy(&jobs_state.done);
+    thread_cond_destroy(&jobs_state.wake);
+    thread_mutex_destroy(&jobs_state.mutex);
+    jobs_state.threads = 1;
+}
+
+int jobs_thread_count(void) {
+    return jobs_state.threads;
+}
+
+void jobs_run(jobs_fn fn, void *data, int count) {
+    int threads = jobs_state.threads;
+    if (threads <= 1 || count <= 1) {
+        for (int i = 0; i < count; i++) {
+            fn(data, i);
+        }
+        return;
+    }
+
+    int round_size = threads * JOBS_DEQUE_SIZE;
+    for (int base = 0; base < count; base += round_size) {
+        int round = count - base < round_size ? count - base : round_size;
+
+        /* Workers are all parked: deal the round into the deques */
+        for (int i = 0; i < threads; i++) {
+            atomic_store(&jobs_state.deques[i].top, 0);
+            atomic_store(&jobs_state.deques[i].bottom, 0);
+        }
+        for (int i = 0; i < round; i++) {
+            deque_push(&jobs_state.deques[i % threads], i);
+        }
+        jobs_state.fn = fn;
+        jobs_state.data = data;
+        jobs_state.base = base;
+        atomic_store(&jobs_state.pending, round);
+
+        thread_mutex_lock(&jobs_state.mutex);
+        jobs_state.active = threads - 1;
+        jobs_state.generation++;
+        thread_cond_broadcast(&jobs_state.wake);
+        thread_mutex_unlock(&jobs_state.mutex);
+
+        jobs_work(0);
+
+        thread_mutex_lock(&jobs_state.mutex);
+        while (atomic_load(&jobs_state.pending) > 0 || jobs_state.active > 0) {
+            thread_cond_wait(&jobs_state.done, &jobs_state.mutex);
+        }
+        thread_mutex_unlock(&jobs_state.mutex);
+    }
+}
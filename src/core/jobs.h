@@ -0,0 +1,55 @@
+/**
+ * Job System - Fixed worker pool with work-stealing deques
+ *
+ * Runs batches of independent indexed tasks across a pool of worker
+ * threads started once at init. Each thread owns a deque; a batch is
+ * dealt round-robin into the deques, owners pop from the bottom and idle
+ * threads steal from the top of the others. The calling thread takes part
+ * in every batch, so a pool of N threads starts N-1 workers.
+ *
+ * Tasks must not depend on the order they run in. Without threads (pool
+ * of one, or thread creation failing) batches run inline in index order.
+ * jobs_run() is called from one thread at a time.
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+/* Most threads in the pool, the caller included */
+#define JOBS_MAX_THREADS 16
+
+/**
+ * Task entry point
+ * @param data Batch data passed to jobs_run()
+ * @param index Task index, 0..count-1
+ */
+typedef void (*jobs_fn)(void *data, int index);
+
+/**
+ * Start the worker pool.
+ * @param threads Threads including the caller, 0 for one per CPU core
+ *                (clamped to 1..JOBS_MAX_THREADS)
+ * @return Threads actually in the pool (1 if workers could not start)
+ */
+int jobs_init(int threads);
+
+/**
+ * Stop and join the workers. Safe without jobs_init().
+ */
+void jobs_shutdown(void);
+
+/**
+ * Get the pool size, the caller included.
+ * @return Threads in the pool (1 before jobs_init())
+ */
+int jobs_thread_count(void);
+
+/**
+ * Run fn(data, i) for i in 0..count-1 and wait for all of them.
+ * @param fn Task entry point
+ * @param data Passed to every task
+ * @param count Number of tasks
+ */
+void jobs_run(jobs_fn fn, void *data, int count);
+
+#endif /* JOBS_H */
@@ -0,0 +1,151 @@
+/**
+ * Mapped Files - Implementation
+ */
+
+#include "mapfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Fallback: read the whole file into memory */
+static int read_whole(mapfile_t *map, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(f);
+        return -1;
+    }
+    void *data = malloc((size_t)size);
+    if (!data) {
+        fprintf(stderr, "MAPFILE: Out of memory (%ld bytes): %s\n", size, path);
+        fclose(f);
+        return -1;
+    }
+    size_t read = fread(data, 1, (size_t)size, f);
+    fclose(f);
+    if (read != (size_t)size) {
+        free(data);
+        return -1;
+    }
+    map->data = data;
+    map->size = (size_t)size;
+    map->mapped = 0;
+    return 0;
+}
+
+#if defined(_WIN32)
+
+static int map_whole(mapfile_t *map, const char *path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+        CloseHandle(file);
+        return -1;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return -1;
+    }
+    map->data = data;
+    map->size = (size_t)size.QuadPart;
+    map->mapped = 1;
+    map->file = file;
+    map->mapping = mapping;
+    return 0;
+}
+
+static void unmap_whole(mapfile_t *map) {
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+}
+
+#elif !defined(__EMSCRIPTEN__)
+
+static int map_whole(mapfile_t *map, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    map->data = data;
+    map->size = (size_t)st.st_size;
+    map->mapped = 1;
+    return 0;
+}
+
+static void unmap_whole(mapfile_t *map) {
+    munmap((void *)map->data, map->size);
+}
+
+#else
+
+/* Emscripten: MEMFS and fetched files are already in memory */
+static int map_whole(mapfile_t *map, const char *path) {
+    (void)map;
+    (void)path;
+    return -1;
+}
+
+static void unmap_whole(mapfile_t *map) {
+    (void)map;
+}
+
+#endif
+
+int mapfile_open(mapfile_t *map, const char *path) {
+    memset(map, 0, sizeof(*map));
+    if (!path) {
+        return -1;
+    }
+    if (map_whole(map, path) == 0) {
+        return 0;
+    }
+    return read_whole(map, path);
+}
+
+void mapfile_close(mapfile_t *map) {
+    if (map->data) {
+        if (map->mapped) {
+            unmap_whole(map);
+        } else {
+            free((void *)map->data);
+        }
+    }
+    memset(map, 0, sizeof(*map));
+}
@@ -0,0 +1,42 @@
+/**
+ * Mapped Files - Read-only file mappings with a read-into-memory fallback
+ *
+ * Maps whole files with mmap (POSIX) or CreateFileMapping (Win32), so
+ * large assets are paged in on demand and shared with the OS cache.
+ * Where mapping is unavailable (Emscripten) or fails, the file is read
+ * into a malloc'd buffer instead; callers see the same data either way.
+ */
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+
+/**
+ * Mapped file
+ */
+typedef struct {
+    const void *data;   /* File contents (read-only) */
+    size_t size;        /* Size in bytes */
+    int mapped;         /* 1 if data is a mapping, 0 if a heap copy */
+#if defined(_WIN32)
+    void *file;         /* HANDLE */
+    void *mapping;      /* HANDLE */
+#endif
+} mapfile_t;
+
+/**
+ * Map a file read-only.
+ * @param map Receives the mapping
+ * @param path File path
+ * @return 0 on success, -1 if the file cannot be opened, is empty or unreadable
+ */
+int mapfile_open(mapfile_t *map, const char *path);
+
+/**
+ * Release a mapping (safe on a zeroed or closed map).
+ * @param map Mapping to close
+ */
+void mapfile_close(mapfile_t *map);
+
+#endif /* MAPFILE_H */
@@ -0,0 +1,464 @@
+/**
+ * Pack Archives - Implementation
+ *
+ * File layout (little-endian):
+ *   header   16 bytes: "SRPK", version, entry count, reserved
+ *   index    64 bytes per entry, sorted by folded name:
+ *            offset, size, name[PACK_NAME_SIZE]
+ *   data     each entry starts on a PACK_ALIGN boundary
+ *
+ * Loose files are read into blocks with a PACK_ALIGN header linking them,
+ * so pack_release() and pack_shutdown() can find and free them.
+ */
+
+#include "pack.h"
+#include "mapfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_MAGIC 0x4B505253u      /* "SRPK" */
+#define PACK_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_entries;
+    uint32_t reserved;
+} pack_header_t;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    char name[PACK_NAME_SIZE];
+} pack_entry_t;
+
+typedef struct {
+    mapfile_t map;              /* Zeroed for pack_open_memory() packs */
+    const uint8_t *base;
+    size_t size;
+    const pack_entry_t *entries;
+    uint32_t num_entries;
+} pack_archive_t;
+
+/* Heap copy of a loose file; data follows the PACK_ALIGN header */
+typedef struct pack_loose {
+    struct pack_loose *next;
+} pack_loose_t;
+
+static struct {
+    pack_archive_t archives[PACK_MAX_ARCHIVES];
+    int num_archives;
+    char *paths[PACK_MAX_PATHS];
+    int num_paths;
+    pack_loose_t *loose;
+} pack_state;
+
+/* Fold a name for the index: upper case, '/' separators */
+static int fold_name(char *out, const char *name) {
+    size_t i = 0;
+    for (; name[i]; i++) {
+        if (i + 1 >= PACK_NAME_SIZE) {
+            return -1;
+        }
+        char c = name[i];
+        if (c == '\\') {
+            c = '/';
+        } else if (c >= 'a' && c <= 'z') {
+            c = (char)(c - 'a' + 'A');
+        }
+        out[i] = c;
+    }
+    out[i] = '\0';
+    return 0;
+}
+
+static const pack_entry_t *find_entry(const pack_archive_t *archive, const char *folded) {
+    uint32_t lo = 0;
+    uint32_t hi = archive->num_entries;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int c = strcmp(archive->entries[mid].name, folded);
+        if (c == 0) {
+            return &archive->entries[mid];
+        }
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/* First pack entry with this name, in open order */
+static const pack_entry_t *lookup(const char *name, const pack_archive_t **archive) {
+    char folded[PACK_NAME_SIZE];
+    if (fold_name(folded, name) != 0) {
+        return NULL;
+    }
+    for (int i = 0; i < pack_state.num_archives; i++) {
+        const pack_entry_t *e = find_entry(&pack_state.archives[i], folded);
+        if (e) {
+            *archive = &pack_state.archives[i];
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* Open a loose file from the search paths */
+static FILE *open_loose(const char *name) {
+    if (pack_state.num_paths == 0) {
+        return fopen(name, "rb");
+    }
+    for (int i = 0; i < pack_state.num_paths; i++) {
+        char path[512];
+        int n = snprintf(path, sizeof(path), "%s/%s", pack_state.paths[i], name);
+        if (n < 0 || (size_t)n >= sizeof(path)) {
+            continue;
+        }
+        FILE *f = fopen(path, "rb");
+        if (f) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+static long file_size(FILE *f) {
+    if (fseek(f, 0, SEEK_END) != 0) {
+        return -1;
+    }
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    return size;
+}
+
+/* Validate a pack image and add it to the search order */
+static int add_archive(const mapfile_t *map, const void *data, size_t size) {
+    if (pack_state.num_archives >= PACK_MAX_ARCHIVES) {
+        fprintf(stderr, "PACK: ERROR Too many packs (max %d)\n", PACK_MAX_ARCHIVES);
+        return -1;
+    }
+
+    const pack_header_t *h = data;
+    if (size < sizeof(*h) || h->magic != PACK_MAGIC || h->version != PACK_VERSION ||
+        h->num_entries > (size - sizeof(*h)) / sizeof(pack_entry_t)) {
+        return -1;
+    }
+    const pack_entry_t *entries = (const pack_entry_t *)((const uint8_t *)data + sizeof(*h));
+    for (uint32_t i = 0; i < h->num_entries; i++) {
+        const pack_entry_t *e = &entries[i];
+        if (memchr(e->name, '\0', PACK_NAME_SIZE) == NULL ||
+            e->offset % PACK_ALIGN != 0 || e->offset > size || e->size > size - e->offset ||
+            (i > 0 && strcmp(entries[i - 1].name, e->name) >= 0)) {
+            return -1;
+        }
+    }
+
+    pack_archive_t *archive = &pack_state.archives[pack_state.num_archives++];
+    memset(archive, 0, sizeof(*archive));
+    if (map) {
+        archive->map = *map;
+    }
+    archive->base = data;
+    archive->size = size;
+    archive->entries = entries;
+    archive->num_entries = h->num_entries;
+    return 0;
+}
+
+void pack_init(void) {
+    pack_shutdown();
+}
+
+void pack_shutdown(void) {
+    for (int i = 0; i < pack_state.num_archives; i++) {
+        mapfile_close(&pack_state.archives[i].map);
+    }
+    for (int i = 0; i < pack_state.num_paths; i++) {
+        free(pack_state.paths[i]);
+    }
+    while (pack_state.loose) {
+        pack_loose_t *next = pack_state.loose->next;
+        free(pack_state.loose);
+        pack_state.loose = next;
+    }
+    memset(&pack_state, 0, sizeof(pack_state));
+}
+
+int pack_open(const char *path) {
+    mapfile_t map;
+    if (mapfile_open(&map, path) != 0) {
+        return -1;
+    }
+    if (add_archive(&map, map.data, map.size) != 0) {
+        fprintf(stderr, "PACK: ERROR Not a valid pack: %s\n", path);
+        mapfile_close(&map);
+        return -1;
+    }
+    printf("[pack] Opened %s (%u files%s)\n", path,
+           pack_state.archives[pack_state.num_archives - 1].num_entries,
+           map.mapped ? ", mapped" : "");
+    return 0;
+}
+
+int pack_open_memory(const void *data, size_t size) {
+    if (!data || add_archive(NULL, data, size) != 0) {
+        fprintf(stderr, "PACK: ERROR Not a valid pack in memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+int pack_add_path(const char *dir) {
+    if (pack_state.num_paths >= PACK_MAX_PATHS) {
+        fprintf(stderr, "PACK: ERROR Too many search paths (max %d)\n", PACK_MAX_PATHS);
+        return -1;
+    }
+    char *copy = malloc(strlen(dir) + 1);
+    if (!copy) {
+        return -1;
+    }
+    strcpy(copy, dir);
+    pack_state.paths[pack_state.num_paths++] = copy;
+    return 0;
+}
+
+int pack_exists(const char *name, size_t *size) {
+    const pack_archive_t *archive;
+    const pack_entry_t *e = lookup(name, &archive);
+    if (e) {
+        if (size) {
+            *size = e->size;
+        }
+        return 1;
+    }
+
+    FILE *f = open_loose(name);
+    if (!f) {
+        return 0;
+    }
+    long n = file_size(f);
+    fclose(f);
+    if (n < 0) {
+        return 0;
+    }
+    if (size) {
+        *size = (size_t)n;
+    }
+    return 1;
+}
+
+const void *pack_readfile(const char *name, size_t *size) {
+    const pack_archive_t *archive;
+    const pack_entry_t *e = lookup(name, &archive);
+    if (e) {
+        if (size) {
+            *size = e->size;
+        }
+        return archive->base + e->offset;
+    }
+
+    FILE *f = open_loose(name);
+    if (!f) {
+        fprintf(stderr, "PACK: ERROR File not found: %s\n", name);
+        return NULL;
+    }
+    long n = file_size(f);
+    pack_loose_t *block = n >= 0 ? malloc(PACK_ALIGN + (size_t)n) : NULL;
+    if (!block) {
+        fprintf(stderr, "PACK: ERROR Cannot read %s\n", name);
+        fclose(f);
+        return NULL;
+    }
+    uint8_t *data = (uint8_t *)block + PACK_ALIGN;
+    size_t read = fread(data, 1, (size_t)n, f);
+    fclose(f);
+    if (read != (size_t)n) {
+        fprintf(stderr, "PACK: ERROR Read error: %s\n", name);
+        free(block);
+        return NULL;
+    }
+
+    block->next = pack_state.loose;
+    pack_state.loose = block;
+    if (size) {
+        *size = (size_t)n;
+    }
+    return data;
+}
+
+void pack_release(const void *data) {
+    if (!data) {
+        return;
+    }
+    for (pack_loose_t **link = &pack_state.loose; *link; link = &(*link)->next) {
+        if ((const uint8_t *)*link + PACK_ALIGN == data) {
+            pack_loose_t *block = *link;
+            *link = block->next;
+            free(block);
+            return;
+        }
+    }
+}
+
+int pack_is_loose(const void *data) {
+    for (const pack_loose_t *block = pack_state.loose; block; block = block->next) {
+        if ((const uint8_t *)block + PACK_ALIGN == data) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+long pack_readfileto(void *buffer, const char *name, size_t pos, size_t count) {
+    const pack_archive_t *archive;
+    const pack_entry_t *e = lookup(name, &archive);
+    if (e) {
+        if (pos >= e->size) {
+            return 0;
+        }
+        if (count > e->size - pos) {
+            count = e->size - pos;
+        }
+        memcpy(buffer, archive->base + e->offset + pos, count);
+        return (long)count;
+    }
+
+    FILE *f = open_loose(name);
+    if (!f) {
+        fprintf(stderr, "PACK: ERROR File not found: %s\n", name);
+        return -1;
+    }
+    long read = 0;
+    if (fseek(f, (long)pos, SEEK_SET) == 0) {
+        read = (long)fread(buffer, 1, count, f);
+    }
+    fclose(f);
+    return read;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(((const pack_entry_t *)a)->name, ((const pack_entry_t *)b)->name);
+}
+
+/* Copy one source file into the pack at its entry offset */
+static int copy_file(FILE *out, const char *path, uint32_t size) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        return -1;
+    }
+    char buf[16384];
+    uint32_t left = size;
+    while (left > 0) {
+        size_t chunk = left < sizeof(buf) ? left : sizeof(buf);
+        if (fread(buf, 1, chunk, in) != chunk || fwrite(buf, 1, chunk, out) != chunk) {
+            fclose(in);
+            return -1;
+        }
+        left -= (uint32_t)chunk;
+    }
+    fclose(in);
+    return 0;
+}
+
+/* Write a pack from source files or, when files is NULL, from memory */
+static int write_pack(const char *path, int num_files, const char *const files[],
+                      const void *const data[], const size_t sizes[], const char *const names[]) {
+    if (num_files < 0) {
+        return -1;
+    }
+    pack_entry_t *entries = calloc((size_t)num_files + 1, sizeof(pack_entry_t));
+    int *source = malloc(sizeof(int) * ((size_t)num_files + 1));
+    if (!entries || !source) {
+        free(entries);
+        free(source);
+        return -1;
+    }
+
+    /* Names and sizes; offsets are assigned after sorting */
+    int ok = 1;
+    for (int i = 0; i < num_files && ok; i++) {
+        long long size = -1;
+        if (files) {
+            FILE *f = fopen(files[i], "rb");
+            size = f ? file_size(f) : -1;
+            if (f) {
+                fclose(f);
+            }
+        } else if (data[i] || sizes[i] == 0) {
+            size = (long long)sizes[i];
+        }
+        if (size < 0 || (unsigned long long)size > UINT32_MAX - PACK_ALIGN) {
+            fprintf(stderr, "PACK: ERROR Cannot read %s\n", files ? files[i] : names[i]);
+            ok = 0;
+        } else if (fold_name(entries[i].name, names[i]) != 0) {
+            fprintf(stderr, "PACK: ERROR Name too long (max %d): %s\n", PACK_NAME_SIZE - 1, names[i]);
+            ok = 0;
+        }
+        entries[i].size = (uint32_t)size;
+        entries[i].offset = (uint32_t)i;    /* Source index until sorted */
+    }
+    if (ok) {
+        qsort(entries, (size_t)num_files, sizeof(pack_entry_t), compare_names);
+    }
+
+    uint64_t offset = sizeof(pack_header_t) + (uint64_t)num_files * sizeof(pack_entry_t);
+    for (int i = 0; i < num_files && ok; i++) {
+        if (i > 0 && strcmp(entries[i - 1].name, entries[i].name) == 0) {
+            fprintf(stderr, "PACK: ERROR Duplicate name: %s\n", entries[i].name);
+            ok = 0;
+        }
+        offset = (offset + PACK_ALIGN - 1) & ~(uint64_t)(PACK_ALIGN - 1);
+        source[i] = (int)entries[i].offset;
+        entries[i].offset = (uint32_t)offset;
+        offset += entries[i].size;
+        if (offset > UINT32_MAX) {
+            fprintf(stderr, "PACK: ERROR Pack larger than 4 GB\n");
+            ok = 0;
+        }
+    }
+
+    FILE *out = ok ? fopen(path, "wb") : NULL;
+    if (out) {
+        pack_header_t h = { PACK_MAGIC, PACK_VERSION, (uint32_t)num_files, 0 };
+        ok = fwrite(&h, sizeof(h), 1, out) == 1 &&
+             fwrite(entries, sizeof(pack_entry_t), (size_t)num_files, out) == (size_t)num_files;
+        for (int i = 0; i < num_files && ok; i++) {
+            static const uint8_t zero[PACK_ALIGN];
+            long pad = (long)entries[i].offset - ftell(out);
+            ok = pad >= 0 && pad < PACK_ALIGN &&
+                 fwrite(zero, 1, (size_t)pad, out) == (size_t)pad &&
+                 (files ? copy_file(out, files[source[i]], entries[i].size) == 0 :
+                  fwrite(data[source[i]], 1, entries[i].size, out) == entries[i].size);
+            if (!ok) {
+                fprintf(stderr, "PACK: ERROR Cannot copy %s\n", files ? files[source[i]] : names[source[i]]);
+            }
+        }
+        if (fclose(out) != 0) {
+            ok = 0;
+        }
+        if (!ok) {
+            remove(path);
+        }
+    } else if (ok) {
+        fprintf(stderr, "PACK: ERROR Cannot create %s\n", path);
+        ok = 0;
+    }
+
+    free(entries);
+    free(source);
+    return ok ? 0 : -1;
+}
+
+int pack_write(const char *path, int num_files, const char *const files[],
+               const char *const names[]) {
+    return write_pack(path, num_files, files, NULL, NULL, names);
+}
+
+int pack_write_data(const char *path, int num_files, const void *const data[],
+                    const size_t sizes[], const char *const names[]) {
+    return write_pack(path, num_files, NULL, data, sizes, names);
+}
@@ -0,0 +1,132 @@
+/**
+ * Pack Archives - Asset loading from memory-mapped pack files
+ *
+ * Replaces the original MAIN/LOADER.H (initloader, readfile, readfileto2,
+ * psopen). Packs built by the srpack tool hold a sorted name index and
+ * 16-byte aligned entries, so a mapped pack serves readfile() as a
+ * zero-copy pointer and lookups are a binary search. Names not found in
+ * any open pack are read from the loose-file search paths instead.
+ *
+ * Names compare case-insensitively with '\\' and '/' equivalent, like the
+ * DOS originals. Main thread only, except that pack_exists() and
+ * pack_readfileto() only read the index and may run on background readers
+ * while no pack is being opened or closed.
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open packs (web builds open one segment per part) and loose-file search paths */
+#define PACK_MAX_ARCHIVES 32
+#define PACK_MAX_PATHS 8
+
+/* Longest entry name, including the terminator */
+#define PACK_NAME_SIZE 56
+
+/* Entry data alignment inside a pack */
+#define PACK_ALIGN 16
+
+/**
+ * Initialize the loader (no packs, no search paths).
+ */
+void pack_init(void);
+
+/**
+ * Close all packs and free loose files still held.
+ * Pointers from pack_readfile() are invalid afterwards.
+ */
+void pack_shutdown(void);
+
+/**
+ * Open a pack file (memory-mapped). Packs are searched in open order.
+ * @param path Pack file path
+ * @return 0 on success, -1 if missing or not a valid pack
+ */
+int pack_open(const char *path);
+
+/**
+ * Open a pack already in memory (e.g. fetched into one buffer on the web).
+ * @param data Pack contents, kept alive by the caller until pack_shutdown()
+ * @param size Size in bytes
+ * @return 0 on success, -1 if not a valid pack
+ */
+int pack_open_memory(const void *data, size_t size);
+
+/**
+ * Add a directory searched for loose files (initloaderpath).
+ * Without any, loose names are opened relative to the working directory.
+ * @param dir Directory path
+ * @return 0 on success, -1 if the path table is full
+ */
+int pack_add_path(const char *dir);
+
+/**
+ * Check whether a file exists in a pack or search path.
+ * @param name File name
+ * @param size Receives the size in bytes (may be NULL)
+ * @return 1 if found, 0 if not
+ */
+int pack_exists(const char *name, size_t *size);
+
+/**
+ * Get a whole file (readfile).
+ * Pack entries are returned in place (16-byte aligned, read-only); loose
+ * files are read into memory held until pack_release() or pack_shutdown().
+ * @param name File name
+ * @param size Receives the size in bytes (may be NULL)
+ * @return File data, or NULL if not found
+ */
+const void *pack_readfile(const char *name, size_t *size);
+
+/**
+ * Release data from pack_readfile() (no-op for pack entries).
+ * @param data Pointer returned by pack_readfile(), or NULL
+ */
+void pack_release(const void *data);
+
+/**
+ * Check whether pack_readfile() data is a loose file's memory, which
+ * stays held until pack_release(), rather than a pack entry.
+ * @param data Pointer returned by pack_readfile()
+ * @return 1 for a loose file, 0 for a pack entry
+ */
+int pack_is_loose(const void *data);
+
+/**
+ * Read part of a file into a buffer (readfileto2), for streaming large
+ * tables and animations without holding a loose file in memory.
+ * @param buffer Destination
+ * @param name File name
+ * @param pos Byte offset into the file
+ * @param count Bytes to read
+ * @return Bytes read (short at end of file), or -1 if not found
+ */
+long pack_readfileto(void *buffer, const char *name, size_t pos, size_t count);
+
+/**
+ * Write a pack file (used by the srpack tool).
+ * @param path Output pack path
+ * @param num_files Number of files
+ * @param files Source file paths
+ * @param names Entry names (folded to upper case with '/' separators)
+ * @return 0 on success, -1 on failure (no file is left behind)
+ */
+int pack_write(const char *path, int num_files, const char *const files[],
+               const char *const names[]);
+
+/**
+ * Write a pack file from entries in memory (used by the srbake tool).
+ * @param path Output pack path
+ * @param num_files Number of entries
+ * @param data Entry contents
+ * @param sizes Entry sizes in bytes
+ * @param names Entry names (folded to upper case with '/' separators)
+ * @return 0 on success, -1 on failure (no file is left behind)
+ */
+int pack_write_data(const char *path, int num_files, const void *const data[],
+                    const size_t sizes[], const char *const names[]);
+
+#endif /* PACK_H */
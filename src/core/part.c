@@ -2,11 +2,28 @@
  * Part Loader Framework - Implementation
  *
  * Manages demo part lifecycle and sequencing.
+ *
+ * Seeks start a part as a straight run would have reached it, without
+ * running the parts before it: the music is placed through the sync
+ * index and the message areas come from snapshots recorded at each part
+ * start of an earlier run from the first part.
+ *
+ * Files still downloading (web builds) never block: a part whose
+ * segment or module has not arrived is held and started from
+ * part_loader_tick(), and the segment of the part after the starting
+ * one is requested right behind it.
  */
 
 #include "part.h"
+#include "arena.h"
+#include "thread.h"
 #include "dis.h"
 #include "video.h"
+#include "profile.h"
+#include "framecheck.h"
+#include "fetch.h"
+#include "audio/music.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -22,6 +39,339 @@ static int s_registry_count = 0;
 static int s_current_index = -1;
 static int s_running = 0;
 static sr_part_transition_fn s_transition_callback = NULL;
+static const char *s_music_path = NULL;    /* Module the sequence plays */
+static const char *s_sequence_music = NULL; /* Module the sequence starts with */
+static int s_music_waiting = 0;            /* s_music_path loading in the background */
+static int s_music_fetching = 0;           /* s_music_path still downloading; load it then */
+static int s_music_prefetch_retry = 0;     /* Next module was downloading, prefetch it later */
+static const char *s_common_pack = NULL;   /* Segment every part needs */
+static int s_mem_hard_cap = 0;
+
+/* Message area snapshot file: magic, version, count, then per part an
+ * int32 sr_part_id_t and the areas */
+#define PART_SNAPSHOT_MAGIC 0x534D5253u  /* "SRMS" */
+#define PART_SNAPSHOT_VERSION 1
+#define PART_SNAPSHOT_SIZE (DIS_MSG_AREA_COUNT * DIS_MSG_AREA_SIZE)
+
+/* Message areas as each part found them at its start, by part id */
+static struct {
+    uint8_t areas[SR_PART_COUNT][PART_SNAPSHOT_SIZE];
+    uint8_t valid[SR_PART_COUNT];
+    int trusted;            /* Current areas follow from a run from the first part */
+    int changed;            /* Recorded since loaded */
+    const char *path;
+} s_snapshots;
+
+/* Part held until its files are available */
+static struct {
+    int active;
+    int from;           /* Part transitioned from, -1 if none */
+    int seek;           /* Entered through part_loader_seek() */
+} s_hold;
+
+/* Part memory: the current part's arena and the one the next part
+ * prepares into; they swap at the transition */
+static arena_t s_arenas[2];
+static arena_t *s_arena = &s_arenas[0];
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define PART_THREAD_LOCAL __declspec(thread)
+#else
+#define PART_THREAD_LOCAL _Thread_local
+#endif
+
+/* Arena of the part being prepared on this thread (NULL: s_arena) */
+static PART_THREAD_LOCAL arena_t *t_prepare_arena = NULL;
+
+/* Background prepare of the next part (one at a time) */
+static struct {
+    int index;          /* Part being prepared, -1 if none */
+    int threaded;       /* Running on thread, not joined yet */
+    thread_t thread;
+} s_prepare = { .index = -1 };
+
+static int same_music(const char *a, const char *b) {
+    return a && b && strcmp(a, b) == 0;
+}
+
+/* Not downloading (a failed or never requested file counts as there) */
+static int part_fetched(const char *path) {
+    return fetch_status(path) != FETCH_PENDING;
+}
+
+/* Module in effect when a part starts in a straight run */
+static const char *part_music_at(int index) {
+    const char *music = s_sequence_music;
+    for (int i = 0; i <= index; i++) {
+        if (s_registry[i] && s_registry[i]->music) {
+            music = s_registry[i]->music;
+        }
+    }
+    return music;
+}
+
+/* A part's segment is there, so it can be prepared */
+static int part_pack_ready(int index) {
+    sr_part_t *part = s_registry[index];
+    return part_fetched(s_common_pack) && (!part || part_fetched(part->pack));
+}
+
+/* Everything a part loads when it starts is there; a seek also places
+ * the music through the sync index, so it needs the module in effect */
+static int part_files_ready(int index, int seek) {
+    sr_part_t *part = s_registry[index];
+    const char *music = seek ? part_music_at(index) : part ? part->music : NULL;
+    return part_pack_ready(index) && part_fetched(music);
+}
+
+static void part_request(const sr_part_t *part, int flags) {
+    if (part && part->pack) {
+        fetch_request(part->pack, FETCH_PACK | flags);
+    }
+    if (part && part->music) {
+        fetch_request(part->music, flags);
+    }
+}
+
+/**
+ * Ask for the files of a starting part, then the next part's, then the
+ * rest of the sequence in order. Already requested files keep their
+ * place unless they move to the front.
+ */
+static void part_request_files(int index) {
+    /* Urgent requests go in front of earlier ones: next part first */
+    if (index + 1 < s_registry_count) {
+        part_request(s_registry[index + 1], FETCH_URGENT);
+    }
+    part_request(s_registry[index], FETCH_URGENT);
+    const char *music = part_music_at(index);
+    if (music) {
+        fetch_request(music, FETCH_URGENT);
+    }
+    for (int i = index + 2; i < s_registry_count; i++) {
+        part_request(s_registry[i], 0);
+    }
+}
+
+/**
+ * Start loading the next module a later part switches to, so the switch
+ * itself only swaps pointers.
+ */
+static void part_prefetch_music(int index) {
+    s_music_prefetch_retry = 0;
+    if (s_music_waiting || music_load_pending_path()) {
+        return;
+    }
+    for (int i = index + 1; i < s_registry_count; i++) {
+        const char *music = s_registry[i] ? s_registry[i]->music : NULL;
+        if (music && !same_music(music, s_music_path)) {
+            if (!part_fetched(music)) {
+                s_music_prefetch_retry = 1;
+            } else {
+                music_load_file_async(music, NULL, NULL);
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Start the background load of the sequence module once it is parsed.
+ * Runs every tick; only the steps that complete a download or load may
+ * use the heap or print.
+ */
+static void part_poll_music(void) {
+    if (s_music_prefetch_retry) {
+        FRAMECHECK_ALLOW_BEGIN(FRAMECHECK_STEP_MUSIC_LOAD);
+        part_prefetch_music(s_current_index);
+        FRAMECHECK_ALLOW_END();
+    }
+    if (!s_music_waiting) {
+        return;
+    }
+    if (s_music_fetching) {
+        if (!part_fetched(s_music_path)) {
+            return;
+        }
+        s_music_fetching = 0;
+        FRAMECHECK_ALLOW_BEGIN(FRAMECHECK_STEP_MUSIC_LOAD);
+        bool started = music_load_file_async(s_music_path, NULL, NULL);
+        FRAMECHECK_ALLOW_END();
+        if (!started) {
+            s_music_waiting = 0;
+            return;
+        }
+    }
+    music_load_state_t state = music_load_poll();
+    if (state == MUSIC_LOAD_PENDING) {
+        return;
+    }
+    s_music_waiting = 0;
+    FRAMECHECK_ALLOW_BEGIN(FRAMECHECK_STEP_MUSIC_COMMIT);
+    if (state == MUSIC_LOAD_READY && music_load_commit()) {
+        music_play();
+    }
+    part_prefetch_music(s_current_index);
+    FRAMECHECK_ALLOW_END();
+}
+
+/**
+ * Make a module the one playing, from the start.
+ * Blocks only if the prefetch has not finished (or never ran).
+ */
+static void part_load_music(const char *music) {
+    printf("[part] Switching music to %s\n", music);
+    int loaded = 0;
+    if (same_music(music_load_pending_path(), music)) {
+        loaded = music_load_wait() == MUSIC_LOAD_READY && music_load_commit();
+    } else {
+        music_load_cancel();
+        loaded = music_load_file(music);
+    }
+    if (loaded) {
+        music_play();
+    }
+    s_music_path = music;
+    s_music_waiting = 0;
+    s_music_fetching = 0;
+}
+
+/**
+ * Switch to the module a starting part asks for.
+ */
+static void part_switch_music(int to_index) {
+    const char *music = s_registry[to_index] ? s_registry[to_index]->music : NULL;
+    if (music && !same_music(music, s_music_path)) {
+        part_load_music(music);
+    }
+    part_prefetch_music(to_index);
+}
+
+/**
+ * Place the music where a straight run would have it when a part starts:
+ * the module in effect at the part, at the part's start code.
+ */
+static void part_seek_music(int index) {
+    const char *music = part_music_at(index);
+    if (!music) {
+        return;
+    }
+    if (!same_music(music, s_music_path) || s_music_fetching) {
+        part_load_music(music);
+    } else if (s_music_waiting) {
+        /* The sync index comes with the module; wait for the background load */
+        s_music_waiting = 0;
+        if (music_load_wait() == MUSIC_LOAD_READY && music_load_commit()) {
+            music_play();
+        }
+    }
+
+    int code = s_registry[index] ? s_registry[index]->start_code : 0;
+    int order = 0;
+    int row = 0;
+    if (code > 0 && !music_find_sync_code(code, &order, &row)) {
+        printf("PART: ERROR - Sync code %d not found in %s, starting it from the top\n", code, music);
+        order = 0;
+        row = 0;
+    }
+    printf("[part] Music %s at order %d row %d\n", music, order, row);
+    music_set_position(order, row);
+}
+
+static int part_snapshot_id(int index) {
+    sr_part_t *part = s_registry[index];
+    return part && (int)part->id >= 0 && part->id < SR_PART_COUNT ? (int)part->id : -1;
+}
+
+/* Record the message areas a part starts with, if they are the real ones */
+static void part_record_snapshot(int index) {
+    int id = part_snapshot_id(index);
+    if (!s_snapshots.trusted || id < 0) {
+        return;
+    }
+    uint8_t areas[PART_SNAPSHOT_SIZE];
+    for (int a = 0; a < DIS_MSG_AREA_COUNT; a++) {
+        memcpy(areas + a * DIS_MSG_AREA_SIZE, dis_msgarea(a), DIS_MSG_AREA_SIZE);
+    }
+    if (!s_snapshots.valid[id] || memcmp(s_snapshots.areas[id], areas, sizeof(areas)) != 0) {
+        memcpy(s_snapshots.areas[id], areas, sizeof(areas));
+        s_snapshots.valid[id] = 1;
+        s_snapshots.changed = 1;
+    }
+}
+
+/* Set the message areas a seek target would have found in a straight run */
+static void part_restore_snapshot(int index) {
+    int id = part_snapshot_id(index);
+    if (index == 0 || (id >= 0 && s_snapshots.valid[id])) {
+        for (int a = 0; a < DIS_MSG_AREA_COUNT; a++) {
+            uint8_t *area = dis_msgarea(a);
+            if (index == 0) {
+                memset(area, 0, DIS_MSG_AREA_SIZE);
+            } else {
+                memcpy(area, s_snapshots.areas[id] + a * DIS_MSG_AREA_SIZE, DIS_MSG_AREA_SIZE);
+            }
+        }
+        s_snapshots.trusted = 1;
+        return;
+    }
+    printf("[part] No message area snapshot for %s; run from the first part once to record it\n",
+           s_registry[index] && s_registry[index]->name ? s_registry[index]->name : "(unnamed)");
+    s_snapshots.trusted = 0;
+}
+
+static int part_load_snapshots(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+    uint32_t header[3];
+    int ok = fread(header, sizeof(header), 1, f) == 1 && header[0] == PART_SNAPSHOT_MAGIC &&
+             header[1] == PART_SNAPSHOT_VERSION && header[2] <= SR_PART_COUNT;
+    for (uint32_t i = 0; ok && i < header[2]; i++) {
+        int32_t id;
+        uint8_t areas[PART_SNAPSHOT_SIZE];
+        ok = fread(&id, sizeof(id), 1, f) == 1 && fread(areas, sizeof(areas), 1, f) == 1 &&
+             id >= 0 && id < SR_PART_COUNT;
+        if (ok) {
+            memcpy(s_snapshots.areas[id], areas, sizeof(areas));
+            s_snapshots.valid[id] = 1;
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        memset(s_snapshots.valid, 0, sizeof(s_snapshots.valid));
+        fprintf(stderr, "PART: ERROR - Ignoring corrupt snapshot file %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int part_save_snapshots(const char *path) {
+    uint32_t header[3] = { PART_SNAPSHOT_MAGIC, PART_SNAPSHOT_VERSION, 0 };
+    for (int id = 0; id < SR_PART_COUNT; id++) {
+        header[2] += s_snapshots.valid[id];
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+    int ok = fwrite(header, sizeof(header), 1, f) == 1;
+    for (int32_t id = 0; ok && id < SR_PART_COUNT; id++) {
+        if (s_snapshots.valid[id]) {
+            ok = fwrite(&id, sizeof(id), 1, f) == 1 &&
+                 fwrite(s_snapshots.areas[id], PART_SNAPSHOT_SIZE, 1, f) == 1;
+        }
+    }
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
 
 /**
  * Clear video state for part transition.
@@ -34,6 +384,74 @@ static void part_clear_video(void) {
     }
     /* Clear framebuffer to index 0 (black) */
     video_clear(0);
+    /* Drop raster effects left behind by the previous part */
+    video_clear_scanlines();
+}
+
+static arena_t *prepare_arena(void) {
+    return s_arena == &s_arenas[0] ? &s_arenas[1] : &s_arenas[0];
+}
+
+static void prepare_worker(void *arg) {
+    sr_part_t *part = arg;
+    t_prepare_arena = prepare_arena();
+    part->prepare(part);
+    t_prepare_arena = NULL;
+}
+
+/* Start preparing the part after index while index runs */
+static void part_start_prepare(int index) {
+    int next = index + 1;
+    sr_part_t *part = next < s_registry_count ? s_registry[next] : NULL;
+    if (s_prepare.index >= 0 || !part || !part->prepare || !part_pack_ready(next)) {
+        return;
+    }
+    FRAMECHECK_ALLOW_BEGIN(FRAMECHECK_STEP_PREPARE_START);
+    arena_reset(prepare_arena());
+    if (thread_create(&s_prepare.thread, prepare_worker, part) == 0) {
+        s_prepare.index = next;
+        s_prepare.threaded = 1;
+    }
+    FRAMECHECK_ALLOW_END();
+}
+
+/* Wait for the background prepare; its arena is dropped unless kept */
+static int part_join_prepare(void) {
+    int index = s_prepare.index;
+    if (s_prepare.threaded) {
+        thread_join(&s_prepare.thread);
+        s_prepare.threaded = 0;
+    }
+    s_prepare.index = -1;
+    return index;
+}
+
+/**
+ * Hand the incoming part its memory: the arena it was prepared into, or
+ * a fresh one with prepare run here if it could not run ahead.
+ */
+static void part_finish_prepare(int to_index) {
+    if (part_join_prepare() == to_index) {
+        s_arena = prepare_arena();
+        return;
+    }
+    arena_reset(prepare_arena());
+    arena_reset(s_arena);
+    sr_part_t *part = s_registry[to_index];
+    if (part && part->prepare) {
+        part->prepare(part);
+    }
+}
+
+/* Report the ending part's memory peak and release its allocations */
+static void part_release_memory(sr_part_t *part) {
+    part->mem_peak = s_arena->peak;
+    if (s_arena->peak > 0) {
+        printf("[part] %s memory peak: %.1f KB of %d KB%s\n",
+               part->name ? part->name : "(unnamed)", s_arena->peak / 1024.0,
+               PART_MEM_BUDGET / 1024, s_arena->peak > PART_MEM_BUDGET ? " (OVER BUDGET)" : "");
+    }
+    arena_reset(s_arena);
 }
 
 /**
@@ -45,14 +463,29 @@ static void part_clear_video(void) {
 static void part_transition(int from_index, int to_index) {
     printf("[part] Transitioning from %d to %d\n", from_index, to_index);
 
+    /* Message areas as this part finds them, for later seeks */
+    part_record_snapshot(to_index);
+
     /* Notify callback */
     if (s_transition_callback) {
         s_transition_callback(from_index, to_index);
     }
 
+    /* Attribute timings to the incoming part */
+    profile_set_part(to_index, s_registry[to_index] ? s_registry[to_index]->name : NULL);
+
+    /* Swap in the part's module before DIS latches the music position */
+    part_switch_music(to_index);
+
     /* Reset DIS state */
     dis_reset();
 
+    /* Prepared state (and arena) for the incoming part's init */
+    part_finish_prepare(to_index);
+
+    /* Render scale before the clear, so a new hi-res buffer is wiped too */
+    video_set_scale(s_registry[to_index] ? s_registry[to_index]->max_scale : VIDEO_SCALE_NATIVE);
+
     /* Clear video state */
     part_clear_video();
 }
@@ -63,25 +496,63 @@ void part_loader_init(void) {
     s_current_index = -1;
     s_running = 0;
     s_transition_callback = NULL;
+    s_music_path = NULL;
+    s_sequence_music = NULL;
+    s_music_waiting = 0;
+    s_music_fetching = 0;
+    s_music_prefetch_retry = 0;
+    s_common_pack = NULL;
     memset(s_registry, 0, sizeof(s_registry));
+    memset(&s_snapshots, 0, sizeof(s_snapshots));
+    memset(&s_hold, 0, sizeof(s_hold));
+
+    /* Reserve the part budget once (twice: one prepares ahead) */
+    part_join_prepare();
+    s_arena = &s_arenas[0];
+    for (int i = 0; i < 2; i++) {
+        arena_destroy(&s_arenas[i]);
+        if (arena_init(&s_arenas[i], PART_MEM_BUDGET, s_mem_hard_cap) != 0) {
+            printf("PART: ERROR - Cannot reserve %d KB part memory\n", PART_MEM_BUDGET / 1024);
+        }
+    }
 }
 
 void part_loader_shutdown(void) {
     printf("[part] Part loader shutdown\n");
 
-    /* Cleanup current part if running */
-    if (s_running && s_current_index >= 0 && s_current_index < s_registry_count) {
+    /* The worker may still be preparing the next part */
+    part_join_prepare();
+
+    /* Cleanup current part if running (a held part never initialized) */
+    framecheck_set_part(NULL);
+    if (s_running && !s_hold.active && s_current_index >= 0 && s_current_index < s_registry_count) {
         sr_part_t *part = s_registry[s_current_index];
         if (part && part->cleanup) {
             part->state = SR_PART_STATE_CLEANUP;
             part->cleanup(part);
             part->state = SR_PART_STATE_STOPPED;
         }
+        if (part) {
+            part_release_memory(part);
+        }
     }
+    arena_destroy(&s_arenas[0]);
+    arena_destroy(&s_arenas[1]);
+    s_arena = &s_arenas[0];
+
+    if (s_snapshots.path && s_snapshots.changed) {
+        if (part_save_snapshots(s_snapshots.path) == 0) {
+            printf("[part] Wrote message area snapshots: %s\n", s_snapshots.path);
+        } else {
+            fprintf(stderr, "PART: ERROR - Cannot write snapshots: %s\n", s_snapshots.path);
+        }
+    }
+    s_snapshots.changed = 0;
 
     s_registry_count = 0;
     s_current_index = -1;
     s_running = 0;
+    s_hold.active = 0;
 }
 
 int part_loader_register(sr_part_t *part) {
@@ -103,6 +574,71 @@ int part_loader_register(sr_part_t *part) {
     return 0;
 }
 
+/* Initialize the part just transitioned to and start preparing the next */
+static void part_begin(int index) {
+    sr_part_t *part = s_registry[index];
+    if (part) {
+        printf("[part] Starting part: %s\n", part->name ? part->name : "(unnamed)");
+        part->state = SR_PART_STATE_INITIALIZING;
+        if (part->init) {
+            part->init(part);
+        }
+        part->state = SR_PART_STATE_RUNNING;
+        framecheck_set_part(part->name ? part->name : "(unnamed)");
+    }
+    part_start_prepare(index);
+}
+
+/**
+ * Transition to and initialize a part, or hold it until its files are
+ * available; part_loader_tick() calls this again while it is held.
+ * @param seek 1 to first set the state a straight run would have left
+ */
+static void part_enter(int from_index, int to_index, int seek) {
+    sr_part_t *part = s_registry[to_index];
+    if (!s_hold.active) {
+        part_request_files(to_index);
+    }
+    if (!part_files_ready(to_index, seek)) {
+        if (!s_hold.active) {
+            printf("[part] Waiting for the files of %s\n", part && part->name ? part->name : "(unnamed)");
+            part_clear_video();
+        }
+        s_hold.active = 1;
+        s_hold.from = from_index;
+        s_hold.seek = seek;
+        return;
+    }
+    s_hold.active = 0;
+
+    if (seek) {
+        /* State the skipped parts would have left behind; the parts in
+         * between are never initialized */
+        part_restore_snapshot(to_index);
+        part_seek_music(to_index);
+    }
+    part_transition(from_index, to_index);
+    part_begin(to_index);
+}
+
+/* Clean up the current part and release its memory */
+static void part_end(int index) {
+    sr_part_t *part = s_registry[index];
+    if (s_hold.active) {
+        return;     /* Never started */
+    }
+    framecheck_set_part(NULL);
+    if (part) {
+        printf("[part] Ending part: %s\n", part->name ? part->name : "(unnamed)");
+        part->state = SR_PART_STATE_CLEANUP;
+        if (part->cleanup) {
+            part->cleanup(part);
+        }
+        part->state = SR_PART_STATE_STOPPED;
+        part_release_memory(part);
+    }
+}
+
 int part_loader_start(int start_index) {
     if (start_index < 0 || start_index >= s_registry_count) {
         printf("PART: ERROR - Invalid start index %d (count=%d)\n", start_index, s_registry_count);
@@ -111,43 +647,109 @@ int part_loader_start(int start_index) {
 
     s_current_index = start_index;
     s_running = 1;
+    s_snapshots.trusted = start_index == 0;
+    s_hold.active = 0;
 
-    /* Prepare for first part */
-    part_transition(-1, s_current_index);
+    /* Prepare for and initialize the first part */
+    part_enter(-1, s_current_index, 0);
+    return 0;
+}
 
-    /* Initialize first part */
-    sr_part_t *part = s_registry[s_current_index];
-    if (part) {
-        printf("[part] Starting part: %s\n", part->name ? part->name : "(unnamed)");
-        part->state = SR_PART_STATE_INITIALIZING;
-        if (part->init) {
-            part->init(part);
+int part_loader_seek(sr_part_id_t id) {
+    int index = -1;
+    for (int i = 0; i < s_registry_count && index < 0; i++) {
+        if (s_registry[i] && s_registry[i]->id == id) {
+            index = i;
         }
-        part->state = SR_PART_STATE_RUNNING;
+    }
+    if (index < 0) {
+        printf("PART: ERROR - No part with id %d registered\n", (int)id);
+        return -1;
     }
 
+    int from_index = -1;
+    if (s_running && s_current_index >= 0) {
+        from_index = s_hold.active ? s_hold.from : s_current_index;
+        part_end(s_current_index);
+    }
+    printf("[part] Seeking to part %d: %s\n", index,
+           s_registry[index]->name ? s_registry[index]->name : "(unnamed)");
+    s_current_index = index;
+    s_running = 1;
+    s_hold.active = 0;
+
+    /* Prepare (inline unless it ran ahead) and initialize the target */
+    part_enter(from_index, index, 1);
     return 0;
 }
 
+/* Compare part names ignoring case */
+static int same_name(const char *a, const char *b) {
+    for (;; a++, b++) {
+        char ca = (*a >= 'a' && *a <= 'z') ? (char)(*a - 'a' + 'A') : *a;
+        char cb = (*b >= 'a' && *b <= 'z') ? (char)(*b - 'a' + 'A') : *b;
+        if (ca != cb) {
+            return 0;
+        }
+        if (ca == '\0') {
+            return 1;
+        }
+    }
+}
+
+int part_loader_find(const char *name) {
+    for (int i = 0; name && i < s_registry_count; i++) {
+        if (s_registry[i] && s_registry[i]->name && same_name(s_registry[i]->name, name)) {
+            return (int)s_registry[i]->id;
+        }
+    }
+    return -1;
+}
+
 void part_loader_tick(void) {
     if (!s_running || s_current_index < 0 || s_current_index >= s_registry_count) {
         return;
     }
 
+    if (s_hold.active) {
+        part_poll_music();
+        part_enter(s_hold.from, s_current_index, s_hold.seek);
+        return;
+    }
+
     sr_part_t *part = s_registry[s_current_index];
     if (!part || part->state != SR_PART_STATE_RUNNING) {
         return;
     }
 
+    PROFILE_BEGIN(PROFILE_ZONE_TICK);
+
+    /* Steady state: no heap or stdio until the part is done, except in
+     * the one-shot steps the music poll and prepare start allow */
+    FRAMECHECK_BEGIN(FRAMECHECK_TICK);
+
+    part_poll_music();
+
+    /* The next part's segment may have arrived since this one started */
+    part_start_prepare(s_current_index);
+
     /* Get frame count from DIS */
     int frame_count = dis_waitb();
 
     /* Update the part - non-zero return means advance to next */
+    int result = 0;
     if (part->update) {
-        int result = part->update(part, frame_count);
-        if (result != 0) {
-            part_loader_next();
-        }
+        PROFILE_BEGIN(PROFILE_ZONE_UPDATE);
+        result = part->update(part, frame_count);
+        PROFILE_END(PROFILE_ZONE_UPDATE);
+    }
+    FRAMECHECK_END();
+
+    /* Close the zone before the next part takes over attribution */
+    PROFILE_END(PROFILE_ZONE_TICK);
+
+    if (result != 0) {
+        part_loader_next();
     }
 }
 
@@ -162,7 +764,11 @@ void part_loader_render(void) {
     }
 
     if (part->render) {
+        FRAMECHECK_BEGIN(FRAMECHECK_RENDER);
+        PROFILE_BEGIN(PROFILE_ZONE_RENDER);
         part->render(part);
+        PROFILE_END(PROFILE_ZONE_RENDER);
+        FRAMECHECK_END();
     }
 }
 
@@ -171,42 +777,22 @@ int part_loader_next(void) {
         return -1;
     }
 
-    /* Cleanup current part */
-    sr_part_t *current = s_registry[s_current_index];
-    if (current) {
-        printf("[part] Ending part: %s\n", current->name ? current->name : "(unnamed)");
-        current->state = SR_PART_STATE_CLEANUP;
-        if (current->cleanup) {
-            current->cleanup(current);
-        }
-        current->state = SR_PART_STATE_STOPPED;
-    }
-
-    int from_index = s_current_index;
+    int from_index = s_hold.active ? s_hold.from : s_current_index;
+    part_end(s_current_index);
+    s_hold.active = 0;
     s_current_index++;
 
     /* Check if we've reached the end */
     if (s_current_index >= s_registry_count) {
         printf("[part] Demo sequence complete\n");
+        video_set_scale(VIDEO_SCALE_NATIVE);
         s_running = 0;
         s_current_index = -1;
         return -1;
     }
 
-    /* Transition to next part */
-    part_transition(from_index, s_current_index);
-
-    /* Initialize next part */
-    sr_part_t *next = s_registry[s_current_index];
-    if (next) {
-        printf("[part] Starting part: %s\n", next->name ? next->name : "(unnamed)");
-        next->state = SR_PART_STATE_INITIALIZING;
-        if (next->init) {
-            next->init(next);
-        }
-        next->state = SR_PART_STATE_RUNNING;
-    }
-
+    /* Transition to and initialize the next part */
+    part_enter(from_index, s_current_index, 0);
     return 0;
 }
 
@@ -232,6 +818,70 @@ int part_loader_is_running(void) {
     return s_running;
 }
 
+int part_loader_set_music(const char *path, int async) {
+    if (!path) {
+        return -1;
+    }
+    music_load_cancel();
+    s_music_path = path;
+    s_sequence_music = path;
+    s_music_waiting = 0;
+    s_music_fetching = 0;
+    if (async && fetch_request(path, FETCH_URGENT) == FETCH_PENDING) {
+        /* Loaded from part_loader_tick() once downloaded */
+        s_music_waiting = 1;
+        s_music_fetching = 1;
+        return 0;
+    }
+    if (async && music_load_file_async(path, NULL, NULL)) {
+        s_music_waiting = 1;
+        return 0;
+    }
+    if (!music_load_file(path)) {
+        return -1;
+    }
+    music_play();
+    return 0;
+}
+
+int part_loader_set_common_pack(const char *path) {
+    s_common_pack = path;
+    if (path && fetch_request(path, FETCH_PACK | FETCH_URGENT) == FETCH_FAILED) {
+        return -1;
+    }
+    return 0;
+}
+
+void *part_getmem(size_t size) {
+    arena_t *arena = t_prepare_arena ? t_prepare_arena : s_arena;
+    void *block = arena_alloc(arena, size);
+    if (!block) {
+        sr_part_t *part = part_loader_current();
+        printf("PART: ERROR - %s out of part memory (%zu bytes requested, %.1f KB used of %d KB)\n",
+               part && part->name ? part->name : "(no part)", size,
+               arena->used / 1024.0, PART_MEM_BUDGET / 1024);
+    }
+    return block;
+}
+
+void part_freemem(void *block) {
+    arena_free(t_prepare_arena ? t_prepare_arena : s_arena, block);
+}
+
+void part_loader_set_mem_cap(int hard) {
+    s_mem_hard_cap = hard;
+    s_arenas[0].hard_cap = hard;
+    s_arenas[1].hard_cap = hard;
+}
+
+int part_loader_set_snapshot_file(const char *path) {
+    s_snapshots.path = path;
+    if (!path) {
+        return 0;
+    }
+    return part_load_snapshots(path);
+}
+
 void part_loader_set_transition_callback(sr_part_transition_fn callback) {
     s_transition_callback = callback;
 }
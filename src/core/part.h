@@ -9,8 +9,12 @@
 #ifndef PART_H
 #define PART_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/* Memory a part may take from its arena, the original's ~450 KB */
+#define PART_MEM_BUDGET (450 * 1024)
+
 /**
  * Part identifiers - matches the original SCRIPT sequence
  */
@@ -63,6 +67,7 @@ typedef void (*sr_part_init_fn)(sr_part_t *part);
 typedef int (*sr_part_update_fn)(sr_part_t *part, int frame_count);
 typedef void (*sr_part_render_fn)(sr_part_t *part);
 typedef void (*sr_part_cleanup_fn)(sr_part_t *part);
+typedef void (*sr_part_prepare_fn)(sr_part_t *part);
 
 /**
  * Part transition callback - called when parts change
@@ -84,6 +89,39 @@ struct sr_part_t {
     sr_part_render_fn render;   /* Called each frame to render */
     sr_part_cleanup_fn cleanup; /* Called when part ends */
 
+    /* Optional heavy setup (decoding images, unpacking or building
+     * tables) run on a worker thread while the previous part plays, so
+     * init only swaps the result in. It may use part_getmem() and the
+     * part's own user_data, but nothing shared: no video, DIS or music.
+     * Runs on the main thread right before init when it could not run
+     * ahead (first part, jumps, no thread support). */
+    sr_part_prepare_fn prepare;
+
+    /* Module this part starts (e.g. "MAIN/MUSIC1.S3M"), NULL keeps the
+     * current one. Loaded in the background ahead of time, switched in
+     * when the part starts, as the original loader did between parts. */
+    const char *music;
+
+    /* Pack segment with the part's assets (e.g. "MAIN/WATER.PAK"), NULL
+     * if it needs none of its own. The part does not start, and is not
+     * prepared ahead, until the segment is available (see fetch.h). Only
+     * web builds download segments; natively they are usually absent,
+     * and the part then reads its assets from the demo pack. */
+    const char *pack;
+
+    /* Sync code (S3M Zxx) of the part's module the part starts at in the
+     * original timing; part_loader_seek() places the music there. 0 =
+     * the top of the module. */
+    int start_code;
+
+    /* Highest render scale the part draws at (1, 2 or 4; 0 = native
+     * only). Applied at part start, clamped to video_get_max_scale(), so
+     * only parts that draw hi-res pay for the supersampled buffer; read
+     * video_get_scale() in init for the scale actually granted. */
+    int max_scale;
+
+    size_t mem_peak;            /* Arena high-water mark of the last run */
+
     void *user_data;            /* Part-specific data */
 };
 
@@ -113,7 +151,9 @@ int part_loader_start(int start_index);
 
 /**
  * Update the current part (call each frame).
- * Handles state machine transitions.
+ * Handles state machine transitions. A part whose pack segment or
+ * module is still downloading stays held (the screen black, the parts
+ * before it cleaned up) and starts from here once they arrived.
  */
 void part_loader_tick(void);
 
@@ -128,6 +168,27 @@ void part_loader_render(void);
  */
 int part_loader_next(void);
 
+/**
+ * Jump straight to a part, as if the sequence had played up to it.
+ * The current part is cleaned up and the parts in between never run:
+ * the target is prepared (inline unless it was already prepared ahead)
+ * and initialized, the music is switched to the module in effect there
+ * and placed at the part's start_code through the sync index, and the
+ * message areas are restored from the snapshot recorded when a run from
+ * the first part reached it (see part_loader_set_snapshot_file()).
+ * Starts the loader if it is not running.
+ * @param id Part to run
+ * @return 0 on success, -1 if no registered part has that id
+ */
+int part_loader_seek(sr_part_id_t id);
+
+/**
+ * Look up a registered part by name.
+ * @param name Part name, any case (e.g. "WATER")
+ * @return Part id, or -1 if no registered part has that name
+ */
+int part_loader_find(const char *name);
+
 /**
  * Get the currently running part.
  * @return Pointer to current part, NULL if none
@@ -152,6 +213,61 @@ int part_loader_get_count(void);
  */
 int part_loader_is_running(void);
 
+/**
+ * Set the module the sequence starts with.
+ * Parts can switch modules later through sr_part_t.music.
+ * @param path Module file (must remain valid)
+ * @param async 1 to load in the background and start playback once
+ *              parsed (parts render meanwhile), 0 to load now
+ * @return 0 on success or request started, -1 on failure
+ */
+int part_loader_set_music(const char *path, int async);
+
+/**
+ * Set a pack segment every part needs (shared data such as VISU/).
+ * It is requested at once, and no part starts before it is available.
+ * @param path Segment file (must remain valid), NULL for none
+ * @return 0 on success or request started, -1 if it failed
+ */
+int part_loader_set_common_pack(const char *path);
+
+/**
+ * Allocate part memory (the original getmem).
+ * Comes from an arena reserved once; everything a part allocated is
+ * released in one shot after its cleanup, so parts need not free.
+ * Called from prepare, it allocates from the preparing part's arena.
+ * @param size Bytes
+ * @return 16-byte aligned memory, or NULL past a hard cap
+ */
+void *part_getmem(size_t size);
+
+/**
+ * Free part memory (the original freemem).
+ * Only the most recent block is reclaimed at once; the rest goes when
+ * the part ends.
+ * @param block Pointer from part_getmem() (NULL is ignored)
+ */
+void part_freemem(void *block);
+
+/**
+ * Enforce PART_MEM_BUDGET: past it part_getmem() fails instead of
+ * spilling to the heap. Peaks are reported either way.
+ * @param hard 1 to enforce, 0 to only report
+ */
+void part_loader_set_mem_cap(int hard);
+
+/**
+ * Keep message area snapshots in a file for part_loader_seek().
+ * Snapshots in it are loaded now; the file is rewritten at shutdown if
+ * this run recorded new ones. Only runs from the first part (or from a
+ * seek that had its snapshot) record, so skipped parts never leave a
+ * guessed state behind.
+ * @param path Snapshot file (must remain valid), NULL to keep them in memory only
+ * @return 0 on success, -1 if the file is missing or corrupt (recording
+ *         still happens)
+ */
+int part_loader_set_snapshot_file(const char *path);
+
 /**
  * Set callback for part transitions.
  * @param callback Function to call on transitions (NULL to remove)
@@ -0,0 +1,128 @@
+/**
+ * Render Pipeline - Implementation
+ *
+ * One kick per frame under a mutex and condition variable; the frames
+ * themselves go through the video triple buffer without locking. busy is
+ * set by the kick and cleared only after video_publish(), so a main
+ * thread that sees it clear owns dis and music state until the next kick.
+ */
+
+#include "pipeline.h"
+#include "profile.h"
+#include "thread.h"
+#include "video.h"
+#include <stdatomic.h>
+#include <stdio.h>
+
+static struct {
+    int active;
+    pipeline_fn produce;
+    thread_t thread;
+    thread_mutex_t mutex;
+    thread_cond_t wake;     /* Render thread waits for a kick */
+    thread_cond_t idle;     /* pipeline_wait() waits for the frame */
+    int kicked;
+    int quit;
+    atomic_int busy;
+} pipeline_state;
+
+static void render_thread(void *arg) {
+    (void)arg;
+    profile_set_thread(PROFILE_THREAD_RENDER);
+    for (;;) {
+        thread_mutex_lock(&pipeline_state.mutex);
+        while (!pipeline_state.kicked && !pipeline_state.quit) {
+            thread_cond_wait(&pipeline_state.wake, &pipeline_state.mutex);
+        }
+        if (!pipeline_state.kicked) {
+            thread_mutex_unlock(&pipeline_state.mutex);
+            return;
+        }
+        pipeline_state.kicked = 0;
+        thread_mutex_unlock(&pipeline_state.mutex);
+
+        pipeline_state.produce();
+        video_publish();
+
+        thread_mutex_lock(&pipeline_state.mutex);
+        atomic_store(&pipeline_state.busy, 0);
+        thread_cond_broadcast(&pipeline_state.idle);
+        thread_mutex_unlock(&pipeline_state.mutex);
+    }
+}
+
+int pipeline_start(pipeline_fn produce) {
+    if (pipeline_state.active || !produce) {
+        return -1;
+    }
+    if (video_set_pipelined(1) < 0) {
+        return -1;
+    }
+
+    pipeline_state.produce = produce;
+    pipeline_state.kicked = 0;
+    pipeline_state.quit = 0;
+    atomic_store(&pipeline_state.busy, 0);
+    thread_mutex_init(&pipeline_state.mutex);
+    thread_cond_init(&pipeline_state.wake);
+    thread_cond_init(&pipeline_state.idle);
+    if (thread_create(&pipeline_state.thread, render_thread, NULL) != 0) {
+        fprintf(stderr, "PIPELINE: ERROR Cannot start render thread\n");
+        thread_cond_destroy(&pipeline_state.idle);
+        thread_cond_destroy(&pipeline_state.wake);
+        thread_mutex_destroy(&pipeline_state.mutex);
+        video_set_pipelined(0);
+        return -1;
+    }
+    pipeline_state.active = 1;
+    printf("[pipeline] Render thread started\n");
+    return 0;
+}
+
+void pipeline_stop(void) {
+    if (!pipeline_state.active) {
+        return;
+    }
+    pipeline_wait();
+    thread_mutex_lock(&pipeline_state.mutex);
+    pipeline_state.quit = 1;
+    thread_cond_signal(&pipeline_state.wake);
+    thread_mutex_unlock(&pipeline_state.mutex);
+    thread_join(&pipeline_state.thread);
+
+    thread_cond_destroy(&pipeline_state.idle);
+    thread_cond_destroy(&pipeline_state.wake);
+    thread_mutex_destroy(&pipeline_state.mutex);
+    pipeline_state.active = 0;
+    video_set_pipelined(0);
+}
+
+int pipeline_active(void) {
+    return pipeline_state.active;
+}
+
+int pipeline_busy(void) {
+    return pipeline_state.active && atomic_load(&pipeline_state.busy);
+}
+
+void pipeline_kick(void) {
+    if (!pipeline_state.active) {
+        return;
+    }
+    thread_mutex_lock(&pipeline_state.mutex);
+    atomic_store(&pipeline_state.busy, 1);
+    pipeline_state.kicked = 1;
+    thread_cond_signal(&pipeline_state.wake);
+    thread_mutex_unlock(&pipeline_state.mutex);
+}
+
+void pipeline_wait(void) {
+    if (!pipeline_state.active) {
+        return;
+    }
+    thread_mutex_lock(&pipeline_state.mutex);
+    while (atomic_load(&pipeline_state.busy)) {
+        thread_cond_wait(&pipeline_state.idle, &pipeline_state.mutex);
+    }
+    thread_mutex_unlock(&pipeline_state.mutex);
+}
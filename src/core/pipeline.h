@@ -0,0 +1,59 @@
+/**
+ * Render Pipeline - Frame production on a render thread
+ *
+ * Runs a frame callback (part tick, render and visu flush) on a thread of
+ * its own, so the part draws frame N+1 while the main thread converts,
+ * uploads and shows frame N. Every finished frame is passed on with
+ * video_publish(); the main thread picks it up with video_acquire().
+ *
+ * The main thread kicks one frame at a time and only while the render
+ * thread is idle, which is when it also updates shared timing (e.g.
+ * dis_frame_tick()), so parts never run concurrently with it. Shown
+ * frames lag drawn ones by one display frame.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/**
+ * Frame callback: draws one frame into the video draw frame
+ */
+typedef void (*pipeline_fn)(void);
+
+/**
+ * Pipeline video frames and start the render thread.
+ * @param produce Called on the render thread for each pipeline_kick()
+ * @return 0 on success, -1 if frames or thread could not be set up
+ *         (nothing changes and frames are drawn on the caller)
+ */
+int pipeline_start(pipeline_fn produce);
+
+/**
+ * Finish the frame in flight, join the render thread and stop pipelining.
+ * Safe without pipeline_start().
+ */
+void pipeline_stop(void);
+
+/**
+ * Check if the render thread runs.
+ * @return 1 between a successful pipeline_start() and pipeline_stop()
+ */
+int pipeline_active(void);
+
+/**
+ * Check if a kicked frame is still being drawn.
+ * @return 1 while the render thread runs the frame callback
+ */
+int pipeline_busy(void);
+
+/**
+ * Have the render thread draw one frame. Call only when not busy.
+ */
+void pipeline_kick(void);
+
+/**
+ * Wait until the kicked frame is drawn and published.
+ */
+void pipeline_wait(void);
+
+#endif /* PIPELINE_H */
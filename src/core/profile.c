@@ -0,0 +1,330 @@
+/**
+ * Frame Profiler - Implementation
+ *
+ * Each (part, zone) pair keeps exact count/total/min/max plus a log-scale
+ * histogram (8 buckets per octave, ~9% resolution) for the p99. Trace
+ * events go to a fixed buffer claimed with an atomic counter, so the audio
+ * thread can record without locks; once the buffer is full only the
+ * aggregates keep updating.
+ *
+ * Only built when SR_PROFILE is enabled.
+ */
+
+#include "profile.h"
+#include "audio/music.h"
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#if !defined(SR_HEADLESS)
+#include "util/sokol_debugtext.h"
+#endif
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Parts tracked separately; the extra slot collects time outside any part */
+#define PROFILE_MAX_PARTS 32
+#define PROFILE_NO_PART PROFILE_MAX_PARTS
+
+/* Histogram: exact below 8 ns, then 8 sub-buckets per power of two */
+#define PROFILE_BUCKETS 256
+
+/* Trace buffer capacity (24 bytes per event) */
+#define PROFILE_TRACE_EVENTS (1 << 18)
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint32_t hist[PROFILE_BUCKETS];
+} profile_stats_t;
+
+typedef struct {
+    uint64_t start_ns;
+    uint32_t dur_ns;
+    uint8_t zone;
+    uint8_t part;
+    uint8_t tid;        /* profile_thread_t */
+} profile_event_t;
+
+static const char *const zone_names[PROFILE_ZONE_COUNT] = {
+    "tick", "update", "render", "copper", "convert", "upload", "audio"
+};
+
+static const char *const thread_names[PROFILE_THREAD_COUNT] = {
+    "main", "audio", "render"
+};
+
+/* Track of the zones this thread records */
+static _Thread_local profile_thread_t t_thread = PROFILE_THREAD_MAIN;
+
+static struct {
+    int initialized;
+    int overlay;
+    uint64_t origin_ns;
+    atomic_int part;
+    const char *part_names[PROFILE_MAX_PARTS + 1];
+    profile_stats_t stats[PROFILE_MAX_PARTS + 1][PROFILE_ZONE_COUNT];
+
+    profile_event_t *events;
+    atomic_uint event_count;
+
+    uint64_t audio_start;   /* Audio thread only */
+} profile_state;
+
+static int bucket_of(uint32_t ns) {
+    if (ns < 8) {
+        return (int)ns;
+    }
+    int msb = 31;
+    while (!(ns & (1u << msb))) {
+        msb--;
+    }
+    int b = (msb - 2) * 8 + (int)((ns >> (msb - 3)) & 7);
+    return b < PROFILE_BUCKETS ? b : PROFILE_BUCKETS - 1;
+}
+
+/* Upper bound of a bucket in nanoseconds */
+static uint64_t bucket_limit(int b) {
+    if (b < 8) {
+        return (uint64_t)b;
+    }
+    int msb = b / 8 + 2;
+    uint64_t step = 1ull << (msb - 3);
+    return (uint64_t)(8 + b % 8) * step + step - 1;
+}
+
+static uint64_t stats_p99(const profile_stats_t *s) {
+    uint64_t target = s->count - s->count / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += s->hist[b];
+        if (seen >= target) {
+            uint64_t limit = bucket_limit(b);
+            return limit < s->max_ns ? limit : s->max_ns;
+        }
+    }
+    return s->max_ns;
+}
+
+static void profile_audio_hook(int end) {
+    if (!end) {
+        profile_state.audio_start = profile_now();
+    } else {
+        profile_record(PROFILE_ZONE_AUDIO, profile_state.audio_start);
+    }
+}
+
+uint64_t profile_now(void) {
+    return (uint64_t)stm_ns(stm_now());
+}
+
+void profile_init(void) {
+    if (profile_state.initialized) {
+        return;
+    }
+    stm_setup();
+    profile_state.origin_ns = profile_now();
+    atomic_store(&profile_state.part, PROFILE_NO_PART);
+    atomic_store(&profile_state.event_count, 0);
+    profile_state.part_names[PROFILE_NO_PART] = "(none)";
+    for (int p = 0; p <= PROFILE_MAX_PARTS; p++) {
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+            profile_state.stats[p][z].min_ns = UINT32_MAX;
+        }
+    }
+
+    profile_state.events = malloc(sizeof(profile_event_t) * PROFILE_TRACE_EVENTS);
+    if (!profile_state.events) {
+        fprintf(stderr, "PROFILE: Out of memory, trace disabled\n");
+    }
+
+#if !defined(SR_HEADLESS)
+    sdtx_setup(&(sdtx_desc_t){
+        .fonts[0] = sdtx_font_kc853()
+    });
+#endif
+    music_set_render_hook(profile_audio_hook);
+    profile_state.initialized = 1;
+    printf("[profile] Enabled\n");
+}
+
+void profile_record(profile_zone_t zone, uint64_t start) {
+    if (!profile_state.initialized) {
+        return;
+    }
+    uint64_t now = profile_now();
+    uint64_t dur = now - start;
+    uint32_t ns = dur > UINT32_MAX ? UINT32_MAX : (uint32_t)dur;
+    int part = atomic_load_explicit(&profile_state.part, memory_order_relaxed);
+
+    /* Each zone has a single writer: the audio thread the audio zone, the
+     * main thread convert and upload, and the part zones either the main
+     * thread or, when pipelined, the render thread */
+    profile_stats_t *s = &profile_state.stats[part][zone];
+    s->count++;
+    s->total_ns += ns;
+    if (ns < s->min_ns) {
+        s->min_ns = ns;
+    }
+    if (ns > s->max_ns) {
+        s->max_ns = ns;
+    }
+    s->hist[bucket_of(ns)]++;
+
+    if (profile_state.events) {
+        unsigned idx = atomic_fetch_add_explicit(&profile_state.event_count, 1, memory_order_relaxed);
+        if (idx < PROFILE_TRACE_EVENTS) {
+            profile_event_t *e = &profile_state.events[idx];
+            e->start_ns = start - profile_state.origin_ns;
+            e->dur_ns = ns;
+            e->zone = (uint8_t)zone;
+            e->part = (uint8_t)part;
+            e->tid = (uint8_t)(zone == PROFILE_ZONE_AUDIO ? PROFILE_THREAD_AUDIO : t_thread);
+        }
+    }
+}
+
+void profile_set_thread(profile_thread_t thread) {
+    t_thread = thread;
+}
+
+void profile_set_part(int index, const char *name) {
+    int part = (index >= 0 && index < PROFILE_MAX_PARTS) ? index : PROFILE_NO_PART;
+    if (part != PROFILE_NO_PART) {
+        profile_state.part_names[part] = name ? name : "(unnamed)";
+    }
+    atomic_store_explicit(&profile_state.part, part, memory_order_relaxed);
+}
+
+void profile_toggle_overlay(void) {
+    profile_state.overlay = !profile_state.overlay;
+}
+
+void profile_draw_overlay(int width, int height) {
+#if defined(SR_HEADLESS)
+    (void)width;
+    (void)height;
+#else
+    if (!profile_state.initialized || !profile_state.overlay) {
+        return;
+    }
+    int part = atomic_load_explicit(&profile_state.part, memory_order_relaxed);
+
+    /* 8x8 font at 2x scale */
+    sdtx_canvas((float)width * 0.5f, (float)height * 0.5f);
+    sdtx_origin(1.0f, 1.0f);
+    sdtx_color3b(255, 255, 0);
+    sdtx_printf("%s\n", profile_state.part_names[part]);
+    sdtx_color3b(255, 255, 255);
+    sdtx_printf("zone      avg    p99    max ms\n");
+    for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+        const profile_stats_t *s = &profile_state.stats[part][z];
+        if (s->count == 0) {
+            continue;
+        }
+        sdtx_printf("%-7s %6.3f %6.3f %6.3f\n", zone_names[z],
+                    (double)s->total_ns / (double)s->count / 1e6,
+                    (double)stats_p99(s) / 1e6, (double)s->max_ns / 1e6);
+    }
+    sdtx_draw();
+#endif
+}
+
+static void write_summary(FILE *f) {
+    fprintf(f, "{\n  \"parts\": [");
+    int first_part = 1;
+    for (int p = 0; p <= PROFILE_MAX_PARTS; p++) {
+        if (!profile_state.part_names[p]) {
+            continue;
+        }
+        fprintf(f, "%s\n    { \"name\": \"%s\", \"zones\": {", first_part ? "" : ",",
+                profile_state.part_names[p]);
+        first_part = 0;
+        int first_zone = 1;
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+            const profile_stats_t *s = &profile_state.stats[p][z];
+            if (s->count == 0) {
+                continue;
+            }
+            fprintf(f, "%s\n      \"%s\": { \"count\": %llu, \"min_us\": %.3f, \"avg_us\": %.3f, "
+                       "\"p99_us\": %.3f, \"max_us\": %.3f }",
+                    first_zone ? "" : ",", zone_names[z], (unsigned long long)s->count,
+                    s->min_ns / 1e3, (double)s->total_ns / (double)s->count / 1e3,
+                    (double)stats_p99(s) / 1e3, s->max_ns / 1e3);
+            first_zone = 0;
+        }
+        fprintf(f, "\n    } }");
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+static void write_trace(FILE *f) {
+    unsigned count = atomic_load(&profile_state.event_count);
+    if (count > PROFILE_TRACE_EVENTS) {
+        count = PROFILE_TRACE_EVENTS;
+    }
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (int t = 0; t < PROFILE_THREAD_COUNT; t++) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                t > 0 ? ",\n" : "", t, thread_names[t]);
+    }
+    for (unsigned i = 0; i < count; i++) {
+        const profile_event_t *e = &profile_state.events[i];
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                zone_names[e->zone], profile_state.part_names[e->part],
+                e->start_ns / 1e3, e->dur_ns / 1e3, e->tid);
+    }
+    fprintf(f, "\n]}\n");
+}
+
+static void write_file(const char *env, const char *fallback, void (*writer)(FILE *f)) {
+    const char *path = getenv(env);
+    if (!path || !path[0]) {
+        path = fallback;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "PROFILE: Cannot open file: %s\n", path);
+        return;
+    }
+    writer(f);
+    fclose(f);
+    printf("[profile] Wrote %s\n", path);
+}
+
+void profile_shutdown(void) {
+    if (!profile_state.initialized) {
+        return;
+    }
+    music_set_render_hook(NULL);
+
+    for (int p = 0; p <= PROFILE_MAX_PARTS; p++) {
+        for (int z = 0; z < PROFILE_ZONE_COUNT; z++) {
+            const profile_stats_t *s = &profile_state.stats[p][z];
+            if (s->count == 0) {
+                continue;
+            }
+            printf("[profile] %-12s %-7s n=%-7llu avg %8.3f us  p99 %8.3f us  max %8.3f us\n",
+                   profile_state.part_names[p], zone_names[z], (unsigned long long)s->count,
+                   (double)s->total_ns / (double)s->count / 1e3,
+                   (double)stats_p99(s) / 1e3, s->max_ns / 1e3);
+        }
+    }
+
+    write_file("SR_PROFILE_JSON", "profile.json", write_summary);
+    if (profile_state.events) {
+        if (atomic_load(&profile_state.event_count) > PROFILE_TRACE_EVENTS) {
+            printf("[profile] Trace buffer full, later events dropped\n");
+        }
+        write_file("SR_PROFILE_TRACE", "profile_trace.json", write_trace);
+        free(profile_state.events);
+        profile_state.events = NULL;
+    }
+
+#if !defined(SR_HEADLESS)
+    sdtx_shutdown();
+#endif
+    profile_state.initialized = 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * Frame Profiler - Scoped timers aggregated per demo part
+ *
+ * Zones cover the part loader tick, part update/render callbacks, DIS
+ * copper callbacks, framebuffer conversion, texture uploads and the audio
+ * callback. Timings are aggregated per part (min/avg/p99/max), shown by
+ * an optional sokol_debugtext overlay, and written at shutdown as a JSON
+ * summary and a Chrome trace (chrome://tracing, Perfetto).
+ *
+ * Compiled out unless SR_PROFILE is defined (CMake option SR_PROFILE):
+ * the zone macros expand to nothing and the functions to empty inlines.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/**
+ * Profiled zones
+ */
+typedef enum {
+    PROFILE_ZONE_TICK = 0,      /* part_loader_tick() */
+    PROFILE_ZONE_UPDATE,        /* sr_part_t update callback */
+    PROFILE_ZONE_RENDER,        /* sr_part_t render callback */
+    PROFILE_ZONE_COPPER,        /* Copper callbacks in dis_waitb() */
+    PROFILE_ZONE_CONVERT,       /* Indexed to RGBA conversion */
+    PROFILE_ZONE_UPLOAD,        /* sg_update_image() calls */
+    PROFILE_ZONE_AUDIO,         /* Music render in the audio callback */
+    PROFILE_ZONE_COUNT
+} profile_zone_t;
+
+/**
+ * Trace tracks, one per thread that records zones
+ */
+typedef enum {
+    PROFILE_THREAD_MAIN = 0,    /* Default for every thread */
+    PROFILE_THREAD_AUDIO,       /* Audio zones, whichever thread renders */
+    PROFILE_THREAD_RENDER,      /* Pipeline render thread */
+    PROFILE_THREAD_COUNT
+} profile_thread_t;
+
+#if defined(SR_PROFILE)
+
+/* Open a zone in the current scope; close it with PROFILE_END(zone) */
+#define PROFILE_BEGIN(zone) uint64_t profile_start_##zone = profile_now()
+#define PROFILE_END(zone) profile_record((zone), profile_start_##zone)
+
+/**
+ * Initialize the profiler. Call after sg_setup().
+ * Output paths come from SR_PROFILE_JSON and SR_PROFILE_TRACE
+ * (defaults: profile.json, profile_trace.json).
+ */
+void profile_init(void);
+
+/**
+ * Write the JSON summary and Chrome trace, print a summary and release
+ * overlay resources. Call before sg_shutdown(), after the audio thread stopped.
+ */
+void profile_shutdown(void);
+
+/**
+ * Get the current time for PROFILE_BEGIN.
+ * @return Nanoseconds on a monotonic clock
+ */
+uint64_t profile_now(void);
+
+/**
+ * Record a zone that started at start (from profile_now()) and ends now.
+ * Safe to call from the audio thread.
+ * @param zone Zone identifier
+ * @param start Start time in nanoseconds
+ */
+void profile_record(profile_zone_t zone, uint64_t start);
+
+/**
+ * Put the zones this thread records on a trace track of their own.
+ * Call once at the start of the thread.
+ * @param thread PROFILE_THREAD_*
+ */
+void profile_set_thread(profile_thread_t thread);
+
+/**
+ * Attribute subsequent timings to a part.
+ * @param index Part loader index (-1 for none)
+ * @param name Part name (must remain valid)
+ */
+void profile_set_part(int index, const char *name);
+
+/**
+ * Toggle the on-screen overlay.
+ */
+void profile_toggle_overlay(void);
+
+/**
+ * Draw the overlay into the current render pass if enabled.
+ * @param width Pass width in pixels
+ * @param height Pass height in pixels
+ */
+void profile_draw_overlay(int width, int height);
+
+#else
+
+#define PROFILE_BEGIN(zone) ((void)0)
+#define PROFILE_END(zone) ((void)0)
+
+static inline void profile_init(void) {}
+static inline void profile_shutdown(void) {}
+static inline void profile_set_thread(profile_thread_t thread) { (void)thread; }
+static inline void profile_set_part(int index, const char *name) { (void)index; (void)name; }
+static inline void profile_toggle_overlay(void) {}
+static inline void profile_draw_overlay(int width, int height) { (void)width; (void)height; }
+
+#endif /* SR_PROFILE */
+
+#endif /* PROFILE_H */
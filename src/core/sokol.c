@@ -8,3 +8,7 @@
 #include "sokol_app.h"
 #include "sokol_gfx.h"
 #include "sokol_glue.h"
+#include "sokol_time.h"
+#if defined(SR_PROFILE)
+#include "util/sokol_debugtext.h"
+#endif
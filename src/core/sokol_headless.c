@@ -0,0 +1,8 @@
+// Headless build: sokol_gfx without a window or GPU.
+// SOKOL_DUMMY_BACKEND is set via CMake compile definitions, so every
+// sg_* call validates and returns without touching a device.
+// sokol_app is not implemented here; headless code must not call sapp_*.
+
+#define SOKOL_IMPL
+#include "sokol_gfx.h"
+#include "sokol_time.h"
@@ -0,0 +1,241 @@
+/**
+ * Tables - Implementation
+ *
+ * Each generator is the formula from the original generator program or,
+ * where that is lost, the one that reproduces the shipped file. All
+ * arithmetic is in double, as the Borland C generators did; the entries
+ * whose exact value sits on an integer boundary came out one lower in the
+ * originals and are patched from a fixup list so no platform's libm
+ * rounding can move them.
+ *
+ * Tables live in one arena for the whole run. A mutex serializes
+ * generation, since prepare callbacks may ask for tables from workers.
+ */
+
+#include "table.h"
+#include "arena.h"
+#include "thread.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Pi to double precision, and as the PLZ.C generator spelled it */
+#define TABLE_EXACT_PI  3.14159265358979323846
+#define TABLE_PI    3.1415926535
+#define TABLE_DPII  (TABLE_PI * 2.0)
+
+/* Entry the original generator computed one lower than exact math */
+typedef struct {
+    int index;
+    int value;
+} table_fixup_t;
+
+typedef struct {
+    const char *const *names;   /* Original files replaced, NULL-terminated */
+    size_t size;                /* Bytes */
+    void (*generate)(void *out);
+} table_desc_t;
+
+static struct {
+    int initialized;
+    thread_mutex_t mutex;
+    arena_t arena;
+    const void *tables[TABLE_COUNT];
+} table_state;
+
+static void put16(void *out, int index, int value) {
+    int16_t v = (int16_t)value;
+    memcpy((uint8_t *)out + (size_t)index * 2, &v, 2);
+}
+
+static void put32(void *out, int index, int32_t value) {
+    memcpy((uint8_t *)out + (size_t)index * 4, &value, 4);
+}
+
+/* SIN1024.INC: a full turn of 256 * sin in 1024 steps */
+static void gen_sin1024(void *out) {
+    for (int i = 0; i < 1024; i++) {
+        put16(out, i, (int)(256.0 * sin(i * 2.0 * TABLE_EXACT_PI / 1024.0)));
+    }
+}
+
+/* JPLOGO keeps the peaks at +-255 so values fit in 8.8 fixed point */
+static void gen_sin1024_clamped(void *out) {
+    for (int i = 0; i < 1024; i++) {
+        int v = (int)(256.0 * sin(i * 2.0 * TABLE_EXACT_PI / 1024.0));
+        put16(out, i, v > 255 ? 255 : v < -255 ? -255 : v);
+    }
+}
+
+static void gen_sin4096(void *out) {
+    for (int i = 0; i < 4096; i++) {
+        put16(out, i, (int)(16384.0 * sin(i * 2.0 * TABLE_EXACT_PI / 4096.0)));
+    }
+}
+
+static void gen_visu_sin(void *out) {
+    for (int i = 0; i < 4096; i++) {
+        put16(out, i, (int)(16384.0 * sin(i * 2.0 * TABLE_EXACT_PI / 4096.0) + 0.5));
+    }
+}
+
+/* AFILLDIV.INC: 65536 / n for the fillers, with n = 0 and 1 as -1 */
+static void gen_visu_div(void *out) {
+    put16(out, 0, -1);
+    put16(out, 1, -1);
+    for (int i = 2; i < 512; i++) {
+        put16(out, i, 65536 / i);
+    }
+}
+
+/* PLZPART: the formulas of PLZ.C, converted to int like its assignments */
+static void gen_plz_lsini4(void *out) {
+    static const table_fixup_t fixups[] = { { 3072, 23 }, { 7168, 23 } };
+    for (int a = 0; a < 8192; a++) {
+        put16(out, a, (int)((sin(a * TABLE_DPII / 4096) * 55 + sin(a * TABLE_DPII / 4096 * 5) * 8 +
+                             sin(a * TABLE_DPII / 4096 * 15) * 2 + 64) * 8));
+    }
+    for (size_t i = 0; i < sizeof(fixups) / sizeof(fixups[0]); i++) {
+        put16(out, fixups[i].index, fixups[i].value);
+    }
+}
+
+static void gen_plz_lsini16(void *out) {
+    for (int a = 0; a < 8192; a++) {
+        put16(out, a, (int)((sin(a * TABLE_DPII / 4096) * 55 + sin(a * TABLE_DPII / 4096 * 4) * 5 +
+                             sin(a * TABLE_DPII / 4096 * 17) * 3 + 64) * 16));
+    }
+}
+
+static void gen_plz_psini(void *out) {
+    uint8_t *psini = out;
+    for (int a = 0; a < 16384; a++) {
+        psini[a] = (uint8_t)(int)(sin(a * TABLE_DPII / 4096) * 55 + sin(a * TABLE_DPII / 4096 * 6) * 5 +
+                                  sin(a * TABLE_DPII / 4096 * 21) * 4 + 64);
+    }
+}
+
+/* GLENZ/MATHSIN.INC: 0.1 degree steps, rounded. The cosine at 60 and 300
+ * degrees is exactly 16383.5 and was rounded down */
+static void gen_glenz_math(void *out) {
+    static const table_fixup_t fixups[] = { { 900 + 600, 16383 }, { 900 + 3000, 16383 } };
+    for (int i = 0; i < 900; i++) {
+        put16(out, i, (int)(32767.0 * sin(i * TABLE_EXACT_PI / 1800.0) + 0.5));
+    }
+    for (int i = 0; i < 3600; i++) {
+        put16(out, 900 + i, (int)(32767.0 * cos(i * TABLE_EXACT_PI / 1800.0) + 0.5));
+    }
+    for (size_t i = 0; i < sizeof(fixups) / sizeof(fixups[0]); i++) {
+        put16(out, fixups[i].index, fixups[i].value);
+    }
+
+    uint8_t *guard = (uint8_t *)out + TABLE_GLENZ_TAN_OFFSET - 4;
+    uint8_t *tan_base = guard + 4;
+    put32(guard, 0, -99999999);
+    for (int i = 0; i < 1024; i++) {
+        put32(tan_base, i, i < 900 ? (int32_t)(65536.0 * tan(i * TABLE_EXACT_PI / 1800.0) + 0.5) : 99999999);
+    }
+}
+
+static const char *const names_sin1024[] = {
+    "COMAN/SIN1024.INC", "DDSTARS/SIN1024.INC", "DOTS/SIN1024.INC", "GLENZ/SIN1024.INC",
+    "HARD/SIN1024.INC", "LENS/SIN1024.INC", "TECHNO/SIN1024.INC", "TWIST/SIN1024.INC", NULL
+};
+static const char *const names_sin1024_clamped[] = { "JPLOGO/SIN1024.INC", NULL };
+static const char *const names_sin4096[] = { "LENS/SIN4096.INC", NULL };
+static const char *const names_visu_sin[] = { "VISU/ADATASIN.INC", NULL };
+static const char *const names_visu_div[] = { "VISU/AFILLDIV.INC", NULL };
+static const char *const names_plz_lsini4[] = { "PLZPART/LSINI4.INC", NULL };
+static const char *const names_plz_lsini16[] = { "PLZPART/LSINI16.INC", NULL };
+static const char *const names_plz_psini[] = { "PLZPART/PSINI.INC", NULL };
+static const char *const names_glenz_math[] = { "GLENZ/MATHSIN.INC", NULL };
+
+static const table_desc_t table_descs[TABLE_COUNT] = {
+    [TABLE_SIN1024] = { names_sin1024, 1024 * 2, gen_sin1024 },
+    [TABLE_SIN1024_CLAMPED] = { names_sin1024_clamped, 1024 * 2, gen_sin1024_clamped },
+    [TABLE_SIN4096] = { names_sin4096, 4096 * 2, gen_sin4096 },
+    [TABLE_VISU_SIN] = { names_visu_sin, 4096 * 2, gen_visu_sin },
+    [TABLE_VISU_DIV] = { names_visu_div, 512 * 2, gen_visu_div },
+    [TABLE_PLZ_LSINI4] = { names_plz_lsini4, 8192 * 2, gen_plz_lsini4 },
+    [TABLE_PLZ_LSINI16] = { names_plz_lsini16, 8192 * 2, gen_plz_lsini16 },
+    [TABLE_PLZ_PSINI] = { names_plz_psini, 16384, gen_plz_psini },
+    [TABLE_GLENZ_MATH] = { names_glenz_math, TABLE_GLENZ_TAN_OFFSET + 1024 * 4, gen_glenz_math },
+};
+
+void table_init(void) {
+    if (table_state.initialized) {
+        return;
+    }
+    memset(&table_state, 0, sizeof(table_state));
+    thread_mutex_init(&table_state.mutex);
+    arena_init(&table_state.arena, 0, 0);   /* Tables spill into heap chunks as generated */
+    table_state.initialized = 1;
+}
+
+void table_shutdown(void) {
+    if (!table_state.initialized) {
+        return;
+    }
+    arena_destroy(&table_state.arena);
+    thread_mutex_destroy(&table_state.mutex);
+    memset(&table_state, 0, sizeof(table_state));
+}
+
+const void *table_get(table_id_t id, size_t *size) {
+    if ((unsigned)id >= TABLE_COUNT || !table_state.initialized) {
+        fprintf(stderr, "TABLE: ERROR Bad table %d\n", (int)id);
+        return NULL;
+    }
+    const table_desc_t *desc = &table_descs[id];
+
+    thread_mutex_lock(&table_state.mutex);
+    const void *table = table_state.tables[id];
+    if (!table) {
+        void *block = arena_alloc(&table_state.arena, desc->size);
+        if (block) {
+            desc->generate(block);
+            table_state.tables[id] = block;
+            table = block;
+        } else {
+            fprintf(stderr, "TABLE: ERROR Out of memory for %s\n", desc->names[0]);
+        }
+    }
+    thread_mutex_unlock(&table_state.mutex);
+
+    if (table && size) {
+        *size = desc->size;
+    }
+    return table;
+}
+
+/* Compare file names ignoring case and separator style */
+static int same_name(const char *a, const char *b) {
+    for (;; a++, b++) {
+        char ca = *a == '\\' ? '/' : *a;
+        char cb = *b == '\\' ? '/' : *b;
+        if (ca >= 'a' && ca <= 'z') {
+            ca = (char)(ca - 'a' + 'A');
+        }
+        if (cb >= 'a' && cb <= 'z') {
+            cb = (char)(cb - 'a' + 'A');
+        }
+        if (ca != cb) {
+            return 0;
+        }
+        if (ca == '\0') {
+            return 1;
+        }
+    }
+}
+
+int table_find(const char *name) {
+    for (int id = 0; id < TABLE_COUNT; id++) {
+        for (const char *const *n = table_descs[id].names; *n; n++) {
+            if (same_name(name, *n)) {
+                return id;
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,72 @@
+/**
+ * Tables - Lookup tables generated on first use
+ *
+ * Many of the original .INC files are plain sine, cosine, tangent and
+ * reciprocal tables written out by a generator program (PLZPART/PLZ.C is
+ * one that survived). Instead of shipping them, each is computed once,
+ * the first time any part asks for it, and kept for the whole run, so
+ * parts that used identical copies (the eight SIN1024.INC files) share
+ * one table. Generation reproduces the original bytes exactly, including
+ * the few entries the original toolchain rounded differently.
+ *
+ * asset_table() resolves the original file names through table_find(),
+ * so ported parts keep loading "DOTS/SIN1024.INC" and never notice. The
+ * tables with hand-written or captured contents stay baked assets.
+ *
+ * Any thread, between table_init() and table_shutdown().
+ */
+
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stddef.h>
+
+/**
+ * Generated tables
+ */
+typedef enum {
+    TABLE_SIN1024,          /* 1024 words, 256 * sin: xx/SIN1024.INC */
+    TABLE_SIN1024_CLAMPED,  /* Same clamped to +-255: JPLOGO/SIN1024.INC */
+    TABLE_SIN4096,          /* 4096 words, 16384 * sin: LENS/SIN4096.INC */
+    TABLE_VISU_SIN,         /* 4096 words, 16384 * sin rounded: VISU/ADATASIN.INC */
+    TABLE_VISU_DIV,         /* 512 words, 65536 / n: VISU/AFILLDIV.INC */
+    TABLE_PLZ_LSINI4,       /* 8192 words: PLZPART/LSINI4.INC */
+    TABLE_PLZ_LSINI16,      /* 8192 words: PLZPART/LSINI16.INC */
+    TABLE_PLZ_PSINI,        /* 16384 bytes: PLZPART/PSINI.INC */
+    TABLE_GLENZ_MATH,       /* Sine, cosine and tangent: GLENZ/MATHSIN.INC */
+    TABLE_COUNT
+} table_id_t;
+
+/* TABLE_GLENZ_MATH layout, byte offsets: sintable16 (900 words, 0.1
+ * degree steps) runs on into costable16 (3600 words), then a -99999999
+ * guard dword sits before tantable32 (1024 dwords, 99999999 from 900) */
+#define TABLE_GLENZ_COS_OFFSET  1800
+#define TABLE_GLENZ_TAN_OFFSET  9004
+
+/**
+ * Initialize the table cache (nothing is generated yet).
+ */
+void table_init(void);
+
+/**
+ * Free every generated table.
+ * Pointers from table_get() are invalid afterwards.
+ */
+void table_shutdown(void);
+
+/**
+ * Get a table, generating it on first use.
+ * @param id TABLE_*
+ * @param size Receives the table size in bytes (may be NULL)
+ * @return 16-byte aligned read-only table, or NULL on error
+ */
+const void *table_get(table_id_t id, size_t *size);
+
+/**
+ * Look up the table that replaces an original .INC file.
+ * @param name Original file name, any case (e.g. "DOTS/SIN1024.INC")
+ * @return TABLE_* id, or -1 if the file is not a generated table
+ */
+int table_find(const char *name);
+
+#endif /* TABLE_H */
@@ -0,0 +1,116 @@
+/**
+ * Thread Primitives - Implementation
+ */
+
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Boxed entry point so both backends can use the void(void *) signature */
+typedef struct {
+    thread_fn fn;
+    void *arg;
+} thread_start_t;
+
+#if defined(_WIN32)
+
+static DWORD WINAPI thread_entry(LPVOID param) {
+    thread_start_t start = *(thread_start_t *)param;
+    free(param);
+    start.fn(start.arg);
+    return 0;
+}
+
+int thread_create(thread_t *thread, thread_fn fn, void *arg) {
+    thread_start_t *start = malloc(sizeof(*start));
+    if (!start) {
+        return -1;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    *thread = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (!*thread) {
+        free(start);
+        fprintf(stderr, "THREAD: Failed to create thread\n");
+        return -1;
+    }
+    return 0;
+}
+
+void thread_join(thread_t *thread) {
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+}
+
+int thread_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+void thread_mutex_init(thread_mutex_t *mutex) { InitializeCriticalSection(mutex); }
+void thread_mutex_destroy(thread_mutex_t *mutex) { DeleteCriticalSection(mutex); }
+void thread_mutex_lock(thread_mutex_t *mutex) { EnterCriticalSection(mutex); }
+void thread_mutex_unlock(thread_mutex_t *mutex) { LeaveCriticalSection(mutex); }
+
+void thread_cond_init(thread_cond_t *cond) { InitializeConditionVariable(cond); }
+void thread_cond_destroy(thread_cond_t *cond) { (void)cond; }
+void thread_cond_wait(thread_cond_t *cond, thread_mutex_t *mutex) {
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+void thread_cond_signal(thread_cond_t *cond) { WakeConditionVariable(cond); }
+void thread_cond_broadcast(thread_cond_t *cond) { WakeAllConditionVariable(cond); }
+
+#else
+
+#include <unistd.h>
+
+static void *thread_entry(void *param) {
+    thread_start_t start = *(thread_start_t *)param;
+    free(param);
+    start.fn(start.arg);
+    return NULL;
+}
+
+int thread_create(thread_t *thread, thread_fn fn, void *arg) {
+    thread_start_t *start = malloc(sizeof(*start));
+    if (!start) {
+        return -1;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    if (pthread_create(thread, NULL, thread_entry, start) != 0) {
+        free(start);
+        fprintf(stderr, "THREAD: Failed to create thread\n");
+        return -1;
+    }
+    return 0;
+}
+
+void thread_join(thread_t *thread) {
+    pthread_join(*thread, NULL);
+}
+
+int thread_cpu_count(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#else
+    return 1;
+#endif
+}
+
+void thread_mutex_init(thread_mutex_t *mutex) { pthread_mutex_init(mutex, NULL); }
+void thread_mutex_destroy(thread_mutex_t *mutex) { pthread_mutex_destroy(mutex); }
+void thread_mutex_lock(thread_mutex_t *mutex) { pthread_mutex_lock(mutex); }
+void thread_mutex_unlock(thread_mutex_t *mutex) { pthread_mutex_unlock(mutex); }
+
+void thread_cond_init(thread_cond_t *cond) { pthread_cond_init(cond, NULL); }
+void thread_cond_destroy(thread_cond_t *cond) { pthread_cond_destroy(cond); }
+void thread_cond_wait(thread_cond_t *cond, thread_mutex_t *mutex) {
+    pthread_cond_wait(cond, mutex);
+}
+void thread_cond_signal(thread_cond_t *cond) { pthread_cond_signal(cond); }
+void thread_cond_broadcast(thread_cond_t *cond) { pthread_cond_broadcast(cond); }
+
+#endif
@@ -0,0 +1,84 @@
+/**
+ * Thread Primitives - Minimal portable threads, mutexes and condition variables
+ *
+ * Wraps pthreads (POSIX, Emscripten with -pthread) and Win32 threads
+ * behind one small API for background workers. Creation can fail where
+ * threads are unavailable (Emscripten without -pthread); callers fall
+ * back to doing the work inline.
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+typedef HANDLE thread_t;
+typedef CRITICAL_SECTION thread_mutex_t;
+typedef CONDITION_VARIABLE thread_cond_t;
+#else
+#include <pthread.h>
+typedef pthread_t thread_t;
+typedef pthread_mutex_t thread_mutex_t;
+typedef pthread_cond_t thread_cond_t;
+#endif
+
+/**
+ * Thread entry point
+ */
+typedef void (*thread_fn)(void *arg);
+
+/**
+ * Start a thread.
+ * @param thread Receives the thread handle
+ * @param fn Entry point
+ * @param arg Argument passed to fn
+ * @return 0 on success, -1 if threads are unavailable
+ */
+int thread_create(thread_t *thread, thread_fn fn, void *arg);
+
+/**
+ * Wait for a thread to finish and release it.
+ * @param thread Thread started with thread_create()
+ */
+void thread_join(thread_t *thread);
+
+/**
+ * Get the number of online CPU cores.
+ * @return Core count, at least 1
+ */
+int thread_cpu_count(void);
+
+/**
+ * Initialize or destroy a non-recursive mutex.
+ */
+void thread_mutex_init(thread_mutex_t *mutex);
+void thread_mutex_destroy(thread_mutex_t *mutex);
+
+/**
+ * Acquire or release a mutex.
+ */
+void thread_mutex_lock(thread_mutex_t *mutex);
+void thread_mutex_unlock(thread_mutex_t *mutex);
+
+/**
+ * Initialize or destroy a condition variable.
+ */
+void thread_cond_init(thread_cond_t *cond);
+void thread_cond_destroy(thread_cond_t *cond);
+
+/**
+ * Atomically release mutex and wait for a signal, then re-acquire it.
+ * May wake spuriously; always re-check the predicate.
+ */
+void thread_cond_wait(thread_cond_t *cond, thread_mutex_t *mutex);
+
+/**
+ * Wake one or all waiters.
+ */
+void thread_cond_signal(thread_cond_t *cond);
+void thread_cond_broadcast(thread_cond_t *cond);
+
+#endif /* THREAD_H */
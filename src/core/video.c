@@ -2,16 +2,37 @@
  * Video Subsystem - VGA-style framebuffer with Sokol GPU upload
  *
  * Reimplements VGA Mode 13h (320x200) and Mode X (320x400) using
- * an indexed-color framebuffer converted to RGBA for GPU display.
+ * an indexed-color framebuffer. Two presentation paths are available:
+ * - CPU: indexed pixels are expanded to RGBA and uploaded (default)
+ * - GPU: indexed pixels are uploaded as an R8 texture and the palette
+ *   lookup happens in the fragment shader against a 256x1 texture
+ *
+ * Parts that support it can render into a supersampled indexed buffer
+ * (2x or 4x) instead of video memory; both paths upload that buffer
+ * directly at its own size through textures made on first use.
  */
 
 #include "video.h"
+#include "video_convert.h"
+#include "profile.h"
+#include "framecheck.h"
 #include "sokol_gfx.h"
+#if !defined(SR_HEADLESS)
 #include "sokol_app.h"
+#endif
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-/* Framebuffer size: 320x400 = 128KB for Mode X */
-#define FB_SIZE (VIDEO_WIDTH * VIDEO_HEIGHT_X)
+/* Framebuffer size: video memory holding two Mode X pages (256000 bytes) */
+#define FB_SIZE VIDEO_MEMORY_SIZE
+
+/* Number of video modes (textures are created per mode) */
+#define VIDEO_MODE_COUNT 2
+
+/* Framebuffer rows (memory lines of VIDEO_WIDTH bytes) */
+#define FB_ROWS (FB_SIZE / VIDEO_WIDTH)
 
 /* Embedded shaders */
 
@@ -35,6 +56,26 @@ static const char *fs_source =
     "void main() {\n"
     "    frag_color = texture(tex, uv);\n"
     "}\n";
+
+static const char *fs_palette_source =
+    "#version 330\n"
+    "uniform sampler2D fb;\n"
+    "uniform sampler2D pal;\n"
+    "uniform sampler2D lines;\n"
+    "uniform sampler2D rpal;\n"
+    "in vec2 uv;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "    int stride = textureSize(fb, 0).x;\n"
+    "    int h = textureSize(lines, 0).x;\n"
+    "    int x = min(int(uv.x * float(stride)), stride - 1);\n"
+    "    int y = min(int(uv.y * float(h)), h - 1);\n"
+    "    ivec4 l = ivec4(texelFetch(lines, ivec2(y, 0), 0) * 255.0 + 0.5);\n"
+    "    int off = l.r + l.g * 256 + l.b * 65536 + x;\n"
+    "    int idx = int(texelFetch(fb, ivec2(off % stride, off / stride), 0).r * 255.0 + 0.5);\n"
+    "    frag_color = (l.a == 0) ? texelFetch(pal, ivec2(idx, 0), 0)\n"
+    "                            : texelFetch(rpal, ivec2(idx, l.a - 1), 0);\n"
+    "}\n";
 #elif defined(SOKOL_GLES3)
 /* GLSL ES 3.00 for WebGL2/GLES3 */
 static const char *vs_source =
@@ -56,6 +97,29 @@ static const char *fs_source =
     "void main() {\n"
     "    frag_color = texture(tex, uv);\n"
     "}\n";
+
+/* highp so the 8-bit index and 24-bit line offsets survive float math */
+static const char *fs_palette_source =
+    "#version 300 es\n"
+    "precision highp float;\n"
+    "precision highp int;\n"
+    "uniform highp sampler2D fb;\n"
+    "uniform highp sampler2D pal;\n"
+    "uniform highp sampler2D lines;\n"
+    "uniform highp sampler2D rpal;\n"
+    "in vec2 uv;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "    int stride = textureSize(fb, 0).x;\n"
+    "    int h = textureSize(lines, 0).x;\n"
+    "    int x = min(int(uv.x * float(stride)), stride - 1);\n"
+    "    int y = min(int(uv.y * float(h)), h - 1);\n"
+    "    ivec4 l = ivec4(texelFetch(lines, ivec2(y, 0), 0) * 255.0 + 0.5);\n"
+    "    int off = l.r + l.g * 256 + l.b * 65536 + x;\n"
+    "    int idx = int(texelFetch(fb, ivec2(off % stride, off / stride), 0).r * 255.0 + 0.5);\n"
+    "    frag_color = (l.a == 0) ? texelFetch(pal, ivec2(idx, 0), 0)\n"
+    "                            : texelFetch(rpal, ivec2(idx, l.a - 1), 0);\n"
+    "}\n";
 #elif defined(SOKOL_D3D11)
 /* HLSL for D3D11 */
 static const char *vs_source =
@@ -78,6 +142,27 @@ static const char *fs_source =
     "float4 main(float2 uv : TEXCOORD0) : SV_Target0 {\n"
     "    return tex.Sample(smp, uv);\n"
     "}\n";
+
+static const char *fs_palette_source =
+    "Texture2D<float4> fb : register(t0);\n"
+    "Texture2D<float4> pal : register(t1);\n"
+    "Texture2D<float4> lines : register(t2);\n"
+    "Texture2D<float4> rpal : register(t3);\n"
+    "SamplerState smp : register(s0);\n"
+    "float4 main(float2 uv : TEXCOORD0) : SV_Target0 {\n"
+    "    uint stride, fb_h, h, lines_h;\n"
+    "    fb.GetDimensions(stride, fb_h);\n"
+    "    lines.GetDimensions(h, lines_h);\n"
+    "    int x = min(int(uv.x * float(stride)), int(stride) - 1);\n"
+    "    int y = min(int(uv.y * float(h)), int(h) - 1);\n"
+    "    int4 l = int4(lines.Load(int3(y, 0, 0)) * 255.0 + 0.5);\n"
+    "    int off = l.r + l.g * 256 + l.b * 65536 + x;\n"
+    "    int idx = int(fb.Load(int3(off % int(stride), off / int(stride), 0)).r * 255.0 + 0.5);\n"
+    "    if (l.a == 0) {\n"
+    "        return pal.Load(int3(idx, 0, 0));\n"
+    "    }\n"
+    "    return rpal.Load(int3(idx, l.a - 1, 0));\n"
+    "}\n";
 #elif defined(SOKOL_METAL)
 /* Metal shaders */
 static const char *vs_source =
@@ -104,125 +189,451 @@ static const char *fs_source =
     "                      sampler smp [[sampler(0)]]) {\n"
     "    return tex.sample(smp, uv);\n"
     "}\n";
+
+static const char *fs_palette_source =
+    "#include <metal_stdlib>\n"
+    "using namespace metal;\n"
+    "fragment float4 _main(float2 uv [[stage_in]],\n"
+    "                      texture2d<float> fb [[texture(0)]],\n"
+    "                      texture2d<float> pal [[texture(1)]],\n"
+    "                      texture2d<float> lines [[texture(2)]],\n"
+    "                      texture2d<float> rpal [[texture(3)]],\n"
+    "                      sampler smp [[sampler(0)]]) {\n"
+    "    int stride = int(fb.get_width());\n"
+    "    int h = int(lines.get_width());\n"
+    "    int x = min(int(uv.x * float(stride)), stride - 1);\n"
+    "    int y = min(int(uv.y * float(h)), h - 1);\n"
+    "    int4 l = int4(lines.read(uint2(y, 0)) * 255.0 + 0.5);\n"
+    "    int off = l.r + l.g * 256 + l.b * 65536 + x;\n"
+    "    uint idx = uint(fb.read(uint2(off % stride, off / stride)).r * 255.0 + 0.5);\n"
+    "    return (l.a == 0) ? pal.read(uint2(idx, 0)) : rpal.read(uint2(idx, l.a - 1));\n"
+    "}\n";
 #else
 #error "Unknown Sokol backend"
 #endif
 
-/* Internal video state */
-static struct {
+/* Per-scanline palette patch (copper-style mid-frame palette write) */
+typedef struct {
+    int line;
+    int start;
+    int count;
+    uint8_t data[768];
+} video_scanline_palette_t;
+
+/* Everything a part sets for one displayed frame. Parts write the draw
+ * frame and presentation reads the show frame; they are the same frame
+ * unless pipelined, when finished frames pass through a triple buffer and
+ * each new draw frame starts as a copy of the last one published. */
+typedef struct {
     uint8_t framebuffer[FB_SIZE];
     uint8_t palette[768];
-    uint32_t rgba_lut[256];
+    int mode;
+    uint32_t start_offset;
+    uint8_t hscroll;
+    int palette_changed;        /* Palette written in this frame */
+
+    /* Scanline table: values written at a line hold until the end of the frame */
+    int32_t scanline_start[VIDEO_HEIGHT_X];   /* -1 = unchanged, else video_set_start() units */
+    int16_t scanline_hscroll[VIDEO_HEIGHT_X]; /* -1 = unchanged */
+    video_scanline_palette_t scanline_palette[VIDEO_SCANLINE_MAX_PALETTES];
+    int scanline_palette_count;
+    int scanline_active;        /* Any start/hscroll entry set */
+    int scanlines_changed;      /* Palette patches written in this frame */
+
+    uint8_t dirty_rows[FB_ROWS];        /* Framebuffer rows written in this frame */
+
+    /* Supersampled frame (video_set_scale), allocated while scale > 1 */
+    int scale;
+    uint8_t *hires;                     /* VIDEO_WIDTH * scale x VIDEO_HEIGHT_X * scale */
+
+    unsigned serial;                    /* Frames published before this one */
+} video_frame_t;
+
+/* Triple buffer slot word: frame index, plus a flag while not yet acquired */
+#define VIDEO_SLOT_FRESH 4u
+
+/* Internal video state */
+static struct {
+    video_frame_t frame;        /* The only frame unless pipelined */
+    video_frame_t *frames[3];   /* Pipelined: frame and two spares */
+    video_frame_t *draw;        /* Written by parts */
+    video_frame_t *show;        /* Read by presentation */
+    int pipelined;
+    int back;                   /* Index of draw, owned by the producer */
+    int front;                  /* Index of show, owned by the consumer */
+    atomic_uint middle;         /* Index of the frame in between | VIDEO_SLOT_FRESH */
+    unsigned published;         /* Frames published, producer side */
+    unsigned taken;             /* Serial of the show frame changes were taken from */
+
+    video_lut_t lut;
     uint32_t rgba_staging[VIDEO_WIDTH * VIDEO_HEIGHT_X];
-    sg_image image;
-    sg_view texture_view;
-    sg_sampler sampler;
+
+    /* CPU path: RGBA textures, one per video mode */
+    sg_image image[VIDEO_MODE_COUNT];
+    sg_view texture_view[VIDEO_MODE_COUNT];
     sg_shader shader;
     sg_pipeline pipeline;
-    int mode;
-    uint16_t start_offset;
-    uint8_t hscroll;
-    int palette_dirty;
+
+    /* GPU path: R8 index textures per mode (visible window) and for all of
+     * video memory, 256x1 palette texture, per-line offset/palette-row
+     * table and raster palette rows */
+    sg_image index_image[VIDEO_MODE_COUNT];
+    sg_view index_view[VIDEO_MODE_COUNT];
+    sg_image memory_image;
+    sg_view memory_view;
+    sg_image palette_image;
+    sg_view palette_view;
+    sg_image lines_image[VIDEO_MODE_COUNT];
+    sg_view lines_view[VIDEO_MODE_COUNT];
+    sg_image raster_palette_image;
+    sg_view raster_palette_view;
+    sg_shader palette_shader;
+    sg_pipeline palette_pipeline;
+
+    sg_sampler sampler;
+    int present_mode;
+    int palette_dirty;          /* LUT needs rebuilding */
+    int palette_upload_pending; /* GPU palette texture is stale */
+    int scanline_palette_dirty; /* Raster LUTs need rebuilding */
     int initialized;
-} video_state;
+
+    /* Resolved per-line state, rebuilt each frame */
+    video_lut_t raster_lut[VIDEO_SCANLINE_MAX_PALETTES];
+    int raster_lut_count;
+    uint32_t line_offset[VIDEO_HEIGHT_X];  /* Framebuffer byte offset of each line */
+    uint8_t line_palette[VIDEO_HEIGHT_X];  /* 0 = base palette, n = raster_lut[n - 1] */
+    uint32_t line_table[VIDEO_HEIGHT_X];   /* GPU line texture: offset | palette row << 24 */
+    uint32_t raster_rgba[VIDEO_SCANLINE_MAX_PALETTES][256]; /* GPU raster palette texture */
+
+    /* Dirty-row tracking (VIDEO_DIRTY_*) */
+    int dirty_mode;
+    uint8_t dirty_rows[FB_ROWS];        /* Framebuffer rows written since last present */
+    uint8_t shadow[FB_SIZE];            /* Last presented framebuffer (VIDEO_DIRTY_DETECT) */
+
+    /* Gathered visible lines for video_get_visible() when not linear */
+    uint8_t visible[VIDEO_WIDTH * VIDEO_HEIGHT_X];
+    uint32_t presented_offset[VIDEO_HEIGHT_X];
+    uint8_t presented_palette[VIDEO_HEIGHT_X];
+    int presented_mode;
+    int presented_path;                 /* Present mode of the last upload, -1 = none */
+    int presented_scale;                /* Scale of the last upload */
+    sg_view presented_view;
+    sg_view drawn_view;                 /* Frame texture of the last video_present() */
+    int line_table_valid[VIDEO_MODE_COUNT];
+    int raster_upload_pending;
+    sg_view drawn_lines_view;           /* Line table of the last video_present() (GPU path) */
+
+    /* Hi-res presentation, made while a supersampled frame is shown */
+    int max_scale;
+    uint32_t *hires_rgba;               /* CPU path staging, hires_width x hires_height */
+    uint32_t hires_lines[VIDEO_HEIGHT_X * VIDEO_SCALE_MAX];  /* GPU line table */
+    int hires_width;                    /* Size of the hi-res textures, 0 = none */
+    int hires_height;
+    sg_image hires_image;               /* CPU path: RGBA */
+    sg_view hires_view;
+    sg_image hires_index_image;         /* GPU path: R8 indices and line table */
+    sg_view hires_index_view;
+    sg_image hires_lines_image;
+    sg_view hires_lines_view;
+} video_state = { .draw = &video_state.frame, .show = &video_state.frame };
+
+/* Get visible height for a video mode */
+static int mode_height(int mode) {
+    return (mode == VIDEO_MODE_X) ? VIDEO_HEIGHT_X : VIDEO_HEIGHT_13H;
+}
+
+/* Expand a 6-bit VGA palette entry to packed RGBA */
+static uint32_t palette_to_rgba(const uint8_t *rgb) {
+    /* VGA uses 6-bit color (0-63), mask to prevent overflow */
+    uint8_t r6 = rgb[0] & 0x3F;
+    uint8_t g6 = rgb[1] & 0x3F;
+    uint8_t b6 = rgb[2] & 0x3F;
+    /* Expand 6-bit to 8-bit: (val << 2) | (val >> 4) */
+    uint8_t r = (r6 << 2) | (r6 >> 4);
+    uint8_t g = (g6 << 2) | (g6 >> 4);
+    uint8_t b = (b6 << 2) | (b6 >> 4);
+    /* Pack as RGBA (little-endian: 0xAABBGGRR) */
+    return 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+}
 
 /* Rebuild RGBA lookup table from palette */
 static void rebuild_rgba_lut(void) {
     for (int i = 0; i < 256; i++) {
-        /* VGA uses 6-bit color (0-63), mask to prevent overflow */
-        uint8_t r6 = video_state.palette[i * 3 + 0] & 0x3F;
-        uint8_t g6 = video_state.palette[i * 3 + 1] & 0x3F;
-        uint8_t b6 = video_state.palette[i * 3 + 2] & 0x3F;
-        /* Expand 6-bit to 8-bit: (val << 2) | (val >> 4) */
-        uint8_t r = (r6 << 2) | (r6 >> 4);
-        uint8_t g = (g6 << 2) | (g6 >> 4);
-        uint8_t b = (b6 << 2) | (b6 >> 4);
-        /* Pack as RGBA (little-endian: 0xAABBGGRR) */
-        video_state.rgba_lut[i] = 0xFF000000 | ((uint32_t)b << 16) | ((uint32_t)g << 8) | r;
+        video_state.lut.rgba[i] = palette_to_rgba(&video_state.show->palette[i * 3]);
     }
+    video_convert_prepare_lut(&video_state.lut);
     video_state.palette_dirty = 0;
+    video_state.scanline_palette_dirty = 1;
 }
 
-/* Convert indexed framebuffer to RGBA staging buffer */
-static void convert_framebuffer_to_rgba(void) {
-    int height = (video_state.mode == VIDEO_MODE_X) ? VIDEO_HEIGHT_X : VIDEO_HEIGHT_13H;
-    int pixel_count = VIDEO_WIDTH * height;
+/* Rebuild raster LUTs: one cumulative palette state per line with patches */
+static void rebuild_raster_luts(void) {
+    const video_frame_t *f = video_state.show;
+    const video_lut_t *prev = &video_state.lut;
+    int rows = 0;
 
-    /* Ensure we don't read beyond framebuffer bounds.
-     * start_offset is already validated in video_set_start(), but we
-     * add a safety check here to prevent any potential over-read. */
-    int safe_offset = video_state.start_offset;
+    for (int i = 0; i < f->scanline_palette_count; i++) {
+        const video_scanline_palette_t *patch = &f->scanline_palette[i];
+        /* Patches on the same line share one palette state */
+        if (rows == 0 || f->scanline_palette[i - 1].line != patch->line) {
+            video_state.raster_lut[rows] = *prev;
+            prev = &video_state.raster_lut[rows];
+            rows++;
+        }
+        video_lut_t *lut = &video_state.raster_lut[rows - 1];
+        for (int c = 0; c < patch->count; c++) {
+            lut->rgba[patch->start + c] = palette_to_rgba(&patch->data[c * 3]);
+        }
+    }
+    for (int r = 0; r < rows; r++) {
+        video_convert_prepare_lut(&video_state.raster_lut[r]);
+    }
+
+    /* Only touch the GPU raster rows when raster palettes are (or were) in use */
+    if (rows > 0 || video_state.raster_lut_count > 0) {
+        video_state.raster_upload_pending = 1;
+    }
+    video_state.raster_lut_count = rows;
+    video_state.scanline_palette_dirty = 0;
+}
+
+/* Convert a CRTC start address to a framebuffer byte offset.
+ * Mode 13h addresses single pixels; Mode X addresses 4-pixel planar
+ * groups, so one unit covers one byte in each of the four planes. */
+static int start_to_pixels(const video_frame_t *f, int offset) {
+    return (f->mode == VIDEO_MODE_X) ? offset * 4 : offset;
+}
+
+/* Check that a start address points into video memory in the frame's mode */
+static int start_in_memory(const video_frame_t *f, uint32_t offset) {
+    return offset < FB_SIZE && start_to_pixels(f, (int)offset) < FB_SIZE;
+}
+
+/* Get the framebuffer offset of the first visible pixel for the current start offset */
+static int visible_offset(const video_frame_t *f) {
+    int pixel_count = VIDEO_WIDTH * mode_height(f->mode);
+
+    /* Ensure we don't read beyond framebuffer bounds. start_offset is
+     * stored as given since its units depend on the mode at present time. */
+    int safe_offset = start_to_pixels(f, (int)f->start_offset);
     if (safe_offset + pixel_count > FB_SIZE) {
         safe_offset = FB_SIZE - pixel_count;
         if (safe_offset < 0) safe_offset = 0;
     }
+    return safe_offset;
+}
+
+/* Clamp a line start so a full line can be read from the framebuffer */
+static uint32_t clamp_line_offset(int offset) {
+    if (offset < 0) {
+        return 0;
+    }
+    if (offset > FB_SIZE - VIDEO_WIDTH) {
+        return FB_SIZE - VIDEO_WIDTH;
+    }
+    return (uint32_t)offset;
+}
+
+/* Resolve a frame's scanline table into per-line source offsets and palette rows.
+ * @return 1 if lines are contiguous from line 0 with the base palette */
+static int resolve_lines(const video_frame_t *f, uint32_t *line_offset, uint8_t *line_palette) {
+    int height = mode_height(f->mode);
+    int base = visible_offset(f);
+    int hscroll = f->hscroll & 3;
+    int palette_row = 0;
+    int patch = 0;
+    int linear = 1;
 
-    const uint8_t *src = video_state.framebuffer + safe_offset;
+    for (int y = 0; y < height; y++) {
+        if (f->scanline_active) {
+            /* A new start address restarts the display at that line (split screen) */
+            if (f->scanline_start[y] >= 0) {
+                base = start_to_pixels(f, f->scanline_start[y]) - y * VIDEO_WIDTH;
+            }
+            if (f->scanline_hscroll[y] >= 0) {
+                hscroll = f->scanline_hscroll[y];
+            }
+        }
+        while (patch < f->scanline_palette_count && f->scanline_palette[patch].line <= y) {
+            if (patch == 0 || f->scanline_palette[patch - 1].line != f->scanline_palette[patch].line) {
+                palette_row++;
+            }
+            patch++;
+        }
+
+        uint32_t offset = clamp_line_offset(base + y * VIDEO_WIDTH + hscroll);
+        line_offset[y] = offset;
+        line_palette[y] = (uint8_t)palette_row;
+        if (offset != line_offset[0] + (uint32_t)(y * VIDEO_WIDTH) || palette_row != 0) {
+            linear = 0;
+        }
+    }
+    return linear;
+}
+
+/* Check if a display line reads from a dirty framebuffer row.
+ * A line with fine scroll can straddle two rows. */
+static int line_is_dirty(int y) {
+    uint32_t first = video_state.line_offset[y] / VIDEO_WIDTH;
+    uint32_t last = (video_state.line_offset[y] + VIDEO_WIDTH - 1) / VIDEO_WIDTH;
+    return video_state.dirty_rows[first] || video_state.dirty_rows[last];
+}
+
+/* VIDEO_DIRTY_DETECT: mark visible rows that differ from the last presented frame.
+ * Hidden pages are skipped; showing them is a layout change and refreshes fully. */
+static void detect_dirty_rows(void) {
+    int height = mode_height(video_state.show->mode);
+    int checked = -1;
+
+    for (int y = 0; y < height; y++) {
+        int first = (int)(video_state.line_offset[y] / VIDEO_WIDTH);
+        int last = (int)((video_state.line_offset[y] + VIDEO_WIDTH - 1) / VIDEO_WIDTH);
+        for (int r = first; r <= last; r++) {
+            if (r == checked) {
+                continue;
+            }
+            checked = r;
+            const uint8_t *row = video_state.show->framebuffer + r * VIDEO_WIDTH;
+            uint8_t *old = video_state.shadow + r * VIDEO_WIDTH;
+            if (!video_state.dirty_rows[r] && memcmp(row, old, VIDEO_WIDTH) == 0) {
+                continue;
+            }
+            memcpy(old, row, VIDEO_WIDTH);
+            video_state.dirty_rows[r] = 1;
+        }
+    }
+}
+
+/* Check if the visible layout (mode, line offsets, palette rows) matches the
+ * last upload for this present path, and record the current layout. */
+static int layout_unchanged(void) {
+    int mode = video_state.show->mode;
+    int height = mode_height(mode);
+    int same = video_state.presented_path == video_state.present_mode &&
+               video_state.presented_mode == mode &&
+               memcmp(video_state.presented_offset, video_state.line_offset,
+                      (size_t)height * sizeof(uint32_t)) == 0 &&
+               memcmp(video_state.presented_palette, video_state.line_palette, (size_t)height) == 0;
+    if (!same) {
+        memcpy(video_state.presented_offset, video_state.line_offset, (size_t)height * sizeof(uint32_t));
+        memcpy(video_state.presented_palette, video_state.line_palette, (size_t)height);
+        video_state.presented_mode = mode;
+        video_state.presented_path = video_state.present_mode;
+    }
+    return same;
+}
+
+/* Convert indexed framebuffer to RGBA staging buffer.
+ * @param linear Lines are contiguous with the base palette (from resolve_lines)
+ * @param full Convert every line, otherwise only lines on dirty rows
+ * @return Number of lines converted */
+static int convert_framebuffer_to_rgba(int linear, int full) {
+    const uint8_t *framebuffer = video_state.show->framebuffer;
+    int height = mode_height(video_state.show->mode);
     uint32_t *dst = video_state.rgba_staging;
+    int converted = 0;
 
-    /* Handle hscroll offset (fine scrolling) */
-    int hscroll = video_state.hscroll & 3;
-    (void)hscroll; /* TODO: implement fine scrolling if needed */
+    if (full && linear) {
+        /* No raster effects: one contiguous conversion */
+        video_convert(dst, framebuffer + video_state.line_offset[0],
+                      VIDEO_WIDTH * height, &video_state.lut);
+        return height;
+    }
 
-    for (int i = 0; i < pixel_count; i++) {
-        dst[i] = video_state.rgba_lut[src[i]];
+    for (int y = 0; y < height; y++) {
+        if (!full && !line_is_dirty(y)) {
+            continue;
+        }
+        int row = video_state.line_palette[y];
+        const video_lut_t *lut = row ? &video_state.raster_lut[row - 1] : &video_state.lut;
+        video_convert(dst + y * VIDEO_WIDTH, framebuffer + video_state.line_offset[y],
+                      VIDEO_WIDTH, lut);
+        converted++;
     }
+    return converted;
 }
 
-void video_init(void) {
-    memset(&video_state, 0, sizeof(video_state));
-    video_state.mode = VIDEO_MODE_13H;
-    video_state.palette_dirty = 1;
+/* Destroy the hi-res textures. Invalid handles are ignored by sokol. */
+static void destroy_hires_textures(void) {
+    sg_destroy_view(video_state.hires_lines_view);
+    sg_destroy_image(video_state.hires_lines_image);
+    sg_destroy_view(video_state.hires_index_view);
+    sg_destroy_image(video_state.hires_index_image);
+    sg_destroy_view(video_state.hires_view);
+    sg_destroy_image(video_state.hires_image);
+    video_state.hires_lines_view.id = 0;
+    video_state.hires_lines_image.id = 0;
+    video_state.hires_index_view.id = 0;
+    video_state.hires_index_image.id = 0;
+    video_state.hires_view.id = 0;
+    video_state.hires_image.id = 0;
+    video_state.hires_width = 0;
+    video_state.hires_height = 0;
+    free(video_state.hires_rgba);
+    video_state.hires_rgba = NULL;
+}
 
-    /* Create default grayscale palette */
-    for (int i = 0; i < 256; i++) {
-        uint8_t gray = (uint8_t)(i >> 2); /* 0-255 -> 0-63 */
-        video_state.palette[i * 3 + 0] = gray;
-        video_state.palette[i * 3 + 1] = gray;
-        video_state.palette[i * 3 + 2] = gray;
+/* Destroy all GPU resources. Invalid handles are ignored by sokol. */
+static void destroy_resources(void) {
+    destroy_hires_textures();
+    sg_destroy_pipeline(video_state.palette_pipeline);
+    sg_destroy_shader(video_state.palette_shader);
+    sg_destroy_view(video_state.raster_palette_view);
+    sg_destroy_image(video_state.raster_palette_image);
+    sg_destroy_view(video_state.palette_view);
+    sg_destroy_image(video_state.palette_image);
+    sg_destroy_view(video_state.memory_view);
+    sg_destroy_image(video_state.memory_image);
+    for (int m = 0; m < VIDEO_MODE_COUNT; m++) {
+        sg_destroy_view(video_state.lines_view[m]);
+        sg_destroy_image(video_state.lines_image[m]);
+        sg_destroy_view(video_state.index_view[m]);
+        sg_destroy_image(video_state.index_image[m]);
     }
-    rebuild_rgba_lut();
+    sg_destroy_pipeline(video_state.pipeline);
+    sg_destroy_shader(video_state.shader);
+    sg_destroy_sampler(video_state.sampler);
+    for (int m = 0; m < VIDEO_MODE_COUNT; m++) {
+        sg_destroy_view(video_state.texture_view[m]);
+        sg_destroy_image(video_state.image[m]);
+    }
+}
 
-    /* Create texture for framebuffer (sized for Mode X) */
-    video_state.image = sg_make_image(&(sg_image_desc){
-        .width = VIDEO_WIDTH,
-        .height = VIDEO_HEIGHT_X,
-        .pixel_format = SG_PIXELFORMAT_RGBA8,
+/* Create a streamed texture and a view for sampling it.
+ * @return 1 on success, 0 on failure */
+static int make_texture(int width, int height, sg_pixel_format format, int stream,
+                        const char *label, sg_image *image, sg_view *view) {
+    *image = sg_make_image(&(sg_image_desc){
+        .width = width,
+        .height = height,
+        .pixel_format = format,
         .usage = {
             .immutable = false,
-            .stream_update = true
+            .stream_update = stream ? true : false,
+            .dynamic_update = stream ? false : true
         },
-        .label = "video_fb"
+        .label = label
     });
-    if (sg_query_image_state(video_state.image) != SG_RESOURCESTATE_VALID) {
-        return; /* Image creation failed */
+    if (sg_query_image_state(*image) != SG_RESOURCESTATE_VALID) {
+        return 0;
     }
 
-    /* Create texture view for sampling */
-    video_state.texture_view = sg_make_view(&(sg_view_desc){
-        .texture.image = video_state.image,
-        .label = "video_tex_view"
+    *view = sg_make_view(&(sg_view_desc){
+        .texture.image = *image,
+        .label = label
     });
-    if (sg_query_view_state(video_state.texture_view) != SG_RESOURCESTATE_VALID) {
-        sg_destroy_image(video_state.image);
-        return; /* View creation failed */
-    }
+    return sg_query_view_state(*view) == SG_RESOURCESTATE_VALID;
+}
 
-    /* Create sampler with nearest filtering for crisp pixels */
-    video_state.sampler = sg_make_sampler(&(sg_sampler_desc){
-        .min_filter = SG_FILTER_NEAREST,
-        .mag_filter = SG_FILTER_NEAREST,
-        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
-        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
-        .label = "video_smp"
-    });
-    if (sg_query_sampler_state(video_state.sampler) != SG_RESOURCESTATE_VALID) {
-        sg_destroy_view(video_state.texture_view);
-        sg_destroy_image(video_state.image);
-        return; /* Sampler creation failed */
+/* Create the CPU-path resources: RGBA textures and pass-through shader */
+static int make_rgba_resources(void) {
+    for (int m = 0; m < VIDEO_MODE_COUNT; m++) {
+        if (!make_texture(VIDEO_WIDTH, mode_height(m), SG_PIXELFORMAT_RGBA8, 1, "video_fb",
+                          &video_state.image[m], &video_state.texture_view[m])) {
+            return 0;
+        }
     }
 
-    /* Create shader */
     video_state.shader = sg_make_shader(&(sg_shader_desc){
         .vertex_func.source = vs_source,
         .fragment_func.source = fs_source,
@@ -246,65 +657,413 @@ void video_init(void) {
         .label = "video_shd"
     });
     if (sg_query_shader_state(video_state.shader) != SG_RESOURCESTATE_VALID) {
-        sg_destroy_sampler(video_state.sampler);
-        sg_destroy_view(video_state.texture_view);
-        sg_destroy_image(video_state.image);
-        return; /* Shader creation failed */
+        return 0;
     }
 
-    /* Create pipeline */
     video_state.pipeline = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = video_state.shader,
         .primitive_type = SG_PRIMITIVETYPE_TRIANGLES,
         .label = "video_pip"
     });
-    if (sg_query_pipeline_state(video_state.pipeline) != SG_RESOURCESTATE_VALID) {
-        sg_destroy_shader(video_state.shader);
-        sg_destroy_sampler(video_state.sampler);
-        sg_destroy_view(video_state.texture_view);
-        sg_destroy_image(video_state.image);
-        return; /* Pipeline creation failed */
+    return sg_query_pipeline_state(video_state.pipeline) == SG_RESOURCESTATE_VALID;
+}
+
+/* Create the GPU-path resources: index, palette and line textures, lookup shader */
+static int make_palette_resources(void) {
+    static const char *names[4] = { "fb", "pal", "lines", "rpal" };
+    sg_shader_desc desc = {
+        .vertex_func.source = vs_source,
+        .fragment_func.source = fs_palette_source,
+        .samplers[0] = {
+            .stage = SG_SHADERSTAGE_FRAGMENT,
+            .sampler_type = SG_SAMPLERTYPE_FILTERING
+        },
+        .label = "video_palette_shd"
+    };
+
+    for (int m = 0; m < VIDEO_MODE_COUNT; m++) {
+        if (!make_texture(VIDEO_WIDTH, mode_height(m), SG_PIXELFORMAT_R8, 1, "video_index",
+                          &video_state.index_image[m], &video_state.index_view[m])) {
+            return 0;
+        }
+        if (!make_texture(mode_height(m), 1, SG_PIXELFORMAT_RGBA8, 0, "video_lines",
+                          &video_state.lines_image[m], &video_state.lines_view[m])) {
+            return 0;
+        }
+    }
+    if (!make_texture(VIDEO_WIDTH, FB_ROWS, SG_PIXELFORMAT_R8, 1, "video_memory",
+                      &video_state.memory_image, &video_state.memory_view)) {
+        return 0;
+    }
+    if (!make_texture(256, 1, SG_PIXELFORMAT_RGBA8, 0, "video_palette",
+                      &video_state.palette_image, &video_state.palette_view)) {
+        return 0;
+    }
+    if (!make_texture(256, VIDEO_SCANLINE_MAX_PALETTES, SG_PIXELFORMAT_RGBA8, 0,
+                      "video_raster_palette",
+                      &video_state.raster_palette_image, &video_state.raster_palette_view)) {
+        return 0;
+    }
+
+    /* Views: 0=fb, 1=pal, 2=lines, 3=rpal, all read with texelFetch */
+    for (int v = 0; v < 4; v++) {
+        desc.views[v].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+        desc.views[v].texture.image_type = SG_IMAGETYPE_2D;
+        desc.views[v].texture.sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+        desc.views[v].texture.hlsl_register_t_n = (uint8_t)v;
+        desc.views[v].texture.msl_texture_n = (uint8_t)v;
+        desc.texture_sampler_pairs[v].stage = SG_SHADERSTAGE_FRAGMENT;
+        desc.texture_sampler_pairs[v].view_slot = (uint8_t)v;
+        desc.texture_sampler_pairs[v].sampler_slot = 0;
+        desc.texture_sampler_pairs[v].glsl_name = names[v];
+    }
+
+    video_state.palette_shader = sg_make_shader(&desc);
+    if (sg_query_shader_state(video_state.palette_shader) != SG_RESOURCESTATE_VALID) {
+        return 0;
+    }
+
+    video_state.palette_pipeline = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = video_state.palette_shader,
+        .primitive_type = SG_PRIMITIVETYPE_TRIANGLES,
+        .label = "video_palette_pip"
+    });
+    return sg_query_pipeline_state(video_state.palette_pipeline) == SG_RESOURCESTATE_VALID;
+}
+
+void video_init(void) {
+    memset(&video_state, 0, sizeof(video_state));
+    video_convert_init();
+    video_state.draw = &video_state.frame;
+    video_state.show = &video_state.frame;
+    video_state.frame.mode = VIDEO_MODE_13H;
+    video_state.frame.scale = VIDEO_SCALE_NATIVE;
+    video_state.present_mode = VIDEO_PRESENT_CPU;
+    video_state.palette_dirty = 1;
+    video_state.palette_upload_pending = 1;
+    video_state.dirty_mode = VIDEO_DIRTY_OFF;
+    video_state.presented_path = -1;
+    video_state.presented_scale = VIDEO_SCALE_NATIVE;
+    video_state.max_scale = VIDEO_SCALE_NATIVE;
+    video_clear_scanlines();
+
+    /* Create default grayscale palette */
+    for (int i = 0; i < 256; i++) {
+        uint8_t gray = (uint8_t)(i >> 2); /* 0-255 -> 0-63 */
+        video_state.frame.palette[i * 3 + 0] = gray;
+        video_state.frame.palette[i * 3 + 1] = gray;
+        video_state.frame.palette[i * 3 + 2] = gray;
+    }
+    rebuild_rgba_lut();
+
+    /* Create sampler with nearest filtering for crisp pixels */
+    video_state.sampler = sg_make_sampler(&(sg_sampler_desc){
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+        .label = "video_smp"
+    });
+    if (sg_query_sampler_state(video_state.sampler) != SG_RESOURCESTATE_VALID) {
+        destroy_resources();
+        return; /* Sampler creation failed */
+    }
+
+    if (!make_rgba_resources() || !make_palette_resources()) {
+        destroy_resources();
+        return; /* Texture, shader or pipeline creation failed */
     }
 
     video_state.initialized = 1;
 }
 
 void video_shutdown(void) {
+    video_set_pipelined(0);
+    free(video_state.frame.hires);
+    free(video_state.hires_rgba);
+    video_state.frame.hires = NULL;
+    video_state.hires_rgba = NULL;
     if (!video_state.initialized) {
         return;
     }
-    sg_destroy_pipeline(video_state.pipeline);
-    sg_destroy_shader(video_state.shader);
-    sg_destroy_sampler(video_state.sampler);
-    sg_destroy_view(video_state.texture_view);
-    sg_destroy_image(video_state.image);
+    destroy_resources();
     memset(&video_state, 0, sizeof(video_state));
+    video_state.draw = &video_state.frame;
+    video_state.show = &video_state.frame;
+}
+
+/* Start dst as a copy of src, keeping dst's own hi-res buffer (resized to
+ * src's scale) and clearing the per-frame change flags.
+ * @return 0 on success, -1 if the hi-res buffer could not be allocated */
+static int copy_frame(video_frame_t *dst, const video_frame_t *src) {
+    size_t pixels = (size_t)VIDEO_WIDTH * VIDEO_HEIGHT_X * (size_t)(src->scale * src->scale);
+    uint8_t *hires = dst->hires;
+    int rc = 0;
+
+    if (dst->scale != src->scale) {
+        free(hires);
+        hires = src->hires ? malloc(pixels) : NULL;
+    }
+    *dst = *src;
+    dst->hires = hires;
+    if (src->hires && !hires) {
+        dst->scale = VIDEO_SCALE_NATIVE;
+        rc = -1;
+    } else if (src->hires) {
+        memcpy(hires, src->hires, pixels);
+    }
+    dst->palette_changed = 0;
+    dst->scanlines_changed = 0;
+    memset(dst->dirty_rows, 0, sizeof(dst->dirty_rows));
+    return rc;
+}
+
+int video_set_pipelined(int enabled) {
+    enabled = enabled ? 1 : 0;
+    if (enabled == video_state.pipelined) {
+        return 0;
+    }
+
+    if (!enabled) {
+        /* Carry the part's latest state back into the single frame */
+        video_frame_t *last = video_state.draw;
+        if (last != &video_state.frame) {
+            copy_frame(&video_state.frame, last);
+            memcpy(video_state.frame.dirty_rows, last->dirty_rows, sizeof(last->dirty_rows));
+            video_state.frame.palette_changed = 1;
+            video_state.frame.scanlines_changed = 1;
+        }
+        for (int i = 1; i < 3; i++) {
+            if (video_state.frames[i]) {
+                free(video_state.frames[i]->hires);
+                free(video_state.frames[i]);
+            }
+            video_state.frames[i] = NULL;
+        }
+        video_state.draw = &video_state.frame;
+        video_state.show = &video_state.frame;
+        video_state.presented_path = -1;
+        video_state.pipelined = 0;
+        return 0;
+    }
+
+    video_state.frames[0] = &video_state.frame;
+    for (int i = 1; i < 3; i++) {
+        video_state.frames[i] = calloc(1, sizeof(video_frame_t));
+        if (!video_state.frames[i] || copy_frame(video_state.frames[i], &video_state.frame) < 0) {
+            fprintf(stderr, "VIDEO: ERROR - Cannot allocate pipelined frames\n");
+            video_state.pipelined = 1;
+            video_state.draw = &video_state.frame;
+            video_set_pipelined(0);
+            return -1;
+        }
+    }
+
+    /* Parts keep drawing into frame 0, frame 2 is shown until the first publish */
+    video_state.back = 0;
+    video_state.front = 2;
+    atomic_store(&video_state.middle, 1u);
+    video_state.draw = video_state.frames[0];
+    video_state.show = video_state.frames[2];
+    video_state.frame.serial = video_state.published;
+    video_state.frames[1]->serial = video_state.published;
+    video_state.frames[2]->serial = video_state.published;
+    video_state.taken = video_state.published;
+    video_state.pipelined = 1;
+    printf("[video] Pipelined frame handoff\n");
+    return 0;
+}
+
+int video_get_pipelined(void) {
+    return video_state.pipelined;
+}
+
+void video_publish(void) {
+    if (!video_state.pipelined) {
+        return;
+    }
+    video_frame_t *done = video_state.draw;
+    done->serial = ++video_state.published;
+
+    unsigned old = atomic_exchange(&video_state.middle, (unsigned)video_state.back | VIDEO_SLOT_FRESH);
+    video_state.back = (int)(old & 3u);
+
+    /* The presenter only reads published frames, so done can be copied
+     * from while it is shown */
+    video_frame_t *next = video_state.frames[video_state.back];
+    if (copy_frame(next, done) < 0) {
+        fprintf(stderr, "VIDEO: ERROR - Cannot allocate %dx render target\n", done->scale);
+    }
+    video_state.draw = next;
+}
+
+int video_acquire(void) {
+    if (!video_state.pipelined || !(atomic_load(&video_state.middle) & VIDEO_SLOT_FRESH)) {
+        return 0;
+    }
+    unsigned old = atomic_exchange(&video_state.middle, (unsigned)video_state.front);
+    video_state.front = (int)(old & 3u);
+    video_state.show = video_state.frames[video_state.front];
+    return 1;
+}
+
+/* Collect what changed in the show frame since the last present: palette
+ * and scanline flags and dirty rows. A pipelined frame is read only once;
+ * if frames were skipped their changes are lost, so everything is redone. */
+static void take_frame_changes(void) {
+    video_frame_t *f = video_state.show;
+    int pipelined = video_state.pipelined;
+
+    if (pipelined && f->serial == video_state.taken) {
+        return;
+    }
+    if (pipelined && f->serial != video_state.taken + 1) {
+        video_state.palette_dirty = 1;
+        video_state.palette_upload_pending = 1;
+        video_state.scanline_palette_dirty = 1;
+        video_state.presented_path = -1;
+        memset(video_state.dirty_rows, 1, sizeof(video_state.dirty_rows));
+        video_state.taken = f->serial;
+        return;
+    }
+    video_state.taken = f->serial;
+
+    if (f->palette_changed) {
+        video_state.palette_dirty = 1;
+        video_state.palette_upload_pending = 1;
+    }
+    if (f->scanlines_changed) {
+        video_state.scanline_palette_dirty = 1;
+    }
+    for (int r = 0; r < FB_ROWS; r++) {
+        video_state.dirty_rows[r] |= f->dirty_rows[r];
+    }
+    /* Unpipelined the frame is also the part's, clear it for the next one */
+    if (!pipelined) {
+        f->palette_changed = 0;
+        f->scanlines_changed = 0;
+        memset(f->dirty_rows, 0, sizeof(f->dirty_rows));
+    }
 }
 
 void video_set_mode(int mode) {
     if (mode == VIDEO_MODE_13H || mode == VIDEO_MODE_X) {
-        video_state.mode = mode;
+        video_state.draw->mode = mode;
     }
 }
 
 int video_get_mode(void) {
-    return video_state.mode;
+    return video_state.draw->mode;
+}
+
+void video_set_present_mode(int present_mode) {
+    if (present_mode == VIDEO_PRESENT_CPU || present_mode == VIDEO_PRESENT_GPU) {
+        video_state.present_mode = present_mode;
+        video_state.palette_upload_pending = 1;
+        video_state.raster_upload_pending = 1;
+    }
+}
+
+int video_get_present_mode(void) {
+    return video_state.present_mode;
+}
+
+void video_set_dirty_tracking(int dirty_mode) {
+    if (dirty_mode == VIDEO_DIRTY_OFF || dirty_mode == VIDEO_DIRTY_EXPLICIT ||
+        dirty_mode == VIDEO_DIRTY_DETECT) {
+        video_state.dirty_mode = dirty_mode;
+        video_state.presented_path = -1; /* Next frame is a full refresh */
+        if (dirty_mode == VIDEO_DIRTY_DETECT) {
+            memcpy(video_state.shadow, video_state.show->framebuffer, FB_SIZE);
+        }
+    }
+}
+
+int video_get_dirty_tracking(void) {
+    return video_state.dirty_mode;
+}
+
+void video_mark_dirty(int row, int count) {
+    int end = row + count;
+    if (row < 0) row = 0;
+    if (end > FB_ROWS) end = FB_ROWS;
+    if (row < end) {
+        memset(&video_state.draw->dirty_rows[row], 1, (size_t)(end - row));
+    }
 }
 
 uint8_t *video_get_framebuffer(void) {
-    return video_state.framebuffer;
+    return video_state.draw->framebuffer;
+}
+
+/* Round a requested scale down to a supported one within the limit */
+static int valid_scale(int scale, int limit) {
+    if (scale > limit) {
+        scale = limit;
+    }
+    return scale >= 4 ? 4 : scale >= 2 ? 2 : VIDEO_SCALE_NATIVE;
+}
+
+void video_set_max_scale(int scale) {
+    video_state.max_scale = valid_scale(scale, VIDEO_SCALE_MAX);
+    if (video_get_scale() > video_state.max_scale) {
+        video_set_scale(video_state.max_scale);
+    }
+}
+
+int video_get_max_scale(void) {
+    return video_state.max_scale ? video_state.max_scale : VIDEO_SCALE_NATIVE;
+}
+
+int video_set_scale(int scale) {
+    scale = valid_scale(scale, video_get_max_scale());
+    if (scale == video_get_scale()) {
+        return scale;
+    }
+
+    /* Native parts pay nothing: the buffer only lives while drawn into,
+     * and presentation drops its textures once a native frame is shown */
+    video_frame_t *f = video_state.draw;
+    free(f->hires);
+    f->hires = NULL;
+    f->scale = VIDEO_SCALE_NATIVE;
+
+    if (scale > VIDEO_SCALE_NATIVE) {
+        size_t pixels = (size_t)VIDEO_WIDTH * VIDEO_HEIGHT_X * (size_t)(scale * scale);
+        f->hires = calloc(pixels, 1);
+        if (!f->hires) {
+            fprintf(stderr, "VIDEO: ERROR - Cannot allocate %dx render target\n", scale);
+            return VIDEO_SCALE_NATIVE;
+        }
+        f->scale = scale;
+    }
+    printf("[video] Render scale %dx\n", f->scale);
+    return f->scale;
+}
+
+int video_get_scale(void) {
+    return video_state.draw->scale ? video_state.draw->scale : VIDEO_SCALE_NATIVE;
+}
+
+uint8_t *video_get_hires_framebuffer(void) {
+    return video_state.draw->hires;
 }
 
 void video_clear(uint8_t color) {
-    memset(video_state.framebuffer, color, FB_SIZE);
+    video_frame_t *f = video_state.draw;
+    memset(f->framebuffer, color, FB_SIZE);
+    video_mark_dirty(0, FB_ROWS);
+    if (f->hires) {
+        memset(f->hires, color, (size_t)VIDEO_WIDTH * VIDEO_HEIGHT_X * (size_t)(f->scale * f->scale));
+    }
 }
 
 void video_set_palette(const uint8_t palette[768]) {
     if (!palette) {
         return;
     }
-    memcpy(video_state.palette, palette, 768);
-    video_state.palette_dirty = 1;
+    memcpy(video_state.draw->palette, palette, 768);
+    video_state.draw->palette_changed = 1;
 }
 
 void video_set_palette_range(uint8_t start, uint8_t count, const uint8_t *data) {
@@ -316,71 +1075,385 @@ void video_set_palette_range(uint8_t start, uint8_t count, const uint8_t *data)
     if (end > 256) {
         count = (uint8_t)(256 - start);
     }
-    memcpy(&video_state.palette[start * 3], data, count * 3);
-    video_state.palette_dirty = 1;
+    memcpy(&video_state.draw->palette[start * 3], data, count * 3);
+    video_state.draw->palette_changed = 1;
 }
 
 void video_set_color(uint8_t index, uint8_t r, uint8_t g, uint8_t b) {
-    video_state.palette[index * 3 + 0] = r;
-    video_state.palette[index * 3 + 1] = g;
-    video_state.palette[index * 3 + 2] = b;
-    video_state.palette_dirty = 1;
+    uint8_t *rgb = &video_state.draw->palette[index * 3];
+    rgb[0] = r;
+    rgb[1] = g;
+    rgb[2] = b;
+    video_state.draw->palette_changed = 1;
 }
 
 void video_get_palette(uint8_t palette[768]) {
     if (!palette) {
         return;
     }
-    memcpy(palette, video_state.palette, 768);
+    memcpy(palette, video_state.draw->palette, 768);
 }
 
-void video_set_start(uint16_t offset) {
-    /* Clamp to valid framebuffer range to prevent buffer over-read.
-     * Mode X uses the full buffer (no page flipping possible).
-     * Mode 13h can offset up to 64000 bytes (one screen size). */
-    int max_offset = (video_state.mode == VIDEO_MODE_X)
-                     ? 0
-                     : (FB_SIZE - (VIDEO_WIDTH * VIDEO_HEIGHT_13H));
-    if (offset > max_offset) {
-        offset = (uint16_t)max_offset;
+void video_get_visible_palette(uint8_t palette[768]) {
+    if (!palette) {
+        return;
     }
-    video_state.start_offset = offset;
+    memcpy(palette, video_state.show->palette, 768);
+}
+
+int video_set_start(uint32_t offset) {
+    /* Flipping only moves the source pointer; nothing is copied. A page
+     * running off the end (or a later mode change) is still clamped
+     * against the framebuffer when the frame is presented. */
+    if (!start_in_memory(video_state.draw, offset)) {
+        return -1;
+    }
+    video_state.draw->start_offset = offset;
+    return 0;
 }
 
 void video_set_hscroll(uint8_t pixels) {
-    video_state.hscroll = pixels;
+    /* Pixel panning shifts the source pointer by 0-3 pixels, pulling the
+     * next line's first pixels in at the right edge like the VGA does */
+    video_state.draw->hscroll = pixels & 3;
 }
 
-void video_present(void) {
-    if (!video_state.initialized) {
-        return;
+void video_clear_scanlines(void) {
+    video_frame_t *f = video_state.draw;
+    for (int y = 0; y < VIDEO_HEIGHT_X; y++) {
+        f->scanline_start[y] = -1;
+        f->scanline_hscroll[y] = -1;
+    }
+    f->scanline_palette_count = 0;
+    f->scanline_active = 0;
+    f->scanlines_changed = 1;
+}
+
+int video_set_scanline_start(int line, uint32_t offset) {
+    if (line < 0 || line >= VIDEO_HEIGHT_X || !start_in_memory(video_state.draw, offset)) {
+        return -1;
+    }
+    video_state.draw->scanline_start[line] = (int32_t)offset;
+    video_state.draw->scanline_active = 1;
+    return 0;
+}
+
+int video_set_scanline_hscroll(int line, uint8_t pixels) {
+    if (line < 0 || line >= VIDEO_HEIGHT_X) {
+        return -1;
+    }
+    video_state.draw->scanline_hscroll[line] = (int16_t)(pixels & 3);
+    video_state.draw->scanline_active = 1;
+    return 0;
+}
+
+int video_set_scanline_palette_range(int line, uint8_t start, int count, const uint8_t *data) {
+    if (line < 0 || line >= VIDEO_HEIGHT_X || !data || count <= 0) {
+        return -1;
+    }
+    video_frame_t *f = video_state.draw;
+    if ((int)start + count > 256) {
+        count = 256 - start;
     }
 
-    /* Rebuild LUT if palette changed */
+    /* Same line and range: replace it, as parts re-set patches each frame */
+    for (int i = 0; i < f->scanline_palette_count; i++) {
+        video_scanline_palette_t *patch = &f->scanline_palette[i];
+        if (patch->line == line && patch->start == start && patch->count == count) {
+            if (memcmp(patch->data, data, (size_t)count * 3) != 0) {
+                memcpy(patch->data, data, (size_t)count * 3);
+                f->scanlines_changed = 1;
+            }
+            return 0;
+        }
+    }
+    if (f->scanline_palette_count >= VIDEO_SCANLINE_MAX_PALETTES) {
+        return -1;
+    }
+
+    /* Keep patches sorted by line; equal lines keep call order */
+    int pos = f->scanline_palette_count;
+    while (pos > 0 && f->scanline_palette[pos - 1].line > line) {
+        f->scanline_palette[pos] = f->scanline_palette[pos - 1];
+        pos--;
+    }
+    video_scanline_palette_t *patch = &f->scanline_palette[pos];
+    patch->line = line;
+    patch->start = start;
+    patch->count = count;
+    memcpy(patch->data, data, (size_t)count * 3);
+
+    f->scanline_palette_count++;
+    f->scanlines_changed = 1;
+    return 0;
+}
+
+/* sg_update_image() wrapped in the upload profiling zone */
+static void update_image(sg_image image, const sg_image_data *data) {
+    PROFILE_BEGIN(PROFILE_ZONE_UPLOAD);
+    sg_update_image(image, data);
+    PROFILE_END(PROFILE_ZONE_UPLOAD);
+}
+
+/* Upload the per-line table for the GPU path if it changed.
+ * @param linear Lines are contiguous and offsets are relative to the visible window */
+static void upload_line_table(int linear) {
+    int mode = video_state.show->mode;
+    int height = mode_height(mode);
+    uint32_t base = linear ? video_state.line_offset[0] : 0;
+    int changed = !video_state.line_table_valid[mode];
+
+    for (int y = 0; y < height; y++) {
+        /* Little-endian RGBA8: RGB = 24-bit offset, A = palette row */
+        uint32_t entry = (video_state.line_offset[y] - base) |
+                         ((uint32_t)video_state.line_palette[y] << 24);
+        if (video_state.line_table[y] != entry) {
+            video_state.line_table[y] = entry;
+            changed = 1;
+        }
+    }
+    if (changed) {
+        update_image(video_state.lines_image[mode], &(sg_image_data){
+            .mip_levels[0] = {
+                .ptr = video_state.line_table,
+                .size = (size_t)height * sizeof(uint32_t)
+            }
+        });
+        /* The table is shared between modes, force a check after a mode switch */
+        for (int m = 0; m < VIDEO_MODE_COUNT; m++) {
+            video_state.line_table_valid[m] = (m == mode);
+        }
+    }
+}
+
+/* Upload the GPU palette texture if the palette changed. The RGBA LUT
+ * doubles as the 256x1 palette texture (1KB). */
+static void upload_palette(void) {
+    if (video_state.palette_upload_pending) {
+        update_image(video_state.palette_image, &(sg_image_data){
+            .mip_levels[0] = {
+                .ptr = video_state.lut.rgba,
+                .size = sizeof(video_state.lut.rgba)
+            }
+        });
+        video_state.palette_upload_pending = 0;
+    }
+}
+
+/* Create the hi-res textures for a width x height frame, replacing any
+ * made for another scale or mode. The GPU line table is linear.
+ * @return 1 on success, 0 on failure */
+static int make_hires_textures(int width, int height) {
+    if (video_state.hires_width == width && video_state.hires_height == height) {
+        return 1;
+    }
+    destroy_hires_textures();
+    if (!make_texture(width, height, SG_PIXELFORMAT_RGBA8, 1, "video_hires",
+                      &video_state.hires_image, &video_state.hires_view) ||
+        !make_texture(width, height, SG_PIXELFORMAT_R8, 1, "video_hires_index",
+                      &video_state.hires_index_image, &video_state.hires_index_view) ||
+        !make_texture(height, 1, SG_PIXELFORMAT_RGBA8, 0, "video_hires_lines",
+                      &video_state.hires_lines_image, &video_state.hires_lines_view)) {
+        destroy_hires_textures();
+        return 0;
+    }
+    video_state.hires_rgba = malloc((size_t)width * height * sizeof(uint32_t));
+    if (!video_state.hires_rgba) {
+        destroy_hires_textures();
+        return 0;
+    }
+
+    for (int y = 0; y < height; y++) {
+        video_state.hires_lines[y] = (uint32_t)(y * width);
+    }
+    update_image(video_state.hires_lines_image, &(sg_image_data){
+        .mip_levels[0] = {
+            .ptr = video_state.hires_lines,
+            .size = (size_t)height * sizeof(uint32_t)
+        }
+    });
+    video_state.hires_width = width;
+    video_state.hires_height = height;
+    return 1;
+}
+
+/* Upload the hi-res framebuffer: always a full frame, no raster effects.
+ * @param view Receives the view to bind for the fullscreen draw
+ * @return 1 on success, 0 if the textures could not be made */
+static int upload_hires(sg_view *view) {
+    const video_frame_t *f = video_state.show;
+    int width = VIDEO_WIDTH * f->scale;
+    int height = mode_height(f->mode) * f->scale;
+
+    if (!make_hires_textures(width, height)) {
+        return 0;
+    }
     if (video_state.palette_dirty) {
         rebuild_rgba_lut();
     }
+    memset(video_state.dirty_rows, 0, sizeof(video_state.dirty_rows));
 
-    /* Convert indexed framebuffer to RGBA */
-    convert_framebuffer_to_rgba();
-
-    /* Calculate actual height based on mode */
-    int height = (video_state.mode == VIDEO_MODE_X) ? VIDEO_HEIGHT_X : VIDEO_HEIGHT_13H;
+    if (video_state.present_mode == VIDEO_PRESENT_GPU) {
+        upload_palette();
+        update_image(video_state.hires_index_image, &(sg_image_data){
+            .mip_levels[0] = { .ptr = f->hires, .size = (size_t)width * height }
+        });
+        video_state.drawn_lines_view = video_state.hires_lines_view;
+        *view = video_state.hires_index_view;
+        return 1;
+    }
 
-    /* Update texture with RGBA data */
-    sg_update_image(video_state.image, &(sg_image_data){
+    PROFILE_BEGIN(PROFILE_ZONE_CONVERT);
+    video_convert(video_state.hires_rgba, f->hires, width * height, &video_state.lut);
+    PROFILE_END(PROFILE_ZONE_CONVERT);
+    update_image(video_state.hires_image, &(sg_image_data){
         .mip_levels[0] = {
-            .ptr = video_state.rgba_staging,
-            .size = VIDEO_WIDTH * height * sizeof(uint32_t)
+            .ptr = video_state.hires_rgba,
+            .size = (size_t)width * height * sizeof(uint32_t)
         }
     });
+    *view = video_state.hires_view;
+    return 1;
+}
 
+/* Upload the framebuffer for the current present mode.
+ * @return View to bind for the fullscreen draw */
+static sg_view upload_frame(void) {
+    const video_frame_t *f = video_state.show;
+    take_frame_changes();
+
+    /* Scale switches refresh fully; textures for a scale no longer shown go */
+    if (f->scale != video_state.presented_scale) {
+        if (f->scale == VIDEO_SCALE_NATIVE) {
+            destroy_hires_textures();
+        }
+        video_state.presented_scale = f->scale;
+        video_state.presented_path = -1;
+    }
+    if (f->scale > VIDEO_SCALE_NATIVE) {
+        sg_view view;
+        if (upload_hires(&view)) {
+            return view;
+        }
+        fprintf(stderr, "VIDEO: ERROR - Cannot create %dx textures, rendering native\n", f->scale);
+        /* The draw frame is the part's while pipelined; it keeps its scale */
+        if (!video_state.pipelined) {
+            video_set_scale(VIDEO_SCALE_NATIVE);
+        }
+        video_state.presented_scale = VIDEO_SCALE_NATIVE;
+    }
+
+    int mode = f->mode;
+    int height = mode_height(mode);
+    int lut_changed = video_state.palette_dirty || video_state.scanline_palette_dirty;
+
+    /* Rebuild LUTs if the palette or raster patches changed */
+    if (video_state.palette_dirty) {
+        rebuild_rgba_lut();
+    }
+    if (video_state.scanline_palette_dirty) {
+        rebuild_raster_luts();
+    }
+
+    int linear = resolve_lines(f, video_state.line_offset, video_state.line_palette);
+
+    /* Decide between a full refresh and a dirty-rows-only update */
+    int full = 1;
+    if (video_state.dirty_mode != VIDEO_DIRTY_OFF) {
+        if (video_state.dirty_mode == VIDEO_DIRTY_DETECT) {
+            detect_dirty_rows();
+        }
+        full = !layout_unchanged();
+        /* Palette changes recolor every pixel in the CPU path */
+        if (video_state.present_mode == VIDEO_PRESENT_CPU && lut_changed) {
+            full = 1;
+        }
+    } else {
+        video_state.presented_path = -1;
+    }
+
+    if (video_state.present_mode == VIDEO_PRESENT_GPU) {
+        upload_palette();
+        if (video_state.raster_upload_pending) {
+            for (int r = 0; r < video_state.raster_lut_count; r++) {
+                memcpy(video_state.raster_rgba[r], video_state.raster_lut[r].rgba,
+                       sizeof(video_state.raster_rgba[r]));
+            }
+            update_image(video_state.raster_palette_image, &(sg_image_data){
+                .mip_levels[0] = {
+                    .ptr = video_state.raster_rgba,
+                    .size = sizeof(video_state.raster_rgba)
+                }
+            });
+            video_state.raster_upload_pending = 0;
+        }
+        upload_line_table(linear);
+        video_state.drawn_lines_view = video_state.lines_view[mode];
+
+        int dirty = full;
+        for (int y = 0; y < height && !dirty; y++) {
+            dirty = line_is_dirty(y);
+        }
+        memset(video_state.dirty_rows, 0, sizeof(video_state.dirty_rows));
+        if (!dirty) {
+            return video_state.presented_view; /* Index texture is current */
+        }
+
+        if (linear) {
+            /* Upload raw indices straight from the framebuffer, no conversion.
+             * Page flips and fine scroll just move the source pointer. */
+            update_image(video_state.index_image[mode], &(sg_image_data){
+                .mip_levels[0] = {
+                    .ptr = f->framebuffer + video_state.line_offset[0],
+                    .size = (size_t)(VIDEO_WIDTH * height)
+                }
+            });
+            video_state.presented_view = video_state.index_view[mode];
+            return video_state.presented_view;
+        }
+
+        /* Raster effects can address any line: upload the whole framebuffer */
+        update_image(video_state.memory_image, &(sg_image_data){
+            .mip_levels[0] = { .ptr = f->framebuffer, .size = FB_SIZE }
+        });
+        video_state.presented_view = video_state.memory_view;
+        return video_state.presented_view;
+    }
+
+    /* Convert indexed framebuffer to RGBA */
+    PROFILE_BEGIN(PROFILE_ZONE_CONVERT);
+    int converted = convert_framebuffer_to_rgba(linear, full);
+    PROFILE_END(PROFILE_ZONE_CONVERT);
+    memset(video_state.dirty_rows, 0, sizeof(video_state.dirty_rows));
+
+    /* Update texture with RGBA data. sokol replaces whole images, so a
+     * partial frame still uploads the full staging buffer; clean frames
+     * skip the upload entirely. */
+    if (converted > 0) {
+        update_image(video_state.image[mode], &(sg_image_data){
+            .mip_levels[0] = {
+                .ptr = video_state.rgba_staging,
+                .size = VIDEO_WIDTH * height * sizeof(uint32_t)
+            }
+        });
+    }
+    return video_state.texture_view[mode];
+}
+
+/* Draw a frame texture letterboxed to the window */
+static void draw_frame(sg_view frame_view) {
     /* Calculate letterbox viewport for 4:3 display aspect ratio.
      * VGA Mode 13h (320x200) and Mode X (320x400) were displayed on 4:3 CRT
      * monitors with non-square pixels. We use a fixed 4:3 ratio to match
      * the authentic VGA display appearance. */
+#if defined(SR_HEADLESS)
+    /* No window: the offscreen target matches the display aspect */
+    int win_width = VIDEO_WIDTH * 2;
+    int win_height = VIDEO_WIDTH * 3 / 2;
+#else
     int win_width = sapp_width();
     int win_height = sapp_height();
+#endif
 
     /* Fixed 4:3 aspect ratio for authentic VGA display */
     float target_aspect = 4.0f / 3.0f;
@@ -403,10 +1476,140 @@ void video_present(void) {
 
     /* Apply viewport and draw fullscreen triangle */
     sg_apply_viewport(vp_x, vp_y, vp_w, vp_h, true);
-    sg_apply_pipeline(video_state.pipeline);
-    sg_apply_bindings(&(sg_bindings){
-        .views[0] = video_state.texture_view,
-        .samplers[0] = video_state.sampler
-    });
+    if (video_state.present_mode == VIDEO_PRESENT_GPU) {
+        sg_apply_pipeline(video_state.palette_pipeline);
+        sg_apply_bindings(&(sg_bindings){
+            .views[0] = frame_view,
+            .views[1] = video_state.palette_view,
+            .views[2] = video_state.drawn_lines_view,
+            .views[3] = video_state.raster_palette_view,
+            .samplers[0] = video_state.sampler
+        });
+    } else {
+        sg_apply_pipeline(video_state.pipeline);
+        sg_apply_bindings(&(sg_bindings){
+            .views[0] = frame_view,
+            .samplers[0] = video_state.sampler
+        });
+    }
     sg_draw(0, 3, 1);
 }
+
+void video_present(void) {
+    if (!video_state.initialized) {
+        return;
+    }
+    /* A scale switch (re)makes textures; only steady frames are checked */
+    FRAMECHECK_BEGIN(video_state.show->scale == video_state.presented_scale ?
+                     FRAMECHECK_PRESENT : FRAMECHECK_NONE);
+    video_state.drawn_view = upload_frame();
+    draw_frame(video_state.drawn_view);
+    FRAMECHECK_END();
+}
+
+void video_redraw(void) {
+    if (!video_state.initialized) {
+        return;
+    }
+    if (video_state.drawn_view.id == 0) {
+        video_present();
+        return;
+    }
+    draw_frame(video_state.drawn_view);
+}
+
+void video_upscale_native(void) {
+    const video_frame_t *f = video_state.draw;
+    int scale = f->scale;
+    int width = VIDEO_WIDTH * scale;
+    uint32_t line_offset[VIDEO_HEIGHT_X];
+    uint8_t line_palette[VIDEO_HEIGHT_X];
+    if (scale <= VIDEO_SCALE_NATIVE) {
+        return;
+    }
+
+    /* Expand each visible line once, then copy it down the block */
+    resolve_lines(f, line_offset, line_palette);
+    for (int y = 0; y < mode_height(f->mode); y++) {
+        const uint8_t *src = f->framebuffer + line_offset[y];
+        uint8_t *dst = f->hires + (size_t)y * scale * width;
+        if (scale == 2) {
+            for (int x = 0; x < VIDEO_WIDTH; x++) {
+                uint16_t pair = (uint16_t)(src[x] * 0x0101u);
+                memcpy(dst + x * 2, &pair, 2);
+            }
+        } else {
+            for (int x = 0; x < VIDEO_WIDTH; x++) {
+                uint32_t quad = src[x] * 0x01010101u;
+                memcpy(dst + x * 4, &quad, 4);
+            }
+        }
+        for (int r = 1; r < scale; r++) {
+            memcpy(dst + (size_t)r * width, dst, (size_t)width);
+        }
+    }
+}
+
+const uint8_t *video_get_visible(int *height) {
+    const video_frame_t *f = video_state.show;
+    int lines = mode_height(f->mode);
+    if (height) {
+        *height = lines;
+    }
+
+    if (f->scale > VIDEO_SCALE_NATIVE) {
+        /* Point-sample the hi-res frame down to native size */
+        int scale = f->scale;
+        for (int y = 0; y < lines; y++) {
+            const uint8_t *src = f->hires + (size_t)y * scale * VIDEO_WIDTH * scale;
+            uint8_t *dst = video_state.visible + y * VIDEO_WIDTH;
+            for (int x = 0; x < VIDEO_WIDTH; x++) {
+                dst[x] = src[x * scale];
+            }
+        }
+        return video_state.visible;
+    }
+
+    if (resolve_lines(f, video_state.line_offset, video_state.line_palette)) {
+        return f->framebuffer + video_state.line_offset[0];
+    }
+    for (int y = 0; y < lines; y++) {
+        memcpy(video_state.visible + y * VIDEO_WIDTH, f->framebuffer + video_state.line_offset[y],
+               VIDEO_WIDTH);
+    }
+    return video_state.visible;
+}
+
+const uint8_t *video_get_visible_full(int *width, int *height) {
+    const video_frame_t *f = video_state.show;
+    if (f->scale <= VIDEO_SCALE_NATIVE) {
+        if (width) {
+            *width = VIDEO_WIDTH;
+        }
+        return video_get_visible(height);
+    }
+    if (width) {
+        *width = VIDEO_WIDTH * f->scale;
+    }
+    if (height) {
+        *height = mode_height(f->mode) * f->scale;
+    }
+    return f->hires;
+}
+
+int video_get_visible_palette_patch(int index, video_palette_patch_t *patch) {
+    const video_frame_t *f = video_state.show;
+    if (index < 0 || index >= f->scanline_palette_count || !patch) {
+        return -1;
+    }
+    const video_scanline_palette_t *p = &f->scanline_palette[index];
+    patch->line = p->line;
+    patch->start = p->start;
+    patch->count = p->count;
+    patch->data = p->data;
+    return 0;
+}
+
+const char *video_get_convert_kernel(void) {
+    return video_convert_name();
+}
@@ -3,7 +3,16 @@
  *
  * Provides Mode 13h (320x200) and Mode X (320x400) framebuffers
  * with 256-color palette support. Converts indexed color to RGBA
- * and uploads to GPU texture for display.
+ * and uploads to GPU texture for display, or uploads the indexed
+ * pixels directly and performs the palette lookup on the GPU.
+ *
+ * Drawing calls (framebuffer, palette, start, scanline table, scale) go
+ * to the draw frame; video_present() and video_get_visible() read the
+ * show frame. Normally they are one frame. With video_set_pipelined()
+ * a render thread draws while the main thread presents: finished frames
+ * are handed over with video_publish() and video_acquire() through a
+ * lock-free triple buffer, and every drawing call belongs to the render
+ * thread and every presenting call to the main thread.
  */
 
 #ifndef VIDEO_H
@@ -15,11 +24,33 @@
 #define VIDEO_MODE_13H      0   /* 320x200, standard VGA */
 #define VIDEO_MODE_X        1   /* 320x400, Mode X tweaked */
 
+/* Presentation modes */
+#define VIDEO_PRESENT_CPU   0   /* Expand to RGBA on CPU, upload 4 bytes/pixel */
+#define VIDEO_PRESENT_GPU   1   /* Upload R8 indices + 256x1 palette, lookup in shader */
+
+/* Dirty-row tracking modes */
+#define VIDEO_DIRTY_OFF      0  /* Convert and upload every frame (default) */
+#define VIDEO_DIRTY_EXPLICIT 1  /* Only rows passed to video_mark_dirty() */
+#define VIDEO_DIRTY_DETECT   2  /* Rows that differ from the last presented frame */
+
 /* Resolution constants */
 #define VIDEO_WIDTH         320
 #define VIDEO_HEIGHT_13H    200
 #define VIDEO_HEIGHT_X      400
 
+/* Video memory, 256000 bytes: two 320x400 Mode X pages or four 320x200
+ * Mode 13h pages, i.e. 800 lines of VIDEO_WIDTH bytes */
+#define VIDEO_MEMORY_SIZE   (VIDEO_WIDTH * VIDEO_HEIGHT_X * 2)
+#define VIDEO_PAGE_SIZE_X   (VIDEO_WIDTH * VIDEO_HEIGHT_X / 4)  /* Start units per Mode X page */
+#define VIDEO_PAGE_SIZE_13H (VIDEO_WIDTH * VIDEO_HEIGHT_13H)     /* Start units per Mode 13h page */
+
+/* Maximum distinct palette patches (line, start, count) in the scanline table */
+#define VIDEO_SCANLINE_MAX_PALETTES 16
+
+/* Render scales: integer multiples of the native resolution */
+#define VIDEO_SCALE_NATIVE  1
+#define VIDEO_SCALE_MAX     4   /* 1280x800 (13h) or 1280x1600 (Mode X) */
+
 /**
  * Initialize the video subsystem.
  * Must be called after sg_setup().
@@ -44,13 +75,105 @@ void video_set_mode(int mode);
  */
 int video_get_mode(void);
 
+/**
+ * Set the presentation mode.
+ * VIDEO_PRESENT_GPU uploads 1 byte per pixel and only re-uploads the
+ * 1KB palette texture when the palette changes.
+ * @param present_mode VIDEO_PRESENT_CPU or VIDEO_PRESENT_GPU
+ */
+void video_set_present_mode(int present_mode);
+
+/**
+ * Get the current presentation mode.
+ * @return VIDEO_PRESENT_CPU or VIDEO_PRESENT_GPU
+ */
+int video_get_present_mode(void);
+
+/**
+ * Set dirty-row tracking for framebuffer uploads.
+ * With tracking on, video_present() only converts display lines whose
+ * framebuffer rows changed and skips the upload when nothing changed.
+ * Palette, mode, start offset and scanline table changes still force a
+ * full refresh (palette changes only in VIDEO_PRESENT_CPU).
+ * @param dirty_mode VIDEO_DIRTY_OFF, VIDEO_DIRTY_EXPLICIT or VIDEO_DIRTY_DETECT
+ */
+void video_set_dirty_tracking(int dirty_mode);
+
+/**
+ * Get the current dirty-row tracking mode.
+ * @return VIDEO_DIRTY_OFF, VIDEO_DIRTY_EXPLICIT or VIDEO_DIRTY_DETECT
+ */
+int video_get_dirty_tracking(void);
+
+/**
+ * Mark framebuffer rows as changed for VIDEO_DIRTY_EXPLICIT.
+ * Rows are VIDEO_WIDTH-byte lines of the framebuffer memory, not display
+ * lines, so page-flipped parts mark the page they drew into.
+ * @param row First framebuffer row
+ * @param count Number of rows (clamped to the framebuffer)
+ */
+void video_mark_dirty(int row, int count);
+
 /**
  * Get pointer to the framebuffer.
- * Size is VIDEO_WIDTH * VIDEO_HEIGHT_X (128KB) for Mode X compatibility.
+ * Size is VIDEO_MEMORY_SIZE (256000 bytes), laid out linearly as
+ * VIDEO_HEIGHT_X * 2 lines of VIDEO_WIDTH bytes. The visible page starts
+ * at the video_set_start() offset.
+ * While pipelined the buffer changes at every video_publish(), so fetch it
+ * each frame rather than keeping the pointer.
  * @return Pointer to indexed color framebuffer
  */
 uint8_t *video_get_framebuffer(void);
 
+/**
+ * Set the highest render scale this run may use (deployment setting).
+ * Parts get at most this scale from video_set_scale(). Lowering it below
+ * the current scale drops back to native resolution.
+ * @param scale 1, 2 or 4 (VIDEO_SCALE_NATIVE..VIDEO_SCALE_MAX)
+ */
+void video_set_max_scale(int scale);
+
+/**
+ * Get the highest render scale this run may use.
+ * @return 1, 2 or 4
+ */
+int video_get_max_scale(void);
+
+/**
+ * Switch the frame the display shows between the native framebuffer and a
+ * supersampled one. Above 1, video_present() shows the hi-res buffer
+ * instead of video memory: one page, base palette only, no start offset,
+ * hscroll or scanline table. Memory for it is reserved on the first
+ * switch up and released on the switch back to native.
+ * The part loader applies sr_part_t.max_scale at every part start.
+ * @param scale Requested scale, clamped to video_get_max_scale() and
+ *              rounded down to 1, 2 or 4
+ * @return Scale in effect (1 if the buffer could not be allocated)
+ */
+int video_set_scale(int scale);
+
+/**
+ * Get the render scale in effect.
+ * @return 1 (native), 2 or 4
+ */
+int video_get_scale(void);
+
+/**
+ * Get the supersampled framebuffer.
+ * Holds VIDEO_HEIGHT_X * scale lines of VIDEO_WIDTH * scale bytes; the top
+ * mode height * scale lines are shown. Cleared with video_clear().
+ * @return Hi-res indexed pixels, NULL at scale 1
+ */
+uint8_t *video_get_hires_framebuffer(void);
+
+/**
+ * Integer-upscale the visible native page into the hi-res framebuffer,
+ * each pixel becoming a scale x scale block. Lets a part mix 2D bitmap
+ * layers drawn at native resolution with hi-res 3D drawn on top.
+ * No-op at scale 1.
+ */
+void video_upscale_native(void);
+
 /**
  * Clear the framebuffer with a color index.
  * @param color Palette index (0-255)
@@ -86,22 +209,171 @@ void video_set_color(uint8_t index, uint8_t r, uint8_t g, uint8_t b);
  */
 void video_get_palette(uint8_t palette[768]);
 
+/**
+ * Get the palette of the frame video_get_visible() returns. Same as
+ * video_get_palette() unless pipelined.
+ * @param palette Output buffer for 768 bytes
+ */
+void video_get_visible_palette(uint8_t palette[768]);
+
 /**
  * Set display start offset for page flipping.
- * @param offset Byte offset into framebuffer
+ * Units follow the VGA CRTC start address: bytes in Mode 13h, 4-pixel
+ * planar groups in Mode X (page 1 starts at VIDEO_PAGE_SIZE_X).
+ * Wider than the VGA's 16-bit register so that all four Mode 13h pages
+ * (page n starts at n * VIDEO_PAGE_SIZE_13H) can be shown.
+ * Flipping moves the source pointer only; no pixels are copied.
+ * @param offset Start address in CRTC units
+ * @return 0 on success, -1 if offset lies past video memory in the
+ *         current mode (the start is left unchanged)
  */
-void video_set_start(uint16_t offset);
+int video_set_start(uint32_t offset);
 
 /**
- * Set horizontal scroll offset for fine scrolling.
- * @param pixels Pixel offset (0-3 for Mode X)
+ * Set horizontal scroll offset for fine scrolling (pixel panning).
+ * Shifts the display left by 0-3 pixels; the rightmost pixels of each
+ * line come from the start of the next line, as on the VGA.
+ * @param pixels Pixel offset (0-3)
  */
 void video_set_hscroll(uint8_t pixels);
 
 /**
- * Convert framebuffer to RGBA, upload to GPU, and draw fullscreen triangle.
+ * Clear the scanline table.
+ * Removes all per-line start, hscroll and palette entries.
+ */
+void video_clear_scanlines(void);
+
+/**
+ * Restart the display at a new start offset from a scanline on.
+ * Line `line` shows the framebuffer at `offset`, following lines continue
+ * from there (split screen). Entries persist until video_clear_scanlines().
+ * @param line Display line (0 = top)
+ * @param offset Start address, same units as video_set_start()
+ * @return 0 on success, -1 if line is out of range or offset lies past
+ *         video memory in the current mode
+ */
+int video_set_scanline_start(int line, uint32_t offset);
+
+/**
+ * Change horizontal fine scroll from a scanline to the end of the frame.
+ * @param line Display line (0 = top)
+ * @param pixels Pixel offset (0-3)
+ * @return 0 on success, -1 if line is out of range
+ */
+int video_set_scanline_hscroll(int line, uint8_t pixels);
+
+/**
+ * Change palette entries from a scanline to the end of the frame.
+ * Patches accumulate, so a patch at line 100 sees the one at line 50.
+ * The frame always starts with the palette set by video_set_palette().
+ * Like the other entries, patches persist into later frames until
+ * video_clear_scanlines(); setting one again with the same line, start
+ * and count replaces it, so a part can re-set its patches every frame.
+ * @param line Display line (0 = top)
+ * @param start Starting palette index
+ * @param count Number of colors
+ * @param data RGB data (count * 3 bytes), each component 0-63
+ * @return 0 on success, -1 on invalid arguments or if
+ *         VIDEO_SCANLINE_MAX_PALETTES patches are already set
+ */
+int video_set_scanline_palette_range(int line, uint8_t start, int count, const uint8_t *data);
+
+/**
+ * Hand frames from a render thread to the presenting thread.
+ * Enabled, the draw frame gets two companions: video_publish() passes a
+ * finished frame on and starts the next one as a copy of it, so parts
+ * still see persistent video memory, palette and scanline table, and
+ * video_acquire() picks the newest finished frame for presentation.
+ * Frames published faster than they are acquired are skipped and the next
+ * acquired one is a full refresh. Switch only while no render thread runs.
+ * @param enabled 1 to pipeline, 0 to draw and present one frame again
+ * @return 0 on success, -1 if the frames could not be allocated
+ */
+int video_set_pipelined(int enabled);
+
+/**
+ * Check if frames are pipelined.
+ * @return 1 after a successful video_set_pipelined(1), 0 otherwise
+ */
+int video_get_pipelined(void);
+
+/**
+ * Publish the finished draw frame (render thread, once per frame).
+ * Drawing continues in a copy of it. No-op unless pipelined.
+ */
+void video_publish(void);
+
+/**
+ * Make the newest published frame the one presented (main thread).
+ * @return 1 if a new frame was acquired, 0 if none was published since
+ *         the last call or not pipelined
+ */
+int video_acquire(void);
+
+/**
+ * Upload the framebuffer to the GPU (RGBA or indexed, depending on the
+ * presentation mode) and draw a fullscreen triangle. Above scale 1 the
+ * hi-res framebuffer is uploaded as is and every frame is a full refresh.
  * Call between sg_begin_pass() and sg_end_pass().
  */
 void video_present(void);
 
+/**
+ * Draw the last presented frame again without converting or uploading,
+ * for display frames in which no retrace elapsed.
+ * Call between sg_begin_pass() and sg_end_pass().
+ */
+void video_redraw(void);
+
+/**
+ * Get the visible frame as the display would scan it out, on the CPU.
+ * Applies the start offset, hscroll and scanline start/hscroll entries;
+ * scanline palette patches are not applied (see video_get_palette()).
+ * A linear layout returns a pointer into video memory without copying,
+ * otherwise lines are gathered into an internal buffer.
+ * Above scale 1 the hi-res frame is point-sampled down to native size
+ * (the top-left pixel of each block); video_get_visible_full() returns
+ * every pixel, as headless frame sinks get it.
+ * Valid until the next video call.
+ * @param height Receives the number of visible lines (may be NULL)
+ * @return VIDEO_WIDTH * height indexed pixels
+ */
+const uint8_t *video_get_visible(int *height);
+
+/**
+ * Get the visible frame at the resolution it was rendered at.
+ * At scale 1 the same as video_get_visible(); above it the shown lines of
+ * the hi-res framebuffer, VIDEO_WIDTH * scale pixels each, without
+ * copying. Valid until the next video call.
+ * @param width Receives the pixels per line (may be NULL)
+ * @param height Receives the number of visible lines (may be NULL)
+ * @return width * height indexed pixels
+ */
+const uint8_t *video_get_visible_full(int *width, int *height);
+
+/**
+ * Scanline palette patch, as video_set_scanline_palette_range() set it
+ */
+typedef struct {
+    int line;               /* Display line (0 = top) */
+    int start;              /* Starting palette index */
+    int count;              /* Number of colors */
+    const uint8_t *data;    /* count * 3 bytes, each component 0-63 */
+} video_palette_patch_t;
+
+/**
+ * Get a scanline palette patch of the frame video_get_visible() returns.
+ * @param index Patch index, in line order
+ * @param patch Receives the patch; data is valid until the next video call
+ * @return 0 on success, -1 past the last patch
+ */
+int video_get_visible_palette_patch(int index, video_palette_patch_t *patch);
+
+/**
+ * Get the name of the indexed-to-RGBA conversion kernel in use.
+ * Selected at video_init() from the SIMD paths this build and CPU support.
+ * @return "scalar", "avx2", "neon" or "simd128"
+ */
+const char *video_get_convert_kernel(void);
+
 #endif /* VIDEO_H */
@@ -0,0 +1,247 @@
+/**
+ * Video Conversion Kernels - Implementation
+ *
+ * The scalar loop is the reference. SIMD kernels are compiled in when
+ * the target supports them and picked in video_convert_init():
+ * - AVX2 (x86, runtime detected): 8-wide gathers from the RGBA LUT
+ * - NEON (AArch64): 4x64-byte table lookups per channel, 16 pixels per step
+ * - wasm SIMD128: 16x16-byte swizzles per channel, 16 pixels per step
+ *
+ * SSE2 has neither a gather nor a byte shuffle (that is SSSE3): a kernel
+ * there could only load each pixel from the LUT on its own, which is the
+ * scalar loop. It uses that.
+ *
+ * Define SR_VIDEO_NO_SIMD to build only the scalar kernel.
+ */
+
+#include "video_convert.h"
+#include <string.h>
+
+#if !defined(SR_VIDEO_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VIDEO_CONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VIDEO_TARGET_AVX2
+#else
+#define VIDEO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VIDEO_CONVERT_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define VIDEO_CONVERT_WASM 1
+#include <wasm_simd128.h>
+#endif
+#endif /* SR_VIDEO_NO_SIMD */
+
+/* Selected kernel */
+static struct {
+    video_convert_fn fn;
+    const char *name;
+    int needs_planes;
+    int initialized;
+} convert_state = { video_convert_scalar, "scalar", 0, 0 };
+
+void video_convert_scalar(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = lut->rgba[src[i]];
+    }
+}
+
+#if defined(VIDEO_CONVERT_X86)
+
+VIDEO_TARGET_AVX2
+static void video_convert_avx2(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut) {
+    const int *rgba = (const int *)lut->rgba;
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        for (int j = 0; j < 32; j += 8) {
+            __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i + j)));
+            __m256i px = _mm256_i32gather_epi32(rgba, idx, 4);
+            _mm256_storeu_si256((__m256i *)(dst + i + j), px);
+        }
+    }
+    for (; i < count; i++) {
+        dst[i] = lut->rgba[src[i]];
+    }
+}
+
+/* Returns 1 if the CPU and OS support AVX2 */
+static int cpu_has_avx2(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return 0;
+    }
+    __cpuid(info, 1);
+    /* OSXSAVE and AVX, then check the OS saves YMM state */
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+        return 0;
+    }
+    if ((_xgetbv(0) & 6) != 6) {
+        return 0;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#elif defined(VIDEO_CONVERT_NEON)
+
+/* Look up 16 indices in a 256-entry byte table held as four 64-byte blocks.
+ * vqtbx leaves lanes untouched for out-of-range indices, so each block
+ * only fills lanes whose (index - base) wrapped into 0..63. */
+static inline uint8x16_t neon_lookup256(const uint8_t *table, uint8x16_t idx) {
+    const uint8x16_t step = vdupq_n_u8(64);
+    uint8x16x4_t t;
+    uint8x16_t out;
+
+    t.val[0] = vld1q_u8(table + 0);   t.val[1] = vld1q_u8(table + 16);
+    t.val[2] = vld1q_u8(table + 32);  t.val[3] = vld1q_u8(table + 48);
+    out = vqtbl4q_u8(t, idx);
+    for (int block = 1; block < 4; block++) {
+        const uint8_t *p = table + block * 64;
+        idx = vsubq_u8(idx, step);
+        t.val[0] = vld1q_u8(p + 0);   t.val[1] = vld1q_u8(p + 16);
+        t.val[2] = vld1q_u8(p + 32);  t.val[3] = vld1q_u8(p + 48);
+        out = vqtbx4q_u8(out, t, idx);
+    }
+    return out;
+}
+
+static void video_convert_neon(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t idx = vld1q_u8(src + i);
+        uint8x16x4_t px;
+        px.val[0] = neon_lookup256(lut->planes[0], idx);
+        px.val[1] = neon_lookup256(lut->planes[1], idx);
+        px.val[2] = neon_lookup256(lut->planes[2], idx);
+        px.val[3] = neon_lookup256(lut->planes[3], idx);
+        /* Interleave R,G,B,A planes back into little-endian RGBA words */
+        vst4q_u8((uint8_t *)(dst + i), px);
+    }
+    for (; i < count; i++) {
+        dst[i] = lut->rgba[src[i]];
+    }
+}
+
+#elif defined(VIDEO_CONVERT_WASM)
+
+/* Look up 16 indices in a 256-entry byte table held as sixteen 16-byte
+ * blocks. The swizzle zeroes lanes whose index is 16 or more, so each
+ * block only fills lanes whose (index - base) wrapped into 0..15. */
+static inline v128_t wasm_lookup256(const uint8_t *table, v128_t idx) {
+    const v128_t step = wasm_i8x16_splat(16);
+    v128_t out = wasm_i8x16_swizzle(wasm_v128_load(table), idx);
+    for (int block = 1; block < 16; block++) {
+        idx = wasm_i8x16_sub(idx, step);
+        out = wasm_v128_or(out, wasm_i8x16_swizzle(wasm_v128_load(table + block * 16), idx));
+    }
+    return out;
+}
+
+static void video_convert_simd128(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        v128_t idx = wasm_v128_load(src + i);
+        v128_t r = wasm_lookup256(lut->planes[0], idx);
+        v128_t g = wasm_lookup256(lut->planes[1], idx);
+        v128_t b = wasm_lookup256(lut->planes[2], idx);
+        v128_t a = wasm_lookup256(lut->planes[3], idx);
+        /* Interleave R,G,B,A planes back into little-endian RGBA words */
+        v128_t rg_lo = wasm_i8x16_shuffle(r, g, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t rg_hi = wasm_i8x16_shuffle(r, g, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        v128_t ba_lo = wasm_i8x16_shuffle(b, a, 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t ba_hi = wasm_i8x16_shuffle(b, a, 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        wasm_v128_store(dst + i + 0, wasm_i16x8_shuffle(rg_lo, ba_lo, 0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(dst + i + 4, wasm_i16x8_shuffle(rg_lo, ba_lo, 4, 12, 5, 13, 6, 14, 7, 15));
+        wasm_v128_store(dst + i + 8, wasm_i16x8_shuffle(rg_hi, ba_hi, 0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(dst + i + 12, wasm_i16x8_shuffle(rg_hi, ba_hi, 4, 12, 5, 13, 6, 14, 7, 15));
+    }
+    for (; i < count; i++) {
+        dst[i] = lut->rgba[src[i]];
+    }
+}
+
+#endif
+
+#ifndef NDEBUG
+/* Compare the selected kernel against the scalar reference.
+ * Odd length exercises the scalar tail of every kernel. */
+static int convert_self_test(void) {
+    static video_lut_t lut;
+    static uint8_t src[1031];
+    static uint32_t expect[1031];
+    static uint32_t got[1031];
+
+    for (int i = 0; i < 256; i++) {
+        lut.rgba[i] = (uint32_t)i * 0x9E3779B1u;
+    }
+    for (int i = 0; i < (int)sizeof(src); i++) {
+        src[i] = (uint8_t)(i * 7 + (i >> 3));
+    }
+    video_convert_prepare_lut(&lut);
+    video_convert_scalar(expect, src, (int)sizeof(src), &lut);
+    convert_state.fn(got, src, (int)sizeof(src), &lut);
+    return memcmp(expect, got, sizeof(expect)) == 0;
+}
+#endif
+
+void video_convert_init(void) {
+    if (convert_state.initialized) {
+        return;
+    }
+    convert_state.initialized = 1;
+
+#if defined(VIDEO_CONVERT_X86)
+    if (cpu_has_avx2()) {
+        convert_state.fn = video_convert_avx2;
+        convert_state.name = "avx2";
+    }
+#elif defined(VIDEO_CONVERT_NEON)
+    convert_state.fn = video_convert_neon;
+    convert_state.name = "neon";
+    convert_state.needs_planes = 1;
+#elif defined(VIDEO_CONVERT_WASM)
+    convert_state.fn = video_convert_simd128;
+    convert_state.name = "simd128";
+    convert_state.needs_planes = 1;
+#endif
+
+#ifndef NDEBUG
+    if (!convert_self_test()) {
+        convert_state.fn = video_convert_scalar;
+        convert_state.name = "scalar";
+        convert_state.needs_planes = 0;
+    }
+#endif
+}
+
+void video_convert_prepare_lut(video_lut_t *lut) {
+    if (!convert_state.needs_planes) {
+        return;
+    }
+    for (int i = 0; i < 256; i++) {
+        uint32_t px = lut->rgba[i];
+        lut->planes[0][i] = (uint8_t)(px >> 0);
+        lut->planes[1][i] = (uint8_t)(px >> 8);
+        lut->planes[2][i] = (uint8_t)(px >> 16);
+        lut->planes[3][i] = (uint8_t)(px >> 24);
+    }
+}
+
+void video_convert(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut) {
+    convert_state.fn(dst, src, count, lut);
+}
+
+const char *video_convert_name(void) {
+    return convert_state.name;
+}
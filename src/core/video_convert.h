@@ -0,0 +1,64 @@
+/**
+ * Video Conversion Kernels - Indexed to RGBA framebuffer expansion
+ *
+ * Internal to the video subsystem. Provides the scalar reference
+ * conversion plus SIMD variants selected at build time (NEON, wasm
+ * SIMD128) and run time (AVX2). Every kernel produces output
+ * bit-identical to the scalar rgba_lut loop.
+ */
+
+#ifndef VIDEO_CONVERT_H
+#define VIDEO_CONVERT_H
+
+#include <stdint.h>
+
+/**
+ * Palette lookup table shared by all kernels.
+ * rgba holds packed 0xAABBGGRR pixels. planes holds the same data
+ * split per byte channel for table-lookup kernels (NEON, SIMD128); it
+ * is only filled when the selected kernel needs it.
+ */
+typedef struct {
+    uint32_t rgba[256];
+    uint8_t planes[4][256];
+} video_lut_t;
+
+/**
+ * Conversion kernel: dst[i] = lut->rgba[src[i]] for count pixels.
+ */
+typedef void (*video_convert_fn)(uint32_t *dst, const uint8_t *src, int count,
+                                 const video_lut_t *lut);
+
+/**
+ * Select the fastest kernel supported by this build and CPU.
+ * Safe to call more than once.
+ */
+void video_convert_init(void);
+
+/**
+ * Refresh derived LUT data after lut->rgba changed.
+ * @param lut Lookup table to update
+ */
+void video_convert_prepare_lut(video_lut_t *lut);
+
+/**
+ * Convert count indexed pixels using the selected kernel.
+ * @param dst RGBA output (count entries)
+ * @param src Indexed input (count bytes)
+ * @param count Number of pixels
+ * @param lut Prepared lookup table
+ */
+void video_convert(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut);
+
+/**
+ * Scalar reference kernel. Always available.
+ */
+void video_convert_scalar(uint32_t *dst, const uint8_t *src, int count, const video_lut_t *lut);
+
+/**
+ * Get the name of the selected kernel ("scalar", "avx2", "neon", "simd128").
+ * @return Static kernel name
+ */
+const char *video_convert_name(void);
+
+#endif /* VIDEO_CONVERT_H */
@@ -0,0 +1,596 @@
+/**
+ * Export Sink - Y4M / raw RGBA / PNG sequence encoder on a worker thread
+ *
+ * The render loop only copies the compact 8-bit frame (64KB in Mode 13h,
+ * 128KB in Mode X, times the square of the render scale) plus palette
+ * and audio into a ring slot. Expansion to RGBA or YCbCr, PNG encoding
+ * and all file I/O happen on the worker. If threads are unavailable each
+ * frame is encoded inline instead.
+ *
+ * The output is SINK_EXPORT_HEIGHT lines of VIDEO_WIDTH pixels, times the
+ * highest render scale of the run, so hi-res parts keep every pixel.
+ * Slots and encoder scratch are sized for that at begin.
+ */
+
+#include "sink.h"
+#include "core/thread.h"
+#include "core/video.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Frames in flight between render loop and encoder */
+#define EXPORT_RING_SLOTS 8
+
+/* Audio frames one slot can hold (48 kHz / 70 fps = 686) */
+#define EXPORT_MAX_AUDIO_FRAMES 1024
+
+/* Largest path produced from the PNG pattern */
+#define EXPORT_PATH_MAX 1024
+
+/* PNG stored deflate block: at most 65535 bytes of filtered scanlines */
+#define PNG_STORED_BLOCK 65535
+
+/* One queued frame */
+typedef struct {
+    int frame;
+    int width;
+    int height;
+    int audio_frames;
+    uint8_t palette[768];
+    uint8_t *pixels;            /* width * height, room for the largest frame */
+    float audio[EXPORT_MAX_AUDIO_FRAMES * 2];
+} export_slot_t;
+
+static struct {
+    int format;
+    const char *video_path;
+    const char *audio_path;
+    FILE *video;
+    FILE *audio;
+    int channels;
+    int width;              /* Output frame size */
+    int height;
+
+    /* Ring: slots [tail, tail + count) are queued for the worker */
+    export_slot_t slots[EXPORT_RING_SLOTS];
+    int head;
+    int tail;
+    int count;
+    int pending;            /* Slot filled by video(), published by audio(), or -1 */
+    int stop;
+    int error;
+    int stalls;             /* Frames that waited for a free slot */
+
+    int started;            /* Ring primitives initialized */
+    int threaded;
+    thread_t worker;
+    thread_mutex_t mutex;
+    thread_cond_t not_empty;
+    thread_cond_t not_full;
+
+    /* Worker-only scratch */
+    uint8_t *line;          /* Output line enlarged from a narrower frame */
+    uint8_t *planes;        /* Y4M: three planes of width * height */
+    uint32_t *rgba;         /* width * height */
+    uint8_t *zlib;          /* PNG: stored zlib stream, png_zlib_size() */
+    uint32_t crc_table[256];
+} export_state;
+
+/* Expand a 6-bit VGA palette entry to 8 bits per channel */
+static void palette_to_rgb8(const uint8_t *rgb6, int *r, int *g, int *b) {
+    *r = ((rgb6[0] & 0x3F) << 2) | ((rgb6[0] & 0x3F) >> 4);
+    *g = ((rgb6[1] & 0x3F) << 2) | ((rgb6[1] & 0x3F) >> 4);
+    *b = ((rgb6[2] & 0x3F) << 2) | ((rgb6[2] & 0x3F) >> 4);
+}
+
+/* Source pixels for an output line. Lines and columns repeat where the
+ * frame is smaller than the output: Mode 13h lines are doubled, and a
+ * frame drawn below the run's highest scale is enlarged */
+static const uint8_t *source_line(const export_slot_t *slot, int y) {
+    const uint8_t *src = slot->pixels + (size_t)(y * slot->height / export_state.height) * slot->width;
+    if (slot->width == export_state.width) {
+        return src;
+    }
+    int repeat = export_state.width / slot->width;
+    for (int x = 0; x < export_state.width; x++) {
+        export_state.line[x] = src[x / repeat];
+    }
+    return export_state.line;
+}
+
+/* Stored zlib stream of the filtered scanlines of one output frame */
+static size_t png_zlib_size(void) {
+    size_t raw = (size_t)(1 + export_state.width) * (size_t)export_state.height;
+    return 2 + raw + 5 * ((raw + PNG_STORED_BLOCK - 1) / PNG_STORED_BLOCK) + 4;
+}
+
+static int write_all(FILE *f, const void *data, size_t size) {
+    return fwrite(data, 1, size, f) == size ? 0 : -1;
+}
+
+/* Y4M: per-palette YCbCr (BT.601 limited range), then three planes */
+static int encode_y4m(const export_slot_t *slot) {
+    uint8_t ycc[256][3];
+    for (int i = 0; i < 256; i++) {
+        int r, g, b;
+        palette_to_rgb8(&slot->palette[i * 3], &r, &g, &b);
+        ycc[i][0] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        ycc[i][1] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        ycc[i][2] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+
+    size_t plane = (size_t)export_state.width * (size_t)export_state.height;
+    for (int y = 0; y < export_state.height; y++) {
+        const uint8_t *src = source_line(slot, y);
+        uint8_t *dst = export_state.planes + (size_t)y * export_state.width;
+        for (int x = 0; x < export_state.width; x++) {
+            const uint8_t *c = ycc[src[x]];
+            dst[x] = c[0];
+            dst[plane + x] = c[1];
+            dst[2 * plane + x] = c[2];
+        }
+    }
+
+    if (write_all(export_state.video, "FRAME\n", 6) != 0 ||
+        write_all(export_state.video, export_state.planes, 3 * plane) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int encode_rgba(const export_slot_t *slot) {
+    uint32_t lut[256];
+    for (int i = 0; i < 256; i++) {
+        int r, g, b;
+        palette_to_rgb8(&slot->palette[i * 3], &r, &g, &b);
+        lut[i] = 0xFF000000u | ((uint32_t)b << 16) | ((uint32_t)g << 8) | (uint32_t)r;
+    }
+
+    for (int y = 0; y < export_state.height; y++) {
+        const uint8_t *src = source_line(slot, y);
+        uint32_t *dst = export_state.rgba + (size_t)y * export_state.width;
+        for (int x = 0; x < export_state.width; x++) {
+            dst[x] = lut[src[x]];
+        }
+    }
+    return write_all(export_state.video, export_state.rgba,
+                     (size_t)export_state.width * export_state.height * sizeof(uint32_t));
+}
+
+/* PNG */
+
+static void crc_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        export_state.crc_table[n] = c;
+    }
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        crc = export_state.crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static int write_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t size) {
+    uint8_t header[8];
+    uint8_t footer[4];
+    put_be32(header, size);
+    memcpy(header + 4, type, 4);
+    uint32_t crc = crc_update(0xFFFFFFFFu, header + 4, 4);
+    crc = crc_update(crc, data, size) ^ 0xFFFFFFFFu;
+    put_be32(footer, crc);
+    if (write_all(f, header, 8) != 0 || (size && write_all(f, data, size) != 0)) {
+        return -1;
+    }
+    return write_all(f, footer, 4);
+}
+
+/* A PNG pattern is used as the snprintf() format: accept only literal
+ * text, "%%" and exactly one "%d" or "%0Nd" (N up to 2 digits) */
+static int png_pattern_ok(const char *pattern) {
+    int numbers = 0;
+    for (const char *p = pattern; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+        if (*p == '0') {
+            p++;
+            for (int digits = 0; digits < 2 && *p >= '0' && *p <= '9'; digits++) {
+                p++;
+            }
+        }
+        if (*p != 'd') {
+            return 0;
+        }
+        numbers++;
+    }
+    return numbers == 1;
+}
+
+/* Indexed PNG with a stored (uncompressed) zlib stream: no zlib dependency,
+ * and pixels stay exact palette indices */
+static int encode_png(const export_slot_t *slot) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    char path[EXPORT_PATH_MAX];
+    uint8_t ihdr[13];
+    uint8_t plte[768];
+
+    snprintf(path, sizeof(path), export_state.video_path, slot->frame);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "SINK: Cannot open file: %s\n", path);
+        return -1;
+    }
+
+    put_be32(ihdr, (uint32_t)export_state.width);
+    put_be32(ihdr + 4, (uint32_t)export_state.height);
+    ihdr[8] = 8;    /* Bit depth */
+    ihdr[9] = 3;    /* Indexed color */
+    ihdr[10] = 0;   /* Deflate */
+    ihdr[11] = 0;   /* Adaptive filtering */
+    ihdr[12] = 0;   /* No interlace */
+
+    for (int i = 0; i < 256; i++) {
+        int r, g, b;
+        palette_to_rgb8(&slot->palette[i * 3], &r, &g, &b);
+        plte[i * 3 + 0] = (uint8_t)r;
+        plte[i * 3 + 1] = (uint8_t)g;
+        plte[i * 3 + 2] = (uint8_t)b;
+    }
+
+    /* zlib header, stored deflate blocks over the filtered scanlines, adler32 */
+    uint8_t *out = export_state.zlib;
+    uint32_t s1 = 1, s2 = 0;
+    int block_left = 0;
+    int raw_left = (1 + export_state.width) * export_state.height;
+    *out++ = 0x78;
+    *out++ = 0x01;
+    for (int y = 0; y < export_state.height; y++) {
+        const uint8_t *src = source_line(slot, y);
+        for (int x = -1; x < export_state.width; x++) {
+            uint8_t v = (x < 0) ? 0 : src[x];   /* Filter type 0 */
+            if (block_left == 0) {
+                block_left = raw_left < PNG_STORED_BLOCK ? raw_left : PNG_STORED_BLOCK;
+                uint16_t len = (uint16_t)block_left;
+                uint16_t nlen = (uint16_t)~len;
+                *out++ = (uint8_t)(raw_left == block_left);   /* BFINAL, BTYPE=00 */
+                *out++ = (uint8_t)(len & 0xFF);
+                *out++ = (uint8_t)(len >> 8);
+                *out++ = (uint8_t)(nlen & 0xFF);
+                *out++ = (uint8_t)(nlen >> 8);
+            }
+            *out++ = v;
+            block_left--;
+            raw_left--;
+            s1 += v;
+            s2 += s1;
+        }
+        /* A row of at most 1281 bytes is below zlib's 5552-byte reduction bound */
+        s1 %= 65521;
+        s2 %= 65521;
+    }
+    put_be32(out, (s2 << 16) | s1);
+    out += 4;
+
+    int rc = 0;
+    if (write_all(f, signature, sizeof(signature)) != 0 ||
+        write_chunk(f, "IHDR", ihdr, sizeof(ihdr)) != 0 ||
+        write_chunk(f, "PLTE", plte, sizeof(plte)) != 0 ||
+        write_chunk(f, "IDAT", export_state.zlib, (uint32_t)(out - export_state.zlib)) != 0 ||
+        write_chunk(f, "IEND", NULL, 0) != 0) {
+        rc = -1;
+    }
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "SINK: Write error: %s\n", path);
+    }
+    return rc;
+}
+
+/* Encode and write one slot (worker thread, or inline without threads) */
+static int export_slot(const export_slot_t *slot) {
+    int rc = 0;
+    switch (export_state.format) {
+    case SINK_EXPORT_Y4M:  rc = encode_y4m(slot); break;
+    case SINK_EXPORT_RGBA: rc = encode_rgba(slot); break;
+    case SINK_EXPORT_PNG:  rc = encode_png(slot); break;
+    default: break;
+    }
+    if (rc != 0 && export_state.format != SINK_EXPORT_PNG) {
+        fprintf(stderr, "SINK: Write error: %s\n", export_state.video_path);
+    }
+
+    if (rc == 0 && export_state.audio && slot->audio_frames > 0) {
+        size_t count = (size_t)slot->audio_frames * (size_t)export_state.channels;
+        if (fwrite(slot->audio, sizeof(float), count, export_state.audio) != count) {
+            fprintf(stderr, "SINK: Write error: %s\n", export_state.audio_path);
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+static void export_worker(void *arg) {
+    (void)arg;
+    thread_mutex_lock(&export_state.mutex);
+    for (;;) {
+        while (export_state.count == 0 && !export_state.stop) {
+            thread_cond_wait(&export_state.not_empty, &export_state.mutex);
+        }
+        if (export_state.count == 0) {
+            break; /* Stopped and drained */
+        }
+        export_slot_t *slot = &export_state.slots[export_state.tail];
+        int failed = export_state.error;
+        thread_mutex_unlock(&export_state.mutex);
+
+        /* Keep draining after an error so the producer never deadlocks */
+        int rc = failed ? -1 : export_slot(slot);
+
+        thread_mutex_lock(&export_state.mutex);
+        if (rc != 0) {
+            export_state.error = 1;
+        }
+        export_state.tail = (export_state.tail + 1) % EXPORT_RING_SLOTS;
+        export_state.count--;
+        thread_cond_signal(&export_state.not_full);
+    }
+    thread_mutex_unlock(&export_state.mutex);
+}
+
+/* Hand the pending slot to the worker */
+static void publish_pending(void) {
+    if (export_state.pending < 0) {
+        return;
+    }
+    if (!export_state.threaded) {
+        if (export_slot(&export_state.slots[export_state.pending]) != 0) {
+            export_state.error = 1;
+        }
+        export_state.pending = -1;
+        return;
+    }
+
+    thread_mutex_lock(&export_state.mutex);
+    export_state.head = (export_state.head + 1) % EXPORT_RING_SLOTS;
+    export_state.count++;
+    export_state.pending = -1;
+    thread_cond_signal(&export_state.not_empty);
+    thread_mutex_unlock(&export_state.mutex);
+}
+
+/* Claim the next free slot, waiting only if the worker is a full ring behind */
+static export_slot_t *acquire_slot(void) {
+    if (!export_state.threaded) {
+        export_state.pending = 0;
+        return &export_state.slots[0];
+    }
+
+    thread_mutex_lock(&export_state.mutex);
+    if (export_state.count == EXPORT_RING_SLOTS) {
+        export_state.stalls++;
+        while (export_state.count == EXPORT_RING_SLOTS) {
+            thread_cond_wait(&export_state.not_full, &export_state.mutex);
+        }
+    }
+    export_state.pending = export_state.head;
+    thread_mutex_unlock(&export_state.mutex);
+    return &export_state.slots[export_state.pending];
+}
+
+static int export_failed(void) {
+    if (!export_state.threaded) {
+        return export_state.error;
+    }
+    thread_mutex_lock(&export_state.mutex);
+    int failed = export_state.error;
+    thread_mutex_unlock(&export_state.mutex);
+    return failed;
+}
+
+static int export_begin(headless_sink_t *sink, const headless_format_t *format) {
+    (void)sink;
+
+    if (format->width % VIDEO_WIDTH != 0 || format->width > VIDEO_WIDTH * VIDEO_SCALE_MAX ||
+        format->sample_rate / format->fps + 1 > EXPORT_MAX_AUDIO_FRAMES ||
+        format->channels != 2) {
+        fprintf(stderr, "SINK: ERROR Unsupported stream format\n");
+        return -1;
+    }
+    export_state.channels = format->channels;
+
+    /* Output, slots and scratch for the highest render scale of the run */
+    int scale = format->width / VIDEO_WIDTH;
+    export_state.width = format->width;
+    export_state.height = SINK_EXPORT_HEIGHT * scale;
+    size_t frame_size = (size_t)export_state.width * (size_t)VIDEO_HEIGHT_X * (size_t)scale;
+    size_t output_size = (size_t)export_state.width * (size_t)export_state.height;
+    for (int i = 0; i < EXPORT_RING_SLOTS; i++) {
+        if (!(export_state.slots[i].pixels = malloc(frame_size))) {
+            fprintf(stderr, "SINK: ERROR Out of memory\n");
+            return -1;
+        }
+    }
+    export_state.line = malloc((size_t)export_state.width);
+    if (export_state.format == SINK_EXPORT_Y4M) {
+        export_state.planes = malloc(3 * output_size);
+    } else if (export_state.format == SINK_EXPORT_RGBA) {
+        export_state.rgba = malloc(output_size * sizeof(uint32_t));
+    } else {
+        export_state.zlib = malloc(png_zlib_size());
+    }
+    if (!export_state.line || (!export_state.planes && !export_state.rgba && !export_state.zlib)) {
+        fprintf(stderr, "SINK: ERROR Out of memory\n");
+        return -1;
+    }
+
+    if (export_state.format == SINK_EXPORT_PNG) {
+        if (!png_pattern_ok(export_state.video_path)) {
+            fprintf(stderr, "SINK: ERROR PNG output needs one frame number, as %%d or %%0Nd (e.g. out/%%05d.png)\n");
+            return -1;
+        }
+        crc_init();
+    } else {
+        export_state.video = fopen(export_state.video_path, "wb");
+        if (!export_state.video) {
+            fprintf(stderr, "SINK: Cannot open file: %s\n", export_state.video_path);
+            return -1;
+        }
+        if (export_state.format == SINK_EXPORT_Y4M) {
+            /* 320x400 (and its multiples) shown at 4:3 gives 5:3 pixels */
+            fprintf(export_state.video, "YUV4MPEG2 W%d H%d F%d:1 Ip A5:3 C444\n",
+                    export_state.width, export_state.height, format->fps);
+        }
+    }
+    if (export_state.audio_path) {
+        export_state.audio = fopen(export_state.audio_path, "wb");
+        if (!export_state.audio) {
+            fprintf(stderr, "SINK: Cannot open file: %s\n", export_state.audio_path);
+            return -1;
+        }
+    }
+
+    thread_mutex_init(&export_state.mutex);
+    thread_cond_init(&export_state.not_empty);
+    thread_cond_init(&export_state.not_full);
+    export_state.started = 1;
+    export_state.threaded = thread_create(&export_state.worker, export_worker, NULL) == 0;
+    if (!export_state.threaded) {
+        printf("[sink] No worker thread, encoding inline\n");
+    }
+    return 0;
+}
+
+static int export_video(headless_sink_t *sink, int frame, const uint8_t *pixels,
+                        int width, int height, const uint8_t palette[768]) {
+    (void)sink;
+
+    /* A frame without audio goes out as soon as the next one arrives */
+    publish_pending();
+    if (export_failed()) {
+        return -1;
+    }
+
+    if (width > export_state.width || export_state.width % width != 0) {
+        fprintf(stderr, "SINK: ERROR Frame %d is %d pixels wide, export is %d\n",
+                frame, width, export_state.width);
+        return -1;
+    }
+    export_slot_t *slot = acquire_slot();
+    slot->frame = frame;
+    slot->width = width;
+    slot->height = height;
+    slot->audio_frames = 0;
+    memcpy(slot->palette, palette, sizeof(slot->palette));
+    memcpy(slot->pixels, pixels, (size_t)width * (size_t)height);
+    return 0;
+}
+
+static int export_audio(headless_sink_t *sink, const float *samples, int num_frames) {
+    (void)sink;
+
+    if (export_state.pending < 0 || num_frames > EXPORT_MAX_AUDIO_FRAMES) {
+        return 0;
+    }
+    export_slot_t *slot = &export_state.slots[export_state.pending];
+    memcpy(slot->audio, samples, (size_t)num_frames * 2 * sizeof(float));
+    slot->audio_frames = num_frames;
+    publish_pending();
+    return 0;
+}
+
+static void export_end(headless_sink_t *sink) {
+    (void)sink;
+
+    if (export_state.started) {
+        publish_pending();
+    }
+    if (export_state.threaded) {
+        thread_mutex_lock(&export_state.mutex);
+        export_state.stop = 1;
+        thread_cond_signal(&export_state.not_empty);
+        thread_mutex_unlock(&export_state.mutex);
+        thread_join(&export_state.worker);
+        export_state.threaded = 0;
+        printf("[sink] Export finished (%d of %d-slot ring stalls)\n",
+               export_state.stalls, EXPORT_RING_SLOTS);
+    }
+    if (export_state.started) {
+        thread_cond_destroy(&export_state.not_full);
+        thread_cond_destroy(&export_state.not_empty);
+        thread_mutex_destroy(&export_state.mutex);
+        export_state.started = 0;
+    }
+
+    if (export_state.video) {
+        fclose(export_state.video);
+        export_state.video = NULL;
+    }
+    if (export_state.audio) {
+        fclose(export_state.audio);
+        export_state.audio = NULL;
+    }
+
+    for (int i = 0; i < EXPORT_RING_SLOTS; i++) {
+        free(export_state.slots[i].pixels);
+        export_state.slots[i].pixels = NULL;
+    }
+    free(export_state.line);
+    free(export_state.planes);
+    free(export_state.rgba);
+    free(export_state.zlib);
+    export_state.line = NULL;
+    export_state.planes = NULL;
+    export_state.rgba = NULL;
+    export_state.zlib = NULL;
+}
+
+static headless_sink_t s_export_sink = {
+    .name = "export",
+    .begin = export_begin,
+    .video = export_video,
+    .audio = export_audio,
+    .end = export_end,
+    .user_data = NULL
+};
+
+headless_sink_t *sink_export(int format, const char *video_path, const char *audio_path) {
+    memset(&export_state, 0, sizeof(export_state));
+    export_state.format = format;
+    export_state.video_path = video_path;
+    export_state.audio_path = audio_path;
+    export_state.pending = -1;
+    return &s_export_sink;
+}
+
+int sink_export_format(const char *name) {
+    if (strcmp(name, "y4m") == 0) {
+        return SINK_EXPORT_Y4M;
+    }
+    if (strcmp(name, "rgba") == 0) {
+        return SINK_EXPORT_RGBA;
+    }
+    if (strcmp(name, "png") == 0) {
+        return SINK_EXPORT_PNG;
+    }
+    return -1;
+}
@@ -0,0 +1,227 @@
+/**
+ * Hash Sink - Per-frame hashes checked against golden lists
+ *
+ * Every frame's size, palette, scanline palette patches and indexed
+ * pixels are hashed with a fast 64-bit multiply-xor hash. Above scale 1
+ * that is the whole hi-res frame, every pixel of each block. The patches
+ * are read from video directly. Frames are numbered from the start of
+ * the part showing them, so each part's list stands on its own: a change
+ * in one part never shifts another part's hashes.
+ *
+ * Golden lists are text files DIR/<part id>.hash (sr_part_id_t, two
+ * digits, so renaming a part keeps its list), one 16-digit hex hash per
+ * line in frame order. Check mode reports the first divergent frame of
+ * each part and fails the run; update mode rewrites the lists.
+ */
+
+#include "sink.h"
+#include "core/part.h"
+#include "core/video.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest golden path */
+#define HASH_PATH_MAX 1024
+
+static struct {
+    const char *dir;
+    int update;
+
+    /* Part being hashed */
+    int active;
+    const sr_part_t *part;
+    int part_frame;
+    FILE *golden;           /* Open golden list (check: read, update: write) */
+    int diverged;           /* Check: first divergence of this part reported */
+
+    int parts;
+    int failures;
+} hash_state;
+
+#define HASH_K0 0x9E3779B97F4A7C15ull
+#define HASH_K1 0xC2B2AE3D27D4EB4Full
+
+static uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= HASH_K1;
+    h ^= h >> 29;
+    return h;
+}
+
+/* Eight bytes at a time, little-endian so hashes match on every host */
+static uint64_t hash_bytes(uint64_t h, const uint8_t *data, size_t size) {
+    while (size >= 8) {
+        uint64_t w = (uint64_t)data[0] | (uint64_t)data[1] << 8 | (uint64_t)data[2] << 16 |
+                     (uint64_t)data[3] << 24 | (uint64_t)data[4] << 32 | (uint64_t)data[5] << 40 |
+                     (uint64_t)data[6] << 48 | (uint64_t)data[7] << 56;
+        h = (h ^ (w * HASH_K0)) * HASH_K1;
+        h ^= h >> 31;
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        h = (h ^ *data++) * HASH_K0;
+    }
+    return h;
+}
+
+static uint64_t hash_frame(int width, int height, const uint8_t *pixels,
+                           const uint8_t palette[768]) {
+    uint64_t h = hash_mix(HASH_K0 ^ (uint64_t)width << 16 ^ (uint64_t)height);
+    h = hash_bytes(h, palette, 768);
+
+    video_palette_patch_t patch;
+    for (int i = 0; video_get_visible_palette_patch(i, &patch) == 0; i++) {
+        const uint8_t head[5] = {
+            (uint8_t)patch.line, (uint8_t)(patch.line >> 8), (uint8_t)patch.start,
+            (uint8_t)patch.count, (uint8_t)(patch.count >> 8)
+        };
+        h = hash_bytes(h, head, sizeof(head));
+        h = hash_bytes(h, patch.data, (size_t)patch.count * 3);
+    }
+    h = hash_bytes(h, pixels, (size_t)width * (size_t)height);
+    return hash_mix(h);
+}
+
+static const char *part_name(const sr_part_t *part) {
+    return part->name ? part->name : "UNNAMED";
+}
+
+/* Close the current part's list. In check mode frames left unseen fail
+ * it, unless the run stopped during this part (last: --frames, exit). */
+static void hash_end_part(int last) {
+    if (!hash_state.active) {
+        return;
+    }
+    const char *name = part_name(hash_state.part);
+    if (hash_state.golden) {
+        char line[64];
+        if (!hash_state.update && !hash_state.diverged &&
+            fgets(line, sizeof(line), hash_state.golden)) {
+            if (last) {
+                printf("[hash] %s: run stopped at frame %d, rest of the list not checked\n",
+                       name, hash_state.part_frame);
+            } else {
+                printf("[hash] %s: FAIL ended at frame %d, golden list has more frames\n",
+                       name, hash_state.part_frame);
+                hash_state.diverged = 1;
+            }
+        }
+        fclose(hash_state.golden);
+        hash_state.golden = NULL;
+    }
+    if (hash_state.diverged) {
+        hash_state.failures++;
+    } else if (hash_state.update) {
+        printf("[hash] %s: wrote %d frames\n", name, hash_state.part_frame);
+    } else {
+        printf("[hash] %s: %d frames match\n", name, hash_state.part_frame);
+    }
+    hash_state.active = 0;
+}
+
+static int hash_begin_part(const sr_part_t *part) {
+    char path[HASH_PATH_MAX];
+    const char *name = part_name(part);
+    hash_state.active = 1;
+    hash_state.part = part;
+    hash_state.part_frame = 0;
+    hash_state.diverged = 0;
+    hash_state.parts++;
+
+    int n = snprintf(path, sizeof(path), "%s/%02d.hash", hash_state.dir, (int)part->id);
+    if (n < 0 || (size_t)n >= sizeof(path)) {
+        fprintf(stderr, "SINK: Path too long: %s/%02d.hash\n", hash_state.dir, (int)part->id);
+        return -1;
+    }
+    hash_state.golden = fopen(path, hash_state.update ? "w" : "r");
+    if (!hash_state.golden) {
+        if (hash_state.update) {
+            fprintf(stderr, "SINK: Cannot open file: %s\n", path);
+            return -1;
+        }
+        printf("[hash] %s: FAIL no golden list %s\n", name, path);
+        hash_state.diverged = 1;
+    }
+    return 0;
+}
+
+static int hash_video(headless_sink_t *sink, int frame, const uint8_t *pixels,
+                      int width, int height, const uint8_t palette[768]) {
+    (void)sink;
+    (void)frame;
+
+    /* The frame the sequence ended on belongs to no part */
+    const sr_part_t *part = part_loader_current();
+    if (!part) {
+        return 0;
+    }
+    if (!hash_state.active || part != hash_state.part) {
+        hash_end_part(0);
+        if (hash_begin_part(part) != 0) {
+            return -1;
+        }
+    }
+
+    uint64_t h = hash_frame(width, height, pixels, palette);
+    int part_frame = hash_state.part_frame++;
+    if (!hash_state.golden) {
+        return 0;
+    }
+    if (hash_state.update) {
+        if (fprintf(hash_state.golden, "%016" PRIx64 "\n", h) < 0) {
+            fprintf(stderr, "SINK: Write error: %02d.hash\n", (int)part->id);
+            return -1;
+        }
+        return 0;
+    }
+    if (hash_state.diverged) {
+        return 0;
+    }
+
+    char line[64];
+    if (!fgets(line, sizeof(line), hash_state.golden)) {
+        printf("[hash] %s: FAIL frame %d beyond the golden list (%d frames)\n",
+               part_name(part), part_frame, part_frame);
+        hash_state.diverged = 1;
+        return 0;
+    }
+    uint64_t expected = strtoull(line, NULL, 16);
+    if (expected != h) {
+        printf("[hash] %s: FAIL first divergent frame %d (expected %016" PRIx64
+               ", got %016" PRIx64 ")\n", part_name(part), part_frame, expected, h);
+        hash_state.diverged = 1;
+    }
+    return 0;
+}
+
+static void hash_end(headless_sink_t *sink) {
+    (void)sink;
+    hash_end_part(1);
+    if (hash_state.update) {
+        printf("[hash] Updated %d golden lists in %s\n", hash_state.parts, hash_state.dir);
+    } else if (hash_state.failures > 0) {
+        printf("[hash] FAIL %d of %d parts diverged\n", hash_state.failures, hash_state.parts);
+    } else {
+        printf("[hash] PASS %d parts\n", hash_state.parts);
+    }
+}
+
+static headless_sink_t s_hash_sink = {
+    .name = "hash",
+    .video = hash_video,
+    .end = hash_end
+};
+
+headless_sink_t *sink_hash(const char *golden_dir, int update) {
+    memset(&hash_state, 0, sizeof(hash_state));
+    hash_state.dir = golden_dir;
+    hash_state.update = update;
+    return &s_hash_sink;
+}
+
+int sink_hash_failures(void) {
+    return hash_state.failures;
+}
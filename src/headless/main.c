@@ -0,0 +1,301 @@
+/**
+ * Headless Runner - Offscreen demo playback on a virtual clock
+ *
+ * Runs the part sequence without sokol_app, a window or an audio device.
+ * Each virtual frame ticks DIS once, updates and renders the current part,
+ * then hands the visible indexed frame, its palette and the music rendered
+ * for that frame to a sink. Nothing waits on vsync or the audio device,
+ * so throughput is bound only by the parts' render cost.
+ */
+
+#include "sokol_gfx.h"
+#include "sokol_time.h"
+#include "core/dis.h"
+#include "core/video.h"
+#include "core/part.h"
+#include "core/pack.h"
+#include "core/fetch.h"
+#include "core/table.h"
+#include "core/jobs.h"
+#include "core/pipeline.h"
+#include "core/profile.h"
+#include "core/framecheck.h"
+#include "audio/music.h"
+#include "visu/visu.h"
+#include "parts/parts.h"
+#include "sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Virtual clock: VGA 320x200/320x400 modes refresh at 70 Hz */
+#define HEADLESS_FPS 70
+
+/* Largest audio block for one frame (rounded up) */
+#define HEADLESS_MAX_FRAME_SAMPLES 4096
+
+typedef struct {
+    const char *music_path;
+    const char *video_path;
+    const char *audio_path;
+    int format;             /* SINK_EXPORT_*, or -1 for the indexed sink */
+    int max_frames;         /* 0 = until the sequence ends */
+    int pcm_cache;          /* Play music from (and write) MODULE.pcm */
+    const char *hash_dir;   /* Golden frame hash lists */
+    int hash_update;        /* Write hash_dir instead of checking it */
+    int threads;            /* Rasterizer threads, 0 = one per core, 1 = off */
+    int scale;              /* Highest render scale parts may use */
+    int pipeline;           /* Draw on a render thread, frames handed over */
+    const char *part;       /* Part to start at, NULL = the first */
+} headless_options_t;
+
+static float s_audio[HEADLESS_MAX_FRAME_SAMPLES * 2];
+
+static void print_usage(const char *argv0) {
+    printf("Usage: %s [options]\n", argv0);
+    printf("  --frames N      Stop after N frames (default: end of sequence)\n");
+    printf("  --music PATH    Module to render (default: MAIN/MUSIC0.S3M)\n");
+    printf("  --no-music      Run without music\n");
+    printf("  --pcm-cache     Play music from a PCM cache, rendering it if missing\n");
+    printf("  --video PATH    Write frames to PATH (PNG: pattern such as out/%%05d.png)\n");
+    printf("  --format FMT    indexed (default), y4m, rgba or png\n");
+    printf("  --audio PATH    Write float32 stereo audio to PATH\n");
+    printf("  --hash DIR      Check frame hashes against golden lists in DIR\n");
+    printf("  --hash-update DIR  Write golden frame hash lists to DIR\n");
+    printf("  --threads N     Rasterize 3D parts on N threads (default: 1, 0: one per core)\n");
+    printf("  --scale N       Let parts render at up to 2x or 4x, output at that size\n");
+    printf("  --pipeline      Draw frames on a render thread and hand them over\n");
+    printf("  --part NAME     Start at a part, music and message areas as in a full run\n");
+}
+
+static int parse_options(int argc, char *argv[], headless_options_t *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->music_path = "MAIN/MUSIC0.S3M";
+    opts->format = -1;
+    opts->threads = 1;
+    opts->scale = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--no-music") == 0) {
+            opts->music_path = NULL;
+        } else if (strcmp(arg, "--pcm-cache") == 0) {
+            opts->pcm_cache = 1;
+        } else if (strcmp(arg, "--pipeline") == 0) {
+            opts->pipeline = 1;
+        } else if (strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            return 1;
+        } else if (!value) {
+            fprintf(stderr, "HEADLESS: ERROR Missing value for %s\n", arg);
+            return -1;
+        } else if (strcmp(arg, "--frames") == 0) {
+            opts->max_frames = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--threads") == 0) {
+            opts->threads = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--scale") == 0) {
+            opts->scale = atoi(value);
+            i++;
+        } else if (strcmp(arg, "--part") == 0) {
+            opts->part = value;
+            i++;
+        } else if (strcmp(arg, "--music") == 0) {
+            opts->music_path = value;
+            i++;
+        } else if (strcmp(arg, "--video") == 0) {
+            opts->video_path = value;
+            i++;
+        } else if (strcmp(arg, "--audio") == 0) {
+            opts->audio_path = value;
+            i++;
+        } else if (strcmp(arg, "--hash") == 0 || strcmp(arg, "--hash-update") == 0) {
+            opts->hash_dir = value;
+            opts->hash_update = strcmp(arg, "--hash-update") == 0;
+            i++;
+        } else if (strcmp(arg, "--format") == 0) {
+            if (strcmp(value, "indexed") == 0) {
+                opts->format = -1;
+            } else if ((opts->format = sink_export_format(value)) < 0) {
+                fprintf(stderr, "HEADLESS: ERROR Unknown format %s\n", value);
+                return -1;
+            }
+            i++;
+        } else {
+            fprintf(stderr, "HEADLESS: ERROR Unknown option %s\n", arg);
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Tick and draw one frame, on the render thread with --pipeline */
+static void produce_frame(void) {
+    part_loader_tick();
+    part_loader_render();
+    visu_flush();
+}
+
+/* Samples covering virtual frame n, so the total never drifts from n / fps */
+static int frame_samples(int frame, int sample_rate) {
+    long long start = (long long)frame * sample_rate / HEADLESS_FPS;
+    long long end = (long long)(frame + 1) * sample_rate / HEADLESS_FPS;
+    return (int)(end - start);
+}
+
+int main(int argc, char *argv[]) {
+    headless_options_t opts;
+    int rc = parse_options(argc, argv, &opts);
+    if (rc != 0) {
+        return rc > 0 ? 0 : 1;
+    }
+
+    headless_sink_t *sink = sink_null();
+    if (opts.hash_dir) {
+        if (opts.video_path || opts.audio_path || opts.format >= 0) {
+            fprintf(stderr, "HEADLESS: ERROR --hash cannot be combined with --video or --audio\n");
+            return 1;
+        }
+        sink = sink_hash(opts.hash_dir, opts.hash_update);
+    } else if (opts.format >= 0) {
+        if (!opts.video_path) {
+            fprintf(stderr, "HEADLESS: ERROR --format needs --video\n");
+            return 1;
+        }
+        sink = sink_export(opts.format, opts.video_path, opts.audio_path);
+    } else if (opts.video_path || opts.audio_path) {
+        sink = sink_indexed(opts.video_path, opts.audio_path);
+    }
+
+    /* Initialize DIS first */
+    dis_version();
+
+    /* Dummy sokol_gfx backend: resources exist, nothing is drawn */
+    sg_setup(&(sg_desc){ 0 });
+    stm_setup();
+    profile_init();
+    video_init();
+    visu_init();
+    if (opts.threads != 1 && jobs_init(opts.threads) > 1) {
+        visu_set_bands(jobs_thread_count() * VISU_BANDS_PER_THREAD);
+    }
+    video_set_max_scale(opts.scale);
+    pack_init();
+    fetch_init();
+    pack_open("MAIN/REALITY.PAK");
+    table_init();
+
+    bool have_music = music_init_offline();
+
+    part_loader_init();
+    parts_register_all();
+
+    /* Load now so the music starts on frame 0 in every run */
+    if (have_music && opts.music_path) {
+        if (opts.pcm_cache) {
+            music_set_pcm_cache(true);
+        }
+        part_loader_set_music(opts.music_path, 0);
+    }
+    part_loader_set_snapshot_file("MAIN/PARTS.msg");
+    if (opts.part) {
+        int id = part_loader_find(opts.part);
+        if (id < 0 || part_loader_seek((sr_part_id_t)id) != 0) {
+            fprintf(stderr, "HEADLESS: ERROR Unknown part %s\n", opts.part);
+            return 1;
+        }
+    } else if (part_loader_start(0) != 0) {
+        fprintf(stderr, "HEADLESS: ERROR No parts registered\n");
+        return 1;
+    }
+    if (opts.pipeline && pipeline_start(produce_frame) != 0) {
+        fprintf(stderr, "HEADLESS: ERROR Cannot start the render pipeline\n");
+        return 1;
+    }
+
+    headless_format_t format = {
+        .fps = HEADLESS_FPS,
+        .width = VIDEO_WIDTH * video_get_max_scale(),
+        .sample_rate = music_get_render_rate(),
+        .channels = 2
+    };
+    rc = 0;
+    if (sink->begin && sink->begin(sink, &format) != 0) {
+        rc = 1;
+    }
+
+    printf("[headless] Running at %d virtual fps, sink: %s\n", HEADLESS_FPS, sink->name);
+    uint64_t start_time = stm_now();
+    int frame = 0;
+    uint8_t palette[768];
+
+    while (rc == 0 && part_loader_is_running() && !dis_exit()) {
+        if (opts.max_frames > 0 && frame >= opts.max_frames) {
+            break;
+        }
+
+        /* Pipelined, each frame still goes through the handoff before the
+         * sink sees it; music and DIS stay on this thread */
+        dis_frame_tick();
+        if (pipeline_active()) {
+            pipeline_kick();
+            pipeline_wait();
+            video_acquire();
+        } else {
+            produce_frame();
+        }
+
+        if (sink->video) {
+            int width = 0;
+            int height = 0;
+            const uint8_t *pixels = video_get_visible_full(&width, &height);
+            video_get_visible_palette(palette);
+            if (sink->video(sink, frame, pixels, width, height, palette) != 0) {
+                rc = 1;
+            }
+        }
+
+        /* Music for this frame's span of virtual time */
+        int samples = frame_samples(frame, format.sample_rate);
+        music_render_offline(s_audio, samples);
+        if (sink->audio && sink->audio(sink, s_audio, samples) != 0) {
+            rc = 1;
+        }
+        frame++;
+    }
+
+    double elapsed = stm_sec(stm_since(start_time));
+    double virtual_time = (double)frame / HEADLESS_FPS;
+    printf("[headless] %d frames (%.2f s virtual) in %.3f s: %.1f fps, %.1fx realtime\n",
+           frame, virtual_time, elapsed,
+           elapsed > 0.0 ? frame / elapsed : 0.0,
+           elapsed > 0.0 ? virtual_time / elapsed : 0.0);
+
+    if (sink->end) {
+        sink->end(sink);
+    }
+    if (opts.hash_dir && !opts.hash_update && sink_hash_failures() > 0) {
+        rc = 1;
+    }
+    pipeline_stop();
+    part_loader_shutdown();
+
+    /* Heap or stdio calls in the frame path fail the run (SR_FRAME_CHECK) */
+    if (framecheck_report() > 0) {
+        rc = 1;
+    }
+    visu_set_bands(0);
+    jobs_shutdown();
+    pack_shutdown();
+    fetch_shutdown();
+    table_shutdown();
+    music_shutdown();
+    profile_shutdown();
+    video_shutdown();
+    sg_shutdown();
+    return rc;
+}
@@ -0,0 +1,116 @@
+/**
+ * Headless Frame Sinks - Implementation
+ */
+
+#include "sink.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Null sink: no callbacks, nothing written */
+static headless_sink_t s_null_sink = {
+    .name = "null"
+};
+
+headless_sink_t *sink_null(void) {
+    return &s_null_sink;
+}
+
+/* Indexed sink */
+
+typedef struct {
+    const char *video_path;
+    const char *audio_path;
+    FILE *video;
+    FILE *audio;
+    int channels;
+} indexed_data_t;
+
+static indexed_data_t s_indexed_data;
+
+static int indexed_begin(headless_sink_t *sink, const headless_format_t *format) {
+    indexed_data_t *data = (indexed_data_t *)sink->user_data;
+    data->channels = format->channels;
+
+    if (data->video_path) {
+        data->video = fopen(data->video_path, "wb");
+        if (!data->video) {
+            fprintf(stderr, "SINK: Cannot open file: %s\n", data->video_path);
+            return -1;
+        }
+    }
+    if (data->audio_path) {
+        data->audio = fopen(data->audio_path, "wb");
+        if (!data->audio) {
+            fprintf(stderr, "SINK: Cannot open file: %s\n", data->audio_path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int indexed_video(headless_sink_t *sink, int frame, const uint8_t *pixels,
+                         int width, int height, const uint8_t palette[768]) {
+    indexed_data_t *data = (indexed_data_t *)sink->user_data;
+    (void)frame;
+
+    if (!data->video) {
+        return 0;
+    }
+
+    uint8_t header[4] = {
+        (uint8_t)(width & 0xFF), (uint8_t)(width >> 8),
+        (uint8_t)(height & 0xFF), (uint8_t)(height >> 8)
+    };
+    size_t size = (size_t)width * (size_t)height;
+    if (fwrite(header, 1, sizeof(header), data->video) != sizeof(header) ||
+        fwrite(palette, 1, 768, data->video) != 768 ||
+        fwrite(pixels, 1, size, data->video) != size) {
+        fprintf(stderr, "SINK: Write error: %s\n", data->video_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int indexed_audio(headless_sink_t *sink, const float *samples, int num_frames) {
+    indexed_data_t *data = (indexed_data_t *)sink->user_data;
+
+    if (!data->audio) {
+        return 0;
+    }
+
+    size_t count = (size_t)num_frames * (size_t)data->channels;
+    if (fwrite(samples, sizeof(float), count, data->audio) != count) {
+        fprintf(stderr, "SINK: Write error: %s\n", data->audio_path);
+        return -1;
+    }
+    return 0;
+}
+
+static void indexed_end(headless_sink_t *sink) {
+    indexed_data_t *data = (indexed_data_t *)sink->user_data;
+
+    if (data->video) {
+        fclose(data->video);
+        data->video = NULL;
+    }
+    if (data->audio) {
+        fclose(data->audio);
+        data->audio = NULL;
+    }
+}
+
+static headless_sink_t s_indexed_sink = {
+    .name = "indexed",
+    .begin = indexed_begin,
+    .video = indexed_video,
+    .audio = indexed_audio,
+    .end = indexed_end,
+    .user_data = &s_indexed_data
+};
+
+headless_sink_t *sink_indexed(const char *video_path, const char *audio_path) {
+    memset(&s_indexed_data, 0, sizeof(s_indexed_data));
+    s_indexed_data.video_path = video_path;
+    s_indexed_data.audio_path = audio_path;
+    return &s_indexed_sink;
+}
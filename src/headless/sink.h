@@ -0,0 +1,114 @@
+/**
+ * Headless Frame Sinks - Destinations for offscreen frames and audio
+ *
+ * The headless runner hands every virtual frame's indexed pixels and
+ * palette, followed by the music rendered for that frame, to a sink.
+ * Frames come at the resolution they were rendered at: VIDEO_WIDTH
+ * columns at scale 1, VIDEO_WIDTH * scale for a part drawing hi-res.
+ * Sinks follow the part structure: a table of callbacks plus user data.
+ */
+
+#ifndef SINK_H
+#define SINK_H
+
+#include <stdint.h>
+
+/**
+ * Stream format, fixed for the whole run
+ */
+typedef struct {
+    int fps;            /* Virtual frames per second */
+    int width;          /* Widest frame: VIDEO_WIDTH * highest render scale */
+    int sample_rate;    /* Audio sample rate in Hz */
+    int channels;       /* Interleaved audio channels */
+} headless_format_t;
+
+/* Forward declaration */
+typedef struct headless_sink_t headless_sink_t;
+
+/**
+ * Sink callback types. Return 0 on success, -1 to stop the run.
+ */
+typedef int (*headless_begin_fn)(headless_sink_t *sink, const headless_format_t *format);
+typedef int (*headless_video_fn)(headless_sink_t *sink, int frame, const uint8_t *pixels,
+                                 int width, int height, const uint8_t palette[768]);
+typedef int (*headless_audio_fn)(headless_sink_t *sink, const float *samples, int num_frames);
+typedef void (*headless_end_fn)(headless_sink_t *sink);
+
+/**
+ * Sink structure - any callback may be NULL
+ */
+struct headless_sink_t {
+    const char *name;           /* Sink name for logging */
+    headless_begin_fn begin;    /* Called once before the first frame */
+    headless_video_fn video;    /* Called once per frame with width * height pixels */
+    headless_audio_fn audio;    /* Called once per frame with that frame's samples */
+    headless_end_fn end;        /* Called once after the last frame */
+    void *user_data;            /* Sink-specific data */
+};
+
+/**
+ * Get the null sink, which discards everything (throughput runs).
+ * @return Static sink
+ */
+headless_sink_t *sink_null(void);
+
+/**
+ * Get the indexed sink, which writes frames and audio to raw files.
+ * Video records are: uint16 width, uint16 height (little-endian),
+ * 768 bytes of 6-bit palette, then width * height index bytes.
+ * Audio is written as interleaved 32-bit float samples.
+ * @param video_path Video output path (NULL to skip video)
+ * @param audio_path Audio output path (NULL to skip audio)
+ * @return Static sink
+ */
+headless_sink_t *sink_indexed(const char *video_path, const char *audio_path);
+
+/* Export formats for sink_export() */
+#define SINK_EXPORT_Y4M     0   /* YUV4MPEG2 stream, 4:4:4 BT.601 */
+#define SINK_EXPORT_RGBA    1   /* Raw RGBA8 stream, no header */
+#define SINK_EXPORT_PNG     2   /* Indexed PNG sequence */
+
+/* Export frame size at scale 1: Mode 13h lines are doubled as the VGA
+ * scanned them out. A run with a higher render scale exports at that
+ * multiple, and frames drawn at a lower scale are enlarged to fill it */
+#define SINK_EXPORT_HEIGHT  400
+
+/**
+ * Get the export sink, which encodes frames on a background thread.
+ * The render loop copies each frame's 8-bit pixels and palette into a
+ * bounded ring; the worker expands, encodes and writes them. The loop
+ * only waits when the worker falls a full ring behind.
+ * @param format SINK_EXPORT_Y4M, SINK_EXPORT_RGBA or SINK_EXPORT_PNG
+ * @param video_path Output path; for PNG a pattern with exactly one
+ *                   frame number, %d or %0Nd (e.g. "out/%05d.png"); any
+ *                   other conversion is rejected at begin
+ * @param audio_path Interleaved float32 audio output path (NULL to skip)
+ * @return Static sink
+ */
+headless_sink_t *sink_export(int format, const char *video_path, const char *audio_path);
+
+/**
+ * Parse an export format name ("y4m", "rgba", "png").
+ * @param name Format name
+ * @return SINK_EXPORT_* value, or -1 if unknown
+ */
+int sink_export_format(const char *name);
+
+/**
+ * Get the hash sink, which checks per-frame hashes of the full-resolution
+ * indexed pixels, palette and scanline palette patches against golden
+ * lists, one per part (DIR/<sr_part_id_t as two digits>.hash).
+ * @param golden_dir Directory of the golden lists
+ * @param update 1 to write the lists from this run, 0 to check against them
+ * @return Static sink
+ */
+headless_sink_t *sink_hash(const char *golden_dir, int update);
+
+/**
+ * Get the number of parts that diverged from their golden lists.
+ * @return Failed parts of the last hash sink run
+ */
+int sink_hash_failures(void);
+
+#endif /* SINK_H */
@@ -4,174 +4,167 @@
 #include "core/dis.h"
 #include "core/video.h"
 #include "core/part.h"
+#include "core/pack.h"
+#include "core/fetch.h"
+#include "core/table.h"
+#include "core/jobs.h"
+#include "core/pipeline.h"
+#include "core/profile.h"
+#include "core/framecheck.h"
 #include "audio/music.h"
+#include "visu/visu.h"
+#include "parts/parts.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static sg_pass_action pass_action;
 
-/* Test Part 1: Red/Blue gradient bars */
+/* --part NAME: start at this part instead of the first */
+static const char *start_part;
 
-typedef struct {
-    int frame_counter;
-} test_part_data_t;
+/* Input that reaches parts, held while the render thread draws */
+#define MAIN_EVENT_QUEUE 32
+static sapp_event pending_events[MAIN_EVENT_QUEUE];
+static int pending_count;
 
-static test_part_data_t test_part_1_data;
-static test_part_data_t test_part_2_data;
+/* Render thread: tick and draw one frame */
+static void produce_frame(void) {
+    part_loader_tick();
+    part_loader_render();
+    visu_flush();
+}
 
-static void test_part_1_init(sr_part_t *part) {
-    printf("[test_part_1] Initializing\n");
-    test_part_data_t *data = (test_part_data_t *)part->user_data;
-    data->frame_counter = 0;
+static void init(void) {
+    /* Initialize DIS first; parts run on the music's 70 Hz clock */
+    dis_version();
+    dis_set_clock(DIS_CLOCK_MUSIC);
 
-    /* Set up red/blue gradient palette */
-    for (int i = 0; i < 256; i++) {
-        uint8_t r = (uint8_t)((i < 128) ? (i * 63 / 128) : 0);
-        uint8_t b = (uint8_t)((i >= 128) ? ((i - 128) * 63 / 128) : 0);
-        video_set_color((uint8_t)i, r, 0, b);
-    }
-}
+    sg_setup(&(sg_desc){
+        .environment = sglue_environment()
+    });
 
-static int test_part_1_update(sr_part_t *part, int frame_count) {
-    test_part_data_t *data = (test_part_data_t *)part->user_data;
-    data->frame_counter += frame_count;
+    /* Initialize profiler (no-op unless built with SR_PROFILE) */
+    profile_init();
 
-    /* Transition after 200 frames */
-    if (data->frame_counter >= 200) {
-        printf("[test_part_1] Reached %d frames, transitioning\n", data->frame_counter);
-        return 1;
+    /* Initialize video subsystem and the shared 3D rasterizer */
+    video_init();
+    visu_init();
+
+    /* SR_THREADS=N rasterizes 3D parts in bands on N threads (0: per core) */
+    const char *threads = getenv("SR_THREADS");
+    if (threads && jobs_init(atoi(threads)) > 1) {
+        visu_set_bands(jobs_thread_count() * VISU_BANDS_PER_THREAD);
     }
-    return 0;
-}
 
-static void test_part_1_render(sr_part_t *part) {
-    test_part_data_t *data = (test_part_data_t *)part->user_data;
-    uint8_t *fb = video_get_framebuffer();
-
-    /* Animated red/blue gradient bars */
-    int offset = data->frame_counter % 256;
-    for (int y = 0; y < VIDEO_HEIGHT_13H; y++) {
-        for (int x = 0; x < VIDEO_WIDTH; x++) {
-            /* Create vertical bars with animation */
-            int bar = (x / 20 + offset / 4) % 16;
-            uint8_t color = (uint8_t)(bar < 8 ? bar * 16 : 128 + (bar - 8) * 16);
-            fb[y * VIDEO_WIDTH + x] = color;
-        }
+    /* SR_SCALE=2|4 lets parts that support it render supersampled */
+    const char *scale = getenv("SR_SCALE");
+    if (scale) {
+        video_set_max_scale(atoi(scale));
     }
-}
 
-static void test_part_1_cleanup(sr_part_t *part) {
-    (void)part;
-    printf("[test_part_1] Cleanup\n");
-}
+    /* Assets come from the demo pack when present, else loose files. The
+     * web page downloads them instead, one segment per part, as parts
+     * get close (`cmake --build . --target web_assets` on the host) */
+    pack_init();
+    fetch_init();
+#if !defined(__EMSCRIPTEN__)
+    pack_open("MAIN/REALITY.PAK");
+#endif
+    table_init();
 
-/* Test Part 2: Green/Yellow gradient bars */
+    /* Initialize audio subsystem */
+    bool have_music = music_init();
 
-static void test_part_2_init(sr_part_t *part) {
-    printf("[test_part_2] Initializing\n");
-    test_part_data_t *data = (test_part_data_t *)part->user_data;
-    data->frame_counter = 0;
+    /* Initialize part loader */
+    part_loader_init();
 
-    /* Set up green/yellow gradient palette */
-    for (int i = 0; i < 256; i++) {
-        uint8_t g = (uint8_t)(i * 63 / 255);
-        uint8_t r = (uint8_t)((i >= 128) ? ((i - 128) * 63 / 128) : 0);
-        video_set_color((uint8_t)i, r, g, 0);
+    /* Register demo parts */
+    parts_register_all();
+#if defined(__EMSCRIPTEN__)
+    /* Every part reads shared data from it; nothing can run without it */
+    if (part_loader_set_common_pack("MAIN/COMMON.PAK") != 0) {
+        fprintf(stderr, "MAIN: ERROR Cannot request MAIN/COMMON.PAK\n");
+        sapp_quit();
+        return;
     }
-}
+#endif
 
-static int test_part_2_update(sr_part_t *part, int frame_count) {
-    test_part_data_t *data = (test_part_data_t *)part->user_data;
-    data->frame_counter += frame_count;
+    /* Main demo music loads in the background; parts start rendering now */
+    if (have_music) {
+        part_loader_set_music("MAIN/MUSIC0.S3M", 1);
+    }
 
-    /* Exit demo after 200 frames */
-    if (data->frame_counter >= 200) {
-        printf("[test_part_2] Reached %d frames, ending demo\n", data->frame_counter);
-        return 1;
+    /* Start from the first part, or jump to the one asked for */
+    part_loader_set_snapshot_file("MAIN/PARTS.msg");
+    int start_id = start_part ? part_loader_find(start_part) : -1;
+    if (start_part && start_id < 0) {
+        fprintf(stderr, "MAIN: ERROR Unknown part %s, starting from the first\n", start_part);
+    }
+    if (start_id < 0 || part_loader_seek((sr_part_id_t)start_id) != 0) {
+        part_loader_start(0);
     }
-    return 0;
-}
 
-static void test_part_2_render(sr_part_t *part) {
-    test_part_data_t *data = (test_part_data_t *)part->user_data;
-    uint8_t *fb = video_get_framebuffer();
-
-    /* Animated green/yellow gradient bars */
-    int offset = data->frame_counter % 256;
-    for (int y = 0; y < VIDEO_HEIGHT_13H; y++) {
-        for (int x = 0; x < VIDEO_WIDTH; x++) {
-            /* Create vertical bars with animation */
-            int bar = (x / 20 + offset / 4) % 16;
-            uint8_t color = (uint8_t)(bar * 16);
-            fb[y * VIDEO_WIDTH + x] = color;
-        }
+    /* SR_PIPELINE=1 draws on a render thread while this one presents */
+    const char *pipeline = getenv("SR_PIPELINE");
+    if (pipeline && atoi(pipeline) > 0) {
+        pipeline_start(produce_frame);
     }
-}
 
-static void test_part_2_cleanup(sr_part_t *part) {
-    (void)part;
-    printf("[test_part_2] Cleanup\n");
+    /* Black clear color for letterboxing */
+    pass_action = (sg_pass_action){
+        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f } }
+    };
 }
 
-/* Part definitions */
-static sr_part_t test_part_1 = {
-    .name = "TEST_PART_1",
-    .description = "Red/blue gradient test bars",
-    .id = SR_PART_ALKU,
-    .init = test_part_1_init,
-    .update = test_part_1_update,
-    .render = test_part_1_render,
-    .cleanup = test_part_1_cleanup,
-    .user_data = &test_part_1_data
-};
-
-static sr_part_t test_part_2 = {
-    .name = "TEST_PART_2",
-    .description = "Green/yellow gradient test bars",
-    .id = SR_PART_BEG,
-    .init = test_part_2_init,
-    .update = test_part_2_update,
-    .render = test_part_2_render,
-    .cleanup = test_part_2_cleanup,
-    .user_data = &test_part_2_data
-};
-
-static void init(void) {
-    /* Initialize DIS first */
-    dis_version();
+/* Apply input to DIS and the part loader */
+static void handle_part_event(const sapp_event *e) {
+    dis_handle_event(e);
 
-    sg_setup(&(sg_desc){
-        .environment = sglue_environment()
-    });
+    /* Space advances to next part */
+    if (e->type == SAPP_EVENTTYPE_KEY_DOWN && e->key_code == SAPP_KEYCODE_SPACE) {
+        printf("[main] Space pressed, advancing to next part\n");
+        part_loader_next();
+    }
+}
 
-    /* Initialize video subsystem */
-    video_init();
+/* Pipelined frame: parts and DIS are only touched while the render thread
+ * is idle; the display shows the newest frame it finished */
+static void frame_pipelined(void) {
+    if (!pipeline_busy()) {
+        for (int i = 0; i < pending_count; i++) {
+            handle_part_event(&pending_events[i]);
+        }
+        pending_count = 0;
 
-    /* Initialize audio subsystem */
-    if (music_init()) {
-        /* Try to load the main demo music for testing */
-        if (music_load_file("MAIN/MUSIC0.S3M")) {
-            music_play();
+        int ticks = dis_frame_tick();
+        if (dis_exit() || !part_loader_is_running()) {
+            sapp_request_quit();
+            return;
+        }
+        if (ticks > 0) {
+            pipeline_kick();
         }
     }
 
-    /* Initialize part loader */
-    part_loader_init();
-
-    /* Register test parts */
-    part_loader_register(&test_part_1);
-    part_loader_register(&test_part_2);
-
-    /* Start from first part */
-    part_loader_start(0);
-
-    /* Black clear color for letterboxing */
-    pass_action = (sg_pass_action){
-        .colors[0] = { .load_action = SG_LOADACTION_CLEAR, .clear_value = { 0.0f, 0.0f, 0.0f, 1.0f } }
-    };
+    sg_begin_pass(&(sg_pass){ .action = pass_action, .swapchain = sglue_swapchain() });
+    if (video_acquire()) {
+        video_present();
+    } else {
+        video_redraw();
+    }
+    profile_draw_overlay(sapp_width(), sapp_height());
+    sg_end_pass();
+    sg_commit();
 }
 
 static void frame(void) {
-    dis_frame_tick();
+    if (pipeline_active()) {
+        frame_pipelined();
+        return;
+    }
+
+    int ticks = dis_frame_tick();
 
     if (dis_exit()) {
         sapp_request_quit();
@@ -184,37 +177,59 @@ static void frame(void) {
         return;
     }
 
-    /* Update and render current part */
-    part_loader_tick();
-    part_loader_render();
+    /* Update and render current part, only when a retrace elapsed: on
+     * displays faster than 70 Hz the other frames show the same image */
+    if (ticks > 0) {
+        produce_frame();
+    }
 
     sg_begin_pass(&(sg_pass){ .action = pass_action, .swapchain = sglue_swapchain() });
-    video_present();
+    if (ticks > 0) {
+        video_present();
+    } else {
+        video_redraw();
+    }
+    profile_draw_overlay(sapp_width(), sapp_height());
     sg_end_pass();
     sg_commit();
 }
 
 static void cleanup(void) {
+    pipeline_stop();
     part_loader_shutdown();
+    framecheck_report();
+    visu_set_bands(0);
+    jobs_shutdown();
+    pack_shutdown();
+    fetch_shutdown();
+    table_shutdown();
     music_shutdown();
+    profile_shutdown();
     video_shutdown();
     sg_shutdown();
 }
 
 static void event(const sapp_event* e) {
-    /* Let DIS handle events */
-    dis_handle_event(e);
+    /* Let DIS and the part loader handle events, after the frame being
+     * drawn when pipelined */
+    if (!pipeline_active()) {
+        handle_part_event(e);
+    } else if (pending_count < MAIN_EVENT_QUEUE) {
+        pending_events[pending_count++] = *e;
+    }
 
-    /* Space advances to next part */
-    if (e->type == SAPP_EVENTTYPE_KEY_DOWN && e->key_code == SAPP_KEYCODE_SPACE) {
-        printf("[main] Space pressed, advancing to next part\n");
-        part_loader_next();
+    /* F1 toggles the profiler overlay */
+    if (e->type == SAPP_EVENTTYPE_KEY_DOWN && e->key_code == SAPP_KEYCODE_F1) {
+        profile_toggle_overlay();
     }
 }
 
 sapp_desc sokol_main(int argc, char* argv[]) {
-    (void)argc;
-    (void)argv;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--part") == 0) {
+            start_part = argv[++i];
+        }
+    }
     return (sapp_desc){
         .init_cb = init,
         .frame_cb = frame,
@@ -0,0 +1,17 @@
+/**
+ * Demo Parts - Registration of all ported parts
+ *
+ * Parts live in src/parts/ and are compiled into every executable.
+ * The registration order defines the demo sequence.
+ */
+
+#ifndef PARTS_H
+#define PARTS_H
+
+/**
+ * Register all demo parts with the part loader, in sequence order.
+ * Must be called after part_loader_init().
+ */
+void parts_register_all(void);
+
+#endif /* PARTS_H */
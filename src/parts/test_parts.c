@@ -0,0 +1,162 @@
+/**
+ * Test Parts - Placeholder parts exercising the part loader
+ *
+ * Shared by the windowed and headless executables so both run the
+ * same sequence. Each names the pack segment of the demo part whose id
+ * it borrows, so the web build holds it until the segment is in;
+ * natively the segments are absent and the request fails quietly.
+ */
+
+#include "parts.h"
+#include "core/part.h"
+#include "core/video.h"
+#include <stdio.h>
+
+/* Test Part 1: Red/Blue gradient bars */
+
+typedef struct {
+    int frame_counter;
+    uint8_t palette[768];   /* Built by prepare, applied by init */
+} test_part_data_t;
+
+static test_part_data_t test_part_1_data;
+static test_part_data_t test_part_2_data;
+
+static void test_part_1_prepare(sr_part_t *part) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+
+    /* Red/blue gradient palette */
+    for (int i = 0; i < 256; i++) {
+        data->palette[i * 3 + 0] = (uint8_t)((i < 128) ? (i * 63 / 128) : 0);
+        data->palette[i * 3 + 1] = 0;
+        data->palette[i * 3 + 2] = (uint8_t)((i >= 128) ? ((i - 128) * 63 / 128) : 0);
+    }
+}
+
+static void test_part_1_init(sr_part_t *part) {
+    printf("[test_part_1] Initializing\n");
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    data->frame_counter = 0;
+    video_set_palette(data->palette);
+}
+
+static int test_part_1_update(sr_part_t *part, int frame_count) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    data->frame_counter += frame_count;
+
+    /* Transition after 200 frames */
+    if (data->frame_counter >= 200) {
+        return 1;     /* Logged in cleanup: no stdio in the frame path */
+    }
+    return 0;
+}
+
+static void test_part_1_render(sr_part_t *part) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    uint8_t *fb = video_get_framebuffer();
+
+    /* Animated red/blue gradient bars */
+    int offset = data->frame_counter % 256;
+    for (int y = 0; y < VIDEO_HEIGHT_13H; y++) {
+        for (int x = 0; x < VIDEO_WIDTH; x++) {
+            /* Create vertical bars with animation */
+            int bar = (x / 20 + offset / 4) % 16;
+            uint8_t color = (uint8_t)(bar < 8 ? bar * 16 : 128 + (bar - 8) * 16);
+            fb[y * VIDEO_WIDTH + x] = color;
+        }
+    }
+}
+
+static void test_part_1_cleanup(sr_part_t *part) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    printf("[test_part_1] Cleanup after %d frames\n", data->frame_counter);
+}
+
+/* Test Part 2: Green/Yellow gradient bars */
+
+static void test_part_2_prepare(sr_part_t *part) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+
+    /* Green/yellow gradient palette */
+    for (int i = 0; i < 256; i++) {
+        data->palette[i * 3 + 0] = (uint8_t)((i >= 128) ? ((i - 128) * 63 / 128) : 0);
+        data->palette[i * 3 + 1] = (uint8_t)(i * 63 / 255);
+        data->palette[i * 3 + 2] = 0;
+    }
+}
+
+static void test_part_2_init(sr_part_t *part) {
+    printf("[test_part_2] Initializing\n");
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    data->frame_counter = 0;
+    video_set_palette(data->palette);
+}
+
+static int test_part_2_update(sr_part_t *part, int frame_count) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    data->frame_counter += frame_count;
+
+    /* Exit demo after 200 frames */
+    if (data->frame_counter >= 200) {
+        return 1;
+    }
+    return 0;
+}
+
+/* Hi-res when granted (--scale 2): odd lines of a block shift the bar
+ * edges by one hi-res pixel, detail only a full-resolution reader sees */
+static void test_part_2_render(sr_part_t *part) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    int scale = video_get_scale();
+    uint8_t *fb = scale > VIDEO_SCALE_NATIVE ? video_get_hires_framebuffer() : video_get_framebuffer();
+    int width = VIDEO_WIDTH * scale;
+
+    /* Animated green/yellow gradient bars */
+    int offset = data->frame_counter % 256;
+    for (int y = 0; y < VIDEO_HEIGHT_13H * scale; y++) {
+        for (int x = 0; x < width; x++) {
+            /* Create vertical bars with animation */
+            int bar = ((x + y % scale) / (20 * scale) + offset / 4) % 16;
+            uint8_t color = (uint8_t)(bar * 16);
+            fb[y * width + x] = color;
+        }
+    }
+}
+
+static void test_part_2_cleanup(sr_part_t *part) {
+    test_part_data_t *data = (test_part_data_t *)part->user_data;
+    printf("[test_part_2] Cleanup after %d frames\n", data->frame_counter);
+}
+
+/* Part definitions */
+static sr_part_t test_part_1 = {
+    .name = "TEST_PART_1",
+    .description = "Red/blue gradient test bars",
+    .id = SR_PART_ALKU,
+    .init = test_part_1_init,
+    .update = test_part_1_update,
+    .render = test_part_1_render,
+    .cleanup = test_part_1_cleanup,
+    .prepare = test_part_1_prepare,
+    .pack = "MAIN/ALKU.PAK",
+    .user_data = &test_part_1_data
+};
+
+static sr_part_t test_part_2 = {
+    .name = "TEST_PART_2",
+    .description = "Green/yellow gradient test bars",
+    .id = SR_PART_BEG,
+    .init = test_part_2_init,
+    .update = test_part_2_update,
+    .render = test_part_2_render,
+    .cleanup = test_part_2_cleanup,
+    .prepare = test_part_2_prepare,
+    .max_scale = 2,
+    .pack = "MAIN/BEG.PAK",
+    .user_data = &test_part_2_data
+};
+
+void parts_register_all(void) {
+    part_loader_register(&test_part_1);
+    part_loader_register(&test_part_2);
+}
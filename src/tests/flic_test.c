@@ -0,0 +1,143 @@
+/**
+ * FLIC Player tests - Malformed frames are rejected, not applied
+ *
+ * Writes small FLC files to the working directory and plays them through
+ * flic_open()/flic_next_frame() on the headless core. A run under a
+ * sanitizer also catches writes outside the framebuffer.
+ *
+ * Usage: flic_test (exit status 0 when every case passes)
+ */
+
+#include "core/flic.h"
+#include "core/pack.h"
+#include "core/video.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_FILE "FLICTEST.FLC"
+#define TEST_WIDTH 32
+#define TEST_HEIGHT 16
+
+/* Bytes for the malicious skip run: enough 0xC000 words (16384 lines
+ * each) to wrap a 32-bit line counter round to -16384 */
+#define TEST_SKIP_WORDS 262143
+
+static int s_failures;
+
+static void put16(uint8_t *p, unsigned v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    put16(p, v & 0xFFFFu);
+    put16(p + 2, v >> 16);
+}
+
+static void check(int ok, const char *what) {
+    printf("[flic_test] %s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+/* Append one frame holding a single DELTA_FLC chunk; returns its end */
+static uint8_t *put_frame(uint8_t *p, const uint8_t *delta, size_t delta_size) {
+    uint32_t chunk_size = (uint32_t)(6 + delta_size);
+    put32(p, 16 + chunk_size);
+    put16(p + 4, 0xF1FA);
+    put16(p + 6, 1);
+    memset(p + 8, 0, 8);
+    put32(p + 16, chunk_size);
+    put16(p + 20, 7);           /* DELTA_FLC */
+    memcpy(p + 22, delta, delta_size);
+    return p + 22 + delta_size;
+}
+
+/* Write a two-frame FLC: a valid delta, then the given one */
+static int write_file(const uint8_t *delta, size_t delta_size) {
+    static const uint8_t good[] = {
+        0x01, 0x00,             /* 1 line */
+        0xFE, 0xFF,             /* Skip 2 lines */
+        0x01, 0x00,             /* 1 packet */
+        0x04, 0x01, 0xAB, 0xCD  /* Skip 4 pixels, copy one pair */
+    };
+    size_t size = 128 + 2 * 22 + sizeof(good) + delta_size;
+    uint8_t *data = calloc(1, size);
+    if (!data) {
+        return -1;
+    }
+    put32(data, (uint32_t)size);
+    put16(data + 4, 0xAF12);
+    put16(data + 6, 2);
+    put16(data + 8, TEST_WIDTH);
+    put16(data + 10, TEST_HEIGHT);
+    put16(data + 12, 8);
+    put32(data + 16, 1000 / 70);
+    uint8_t *end = put_frame(data + 128, good, sizeof(good));
+    put_frame(end, delta, delta_size);
+
+    FILE *f = fopen(TEST_FILE, "wb");
+    int ok = f && fwrite(data, 1, size, f) == size;
+    if (f && fclose(f) != 0) {
+        ok = 0;
+    }
+    free(data);
+    return ok ? 0 : -1;
+}
+
+/* Play both frames: the first must apply, the second must be refused */
+static void run_case(const char *what, const uint8_t *delta, size_t delta_size) {
+    uint8_t *fb = video_get_framebuffer();
+    memset(fb, 0, (size_t)VIDEO_WIDTH * TEST_HEIGHT);
+
+    flic_t flic;
+    if (write_file(delta, delta_size) != 0 || flic_open(&flic, TEST_FILE, 0) != 0) {
+        check(0, what);
+        return;
+    }
+    int first = flic_next_frame(&flic);
+    int applied = fb[2 * VIDEO_WIDTH + 4] == 0xAB && fb[2 * VIDEO_WIDTH + 5] == 0xCD;
+    int second = flic_next_frame(&flic);
+    flic_close(&flic);
+    check(first == 1 && applied && second == -1, what);
+}
+
+int main(void) {
+    pack_init();
+
+    /* Skip words until the line counter would wrap negative, then an odd
+     * last pixel, which would land far before the framebuffer */
+    size_t size = 2 + TEST_SKIP_WORDS * 2 + 4;
+    uint8_t *delta = malloc(size);
+    if (!delta) {
+        return 1;
+    }
+    put16(delta, 1);
+    for (size_t i = 0; i < TEST_SKIP_WORDS; i++) {
+        put16(delta + 2 + i * 2, 0xC000);
+    }
+    put16(delta + size - 4, 0x8000 | 0x77);
+    put16(delta + size - 2, 0);
+    run_case("line skips wrapping the line counter", delta, size);
+    free(delta);
+
+    /* One skip past the last line, then a packet for that line */
+    static const uint8_t past_end[] = {
+        0x01, 0x00,
+        0x00, 0xFF,             /* Skip 256 lines of 16 */
+        0x01, 0x00,
+        0x00, 0x01, 0x11, 0x22
+    };
+    run_case("line skip past the last line", past_end, sizeof(past_end));
+
+    remove(TEST_FILE);
+    pack_shutdown();
+    if (s_failures > 0) {
+        printf("[flic_test] %d case(s) failed\n", s_failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * Music Index tests - Row timing agrees with libopenmpt's own seeking
+ *
+ * Builds the sync index of each shipped module, then seeks libopenmpt by
+ * time to the middle of every row the index reached and checks it lands
+ * on that order and row. An effect the index walk reads differently from
+ * playback (speed, tempo, breaks, jumps, row delays) shows up as the
+ * rows after it drifting.
+ *
+ * Usage: music_index_test MAIN_DIR (exit status 0 when every module passes)
+ */
+
+#include "audio/music_index.h"
+#include <libopenmpt/libopenmpt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_SAMPLE_RATE 48000
+#define TEST_MAX_REPORTS 8
+
+static int compare_sample(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    void *data = NULL;
+    long n = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    if (n > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        data = malloc((size_t)n);
+    }
+    if (data && fread(data, 1, (size_t)n, f) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)n;
+    return data;
+}
+
+/* First row start after sample, or the song end */
+static uint32_t next_start(const uint32_t *starts, int count, uint32_t sample, uint32_t end) {
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (starts[mid] <= sample) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < count ? starts[lo] : end;
+}
+
+/* @return Number of rows libopenmpt placed elsewhere, -1 if not tested */
+static int check_module(const char *dir, const char *file) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    size_t size = 0;
+    void *data = read_file(path, &size);
+    if (!data) {
+        fprintf(stderr, "MUSIC_INDEX_TEST: ERROR Cannot read %s\n", path);
+        return -1;
+    }
+    openmpt_module *mod = openmpt_module_create_from_memory2(data, size, NULL, NULL, NULL, NULL,
+                                                             NULL, NULL, NULL);
+    music_index_t index;
+    memset(&index, 0, sizeof(index));
+    if (!mod || music_index_build(&index, mod, TEST_SAMPLE_RATE,
+                                  music_index_hash(data, size), (uint32_t)size) != 0) {
+        fprintf(stderr, "MUSIC_INDEX_TEST: ERROR Cannot index %s\n", path);
+        if (mod) {
+            openmpt_module_destroy(mod);
+        }
+        free(data);
+        return -1;
+    }
+
+    uint32_t *starts = malloc(sizeof(uint32_t) * (size_t)(index.num_rows > 0 ? index.num_rows : 1));
+    int count = 0;
+    for (int i = 0; starts && i < index.num_rows; i++) {
+        if (index.row_sample[i] != MUSIC_INDEX_UNREACHED) {
+            starts[count++] = index.row_sample[i];
+        }
+    }
+    if (starts) {
+        qsort(starts, (size_t)count, sizeof(starts[0]), compare_sample);
+    }
+
+    int checked = 0;
+    int wrong = 0;
+    for (int order = 0; starts && order < index.num_orders; order++) {
+        for (int row = 0; row < index.order_rows[order]; row++) {
+            uint32_t start = music_index_row_sample(&index, order, row);
+            if (start == MUSIC_INDEX_UNREACHED) {
+                continue;
+            }
+            uint32_t end = next_start(starts, count, start, index.end_sample);
+            double seconds = (start + (end - start) / 2.0) / TEST_SAMPLE_RATE;
+            openmpt_module_set_position_seconds(mod, seconds);
+            int at_order = openmpt_module_get_current_order(mod);
+            int at_row = openmpt_module_get_current_row(mod);
+            checked++;
+            if (at_order != order || at_row != row) {
+                if (wrong < TEST_MAX_REPORTS) {
+                    printf("[music_index_test] %s order %d row %d (%.3f s): libopenmpt at order %d row %d\n",
+                           file, order, row, seconds, at_order, at_row);
+                }
+                wrong++;
+            }
+        }
+    }
+    int result = starts ? wrong : -1;
+    printf("[music_index_test] %s: %s, %d of %d rows where libopenmpt plays them\n",
+           file, result == 0 ? "PASS" : "FAIL", checked - wrong, checked);
+
+    free(starts);
+    music_index_free(&index);
+    openmpt_module_destroy(mod);
+    free(data);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: music_index_test MAIN_DIR\n");
+        return 2;
+    }
+    static const char *const modules[] = { "MUSIC0.S3M", "MUSIC1.S3M" };
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(modules) / sizeof(modules[0]); i++) {
+        if (check_module(argv[1], modules[i]) != 0) {
+            failures++;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
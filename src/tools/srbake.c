@@ -0,0 +1,138 @@
+/**
+ * srbake - Bake original assets into a pack archive
+ *
+ * Modern counterpart of UTIL/DOOBJ and UTIL/LBM2P. .INC tables are
+ * assembled and .LBM pictures decoded once, at build time, into baked
+ * blobs that asset_table() and asset_image() serve straight from the
+ * mapped pack. Other files are stored as is, so one run can build the
+ * whole demo pack. Entry names follow srpack: the file arguments as
+ * given, relative to -C DIR when set.
+ *
+ * Usage: srbake [-C DIR] [-z] OUT.PAK FILE...
+ *   -z  LZ-compress baked blobs where that saves space (unpacked into
+ *       part memory on load instead of zero-copy)
+ */
+
+#include "core/asset.h"
+#include "core/asset_bake.h"
+#include "core/pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Read a whole file into memory */
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    uint8_t *data = NULL;
+    long n = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        n = ftell(f);
+        fseek(f, 0, SEEK_SET);
+    }
+    if (n >= 0) {
+        data = malloc((size_t)n + 1);
+    }
+    if (data && fread(data, 1, (size_t)n, f) != (size_t)n) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)n;
+    return data;
+}
+
+/* Convert one file into its pack entry
+ * @return Entry contents (free() them), or NULL on error */
+static uint8_t *bake_file(const char *path, const char *name, int compress, size_t *size) {
+    size_t length;
+    uint8_t *data = read_file(path, &length);
+    if (!data) {
+        fprintf(stderr, "BAKE: ERROR Cannot read %s\n", path);
+        return NULL;
+    }
+
+    int type = bake_has_extension(name, ".INC") ? ASSET_TYPE_TABLE :
+               bake_has_extension(name, ".LBM") ? ASSET_TYPE_IMAGE : 0;
+    if (type == 0) {
+        *size = length;
+        return data;
+    }
+
+    size_t payload_size = 0;
+    uint8_t *payload = type == ASSET_TYPE_TABLE ?
+                       bake_inc(name, (const char *)data, length, &payload_size) :
+                       bake_lbm(name, data, length, &payload_size);
+    free(data);
+    if (!payload) {
+        return NULL;
+    }
+    uint8_t *blob = bake_blob(type, payload, payload_size, compress, size);
+    free(payload);
+    if (blob) {
+        printf("[srbake] %s: %zu -> %zu bytes%s\n", name, length, *size,
+               ((const asset_header_t *)blob)->flags & ASSET_FLAG_LZ ? " (lz)" : "");
+    }
+    return blob;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = NULL;
+    int compress = 0;
+    int arg = 1;
+    for (;;) {
+        if (arg + 1 < argc && strcmp(argv[arg], "-C") == 0) {
+            dir = argv[arg + 1];
+            arg += 2;
+        } else if (arg < argc && strcmp(argv[arg], "-z") == 0) {
+            compress = 1;
+            arg++;
+        } else {
+            break;
+        }
+    }
+    if (argc - arg < 1) {
+        fprintf(stderr, "Usage: %s [-C DIR] [-z] OUT.PAK FILE...\n", argv[0]);
+        return 1;
+    }
+
+    const char *out = argv[arg++];
+    int num_files = argc - arg;
+    const char **names = (const char **)&argv[arg];
+    uint8_t **blobs = calloc((size_t)num_files + 1, sizeof(uint8_t *));
+    size_t *sizes = calloc((size_t)num_files + 1, sizeof(size_t));
+    if (!blobs || !sizes) {
+        return 1;
+    }
+
+    int rc = 0;
+    for (int i = 0; i < num_files && rc == 0; i++) {
+        char path[1024];
+        int n = dir ? snprintf(path, sizeof(path), "%s/%s", dir, names[i]) :
+                      snprintf(path, sizeof(path), "%s", names[i]);
+        if (n < 0 || (size_t)n >= sizeof(path)) {
+            fprintf(stderr, "BAKE: ERROR Path too long: %s\n", names[i]);
+            rc = -1;
+            break;
+        }
+        blobs[i] = bake_file(path, names[i], compress, &sizes[i]);
+        if (!blobs[i]) {
+            rc = -1;
+        }
+    }
+    if (rc == 0) {
+        rc = pack_write_data(out, num_files, (const void *const *)blobs, sizes, names);
+    }
+    if (rc == 0) {
+        printf("[srbake] Wrote %s (%d files)\n", out, num_files);
+    }
+
+    for (int i = 0; i < num_files; i++) {
+        free(blobs[i]);
+    }
+    free(blobs);
+    free(sizes);
+    return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+/**
+ * srpack - Build a pack archive for the core pack loader
+ *
+ * Counterpart of the original MAIN/PACK.C. Entry names are the file
+ * arguments as given, relative to -C DIR when set, so parts look assets
+ * up by the same path they would open loose (e.g. GLENZ/GLENZ.INC).
+ *
+ * Usage: srpack [-C DIR] OUT.PAK FILE...
+ */
+
+#include "core/pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]) {
+    const char *dir = NULL;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "-C") == 0) {
+        dir = argv[arg + 1];
+        arg += 2;
+    }
+    if (argc - arg < 1) {
+        fprintf(stderr, "Usage: %s [-C DIR] OUT.PAK FILE...\n", argv[0]);
+        return 1;
+    }
+
+    const char *out = argv[arg++];
+    int num_files = argc - arg;
+    const char **names = (const char **)&argv[arg];
+    const char **files = names;
+    char **joined = NULL;
+    if (dir) {
+        joined = calloc((size_t)num_files + 1, sizeof(char *));
+        if (!joined) {
+            return 1;
+        }
+        for (int i = 0; i < num_files; i++) {
+            joined[i] = malloc(strlen(dir) + strlen(names[i]) + 2);
+            if (!joined[i]) {
+                return 1;
+            }
+            sprintf(joined[i], "%s/%s", dir, names[i]);
+        }
+        files = (const char **)joined;
+    }
+
+    int rc = pack_write(out, num_files, files, names);
+    if (rc == 0) {
+        printf("[srpack] Wrote %s (%d files)\n", out, num_files);
+    }
+    if (joined) {
+        for (int i = 0; i < num_files; i++) {
+            free(joined[i]);
+        }
+        free(joined);
+    }
+    return rc == 0 ? 0 : 1;
+}
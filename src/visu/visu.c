@@ -0,0 +1,585 @@
+/**
+ * VISU - Implementation
+ *
+ * Port of the 2D half of the VISU draw path: newclip (ADRAWCLP.ASM)
+ * clips against the window sides, poly_nrm/poly_grd (ADRAW.ASM) walk the
+ * left and right edges from the top vertex, and drawfill_nrm/grd
+ * (AVIDFILL.ASM) step the edges and fill the spans. The original split
+ * the work through a fill data stream and VGA plane masks; here the
+ * edges feed the span kernels directly in linear memory.
+ */
+
+#include "visu.h"
+#include "visu_span.h"
+#include "core/jobs.h"
+#include "core/video.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Vertices a polygon can grow to while clipping (one per side for
+ * convex input, bounded for anything else) */
+#define VISU_CLIP_SIDES (VISU_MAX_SIDES * 2)
+
+/* Clip multiplier precision (NEWCLIPCALC: 0..16384) */
+#define VISU_CLIP_SHIFT 14
+
+/* Window sides a vertex lies outside of (the original VF_* flags) */
+#define VISU_OUT_UP     1
+#define VISU_OUT_DOWN   2
+#define VISU_OUT_LEFT   4
+#define VISU_OUT_RIGHT  8
+
+/* Thinnest band */
+#define VISU_BAND_MIN_ROWS 8
+
+/* Clipped polygon or line, as queued for banded drawing */
+typedef struct {
+    uint8_t line;       /* 1: line v[0]-v[1], 0: polygon */
+    uint8_t mode;
+    uint8_t color;
+    uint8_t sides;
+    int16_t y0;         /* Rows written: y0 <= y < y1 */
+    int16_t y1;
+    int16_t window[4];  /* Lines: clip window x0, y0, x1, y1 */
+    visu_vertex_t v[VISU_CLIP_SIDES];
+} visu_cmd_t;
+
+typedef struct {
+    int32_t x;          /* 16.16, centered on the pixel */
+    int32_t dx;
+    int32_t color;      /* 8.8 */
+    int32_t dcolor;
+    int rows;           /* Rows left on this edge */
+    int vertex;         /* Vertex the edge runs to */
+} visu_edge_t;
+
+static struct {
+    uint8_t *target;    /* NULL: video framebuffer */
+    int pitch;          /* Bytes per target line */
+    int clip_x0;
+    int clip_y0;
+    int clip_x1;
+    int clip_y1;
+
+    /* Banded drawing (bands == 0: draw immediately) */
+    int bands;
+    visu_cmd_t *cmds;   /* VISU_QUEUE_SIZE */
+    int count;
+    int overflows;      /* Early flushes of a full queue */
+    int *bins;          /* Command indices per band, in submission order
+                         * (room for every command in every band) */
+    int bin_start[VISU_MAX_BANDS + 1];
+    int band_y0;        /* First row of band 0 in this flush */
+    int band_rows;
+    uint8_t *band_target;
+    int band_pitch;
+} visu_state = { .pitch = VIDEO_WIDTH, .clip_x1 = VIDEO_WIDTH - 1, .clip_y1 = VIDEO_HEIGHT_13H - 1 };
+
+void visu_init(void) {
+    visu_span_init();
+    visu_set_target(NULL);
+    visu_window(0, 0, VIDEO_WIDTH - 1, VIDEO_HEIGHT_13H - 1);
+}
+
+void visu_set_target(uint8_t *pixels) {
+    visu_set_target_pitch(pixels, VIDEO_WIDTH);
+}
+
+void visu_set_target_pitch(uint8_t *pixels, int pitch) {
+    if (pixels != visu_state.target || pitch != visu_state.pitch) {
+        visu_flush();
+    }
+    visu_state.target = pixels;
+    visu_state.pitch = pitch;
+}
+
+void visu_window(int x0, int y0, int x1, int y1) {
+    visu_state.clip_x0 = x0;
+    visu_state.clip_y0 = y0;
+    visu_state.clip_x1 = x1;
+    visu_state.clip_y1 = y1;
+}
+
+const char *visu_get_span_kernel(void) {
+    return visu_span_name();
+}
+
+static uint8_t *target(void) {
+    return visu_state.target ? visu_state.target : video_get_framebuffer();
+}
+
+static int outcode(int x, int y) {
+    int code = 0;
+    if (y < visu_state.clip_y0) {
+        code |= VISU_OUT_UP;
+    }
+    if (y > visu_state.clip_y1) {
+        code |= VISU_OUT_DOWN;
+    }
+    if (x < visu_state.clip_x0) {
+        code |= VISU_OUT_LEFT;
+    }
+    if (x > visu_state.clip_x1) {
+        code |= VISU_OUT_RIGHT;
+    }
+    return code;
+}
+
+/* Clipping */
+
+static int16_t *clip_coord(visu_vertex_t *v, int vertical) {
+    return vertical ? &v->y : &v->x;
+}
+
+static int16_t *other_coord(visu_vertex_t *v, int vertical) {
+    return vertical ? &v->x : &v->y;
+}
+
+/* NEWCLIPCALC: interpolate from the end with the smaller clipped
+ * coordinate, so an edge shared by two polygons clips the same way */
+static visu_vertex_t clip_point(visu_vertex_t p, visu_vertex_t q, int vertical, int limit) {
+    visu_vertex_t a = *clip_coord(&p, vertical) < *clip_coord(&q, vertical) ? p : q;
+    visu_vertex_t b = *clip_coord(&p, vertical) < *clip_coord(&q, vertical) ? q : p;
+    int32_t ac = *clip_coord(&a, vertical);
+    int32_t t = (int32_t)(limit - ac) * (1 << VISU_CLIP_SHIFT) /
+                (int32_t)(*clip_coord(&b, vertical) - ac);
+    int32_t ao = *other_coord(&a, vertical);
+    int32_t bo = *other_coord(&b, vertical);
+
+    visu_vertex_t r;
+    *clip_coord(&r, vertical) = (int16_t)limit;
+    *other_coord(&r, vertical) = (int16_t)(ao + (((bo - ao) * t) >> VISU_CLIP_SHIFT));
+    r.color = (uint16_t)(a.color + ((((int32_t)b.color - a.color) * t) >> VISU_CLIP_SHIFT));
+    return r;
+}
+
+static int clip_add(visu_vertex_t *out, int count, visu_vertex_t v) {
+    if (count > 0 && out[count - 1].x == v.x && out[count - 1].y == v.y) {
+        return count;
+    }
+    if (count == VISU_CLIP_SIDES) {
+        return count;
+    }
+    out[count] = v;
+    return count + 1;
+}
+
+/* Clip against one window side: keep = +1 keeps coords >= limit,
+ * -1 keeps coords <= limit */
+static int clip_side(const visu_vertex_t *in, int count, visu_vertex_t *out,
+                     int vertical, int limit, int keep) {
+    int n = 0;
+    visu_vertex_t prev = in[count - 1];
+    int prev_in = (*clip_coord(&prev, vertical) - limit) * keep >= 0;
+    for (int i = 0; i < count; i++) {
+        visu_vertex_t cur = in[i];
+        int cur_in = (*clip_coord(&cur, vertical) - limit) * keep >= 0;
+        if (cur_in != prev_in) {
+            n = clip_add(out, n, clip_point(prev, cur, vertical, limit));
+        }
+        if (cur_in) {
+            n = clip_add(out, n, cur);
+        }
+        prev = cur;
+        prev_in = cur_in;
+    }
+    if (n > 1 && out[n - 1].x == out[0].x && out[n - 1].y == out[0].y) {
+        n--;
+    }
+    return n;
+}
+
+/* newclip: up, down, left, right, only the sides some vertex is outside
+ * of. Returns the clipped vertex count, the result in *result. */
+static int clip_poly(const visu_vertex_t *vertices, int sides, visu_vertex_t buffers[2][VISU_CLIP_SIDES],
+                     const visu_vertex_t **result) {
+    int any = 0;
+    int all = VISU_OUT_UP | VISU_OUT_DOWN | VISU_OUT_LEFT | VISU_OUT_RIGHT;
+    for (int i = 0; i < sides; i++) {
+        int code = outcode(vertices[i].x, vertices[i].y);
+        any |= code;
+        all &= code;
+    }
+    *result = vertices;
+    if (all) {
+        return 0;
+    }
+    if (!any) {
+        return sides;
+    }
+
+    static const struct {
+        int flag;
+        int vertical;
+        int keep;
+    } passes[4] = {
+        { VISU_OUT_UP, 1, 1 },
+        { VISU_OUT_DOWN, 1, -1 },
+        { VISU_OUT_LEFT, 0, 1 },
+        { VISU_OUT_RIGHT, 0, -1 },
+    };
+    const int limits[4] = { visu_state.clip_y0, visu_state.clip_y1,
+                            visu_state.clip_x0, visu_state.clip_x1 };
+    const visu_vertex_t *in = vertices;
+    int count = sides;
+    int buffer = 0;
+    for (int p = 0; p < 4 && count > 0; p++) {
+        if (!(any & passes[p].flag)) {
+            continue;
+        }
+        count = clip_side(in, count, buffers[buffer], passes[p].vertical, limits[p], passes[p].keep);
+        in = buffers[buffer];
+        buffer ^= 1;
+    }
+    *result = in;
+    return count;
+}
+
+/* Filling */
+
+/* POLYSIDECALC(_GRD): start at the pixel center, 16.16 slope by idiv */
+static void edge_setup(visu_edge_t *edge, const visu_vertex_t *from, const visu_vertex_t *to,
+                       int rows, int vertex) {
+    edge->x = (int32_t)from->x * 65536 + 32768;
+    edge->dx = (int32_t)(to->x - from->x) * 65536 / rows;
+    edge->color = from->color;
+    edge->dcolor = ((int32_t)to->color - from->color) / rows;
+    edge->rows = rows;
+    edge->vertex = vertex;
+}
+
+/* Reload an exhausted edge, walking dir (-1 left, +1 right) past flat
+ * sides. Returns 0 when the edge turns upwards (bottom reached). */
+static int edge_reload(visu_edge_t *edge, const visu_vertex_t *v, int sides, int dir) {
+    int from = edge->vertex;
+    for (int guard = 0; guard < sides; guard++) {
+        int to = (from + dir + sides) % sides;
+        int rows = v[to].y - v[from].y;
+        if (rows < 0) {
+            return 0;
+        }
+        if (rows > 0) {
+            edge_setup(edge, &v[from], &v[to], rows, to);
+            return 1;
+        }
+        from = to;
+    }
+    return 0;
+}
+
+/* drawfill_nrm/grd: step both edges, then fill [min, max) of the row */
+static void fill_rows(uint8_t *row, int pitch, int rows, visu_edge_t *left, visu_edge_t *right,
+                      int mode, uint8_t color) {
+    for (int r = 0; r < rows; r++, row += pitch) {
+        left->x += left->dx;
+        right->x += right->dx;
+        left->color += left->dcolor;
+        right->color += right->dcolor;
+
+        int x0 = left->x >> 16;
+        int x1 = right->x >> 16;
+        int32_t c0 = left->color;
+        int32_t c1 = right->color;
+        if (x0 == x1) {
+            continue;
+        }
+        if (x0 > x1) {
+            int t = x0;
+            x0 = x1;
+            x1 = t;
+            c0 = right->color;
+            c1 = left->color;
+        }
+
+        int count = x1 - x0;
+        switch (mode) {
+        case VISU_FILL_GOURAUD: {
+            /* Color step through the reciprocal table (AFILLDIV.INC) */
+            int32_t dc = c1 - c0;
+            int32_t step = 0;
+            if (count > 1) {
+                int32_t mag = (int32_t)(((int64_t)(dc < 0 ? -dc : dc) * (65536 / count)) >> 16);
+                step = dc < 0 ? -mag : mag;
+            }
+            visu_span_gouraud(row + x0, count, (uint16_t)c0, (int16_t)step);
+            break;
+        }
+        case VISU_FILL_GLENZ:
+            visu_span_glenz(row + x0, count, color);
+            break;
+        default:
+            memset(row + x0, color, (size_t)count);
+            break;
+        }
+    }
+}
+
+static void edge_advance(visu_edge_t *edge, int rows) {
+    edge->x += edge->dx * rows;
+    edge->color += edge->dcolor * rows;
+}
+
+/* Fill the rows of a clipped polygon that fall in [r0, r1). Edges step
+ * over the rows outside with one multiply, which lands on the same 16.16
+ * values as stepping row by row, so every band matches a full draw. */
+static void raster_poly(const visu_cmd_t *cmd, uint8_t *pixels, int pitch, int r0, int r1) {
+    const visu_vertex_t *v = cmd->v;
+    int sides = cmd->sides;
+
+    /* Uppermost vertex (first of equals) */
+    int top = 0;
+    for (int i = 1; i < sides; i++) {
+        if (v[i].y < v[top].y) {
+            top = i;
+        }
+    }
+
+    visu_edge_t left = { .vertex = top };
+    visu_edge_t right = { .vertex = top };
+    int y = cmd->y0;
+    while (y < cmd->y1 && y < r1) {
+        if (left.rows == 0 && !edge_reload(&left, v, sides, -1)) {
+            break;
+        }
+        if (right.rows == 0 && !edge_reload(&right, v, sides, 1)) {
+            break;
+        }
+        int rows = left.rows < right.rows ? left.rows : right.rows;
+        int s0 = y > r0 ? y : r0;
+        int s1 = y + rows < r1 ? y + rows : r1;
+        if (s0 < s1) {
+            edge_advance(&left, s0 - y);
+            edge_advance(&right, s0 - y);
+            fill_rows(pixels + (size_t)s0 * pitch, pitch, s1 - s0, &left, &right, cmd->mode, cmd->color);
+            edge_advance(&left, y + rows - s1);
+            edge_advance(&right, y + rows - s1);
+        } else {
+            edge_advance(&left, rows);
+            edge_advance(&right, rows);
+        }
+        left.rows -= rows;
+        right.rows -= rows;
+        y += rows;
+    }
+}
+
+/* nrlineto: DDA along the major axis with a 16-bit minor fraction,
+ * walked from the end point towards the start. Pixels outside the
+ * window or [r0, r1) are skipped. */
+static void raster_line(const visu_cmd_t *cmd, uint8_t *pixels, int pitch, int r0, int r1) {
+    int x0 = cmd->v[0].x;
+    int y0 = cmd->v[0].y;
+    int x1 = cmd->v[1].x;
+    int y1 = cmd->v[1].y;
+    int top = cmd->window[1] > r0 ? cmd->window[1] : r0;
+    int bottom = cmd->window[3] < r1 - 1 ? cmd->window[3] : r1 - 1;
+
+    int xdif = x0 - x1;
+    int ydif = y0 - y1;
+    int xsgn = (xdif > 0) - (xdif < 0);
+    int ysgn = (ydif > 0) - (ydif < 0);
+    int xabs = xdif < 0 ? -xdif : xdif;
+    int yabs = ydif < 0 ? -ydif : ydif;
+
+    int major = xabs >= yabs ? xabs : yabs;
+    int minor = xabs >= yabs ? yabs : xabs;
+    uint32_t add = major == 0 ? 0 : major == minor ? 65535u : ((uint32_t)minor << 16) / (uint32_t)major;
+    uint32_t frac = 32767;
+    int x = x1;
+    int y = y1;
+    for (int i = 0; i <= major; i++) {
+        if (x >= cmd->window[0] && x <= cmd->window[2] && y >= top && y <= bottom) {
+            pixels[(size_t)y * pitch + x] = cmd->color;
+        }
+        frac += add;
+        if (xabs >= yabs) {
+            x += xsgn;
+            if (frac > 0xFFFF) {
+                y += ysgn;
+            }
+        } else {
+            y += ysgn;
+            if (frac > 0xFFFF) {
+                x += xsgn;
+            }
+        }
+        frac &= 0xFFFF;
+    }
+}
+
+static void raster(const visu_cmd_t *cmd, uint8_t *pixels, int pitch, int r0, int r1) {
+    if (cmd->line) {
+        raster_line(cmd, pixels, pitch, r0, r1);
+    } else {
+        raster_poly(cmd, pixels, pitch, r0, r1);
+    }
+}
+
+/* Banded drawing */
+
+/* Queue a command for visu_flush(), or draw it now without bands. A
+ * full queue is flushed first: order is kept, only the batch is smaller */
+static void submit(const visu_cmd_t *cmd) {
+    if (visu_state.bands == 0) {
+        raster(cmd, target(), visu_state.pitch, INT_MIN, INT_MAX);
+        return;
+    }
+    if (visu_state.count == VISU_QUEUE_SIZE) {
+        visu_state.overflows++;
+        visu_flush();
+    }
+    visu_state.cmds[visu_state.count++] = *cmd;
+}
+
+static void band_job(void *data, int band) {
+    (void)data;
+    int r0 = visu_state.band_y0 + band * visu_state.band_rows;
+    int r1 = r0 + visu_state.band_rows;
+    for (int i = visu_state.bin_start[band]; i < visu_state.bin_start[band + 1]; i++) {
+        raster(&visu_state.cmds[visu_state.bins[i]], visu_state.band_target, visu_state.band_pitch, r0, r1);
+    }
+}
+
+void visu_set_bands(int bands) {
+    visu_flush();
+    if (bands < 0) {
+        bands = 0;
+    }
+    if (bands > VISU_MAX_BANDS) {
+        bands = VISU_MAX_BANDS;
+    }
+    if (visu_state.overflows > 0) {
+        printf("[visu] Band queue filled %d times, flushed early (VISU_QUEUE_SIZE %d)\n",
+               visu_state.overflows, VISU_QUEUE_SIZE);
+        visu_state.overflows = 0;
+    }
+
+    free(visu_state.cmds);
+    free(visu_state.bins);
+    visu_state.cmds = NULL;
+    visu_state.bins = NULL;
+    visu_state.bands = 0;
+    if (bands == 0) {
+        return;
+    }
+    visu_state.cmds = malloc((size_t)VISU_QUEUE_SIZE * sizeof(*visu_state.cmds));
+    visu_state.bins = malloc((size_t)VISU_QUEUE_SIZE * (size_t)bands * sizeof(*visu_state.bins));
+    if (!visu_state.cmds || !visu_state.bins) {
+        fprintf(stderr, "VISU: ERROR Cannot reserve the band queue, drawing immediately\n");
+        free(visu_state.cmds);
+        free(visu_state.bins);
+        visu_state.cmds = NULL;
+        visu_state.bins = NULL;
+        return;
+    }
+    visu_state.bands = bands;
+}
+
+void visu_flush(void) {
+    int count = visu_state.count;
+    if (count == 0) {
+        return;
+    }
+    visu_state.count = 0;
+
+    /* Bands split the rows this batch touches, not the whole page */
+    int y0 = visu_state.cmds[0].y0;
+    int y1 = visu_state.cmds[0].y1;
+    for (int i = 1; i < count; i++) {
+        y0 = visu_state.cmds[i].y0 < y0 ? visu_state.cmds[i].y0 : y0;
+        y1 = visu_state.cmds[i].y1 > y1 ? visu_state.cmds[i].y1 : y1;
+    }
+    int rows = (y1 - y0 + visu_state.bands - 1) / visu_state.bands;
+    rows = rows < VISU_BAND_MIN_ROWS ? VISU_BAND_MIN_ROWS : rows;
+    int bands = (y1 - y0 + rows - 1) / rows;
+
+    /* Bin in submission order: count per band, prefix sum, fill */
+    int fill[VISU_MAX_BANDS];
+    memset(fill, 0, sizeof(fill));
+    for (int i = 0; i < count; i++) {
+        int b0 = (visu_state.cmds[i].y0 - y0) / rows;
+        int b1 = (visu_state.cmds[i].y1 - 1 - y0) / rows;
+        for (int b = b0; b <= b1; b++) {
+            fill[b]++;
+        }
+    }
+    visu_state.bin_start[0] = 0;
+    for (int b = 0; b < bands; b++) {
+        visu_state.bin_start[b + 1] = visu_state.bin_start[b] + fill[b];
+        fill[b] = visu_state.bin_start[b];
+    }
+    for (int i = 0; i < count; i++) {
+        int b0 = (visu_state.cmds[i].y0 - y0) / rows;
+        int b1 = (visu_state.cmds[i].y1 - 1 - y0) / rows;
+        for (int b = b0; b <= b1; b++) {
+            visu_state.bins[fill[b]++] = i;
+        }
+    }
+
+    visu_state.band_y0 = y0;
+    visu_state.band_rows = rows;
+    visu_state.band_target = target();
+    visu_state.band_pitch = visu_state.pitch;
+    jobs_run(band_job, NULL, bands);
+}
+
+/* Drawing */
+
+void visu_poly(const visu_vertex_t *vertices, int sides, int mode, uint8_t color) {
+    visu_vertex_t buffers[2][VISU_CLIP_SIDES];
+    const visu_vertex_t *v;
+
+    if (sides < 3 || sides > VISU_MAX_SIDES) {
+        return;
+    }
+    visu_span_init();
+    sides = clip_poly(vertices, sides, buffers, &v);
+    if (sides < 3) {
+        return;
+    }
+
+    visu_cmd_t cmd;
+    cmd.line = 0;
+    cmd.mode = (uint8_t)mode;
+    cmd.color = color;
+    cmd.sides = (uint8_t)sides;
+    cmd.y0 = v[0].y;
+    cmd.y1 = v[0].y;
+    for (int i = 1; i < sides; i++) {
+        cmd.y0 = v[i].y < cmd.y0 ? v[i].y : cmd.y0;
+        cmd.y1 = v[i].y > cmd.y1 ? v[i].y : cmd.y1;
+    }
+    if (cmd.y0 == cmd.y1) {
+        return;
+    }
+    memcpy(cmd.v, v, (size_t)sides * sizeof(*v));
+    submit(&cmd);
+}
+
+void visu_line(int x0, int y0, int x1, int y1, uint8_t color) {
+    visu_cmd_t cmd;
+    cmd.line = 1;
+    cmd.mode = 0;
+    cmd.color = color;
+    cmd.sides = 2;
+    cmd.v[0] = (visu_vertex_t){ (int16_t)x0, (int16_t)y0, 0 };
+    cmd.v[1] = (visu_vertex_t){ (int16_t)x1, (int16_t)y1, 0 };
+    cmd.window[0] = (int16_t)visu_state.clip_x0;
+    cmd.window[1] = (int16_t)visu_state.clip_y0;
+    cmd.window[2] = (int16_t)visu_state.clip_x1;
+    cmd.window[3] = (int16_t)visu_state.clip_y1;
+
+    /* Rows the line can write, for binning */
+    int top = y0 < y1 ? y0 : y1;
+    int bottom = y0 < y1 ? y1 : y0;
+    top = top > visu_state.clip_y0 ? top : visu_state.clip_y0;
+    bottom = bottom < visu_state.clip_y1 ? bottom : visu_state.clip_y1;
+    if (top > bottom) {
+        return;
+    }
+    cmd.y0 = (int16_t)top;
+    cmd.y1 = (int16_t)(bottom + 1);
+    submit(&cmd);
+}
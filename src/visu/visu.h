@@ -0,0 +1,130 @@
+/**
+ * VISU - Shared polygon and line rasterizer for the 3D parts
+ *
+ * Replaces the original VISU library fill code (ADRAW.ASM, ADRAWCLP.ASM,
+ * AVIDFILL.ASM) used by 3DS, GLENZ, the city flyby and others. Polygons
+ * are clipped against the window, walked from the top vertex with the
+ * original 16.16 edge stepping, and filled with the spans in visu_span.c.
+ *
+ * Fill conventions follow the originals: every edge is stepped once
+ * before its first row, the bottom row and the rightmost pixel of each
+ * span are not drawn, and vertex order may be either winding.
+ *
+ * Drawing goes into the video framebuffer (or a caller-set target) at
+ * VIDEO_WIDTH bytes per line, or the caller's pitch for supersampled
+ * targets (video_get_hires_framebuffer()). Parts using VIDEO_DIRTY_EXPLICIT mark the
+ * rows they drew themselves. Main thread only.
+ *
+ * With bands enabled, clipped polygons and lines are queued instead and
+ * binned into horizontal screen bands at visu_flush(), one job pool task
+ * per band. Bands keep submission order and step edges exactly as the
+ * immediate path, so frames are identical with any band or thread count.
+ */
+
+#ifndef VISU_H
+#define VISU_H
+
+#include <stdint.h>
+
+/* Most sides in a polygon passed to visu_poly() (MAXPOLYSIDES) */
+#define VISU_MAX_SIDES 16
+
+/* Most screen bands a flush is split into, and the split used per pool
+ * thread (more bands than threads lets idle threads steal the rest) */
+#define VISU_MAX_BANDS 64
+#define VISU_BANDS_PER_THREAD 4
+
+/* Polygons and lines queued between flushes with bands enabled */
+#define VISU_QUEUE_SIZE 1024
+
+/* Fill modes */
+#define VISU_FILL_FLAT      0   /* Solid color */
+#define VISU_FILL_GOURAUD   1   /* Vertex colors interpolated (8.8 fixed point) */
+#define VISU_FILL_GLENZ     2   /* Color ORed into the pixels (transparent layers) */
+
+/**
+ * Polygon vertex in screen coordinates
+ */
+typedef struct {
+    int16_t x;
+    int16_t y;
+    uint16_t color;     /* Gouraud color, 8.8 fixed point (color << 8) */
+} visu_vertex_t;
+
+/**
+ * Reset the target to the video framebuffer and the window to the
+ * original 320x200 projection clip (0,0)-(319,199).
+ */
+void visu_init(void);
+
+/**
+ * Set the buffer polygons and lines are drawn into.
+ * @param pixels Start of the page, VIDEO_WIDTH bytes per line, or NULL
+ *               for video_get_framebuffer()
+ */
+void visu_set_target(uint8_t *pixels);
+
+/**
+ * Set the buffer polygons and lines are drawn into, with its line pitch.
+ * For a supersampled part: the hi-res framebuffer at VIDEO_WIDTH * scale,
+ * with the window and vertices in hi-res coordinates.
+ * @param pixels Start of the page, or NULL for video_get_framebuffer()
+ * @param pitch Bytes per line
+ */
+void visu_set_target_pitch(uint8_t *pixels, int pitch);
+
+/**
+ * Draw polygons and lines in horizontal bands on the job pool.
+ * Queued drawing lands in the target only at visu_flush(), so flush
+ * before reading or writing the pixels directly. Changing the target or
+ * the band count flushes first.
+ * The queue (VISU_QUEUE_SIZE commands and their band bins) is reserved
+ * here, so drawing never allocates. A frame drawing more flushes early
+ * whenever the queue fills; its pixels are the same. The next call
+ * reports how often that happened.
+ * @param bands Bands per flush (0 draws immediately, the default;
+ *              clamped to VISU_MAX_BANDS)
+ */
+void visu_set_bands(int bands);
+
+/**
+ * Draw everything queued since the last flush (no-op without bands).
+ * The frame loop flushes after each part's render.
+ */
+void visu_flush(void);
+
+/**
+ * Set the clip window (vid_window / projclip), inclusive on both ends.
+ * @param x0 Left edge
+ * @param y0 Top edge
+ * @param x1 Right edge
+ * @param y1 Bottom edge
+ */
+void visu_window(int x0, int y0, int x1, int y1);
+
+/**
+ * Clip and fill a convex polygon.
+ * @param vertices Vertices in either winding
+ * @param sides Number of vertices (3..VISU_MAX_SIDES; fewer draws nothing)
+ * @param mode VISU_FILL_FLAT, VISU_FILL_GOURAUD or VISU_FILL_GLENZ
+ * @param color Palette index for flat and glenz fills (unused for gouraud)
+ */
+void visu_poly(const visu_vertex_t *vertices, int sides, int mode, uint8_t color);
+
+/**
+ * Draw a line, both end points included, clipped to the window.
+ * @param x0 Start X
+ * @param y0 Start Y
+ * @param x1 End X
+ * @param y1 End Y
+ * @param color Palette index
+ */
+void visu_line(int x0, int y0, int x1, int y1, uint8_t color);
+
+/**
+ * Get the name of the span kernels in use ("scalar", "sse2", "neon", "simd128").
+ * @return Static kernel name
+ */
+const char *visu_get_span_kernel(void);
+
+#endif /* VISU_H */
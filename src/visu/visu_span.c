@@ -0,0 +1,201 @@
+/**
+ * VISU Span Kernels - Implementation
+ *
+ * The scalar loops are the reference. SIMD kernels are compiled in when
+ * the target supports them and picked in visu_span_init():
+ * - SSE2 (all x86-64): 16 pixels per step, 8.8 colors in 16-bit lanes
+ * - NEON (AArch64): the same with narrowing shifts
+ * - wasm SIMD128: the same with saturating narrows
+ *
+ * Flat spans are plain memset(), which every C library already
+ * vectorizes. Define SR_VISU_NO_SIMD to build only the scalar kernels.
+ */
+
+#include "visu_span.h"
+#include <string.h>
+
+#if !defined(SR_VISU_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VISU_SPAN_X86 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VISU_SPAN_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define VISU_SPAN_WASM 1
+#include <wasm_simd128.h>
+#endif
+#endif /* SR_VISU_NO_SIMD */
+
+/* Selected kernels */
+static struct {
+    visu_span_gouraud_fn gouraud;
+    visu_span_glenz_fn glenz;
+    const char *name;
+    int initialized;
+} span_state = { visu_span_gouraud_scalar, visu_span_glenz_scalar, "scalar", 0 };
+
+void visu_span_gouraud_scalar(uint8_t *dst, int count, uint16_t color, int16_t step) {
+    for (int i = 0; i < count; i++) {
+        dst[i] = (uint8_t)(color >> 8);
+        color = (uint16_t)(color + step);
+    }
+}
+
+void visu_span_glenz_scalar(uint8_t *dst, int count, uint8_t color) {
+    for (int i = 0; i < count; i++) {
+        dst[i] |= color;
+    }
+}
+
+#if defined(VISU_SPAN_X86)
+
+static void visu_span_gouraud_sse2(uint8_t *dst, int count, uint16_t color, int16_t step) {
+    int i = 0;
+    if (count >= 16) {
+        __m128i ramp = _mm_mullo_epi16(_mm_set1_epi16(step), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+        __m128i c0 = _mm_add_epi16(_mm_set1_epi16((short)color), ramp);
+        __m128i c1 = _mm_add_epi16(c0, _mm_set1_epi16((short)(step * 8)));
+        __m128i inc = _mm_set1_epi16((short)(step * 16));
+        for (; i + 16 <= count; i += 16) {
+            __m128i px = _mm_packus_epi16(_mm_srli_epi16(c0, 8), _mm_srli_epi16(c1, 8));
+            _mm_storeu_si128((__m128i *)(dst + i), px);
+            c0 = _mm_add_epi16(c0, inc);
+            c1 = _mm_add_epi16(c1, inc);
+        }
+    }
+    visu_span_gouraud_scalar(dst + i, count - i, (uint16_t)(color + i * step), step);
+}
+
+static void visu_span_glenz_sse2(uint8_t *dst, int count, uint8_t color) {
+    __m128i c = _mm_set1_epi8((char)color);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(px, c));
+    }
+    visu_span_glenz_scalar(dst + i, count - i, color);
+}
+
+#elif defined(VISU_SPAN_NEON)
+
+static void visu_span_gouraud_neon(uint8_t *dst, int count, uint16_t color, int16_t step) {
+    static const uint16_t lanes[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    int i = 0;
+    if (count >= 16) {
+        uint16x8_t c0 = vmlaq_n_u16(vdupq_n_u16(color), vld1q_u16(lanes), (uint16_t)step);
+        uint16x8_t c1 = vaddq_u16(c0, vdupq_n_u16((uint16_t)(step * 8)));
+        uint16x8_t inc = vdupq_n_u16((uint16_t)(step * 16));
+        for (; i + 16 <= count; i += 16) {
+            vst1q_u8(dst + i, vcombine_u8(vshrn_n_u16(c0, 8), vshrn_n_u16(c1, 8)));
+            c0 = vaddq_u16(c0, inc);
+            c1 = vaddq_u16(c1, inc);
+        }
+    }
+    visu_span_gouraud_scalar(dst + i, count - i, (uint16_t)(color + i * step), step);
+}
+
+static void visu_span_glenz_neon(uint8_t *dst, int count, uint8_t color) {
+    uint8x16_t c = vdupq_n_u8(color);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(dst + i, vorrq_u8(vld1q_u8(dst + i), c));
+    }
+    visu_span_glenz_scalar(dst + i, count - i, color);
+}
+
+#elif defined(VISU_SPAN_WASM)
+
+static void visu_span_gouraud_simd128(uint8_t *dst, int count, uint16_t color, int16_t step) {
+    int i = 0;
+    if (count >= 16) {
+        v128_t ramp = wasm_i16x8_mul(wasm_i16x8_splat(step), wasm_i16x8_make(0, 1, 2, 3, 4, 5, 6, 7));
+        v128_t c0 = wasm_i16x8_add(wasm_i16x8_splat((int16_t)color), ramp);
+        v128_t c1 = wasm_i16x8_add(c0, wasm_i16x8_splat((int16_t)(step * 8)));
+        v128_t inc = wasm_i16x8_splat((int16_t)(step * 16));
+        for (; i + 16 <= count; i += 16) {
+            v128_t px = wasm_u8x16_narrow_i16x8(wasm_u16x8_shr(c0, 8), wasm_u16x8_shr(c1, 8));
+            wasm_v128_store(dst + i, px);
+            c0 = wasm_i16x8_add(c0, inc);
+            c1 = wasm_i16x8_add(c1, inc);
+        }
+    }
+    visu_span_gouraud_scalar(dst + i, count - i, (uint16_t)(color + i * step), step);
+}
+
+static void visu_span_glenz_simd128(uint8_t *dst, int count, uint8_t color) {
+    v128_t c = wasm_u8x16_splat(color);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        wasm_v128_store(dst + i, wasm_v128_or(wasm_v128_load(dst + i), c));
+    }
+    visu_span_glenz_scalar(dst + i, count - i, color);
+}
+
+#endif
+
+#ifndef NDEBUG
+/* Compare the selected kernels against the scalar reference. Steep
+ * negative steps wrap the 16-bit color; odd lengths exercise the tails. */
+static int span_self_test(void) {
+    static uint8_t expect[333];
+    static uint8_t got[333];
+    static const int16_t steps[] = { 0, 37, -37, 256, -700, 32767 };
+
+    for (int s = 0; s < (int)(sizeof(steps) / sizeof(steps[0])); s++) {
+        span_state.gouraud(got, (int)sizeof(got), 0x1280, steps[s]);
+        visu_span_gouraud_scalar(expect, (int)sizeof(expect), 0x1280, steps[s]);
+        if (memcmp(expect, got, sizeof(expect)) != 0) {
+            return 0;
+        }
+    }
+    for (int i = 0; i < (int)sizeof(got); i++) {
+        expect[i] = got[i] = (uint8_t)(i * 7 + (i >> 3));
+    }
+    span_state.glenz(got + 1, (int)sizeof(got) - 2, 0x40);
+    visu_span_glenz_scalar(expect + 1, (int)sizeof(expect) - 2, 0x40);
+    return memcmp(expect, got, sizeof(expect)) == 0;
+}
+#endif
+
+void visu_span_init(void) {
+    if (span_state.initialized) {
+        return;
+    }
+    span_state.initialized = 1;
+
+#if defined(VISU_SPAN_X86)
+    span_state.gouraud = visu_span_gouraud_sse2;
+    span_state.glenz = visu_span_glenz_sse2;
+    span_state.name = "sse2";
+#elif defined(VISU_SPAN_NEON)
+    span_state.gouraud = visu_span_gouraud_neon;
+    span_state.glenz = visu_span_glenz_neon;
+    span_state.name = "neon";
+#elif defined(VISU_SPAN_WASM)
+    span_state.gouraud = visu_span_gouraud_simd128;
+    span_state.glenz = visu_span_glenz_simd128;
+    span_state.name = "simd128";
+#endif
+
+#ifndef NDEBUG
+    if (!span_self_test()) {
+        span_state.gouraud = visu_span_gouraud_scalar;
+        span_state.glenz = visu_span_glenz_scalar;
+        span_state.name = "scalar";
+    }
+#endif
+}
+
+void visu_span_gouraud(uint8_t *dst, int count, uint16_t color, int16_t step) {
+    span_state.gouraud(dst, count, color, step);
+}
+
+void visu_span_glenz(uint8_t *dst, int count, uint8_t color) {
+    span_state.glenz(dst, count, color);
+}
+
+const char *visu_span_name(void) {
+    return span_state.name;
+}
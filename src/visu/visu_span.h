@@ -0,0 +1,54 @@
+/**
+ * VISU Span Kernels - Horizontal span writers for the polygon filler
+ *
+ * Internal to the visu library. Provides the scalar reference spans plus
+ * SIMD variants selected at build time (SSE2, NEON, wasm SIMD128). Every
+ * kernel produces output bit-identical to the scalar loop.
+ */
+
+#ifndef VISU_SPAN_H
+#define VISU_SPAN_H
+
+#include <stdint.h>
+
+/**
+ * Gouraud span: dst[i] = (uint16_t)(color + i * step) >> 8.
+ * Color and step are 8.8 fixed point and wrap at 16 bits like the
+ * original AVIDFILL.ASM register arithmetic.
+ */
+typedef void (*visu_span_gouraud_fn)(uint8_t *dst, int count, uint16_t color, int16_t step);
+
+/**
+ * Glenz span: dst[i] |= color (transparent layers in separate color bits).
+ */
+typedef void (*visu_span_glenz_fn)(uint8_t *dst, int count, uint8_t color);
+
+/**
+ * Select the SIMD kernels supported by this build.
+ * Safe to call more than once.
+ */
+void visu_span_init(void);
+
+/**
+ * Write a gouraud span with the selected kernel.
+ */
+void visu_span_gouraud(uint8_t *dst, int count, uint16_t color, int16_t step);
+
+/**
+ * Write a glenz span with the selected kernel.
+ */
+void visu_span_glenz(uint8_t *dst, int count, uint8_t color);
+
+/**
+ * Scalar reference kernels. Always available.
+ */
+void visu_span_gouraud_scalar(uint8_t *dst, int count, uint16_t color, int16_t step);
+void visu_span_glenz_scalar(uint8_t *dst, int count, uint8_t color);
+
+/**
+ * Get the name of the selected kernels ("scalar", "sse2", "neon", "simd128").
+ * @return Static kernel name
+ */
+const char *visu_span_name(void);
+
+#endif /* VISU_SPAN_H */